@@ -50,6 +50,7 @@ endif ()
 
 #add_definitions (-DSGE_DEBUG_MODE)
 #add_definitions (-DSGE_PROFILING_MODE)
+#add_definitions (-DSGE_ALLOCATION_TRACKING)
 
 ################################################################################
 
@@ -62,3 +63,23 @@ foreach (_source IN ITEMS ${SOURCE_LIST})
 endforeach ()
 
 target_link_libraries (sge Vulkan::Vulkan imgui)
+
+################################################################################
+
+# Packs the compiled shaders (see res.py) into a single archive next to them, see sge_archive.hh & pak.py.
+find_package (PythonInterp 3)
+if (PYTHONINTERP_FOUND)
+
+if (G_TARGET STREQUAL "MACOSX")
+set (SGEPAK_DIR ${CMAKE_BINARY_DIR}/Debug)
+else ()
+set (SGEPAK_DIR ${CMAKE_BINARY_DIR})
+endif ()
+
+add_custom_target (sgepak
+    COMMAND ${PYTHON_EXECUTABLE} ${CMAKE_CURRENT_SOURCE_DIR}/${G_ROOT_DIR}/pak.py --compress --include "*.spv" ${SGEPAK_DIR}/sge.sgepak ${SGEPAK_DIR}
+    WORKING_DIRECTORY ${SGEPAK_DIR}
+    COMMENT "Packing shaders into sge.sgepak"
+    VERBATIM)
+
+endif ()
@@ -74,6 +74,7 @@ void initialise () {
     ubo_settings.display_mode = 0;
 
     computation.shader_path = "raymarching.comp.spv";
+    computation.workgroup_size_ids = std::make_pair (0u, 1u);
     computation.push_constants = std::optional<sge::dataspan> ({ &push, sizeof (PUSH) });
     computation.uniforms = {
         sge::dataspan { &ubo_camera, sizeof (UBO_CAMERA) },
@@ -90,6 +90,9 @@ void initialise () {
     sbo_planes.push_back(newPlane(sge::math::vector3 { 1.0f, 0.0f, 0.0f }, roomDim, sge::math::vector3 { 0.0f, 1.0f, 0.0f }, 32.0f));
 
     computation.shader_path = "raytracing.comp.spv";
+    //computation.shader_defines = { { "RAYBOUNCES", "4" }, { "REFLECTIONS", "true" } }; // variants are compiled at runtime from raytracing.comp (needs the Vulkan SDK).
+    //computation.specializations = { { "16x16" }, { "8x8", {}, 8, 8 } }; // with `layout (local_size_x_id = 0, local_size_y_id = 1) in;` in raytracing.comp, switched between with system_int_state::specialization.
+    //computation.workgroup_size_ids = std::make_pair (0u, 1u);
     computation.push_constants = std::optional<sge::dataspan> ({ &push, sizeof (PUSH) });
     computation.uniforms = { sge::dataspan { &ubo, sizeof (UBO) }, };
     computation.blobs = {
@@ -0,0 +1,104 @@
+import sys
+
+if sys.version_info <= (3, 0):
+    sys.stdout.write("Requires Python 3.x\n")
+    sys.exit(1)
+
+# Packs files into a .sgepak archive, see src/sge_archive.hh for the format.
+#   python3 pak.py [--compress] [--include PATTERN]... OUTPUT INPUT...
+# Directories are packed recursively, their files named by their paths relative to the directory; other inputs are
+# named by their file names. With --compress entries are stored as LZ4 blocks where that makes them smaller (this needs
+# the lz4 module, without which everything is stored as it is).
+
+import argparse
+import fnmatch
+import os
+import struct
+
+alignment = 64
+version = 1
+flag_lz4 = 1
+header_format = '<8sIIQQQ'
+toc_entry_format = '<QQQQIIII'
+
+def hash_fnv1a (data):
+    h = 14695981039346656037
+    for b in data:
+        h ^= b
+        h = (h * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+def align (offset):
+    return (offset + alignment - 1) // alignment * alignment
+
+def gather (inputs, patterns):
+    files = {}
+    for path in inputs:
+        if os.path.isdir (path):
+            for root, _, names in os.walk (path):
+                for name in names:
+                    full = os.path.join (root, name)
+                    files[os.path.relpath (full, path).replace (os.sep, '/')] = full
+        else:
+            files[os.path.basename (path)] = path
+    if patterns:
+        files = { k: v for k, v in files.items () if any (fnmatch.fnmatch (k, p) for p in patterns) }
+    return files
+
+def main ():
+    parser = argparse.ArgumentParser (description = 'Packs files into a .sgepak archive.')
+    parser.add_argument ('--compress', action = 'store_true', help = 'store entries as LZ4 blocks where that makes them smaller')
+    parser.add_argument ('--include', action = 'append', default = [], help = 'only pack names matching this pattern (repeatable)')
+    parser.add_argument ('output')
+    parser.add_argument ('inputs', nargs = '+')
+    args = parser.parse_args ()
+
+    compress = None
+    if args.compress:
+        try:
+            import lz4.block
+            compress = lambda data: lz4.block.compress (data, store_size = False)
+        except ImportError:
+            print ("lz4 module not found, entries will be stored uncompressed.")
+
+    files = gather (args.inputs, args.include)
+    names = sorted (files.keys (), key = lambda n: n.encode ('utf-8')) # the archive looks names up by binary search.
+
+    entries = []
+    for name in names:
+        with open (files[name], 'rb') as f:
+            data = f.read ()
+        stored, flags = data, 0
+        if compress and len (data) > 0:
+            packed = compress (data)
+            if len (packed) < len (data):
+                stored, flags = packed, flag_lz4
+        entries.append ((name.encode ('utf-8'), data, stored, flags))
+
+    name_table = b''.join (e[0] for e in entries)
+    toc_offset = align (struct.calcsize (header_format))
+    names_offset = toc_offset + len (entries) * struct.calcsize (toc_entry_format)
+    offset = align (names_offset + len (name_table))
+
+    toc = b''
+    contents = []
+    name_offset = 0
+    for name, data, stored, flags in entries:
+        toc += struct.pack (toc_entry_format, offset, len (stored), len (data), hash_fnv1a (data), name_offset, len (name), flags, 0)
+        contents.append ((offset, stored))
+        name_offset += len (name)
+        offset = align (offset + len (stored))
+
+    with open (args.output, 'wb') as f:
+        f.write (struct.pack (header_format, b'SGEPAK\0\0', version, len (entries), toc_offset, names_offset, len (name_table)))
+        f.write (b'\0' * (toc_offset - f.tell ()))
+        f.write (toc)
+        f.write (name_table)
+        for offset, stored in contents:
+            f.write (b'\0' * (offset - f.tell ()))
+            f.write (stored)
+
+    num_compressed = sum (1 for e in entries if e[3] & flag_lz4)
+    print ("packed " + str (len (entries)) + " entries (" + str (num_compressed) + " compressed) into " + args.output)
+
+main ()
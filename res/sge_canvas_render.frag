@@ -2,12 +2,37 @@
 
 layout (binding = 0) uniform sampler2D samplerColor;
 
+layout (push_constant) uniform Display {
+	int mode; // 0: as is, 1: tonemapped, 2: first channel scaled to grey.
+	float exposure;
+	float range;
+} display;
+
 layout (location = 0) in vec2 inUV;
 
 layout (location = 0) out vec4 outFragColor;
 
+// Narkowicz's fit of the ACES filmic curve.
+vec3 tonemap_aces (vec3 x)
+{
+	return clamp ((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+// the swapchain is UNORM, so linear colour is encoded here.
+vec3 encode_srgb (vec3 x)
+{
+	return mix (12.92 * x, 1.055 * pow (x, vec3 (1.0 / 2.4)) - 0.055, step (0.0031308, x));
+}
+
 void main() 
 {
 	vec2 f = vec2 (inUV.s, 1.0 - inUV.t);
-  	outFragColor = texture(samplerColor, f);
-}
\ No newline at end of file
+	ivec2 size = textureSize (samplerColor, 0);
+	// fetched rather than sampled as linear filtering isn't supported for every output format.
+	vec4 c = texelFetch (samplerColor, clamp (ivec2 (f * size), ivec2 (0), size - 1), 0);
+	if (display.mode == 1)
+		c = vec4 (encode_srgb (tonemap_aces (c.rgb * display.exposure)), 1.0);
+	else if (display.mode == 2)
+		c = vec4 (vec3 (clamp (c.r / display.range, 0.0, 1.0)), 1.0);
+  	outFragColor = c;
+}
@@ -0,0 +1,36 @@
+#version 450
+
+layout (binding = 0) uniform usampler2D samplerValue;
+
+layout (push_constant) uniform Display {
+	int mode; // 3: a colour per value (i.e. for ids), otherwise scaled to grey.
+	float exposure;
+	float range;
+} display;
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+uint hash (uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+void main() 
+{
+	vec2 f = vec2 (inUV.s, 1.0 - inUV.t);
+	ivec2 size = textureSize (samplerValue, 0);
+	uint v = texelFetch (samplerValue, clamp (ivec2 (f * size), ivec2 (0), size - 1), 0).r;
+	if (display.mode == 3) {
+		uint h = hash (v);
+		outFragColor = v == 0u ? vec4 (0.0, 0.0, 0.0, 1.0) : vec4 (vec3 (h & 0xffu, (h >> 8) & 0xffu, (h >> 16) & 0xffu) / 255.0, 1.0);
+	}
+	else
+		outFragColor = vec4 (vec3 (clamp (float (v) / display.range, 0.0, 1.0)), 1.0);
+}
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "sge.hh"
+#include "sge_runtime.hh"
+
+#include <atomic>
+#include <mutex>
+
+// CAPTURE
+//--------------------------------------------------------------------------------------------------------------------//
+
+namespace sge::ext {
+
+// Streams every nth frame of the compute output to disk.
+// * Frames are read back asynchronously into a fixed size queue, each is then encoded by a job (Y4M conversion is also
+//   split across rows) so encoding runs alongside rendering on the engine's worker threads.
+// * Encoded frames are written strictly in order, whichever job finishes them.
+// * When the queue is full the frame is either dropped or the main thread helps encode until there's room.
+// * Assumes an rgba8 output, rows are flipped so files are the right way up (as displayed).
+class capture : public runtime::system {
+public:
+    enum class encoding : int { y4m, raw, qoi }; // a single .y4m or .rgba stream, or numbered .qoi files.
+    enum class policy : int { drop, block };
+
+    capture (runtime::api& z) : runtime::system (z, "Capture") {}
+
+    ~capture () {
+        sge.jobs__wait (encoding_counter);
+        finish ();
+    }
+
+    void start () {
+        if (recording || stopping)
+            return;
+        sge.jobs__wait (encoding_counter); // the last recording's jobs may not have quite finished with the queue.
+        frames.clear ();
+        for (int i = 0; i < std::max (queue_size, 1); ++i)
+            frames.emplace_back (std::make_unique<frame> ());
+        frame_index = 0;
+        next_sequence = 0;
+        next_write = 0;
+        stream_width = stream_height = 0;
+        num_written = 0;
+        num_dropped = 0;
+        recording = true;
+    }
+
+    void stop () {
+        if (recording)
+            stopping = true;
+        recording = false;
+    }
+
+    bool is_recording () const { return recording || stopping; }
+    float get_capture_fps () const { return capture_fps; }
+    uint32_t get_queue_depth () const { return (uint32_t) std::count_if (frames.begin (), frames.end (), [] (const auto& f) { return f->status != frame::available; }); }
+    uint32_t get_queue_size () const { return (uint32_t) frames.size (); }
+    uint64_t get_num_written () const { return num_written; }
+    uint64_t get_num_dropped () const { return num_dropped; }
+
+    // changes to these take effect from the next recording.
+    encoding                            output_encoding = encoding::y4m;
+    policy                              full_policy = policy::drop;
+    int                                 every_nth = 1;
+    int                                 queue_size = 8;
+    int                                 frame_rate = 60; // written to the Y4M header.
+    std::string                         path = "sge_capture";
+
+    virtual void update () override {
+        if (recording && (frame_index++ % (uint64_t) std::max (every_nth, 1)) == 0) {
+            int i = reserve ();
+            if (i < 0 && full_policy == policy::block && !encoding_counter.is_complete ()) {
+                sge.jobs__wait (encoding_counter);
+                i = reserve ();
+            }
+            if (i >= 0)
+                sge.readback__request (0, 0, 0, 0, [this, i] (const runtime::readback_view& v) { deliver (i, v); });
+            else
+                num_dropped++;
+        }
+
+        if (stopping && get_queue_depth () == 0) {
+            finish ();
+            stopping = false;
+        }
+
+        fps_time += sge.timer__get_delta ();
+        if (fps_time >= 1.0f) {
+            const uint64_t written = num_written;
+            capture_fps = (float) (written - fps_written) / fps_time;
+            fps_written = written;
+            fps_time = 0.0f;
+        }
+    }
+
+    virtual void managed_debug_ui () override {
+        if (is_recording ()) {
+            if (ImGui::Button (stopping ? "Finishing..." : "Stop") && recording)
+                stop ();
+        }
+        else {
+            if (ImGui::Button ("Record"))
+                start ();
+            ImGui::Combo ("Encoding", (int*) &output_encoding, "Y4M\0Raw RGBA\0QOI\0");
+            ImGui::Combo ("When full", (int*) &full_policy, "Drop\0Block\0");
+            ImGui::SliderInt ("Every nth", &every_nth, 1, 16);
+            ImGui::SliderInt ("Queue size", &queue_size, 1, 32);
+            ImGui::SliderInt ("Frame rate", &frame_rate, 1, 120);
+        }
+        ImGui::Text ("%.1f FPS, queue %u/%u", capture_fps, get_queue_depth (), get_queue_size ());
+        ImGui::Text ("%llu written, %llu dropped", (unsigned long long) num_written, (unsigned long long) num_dropped);
+    }
+
+private:
+    struct frame {
+        enum status_t { available, requested, encoding };
+        std::atomic<status_t>           status = { available };
+        uint64_t                        sequence = 0;
+        uint32_t                        width = 0, height = 0;
+        std::vector<uint8_t>            pixels; // rgba8, top row first.
+        std::vector<uint8_t>            encoded;
+        bool                            ready = false; // encoded & waiting its turn to be written, guarded by the writer mutex.
+    };
+
+    std::vector<std::unique_ptr<frame>> frames; // only resized whilst not recording, so indices held by callbacks stay valid.
+    jobs::counter                       encoding_counter;
+    std::mutex                          writer_mutex;
+    FILE*                               file = nullptr; // y4m & raw streams.
+
+    bool                                recording = false;
+    bool                                stopping = false; // waiting on frames still in the queue.
+    uint64_t                            frame_index = 0;
+    uint64_t                            next_sequence = 0; // given to the next frame delivered.
+    uint64_t                            next_write = 0; // sequence of the next frame to be written.
+    uint32_t                            stream_width = 0, stream_height = 0;
+
+    std::atomic<uint64_t>               num_written = { 0 };
+    uint64_t                            num_dropped = 0;
+    float                               capture_fps = 0.0f;
+    float                               fps_time = 0.0f;
+    uint64_t                            fps_written = 0;
+
+    int reserve () {
+        for (int i = 0; i < (int) frames.size (); ++i) {
+            if (frames[i]->status == frame::available) {
+                frames[i]->status = frame::requested;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // called on the main thread by the readback.
+    void deliver (int z_index, const runtime::readback_view& z_view) {
+        frame& f = *frames[z_index];
+        if (!z_view.data || z_view.texel_size != 4 || !open (z_view.width, z_view.height)) {
+            f.status = frame::available;
+            num_dropped++;
+            return;
+        }
+
+        f.width = z_view.width;
+        f.height = z_view.height;
+        f.pixels.resize ((size_t) f.width * f.height * 4);
+        const size_t row_size = (size_t) f.width * 4;
+        for (uint32_t y = 0; y < f.height; ++y)
+            memcpy (f.pixels.data () + y * row_size, z_view.data + (size_t) (f.height - 1 - y) * z_view.row_pitch, row_size);
+
+        f.sequence = next_sequence++;
+        f.status = frame::encoding;
+        sge.jobs__run ([this, z_index] () { encode (*frames[z_index]); }, &encoding_counter);
+    }
+
+    // the stream is opened by the first frame as the Y4M header needs its size, later frames must match it.
+    bool open (uint32_t z_width, uint32_t z_height) {
+        if (output_encoding == encoding::qoi || file)
+            return output_encoding == encoding::qoi || (z_width == stream_width && z_height == stream_height);
+        if (z_width == 0 || z_height == 0)
+            return false;
+
+        const std::string file_path = path + (output_encoding == encoding::y4m ? ".y4m" : ".rgba");
+        file = fopen (file_path.c_str (), "wb");
+        if (!file) {
+            sge.tty__log (runtime::log_level::error, L"capture", L"failed to open the capture file");
+            stop ();
+            return false;
+        }
+        if (output_encoding == encoding::y4m)
+            fprintf (file, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 C420jpeg\n", z_width, z_height, frame_rate);
+        stream_width = z_width;
+        stream_height = z_height;
+        return true;
+    }
+
+    void finish () {
+        if (file)
+            fclose (file);
+        file = nullptr;
+    }
+
+    void encode (frame& f) {
+        switch (output_encoding) {
+            case encoding::y4m: encode_y4m (f); break;
+            case encoding::raw: f.encoded.swap (f.pixels); break;
+            case encoding::qoi: encode_qoi (f); break;
+        }
+
+        // frames can finish in any order, whichever job completes the next in sequence writes out all that are ready.
+        std::lock_guard<std::mutex> lock (writer_mutex);
+        f.ready = true;
+        for (bool wrote = true; wrote; ) {
+            wrote = false;
+            for (auto& candidate : frames) {
+                if (candidate->status != frame::encoding || !candidate->ready || candidate->sequence != next_write)
+                    continue;
+                write (*candidate);
+                candidate->ready = false;
+                candidate->status = frame::available;
+                next_write++;
+                num_written++;
+                wrote = true;
+            }
+        }
+    }
+
+    void write (const frame& f) {
+        if (output_encoding == encoding::qoi) {
+            char file_path[512];
+            snprintf (file_path, sizeof (file_path), "%s_%06llu.qoi", path.c_str (), (unsigned long long) f.sequence);
+            if (FILE* qoi = fopen (file_path, "wb")) {
+                fwrite (f.encoded.data (), 1, f.encoded.size (), qoi);
+                fclose (qoi);
+            }
+            return;
+        }
+        if (output_encoding == encoding::y4m)
+            fputs ("FRAME\n", file);
+        fwrite (f.encoded.data (), 1, f.encoded.size (), file);
+    }
+
+    // BT.601 full range (as C420jpeg) with chroma averaged over each 2x2 block, a row of chroma per job range element.
+    void encode_y4m (frame& f) {
+        const uint32_t w = f.width, h = f.height, cw = (w + 1) / 2, ch = (h + 1) / 2;
+        f.encoded.resize ((size_t) w * h + (size_t) cw * ch * 2);
+        uint8_t* y_plane = f.encoded.data ();
+        uint8_t* u_plane = y_plane + (size_t) w * h;
+        uint8_t* v_plane = u_plane + (size_t) cw * ch;
+        const uint8_t* rgba = f.pixels.data ();
+
+        sge.jobs__parallel_for (ch, 0, [=] (uint32_t z_begin, uint32_t z_end) {
+            for (uint32_t cy = z_begin; cy < z_end; ++cy) {
+                for (uint32_t cx = 0; cx < cw; ++cx) {
+                    int r = 0, g = 0, b = 0;
+                    for (uint32_t i = 0; i < 4; ++i) {
+                        const uint32_t x = std::min (cx * 2 + (i & 1), w - 1), y = std::min (cy * 2 + (i >> 1), h - 1);
+                        const uint8_t* p = rgba + ((size_t) y * w + x) * 4;
+                        y_plane[(size_t) y * w + x] = (uint8_t) ((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+                        r += p[0]; g += p[1]; b += p[2];
+                    }
+                    r = (r + 2) >> 2; g = (g + 2) >> 2; b = (b + 2) >> 2;
+                    u_plane[(size_t) cy * cw + cx] = (uint8_t) std::clamp (((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128, 0, 255);
+                    v_plane[(size_t) cy * cw + cx] = (uint8_t) std::clamp (((128 * r - 107 * g - 21 * b + 128) >> 8) + 128, 0, 255);
+                }
+            }
+        });
+    }
+
+    // See: https://qoiformat.org/qoi-specification.pdf
+    void encode_qoi (frame& f) {
+        const uint32_t count = f.width * f.height;
+        f.encoded.clear ();
+        f.encoded.reserve (14 + (size_t) count * 5 + 8);
+        auto push_u32 = [&] (uint32_t v) { for (int s = 24; s >= 0; s -= 8) f.encoded.push_back ((uint8_t) (v >> s)); };
+        f.encoded.insert (f.encoded.end (), { 'q', 'o', 'i', 'f' });
+        push_u32 (f.width);
+        push_u32 (f.height);
+        f.encoded.push_back (4); // channels.
+        f.encoded.push_back (0); // sRGB with linear alpha.
+
+        std::array<uint32_t, 64> index = {};
+        const uint8_t* px = f.pixels.data ();
+        uint8_t prev[4] = { 0, 0, 0, 255 };
+        int run = 0;
+        for (uint32_t i = 0; i < count; ++i, px += 4) {
+            if (memcmp (px, prev, 4) == 0) {
+                if (++run == 62 || i == count - 1) {
+                    f.encoded.push_back ((uint8_t) (0xc0 | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                f.encoded.push_back ((uint8_t) (0xc0 | (run - 1)));
+                run = 0;
+            }
+
+            uint32_t value;
+            memcpy (&value, px, 4);
+            const int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+            if (index[hash] == value) {
+                f.encoded.push_back ((uint8_t) hash);
+            }
+            else {
+                index[hash] = value;
+                if (px[3] == prev[3]) {
+                    const int vr = (int8_t) (px[0] - prev[0]), vg = (int8_t) (px[1] - prev[1]), vb = (int8_t) (px[2] - prev[2]);
+                    const int vg_r = vr - vg, vg_b = vb - vg;
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        f.encoded.push_back ((uint8_t) (0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                    }
+                    else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                        f.encoded.push_back ((uint8_t) (0x80 | (vg + 32)));
+                        f.encoded.push_back ((uint8_t) ((vg_r + 8) << 4 | (vg_b + 8)));
+                    }
+                    else {
+                        f.encoded.insert (f.encoded.end (), { 0xfe, px[0], px[1], px[2] });
+                    }
+                }
+                else {
+                    f.encoded.insert (f.encoded.end (), { 0xff, px[0], px[1], px[2], px[3] });
+                }
+            }
+            memcpy (prev, px, 4);
+        }
+        f.encoded.insert (f.encoded.end (), { 0, 0, 0, 0, 0, 0, 0, 1 });
+    }
+};
+
+}
@@ -33,8 +33,19 @@ struct freecam : public runtime::view {
     constexpr static float LOOK_RATE = 1.20f;
     constexpr static float FAST_LOOK_RATE = 1.70f;
     constexpr static float MOUSE_F = 1.0f / 1.40f; // moving 140% of screen space per second is equivalent to holding a joystick on full
+
+    runtime::ext_handle<ext::keyboard> keyboard_handle;
+    runtime::ext_handle<ext::mouse> mouse_handle;
+    runtime::ext_handle<ext::gamepad> gamepad_handle;
     
-    freecam (const runtime::api& z) : runtime::view (z, "Freecam") {
+    freecam (const runtime::api& z)
+        : runtime::view (z, "Freecam", default_configuration | CONCURRENT_UPDATE)
+        , keyboard_handle (z)
+        , mouse_handle (z)
+        , gamepad_handle (z) {
+        reads<ext::keyboard> ();
+        reads<ext::mouse> ();
+        reads<ext::gamepad> ();
         float y = 4.0f;
         float zx = 6.0f;
         default_position = { zx, y, zx };
@@ -48,9 +59,9 @@ struct freecam : public runtime::view {
 
         const float dt = sge.timer__get_delta ();
 
-        const auto& keyboard = *static_cast <ext::keyboard*> (sge.extension_get (runtime::type_id<ext::keyboard>()));
-        const auto& mouse = *static_cast <ext::mouse*> (sge.extension_get (runtime::type_id<ext::mouse>()));
-        const auto& gamepad = *static_cast <ext::gamepad*> (sge.extension_get (runtime::type_id<ext::gamepad>()));
+        const auto& keyboard = *keyboard_handle;
+        const auto& mouse = *mouse_handle;
+        const auto& gamepad = *gamepad_handle;
         
         if (gamepad.is_button_down(runtime::gamepad_button::dpad_left)) { fov -= dt * FOV_DEBUG_RATE; }
         if (gamepad.is_button_down(runtime::gamepad_button::dpad_right)) {  fov += dt * FOV_DEBUG_RATE; }
@@ -8,10 +8,10 @@ class gamepad : public runtime::view {
 
 public:
 
-    bool is_button_down (runtime::gamepad_button z)             const { return buttons_current.find (z) != buttons_current.end (); }
-    bool is_button_up (runtime::gamepad_button z)               const { return buttons_current.find (z) == buttons_current.end (); }
-    bool was_button_down (runtime::gamepad_button z)            const { return buttons_previous.find (z) != buttons_previous.end (); }
-    bool was_button_up (runtime::gamepad_button z)              const { return buttons_previous.find (z) == buttons_previous.end (); }
+    bool is_button_down (runtime::gamepad_button z)             const { return fixed::contains (buttons_current, z); }
+    bool is_button_up (runtime::gamepad_button z)               const { return !fixed::contains (buttons_current, z); }
+    bool was_button_down (runtime::gamepad_button z)            const { return fixed::contains (buttons_previous, z); }
+    bool was_button_up (runtime::gamepad_button z)              const { return !fixed::contains (buttons_previous, z); }
     bool is_button_just_pressed (runtime::gamepad_button z)     const { return is_button_down (z) && was_button_up (z); }
     bool is_button_just_released (runtime::gamepad_button z)    const { return is_button_up (z) && was_button_down (z); }
     math::vector2 left_stick ()                                 const { auto x = get_analog_control (runtime::gamepad_axis::left_stick_horizontal), y = get_analog_control (runtime::gamepad_axis::left_stick_vertical); return math::vector2{ x, y }; }
@@ -20,22 +20,15 @@ public:
     float right_trigger ()                                      const { return get_analog_control (runtime::gamepad_axis::right_trigger); }
 
 private:
-    std::unordered_set<runtime::gamepad_button> buttons_current;
-    std::unordered_set<runtime::gamepad_button> buttons_previous;
-    std::unordered_map<runtime::gamepad_axis, float> axes_current;
-
-    float get_analog_control (runtime::gamepad_axis z) const {
-        return (axes_current.find (z) != axes_current.end ())
-            ? axes_current.at (z)
-            : 0.0f;
-    }
+    fixed::static_vector<runtime::gamepad_button, (size_t) runtime::gamepad_button::COUNT> buttons_current;
+    fixed::static_vector<runtime::gamepad_button, (size_t) runtime::gamepad_button::COUNT> buttons_previous;
+    fixed::array<float, (size_t) runtime::gamepad_axis::COUNT> axes_current = {};
+
+    float get_analog_control (runtime::gamepad_axis z) const { return axes_current[(size_t) z]; }
 
 public:
 
-    gamepad (const runtime::api& z) : runtime::view (z, "Gamepad") {
-        buttons_current.reserve((size_t) runtime::gamepad_button::COUNT);
-        buttons_previous.reserve((size_t) runtime::gamepad_button::COUNT);
-    }
+    gamepad (const runtime::api& z) : runtime::view (z, "Gamepad", default_configuration | CONCURRENT_UPDATE) {}
 
     virtual void update () override {
         uint32_t sz = 0;
@@ -51,7 +44,7 @@ public:
             sge.input__gamepad_pressed_buttons (&sz, buttons_arr.data());
 
             for (uint32_t i = 0; i < sz; ++i)
-                buttons_current.insert(buttons_arr[i]);
+                buttons_current.push_back (buttons_arr[i]);
         }
 
         { // axes
@@ -63,7 +56,7 @@ public:
             sge.input__gamepad_analogue_axes (&sz, axes_arr_keys.data(), axes_arr_values.data());
 
             for (uint32_t i = 0; i < sz; ++i)
-                axes_current[axes_arr_keys[i]] = axes_arr_values[i];
+                axes_current[(size_t) axes_arr_keys[i]] = axes_arr_values[i];
         }
     }
 
@@ -25,10 +25,13 @@ class gizmo : public runtime::view {
     math::vector3 gizmo_obj_pos = math::vector3 { 0, 0.0f, -1 };
     math::quaternion gizmo_obj_orientation = math::quaternion::identity;
     
-    ext::freecam* freecam;
+    runtime::ext_handle<ext::freecam> freecam;
         
 public:
-    gizmo (const runtime::api& z) : runtime::view (z, "Gizmo", MANAGED_DEBUG_UI | CUSTOM_DEBUG_UI) {
+    gizmo (const runtime::api& z)
+        : runtime::view (z, "Gizmo", MANAGED_DEBUG_UI | CUSTOM_DEBUG_UI | CONCURRENT_UPDATE)
+        , freecam (z) {
+        reads<ext::freecam> ();
         utils::set_flag_at_mask (runtime_state, runtime_flags::CUSTOM_DEBUG_UI_ACTIVE, true);
         if (1) {
             sge::data::get_unit_cube(gizmo_vertices);
@@ -37,13 +40,10 @@ public:
         } else {
             sge::data::get_colourful_cube(gizmo_vertices, gizmo_indices);
         }
-        
-        freecam = static_cast <ext::freecam*> (sge.extension_get (runtime::type_id<ext::freecam>()));
-        
     }
     virtual void update () override {
-        if (!freecam || !freecam->is_active()) {
-            set_active(false);
+        if (!freecam.try_get () || !freecam->is_active()) {
+            request_active (false); // this runs on a worker thread.
             return;
         }
         
@@ -51,7 +51,7 @@ public:
     }
 
     virtual void managed_debug_ui () override {
-        if (!freecam || !freecam->is_active()) return;
+        if (!freecam.try_get () || !freecam->is_active()) return;
         ImGui::Text("cam position (x:%.2f, y:%.2f, z:%.2f)", gizmo_cam_pos.x, gizmo_cam_pos.y, gizmo_cam_pos.z);
         ImGui::Text("cam orientation (i:%.2f, j:%.2f, k:%.2f, u:%.2f)", gizmo_cam_orientation.i, gizmo_cam_orientation.j, gizmo_cam_orientation.k, gizmo_cam_orientation.u);
         ImGui::Text("obj position (x:%.2f, y:%.2f, z:%.2f)", gizmo_obj_pos.x, gizmo_obj_pos.y, gizmo_obj_pos.z);
@@ -139,7 +139,7 @@ public:
     }
     
     virtual void custom_debug_ui () override {
-        if (!freecam || !freecam->is_active()) return;
+        if (!freecam.try_get () || !freecam->is_active()) return;
         ImGui::PushStyleColor (ImGuiCol_WindowBg, ImVec4 (0, 0, 0, 0));
         ImGui::Begin ("Gizmo 3D", NULL,
             ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
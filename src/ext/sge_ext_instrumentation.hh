@@ -1,6 +1,8 @@
 #pragma once
 
 #include "sge.hh"
+#include "sge_runtime.hh"
+#include "sge_ext_capture.hh"
 
 // INSTRUMENTATION
 //--------------------------------------------------------------------------------------------------------------------//
@@ -13,8 +15,11 @@ class instrumentation : public runtime::view {
     float max_fps = 60;
     float min_fps = 30;
 
+    runtime::ext_handle<ext::capture> capture;
+
 public:
-    instrumentation (const runtime::api& z) : runtime::view (z, "Instrumentation") {
+    instrumentation (const runtime::api& z) : runtime::view (z, "Instrumentation", default_configuration | CONCURRENT_UPDATE)
+        , capture (z) {
         for (int i = 0; i < fps_data.size (); ++i) {
             fps_data[i] = 60;
         }
@@ -40,6 +45,11 @@ public:
         char overlay[32];
         sprintf(overlay, "%d FPS", fps ());
         ImGui::PlotLines("", fps_data.data(), fps_data.size (), 0, overlay, min_fps, max_fps, ImVec2(fps_data.size (), 200));
+
+        if (capture->is_recording ()) {
+            ImGui::Text ("Capture: %.1f FPS, queue %u/%u, %llu dropped", capture->get_capture_fps (),
+                capture->get_queue_depth (), capture->get_queue_size (), (unsigned long long) capture->get_num_dropped ());
+        }
     }
 };
 
@@ -9,40 +9,37 @@ class keyboard : public runtime::view {
 
 public:
 
-    bool is_character_down          (wchar_t z)                         const { return characters_current.find (z) != characters_current.end (); }
-    bool is_character_up            (wchar_t z)                         const { return characters_current.find (z) == characters_current.end (); }
-    bool was_character_down         (wchar_t z)                         const { return characters_previous.find (z) != characters_previous.end (); }
-    bool was_character_up           (wchar_t z)                         const { return characters_previous.find (z) == characters_previous.end (); }
+    bool is_character_down          (wchar_t z)                         const { return fixed::contains (characters_current, z); }
+    bool is_character_up            (wchar_t z)                         const { return !fixed::contains (characters_current, z); }
+    bool was_character_down         (wchar_t z)                         const { return fixed::contains (characters_previous, z); }
+    bool was_character_up           (wchar_t z)                         const { return !fixed::contains (characters_previous, z); }
     bool character_just_pressed     (wchar_t z)                         const { return is_character_down (z) && was_character_up (z); }
     bool character_just_released    (wchar_t z)                         const { return is_character_up (z) && was_character_down (z); }
 
-    bool is_key_down                (runtime::keyboard_key z)           const { return keys_current.find (z) != keys_current.end (); }
-    bool is_key_up                  (runtime::keyboard_key z)           const { return keys_current.find (z) == keys_current.end (); }
-    bool was_key_down               (runtime::keyboard_key z)           const { return keys_previous.find (z) != keys_previous.end (); }
-    bool was_key_up                 (runtime::keyboard_key z)           const { return keys_previous.find (z) == keys_previous.end (); }
+    bool is_key_down                (runtime::keyboard_key z)           const { return fixed::contains (keys_current, z); }
+    bool is_key_up                  (runtime::keyboard_key z)           const { return !fixed::contains (keys_current, z); }
+    bool was_key_down               (runtime::keyboard_key z)           const { return fixed::contains (keys_previous, z); }
+    bool was_key_up                 (runtime::keyboard_key z)           const { return !fixed::contains (keys_previous, z); }
     bool key_just_pressed           (runtime::keyboard_key z)           const { return is_key_down (z) && was_key_up (z); }
     bool key_just_released          (runtime::keyboard_key z)           const { return is_key_up (z) && was_key_down (z); }
 
-    bool is_lock_locked             (runtime::keyboard_lock z)          const { return locked_locks.find (z) != locked_locks.end (); }
-    bool is_lock_down               (runtime::keyboard_lock z)          const { return pressed_locks.find (z) != pressed_locks.end (); }
+    bool is_lock_locked             (runtime::keyboard_lock z)          const { return fixed::contains (locked_locks, z); }
+    bool is_lock_down               (runtime::keyboard_lock z)          const { return fixed::contains (pressed_locks, z); }
         
 
 private:
-    std::unordered_set<runtime::keyboard_key> keys_current;
-    std::unordered_set<runtime::keyboard_key> keys_previous;
+    fixed::static_vector<runtime::keyboard_key, (size_t) runtime::keyboard_key::COUNT> keys_current;
+    fixed::static_vector<runtime::keyboard_key, (size_t) runtime::keyboard_key::COUNT> keys_previous;
     
-    std::unordered_set<wchar_t> characters_current;
-    std::unordered_set<wchar_t> characters_previous;
+    fixed::static_vector<wchar_t, (size_t) runtime::keyboard_character::COUNT> characters_current;
+    fixed::static_vector<wchar_t, (size_t) runtime::keyboard_character::COUNT> characters_previous;
     
-    std::unordered_set<runtime::keyboard_lock> pressed_locks;
-    std::unordered_set<runtime::keyboard_lock> locked_locks;
+    fixed::static_vector<runtime::keyboard_lock, (size_t) runtime::keyboard_lock::COUNT> pressed_locks;
+    fixed::static_vector<runtime::keyboard_lock, (size_t) runtime::keyboard_lock::COUNT> locked_locks;
 
 public:
     
-    keyboard (const runtime::api& z) : runtime::view (z, "Keyboard") {
-        keys_current.reserve((size_t) runtime::keyboard_key::COUNT);
-        keys_previous.reserve((size_t) runtime::keyboard_key::COUNT);
-    }
+    keyboard (const runtime::api& z) : runtime::view (z, "Keyboard", default_configuration | CONCURRENT_UPDATE) {}
 
     virtual void update () override {
         uint32_t sz = 0;
@@ -61,7 +58,7 @@ public:
                 sge.input__keyboard_pressed_keys (&sz, keys_arr.data());
                 
                 for (uint32_t i = 0; i < sz; ++i)
-                    keys_current.insert(keys_arr[i]);
+                    keys_current.push_back (keys_arr[i]);
             }
         }
         
@@ -77,7 +74,7 @@ public:
                 sge.input__keyboard_pressed_characters (&sz, chars_arr.data());
                 
                 for (uint32_t i = 0; i < sz; ++i)
-                    characters_current.insert(chars_arr[i]);
+                    characters_current.push_back (chars_arr[i]);
             }
         }
         
@@ -89,14 +86,14 @@ public:
             assert (sz <= locks_arr.size ());
             sge.input__keyboard_pressed_locks (&sz, locks_arr.data());
             for (uint32_t i = 0; i < sz; ++i)
-                pressed_locks.insert(locks_arr[i]);
+                pressed_locks.push_back (locks_arr[i]);
             
             locked_locks.clear ();
             sge.input__keyboard_locked_locks (&sz, nullptr);
             assert (sz <= locks_arr.size ());
             sge.input__keyboard_locked_locks (&sz, locks_arr.data());
             for (uint32_t i = 0; i < sz; ++i)
-                locked_locks.insert(locks_arr[i]);
+                locked_locks.push_back (locks_arr[i]);
         }
         
     }
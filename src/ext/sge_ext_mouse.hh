@@ -10,10 +10,10 @@ public:
 
     enum class proportion { screensize, displaysize };
 
-    bool is_button_down             (runtime::mouse_button z)   const { return buttons_current.find (z) != buttons_current.end (); }
-    bool is_button_up               (runtime::mouse_button z)   const { return buttons_current.find (z) == buttons_current.end (); }
-    bool was_button_down            (runtime::mouse_button z)   const { return buttons_previous.find (z) != buttons_previous.end (); }
-    bool was_button_up              (runtime::mouse_button z)   const { return buttons_previous.find (z) == buttons_previous.end (); }
+    bool is_button_down             (runtime::mouse_button z)   const { return fixed::contains (buttons_current, z); }
+    bool is_button_up               (runtime::mouse_button z)   const { return !fixed::contains (buttons_current, z); }
+    bool was_button_down            (runtime::mouse_button z)   const { return fixed::contains (buttons_previous, z); }
+    bool was_button_up              (runtime::mouse_button z)   const { return !fixed::contains (buttons_previous, z); }
     bool is_button_just_pressed     (runtime::mouse_button z)   const { return is_button_down (z) && was_button_up (z); }
     bool is_button_just_released    (runtime::mouse_button z)   const { return is_button_up (z) && was_button_down (z); }
     math::point2 position           ()                          const { return position_current; }
@@ -28,8 +28,8 @@ public:
     int scrollwheel_delta           ()                          const { return scrollwheel_current - scrollwheel_previous; }
 
 private:
-    std::unordered_set<runtime::mouse_button> buttons_current;
-    std::unordered_set<runtime::mouse_button> buttons_previous;
+    fixed::static_vector<runtime::mouse_button, (size_t) runtime::mouse_button::COUNT> buttons_current;
+    fixed::static_vector<runtime::mouse_button, (size_t) runtime::mouse_button::COUNT> buttons_previous;
 
     bool imgui_wants_mouse_current;
     bool imgui_wants_mouse_previous;
@@ -47,10 +47,7 @@ private:
 
 public:
 
-    mouse (const runtime::api& z) : runtime::view (z, "Mouse") {
-        buttons_current.reserve((size_t) runtime::mouse_button::COUNT);
-        buttons_previous.reserve((size_t) runtime::mouse_button::COUNT);
-    }
+    mouse (const runtime::api& z) : runtime::view (z, "Mouse", default_configuration | CONCURRENT_UPDATE) {}
 
     virtual void update () override {
 
@@ -75,7 +72,7 @@ public:
                 sge.input__mouse_pressed_buttons (&sz, buttons_arr.data());
 
                 for (uint32_t i = 0; i < sz; ++i)
-                    buttons_current.insert(buttons_arr[i]);
+                    buttons_current.push_back (buttons_arr[i]);
             }
         }
 
@@ -34,7 +34,7 @@ public:
             int y = canvas_y + 20;
             int* py = &y;
             const int line_spacing = 14;
-            const std::function<void ()> next_line = [py]() {
+            const auto next_line = [py]() {
                 int yy = *py + line_spacing;
                 *py = yy;
             };
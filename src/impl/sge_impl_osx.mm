@@ -103,12 +103,13 @@ private:
 
     };
 
-    typedef std::variant<attached_event, detached_event, input_event>       event;
+    typedef std::variant<attached_event, detached_event>                    event;
     typedef std::chrono::high_resolution_clock::time_point                  timestamp;
     typedef std::optional<std::pair<IOHIDDeviceRef, device_state>>          connection;
 
     // accessed on hid thread
-    std::queue<event>                                                       event_queue;
+    std::queue<event>                                                       event_queue;    // device changes, guarded by the mutex.
+    sge::fixed::spsc_ring<input_event, 512>                                 input_queue;    // produced on the hid thread, consumed on the main thread.
     std::unordered_map<IOHIDDeviceRef, std::unique_ptr<input_reference>>    input_callback_data;
 
     // local only
@@ -174,6 +175,8 @@ private:
         pthread_mutex_lock (&mutex);
         while (event_queue.size ())
             event_queue.pop();
+        input_event discarded;
+        while (input_queue.pop (discarded)) {}
 
         // having this bit causes `IOHIDManagerClose` to assert... :/
         //for (auto& kvp : input_callback_data) {
@@ -217,9 +220,11 @@ private:
                 event_queue.pop ();
                 if (attached_event* attached = std::get_if<attached_event> (&event)) { add_connection (attached->device); }
                 if (detached_event* detached = std::get_if<detached_event> (&event)) { remove_connection (detached->device); }
-                if (input_event* input = std::get_if<input_event> (&event)) { handle_input_event (input->device, input->identifier_type, input->identifier, input->value); }
             }
             pthread_mutex_unlock (&mutex);
+            input_event input;
+            while (input_queue.pop (input))
+                handle_input_event (input.device, input.identifier_type, input.identifier, input.value);
             last_gamepad_update = now;
         }
     }
@@ -252,7 +257,8 @@ private:
     void handle_input_event (IOHIDDeviceRef device, identifier_type type, int identifier, int value) {
 
         const auto idx = get_connection_index (device);
-        assert (idx.has_value());
+        if (!idx.has_value ())
+            return; // input queued before the device was detached.
         const int index = idx.value();
         assert (connections[index].has_value());
         auto& state = connections[index].value ().second;
@@ -441,24 +447,21 @@ private:
         const IOHIDElementCookie element_cookie = IOHIDElementGetCookie (element);
         const int int_value = IOHIDValueGetIntegerValue (value);
 
-        pthread_mutex_lock (&ir->parent.mutex);
-
-        if (ir->parent.event_queue.size () < 512) {
+        // lock-free, this is the only thread that produces input events.
+        {
             if (ir->info.button_indicies.find (element_cookie) != ir->info.button_indicies.end()) {
                 assert (element_type == kIOHIDElementTypeInput_Button);
                 uint32_t identifier = ir->info.button_indicies.at (element_cookie);
                 auto item = input_event { ir->device, element_cookie, element_type, identifier_type::BUTTON, identifier, int_value };
-                ir->parent.event_queue.push (item);
+                if (!ir->parent.input_queue.push (item)) assert (false); // too many events!
             }
             if (ir->info.axis_indicies.find (element_cookie) != ir->info.axis_indicies.end()) {
                 assert (element_type == kIOHIDElementTypeInput_Axis || element_type == kIOHIDElementTypeInput_Misc);
                 uint32_t identifier = ir->info.axis_indicies.at (element_cookie);
                 auto item = input_event { ir->device, element_cookie, element_type, identifier_type::AXIS, identifier, int_value };
-                ir->parent.event_queue.push (item);
+                if (!ir->parent.input_queue.push (item)) assert (false); // too many events!
             }
         }
-        else assert (false); // too many events!
-        pthread_mutex_unlock (&ir->parent.mutex);
     }
 
 
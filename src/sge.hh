@@ -101,5 +101,10 @@ struct dataspan {
     bool operator != (const dataspan& s) const { return !(*this == s); }
 };
 
+struct byterange {
+    size_t offset;
+    size_t size;
+};
+
 
 }
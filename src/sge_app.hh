@@ -16,7 +16,11 @@ namespace sge::app {
 struct api { // used by an SGE app to interact with SGE
     
     runtime::api& runtime;
-    
+
+private:
+    mutable std::vector<runtime::extension*> extensions; // resolved by ext, indexed by runtime::type_id.
+
+public:
     struct input_container {
         sge::ext::keyboard& keyboard;
         sge::ext::mouse& mouse;
@@ -40,15 +44,15 @@ struct api { // used by an SGE app to interact with SGE
     {
     }
     
+    // resolved once per type, from the thread the app runs on.
     template<typename T>
     T& ext () const {
-        static_assert(std::is_base_of<runtime::extension, T>::value, "T must inherit from extension");
-        size_t id = runtime::type_id <T>();
-        runtime::extension* ext = runtime.extension_get (id);
-        assert (ext);
-        T* ext_t = static_cast <T*> (ext);
-        assert (ext_t);
-        return *ext_t;
+        const size_t id = runtime::type_id<T> ();
+        if (id >= extensions.size ())
+            extensions.resize (id + 1, nullptr);
+        if (!extensions[id])
+            extensions[id] = runtime::ext_handle<T> (runtime).get ();
+        return *static_cast<T*> (extensions[id]);
     }
 };
 
@@ -4,6 +4,7 @@
 
 #include "sge_ext_overlay.hh"
 #include "sge_ext_presentation.hh"
+#include "sge_ext_capture.hh"
 #include "sge_ext_gizmo.hh"
 
 namespace sge::app::internal {
@@ -38,6 +39,7 @@ extensions& get_standard_extensions () {
         };
         standard_extensions->systems = {
             { sge::runtime::type_id<sge::ext::presentation>(), [] (sge::runtime::api& x) { return new sge::ext::presentation (x); }},
+            { sge::runtime::type_id<sge::ext::capture>(), [] (sge::runtime::api& x) { return new sge::ext::capture (x); }},
         };
     }
 
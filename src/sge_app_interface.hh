@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sge.hh"
+#include "sge_fixed.hh"
 
 #include "imgui_ext.hh"
 
@@ -26,6 +27,29 @@ struct configuration {
     int app_height = 360;
     bool enable_console = false;
     bool ignore_os_dpi_scaling = true;
+    std::string archive_path = ""; // a .sgepak (see sge_archive.hh, built by the sgepak target) shaders & data are read from before loose files (unless they are newer), relative paths are looked for beside the executable first, empty uses loose files only.
+    std::string log_path = "sge.log"; // file the engine log is written to, empty disables it.
+    std::string log_database_path = "sge_log"; // base path of the indexed log segments viewed in the log window, empty disables them.
+    int log_database_segments = 8; // maximum number of 16MB log segments kept on disk, the oldest is deleted when exceeded.
+    std::string replay_path = "sge_input.trace"; // input trace written when recording and read when replaying (see Engine > Replay).
+    std::string replay_timings_path = "sge_replay_timings.csv"; // per-frame timings written whilst replaying, empty disables them.
+    bool replay_on_start = false; // replay the input trace from the first frame, for unattended performance comparisons.
+    bool runtime_shader_compilation = false; // compile the shader source at startup even without shader defines, falls back to shader_path if that fails.
+    bool optimise_shaders = true; // run spirv-opt on shaders compiled at runtime (when available).
+    std::string shader_cache_path = "sge_shader_cache"; // directory of shaders compiled at runtime, empty disables caching.
+    bool enable_shader_hot_reload = true; // rebuild the compute pipeline in the background when its shader (or shader source) changes.
+    std::string pipeline_cache_path = "sge_pipeline_cache"; // base path of the on-disk Vulkan pipeline cache (one file per device), empty disables it.
+    std::string device = ""; // name (or part of it) or enumeration index of the device to use, empty picks the best scoring one, the SGE_DEVICE environment variable takes precedence.
+    bool autotune_workgroup_size = false; // time the compute shader with a range of workgroup sizes and use the fastest, needs content.workgroup_size_ids (choices are kept next to the pipeline cache).
+    int autotune_frames = 16; // frames timed for each workgroup size tried.
+    int texture_staging_mb = 64; // host visible memory content textures are streamed through, a chunk of rows at a time.
+    int texture_loader_threads = 2; // worker threads reading content textures from disk.
+    int readback_slots = 3; // readbacks of the compute output that can be in flight at once, beyond this they're dropped.
+    bool split_frame = false; // split the compute output into bands dispatched on every device (needs Vulkan 1.1 & single shader content without a secondary output), composited on the primary one.
+    int allocation_warmup_frames = 300; // frames after which any heap allocation in the frame loop is reported (needs SGE_ALLOCATION_TRACKING).
+    bool log_frame_allocations = false; // log a warning for each frame past warm-up that allocates.
+    bool assert_frame_allocations = false; // assert that no frame past warm-up allocates, for catching regressions in benchmarks.
+    int job_worker_count = -1; // number of job system worker threads in addition to the main thread, -1 uses one per remaining hardware thread.
 
     // todo, this shouldn't live here.
     int adjusted_app_width () const { return app_width; }
@@ -42,13 +66,98 @@ struct configuration {
 //  |void main () {
 //  |    imageStore (output, ivec2 (gl_GlobalInvocationID.xy), vec4 (0, 0, 0, 1));
 //  |}
-// Where the output format is currently fixed in the engine to be rgba8 - more flexibility
-// to be added in due course, i.e. optional depth buffer output and alternative formats.
+// Where the image format qualifier matches the content's output format (rgba8 unless set otherwise, see
+// output_format). Content with a secondary output (i.e. depth or an object id) is also bound that image after the
+// uniforms & blobs.
+// The workgroup size may instead be declared with `layout (local_size_x_id = 100, local_size_y_id = 101) in;` and
+// given per specialization (see workgroup_size_ids).
+
+// Formats of the image the compute shader writes, the canvas shows float formats through a tonemapper (rgba16f &
+// rgba32f) or scaled to grey (r32f), and r32ui either scaled to grey or as a colour per value (for ids). If the device
+// can't write a format the nearest one it can is used in its place, and a warning logged, as such shaders should
+// declare the format their content asks for rather than relying on it.
+enum class output_format { rgba8, rgba16f, rgba32f, r32f, r32ui, rgb10a2 };
+
+// A set of values for the compute shader's specialization constants (`layout (constant_id = N) const int X = 1;`),
+// the pipeline for each set is built once, when first used, and the active set can be switched at runtime with
+// system_int_state::specialization without reloading the shader.
+struct specialization {
+    std::string name = "";
+    std::vector<std::pair<uint32_t, uint32_t>> constants = {}; // (constant_id, value), 32 bit values only: bools as 0/1 and floats as their bit pattern.
+    uint32_t workgroup_size_x = 16; // used to size the dispatch, so must match the shader's local size if it isn't specialized.
+    uint32_t workgroup_size_y = 16;
+};
+
+// Content may instead be a graph of compute passes, each a shader of the form above, connected by transient images and
+// buffers the engine owns. Every pass is bound the output at 0, then the uniforms, blobs & secondary output as usual and
+// then the transient resources it reads followed by those it writes (in the order listed). The engine places the barriers
+// between passes, shares memory between transients whose lifetimes don't overlap and skips passes that contribute
+// nothing to the output.
+enum class transient_format { rgba8, rgba16f, rgba32f, r32f, rg32f, r32ui };
+
+struct transient_image {
+    std::string name = "";
+    transient_format format = transient_format::rgba8;
+    float scale = 1.0f; // of the output's resolution, i.e. 0.5 for a half resolution prepass.
+};
+
+struct transient_buffer {
+    std::string name = "";
+    size_t size = 0; // in bytes, per pixel of the output at `scale` if per_pixel is set.
+    bool per_pixel = false;
+    float scale = 1.0f;
+};
+
+struct compute_pass {
+    std::string name = "";
+    std::string shader_path = ""; // SPIR-V with a 16x16 local size, dispatched over the first image it writes (or the output).
+    std::vector<std::string> reads = {}; // names of transient resources, "output" or "secondary".
+    std::vector<std::string> writes = {};
+};
+
+enum class texture_type { image_2d, image_2d_array, image_3d, cube };
+enum class texture_format { r8, rg8, rgba8, rgba8_srgb, r16f, rgba16f, r32f, rgba32f };
+
+// A sampled image loaded in the background, it reads as zero until it's loaded.
+struct texture_input {
+    std::string path = ""; // raw texels of the first mip level, tightly packed, layer after layer (or slice after slice), cube faces in the order +x, -x, +y, -y, +z, -z.
+    texture_type type = texture_type::image_2d;
+    texture_format format = texture_format::rgba8;
+    uint32_t width = 1;
+    uint32_t height = 1;
+    uint32_t depth = 1; // of 3D textures.
+    uint32_t layers = 1; // of arrays, cubes always have 6 (square) faces.
+    bool mips = true; // generated on the GPU once loaded, if the device can blit the format.
+    bool linear = true; // filtering, otherwise nearest.
+    bool repeat = true; // addressing, otherwise clamped to the edge.
+};
+
+struct streamed_blob {
+    std::string path = ""; // a file that's memory mapped & paged in as the shader asks for it, see sge_vk_blob_streamer.hh.
+    uint32_t page_size = 64 * 1024; // in bytes, a multiple of 4.
+    uint32_t pool_pages = 1024; // how many pages can be resident on the device at once.
+    uint32_t max_loads_per_frame = 64; // pages being read from the file or copied into the pool at once.
+};
+
 struct content {
-    std::string shader_path = "";
+    std::string shader_path = ""; // unused if passes are given.
+    std::string shader_source_path = ""; // optional GLSL source of shader_path for hot reload & runtime compilation, defaults to shader_path without its .spv extension (if that exists).
+    std::vector<std::pair<std::string, std::string>> shader_defines = {}; // if set the shader source is compiled at runtime with these defines (name, value) rather than loading shader_path.
+    std::vector<specialization> specializations = {}; // the first is active at startup, if empty the shader is built unspecialized with a 16x16 workgroup size.
+    std::optional<std::pair<uint32_t, uint32_t>> workgroup_size_ids = {}; // constant ids given each specialization's workgroup size (x, y), for shaders with a specialized local size.
     std::optional<dataspan> push_constants = {};
     std::vector<dataspan> uniforms = {};
+    bool detect_changes = false; // if set uniforms & blobs are compared with copies of what was last uploaded every frame and only what differs is uploaded, so changes needn't be flagged (at the cost of comparing them all on the host).
     std::vector<dataspan> blobs = {}; // todo: change to pair<dataspan, size_t> and make it possible to know the maximum size a blob could be over the full course of the app so we can allocate it on the gpu upfront.  right now when the user changes blob size at runtime the whole sbo is deallocated and reallocated to accomodate.
+    output_format output = output_format::rgba8;
+    std::optional<output_format> secondary_output = {}; // an extra image the size of the output, bound after the blobs.
+    std::vector<streamed_blob> streamed_blobs = {}; // bound after the secondary output, three buffers each (not with passes).
+    std::vector<texture_input> textures = {}; // combined image samplers bound after the streamed blobs (not with passes).
+    float output_exposure = 1.0f; // applied before tonemapping float outputs.
+    float output_range = 1.0f; // the value shown as white when single channel outputs are scaled to grey.
+    std::vector<compute_pass> passes = {}; // run in order, if set these replace shader_path (hot reload, specializations & autotuning only apply to a single shader).
+    std::vector<transient_image> transient_images = {};
+    std::vector<transient_buffer> transient_buffers = {};
 };
 
 struct extensions {
@@ -65,8 +174,15 @@ struct response {
     bool request_shutdown;
     bool push_constants_changed;
     std::vector<bool> uniform_changes;
-    std::vector<std::optional<dataspan>> blob_changes;
-    response (int usz, int bsz): uniform_changes (usz), blob_changes (bsz) {}
+    std::vector<std::optional<dataspan>> blob_changes; // where a changed blob is now, blobs that move or are resized must be flagged (unless the content detects changes).
+    std::vector<fixed::byterange_list> blob_dirty_ranges; // per blob, if any are given only these bytes of a change that keeps the blob's size are uploaded.
+    response (int usz, int bsz): uniform_changes (usz), blob_changes (bsz), blob_dirty_ranges (bsz) {}
+
+    // flags a change to only part of a blob, can be called any number of times a frame.
+    void mark_blob_dirty (int blob, const dataspan& data, size_t offset, size_t size) {
+        blob_changes[blob] = data;
+        blob_dirty_ranges[blob].emplace_back (byterange { offset, size });
+    }
 };
 
 
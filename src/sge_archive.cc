@@ -0,0 +1,246 @@
+#include "sge_archive.hh"
+
+#include "sge_utils.hh"
+
+#if TARGET_MACOSX
+#include <mach-o/dyld.h>
+#elif TARGET_LINUX
+#include <unistd.h>
+#endif
+
+namespace sge::utils {
+
+namespace {
+
+constexpr char magic[8] = { 'S', 'G', 'E', 'P', 'A', 'K', 0, 0 };
+
+std::string find_executable_directory () {
+    char path[4096];
+#if TARGET_WIN32
+    const DWORD length = GetModuleFileNameA (NULL, path, (DWORD) sizeof (path));
+    if (length == 0 || length == sizeof (path))
+        return {};
+#elif TARGET_MACOSX
+    uint32_t size = (uint32_t) sizeof (path);
+    if (_NSGetExecutablePath (path, &size) != 0)
+        return {};
+#elif TARGET_LINUX
+    const ssize_t length = readlink ("/proc/self/exe", path, sizeof (path) - 1);
+    if (length <= 0)
+        return {};
+    path[length] = '\0';
+#endif
+    return std::filesystem::path (path).parent_path ().string ();
+}
+
+}
+
+bool archive::open (const char* z_path) {
+    assert (!is_open ());
+    if (!file.open (z_path, mapped_file::access::read_only))
+        return false;
+
+    // everything the table of contents points at must lie within the file, so lookups needn't check again.
+    const size_t size = file.size ();
+    const header* h = (const header*) file.data ();
+    const bool valid_header = size >= sizeof (header)
+        && memcmp (h->magic, magic, sizeof (magic)) == 0
+        && h->version == current_version
+        && h->toc_offset % alignment == 0
+        && h->toc_offset <= size && (size - h->toc_offset) / sizeof (toc_entry) >= h->num_entries
+        && h->names_offset <= size && size - h->names_offset >= h->names_size;
+    if (!valid_header) {
+        std::cout << "Failed to open archive " << z_path << ", it isn't a version " << current_version << " .sgepak.\n";
+        file.close ();
+        return false;
+    }
+
+    toc = (const toc_entry*) (file.data () + h->toc_offset);
+    names = (const char*) (file.data () + h->names_offset);
+    for (uint32_t i = 0; i < h->num_entries; ++i) {
+        const toc_entry& e = toc[i];
+        const bool valid_entry = e.offset % alignment == 0
+            && e.offset <= size && size - e.offset >= e.stored_size
+            && (uint64_t) e.name_offset + e.name_size <= h->names_size
+            && ((e.flags & flag_lz4) || e.stored_size == e.size)
+            && (i == 0 || get_name (toc[i - 1]) < get_name (e));
+        if (!valid_entry) {
+            std::cout << "Failed to open archive " << z_path << ", entry " << i << " is malformed.\n";
+            close ();
+            return false;
+        }
+    }
+
+    num_entries = h->num_entries;
+    statuses.assign (num_entries, status::unchecked);
+    decompressed.resize (num_entries);
+    return true;
+}
+
+void archive::close () {
+    file.close ();
+    toc = nullptr;
+    names = nullptr;
+    num_entries = 0;
+    statuses.clear ();
+    decompressed.clear ();
+}
+
+std::string_view archive::get_name (const toc_entry& z_entry) const {
+    return std::string_view (names + z_entry.name_offset, z_entry.name_size);
+}
+
+std::optional<dataspan> archive::find (std::string_view z_name) {
+    const toc_entry* const end = toc + num_entries;
+    const toc_entry* e = std::lower_bound (toc, end, z_name, [this] (const toc_entry& x, std::string_view name) { return get_name (x) < name; });
+    if (e == end || get_name (*e) != z_name)
+        return std::nullopt;
+
+    const size_t i = e - toc;
+    if (statuses[i] == status::corrupt)
+        return std::nullopt;
+
+    uint8_t* contents = file.data () + e->offset;
+    if (e->flags & flag_lz4) {
+        if (statuses[i] == status::unchecked) {
+            decompressed[i].resize (e->size);
+            if (!lz4_decompress (contents, e->stored_size, decompressed[i].data (), decompressed[i].size ()))
+                statuses[i] = status::corrupt;
+        }
+        contents = decompressed[i].data ();
+    }
+
+    if (statuses[i] == status::unchecked)
+        statuses[i] = hash_fnv1a (contents, e->size) == e->hash ? status::ok : status::corrupt;
+    if (statuses[i] == status::corrupt) {
+        std::cout << "Archive entry " << z_name << " is corrupt.\n";
+        decompressed[i] = {};
+        return std::nullopt;
+    }
+    return dataspan { contents, e->size };
+}
+
+bool lz4_decompress (const uint8_t* z_src, size_t z_src_size, uint8_t* z_dst, size_t z_dst_size) {
+    const uint8_t* ip = z_src;
+    const uint8_t* const iend = z_src + z_src_size;
+    uint8_t* op = z_dst;
+    uint8_t* const oend = z_dst + z_dst_size;
+
+    // lengths of 15 continue in the bytes that follow, until one isn't 255.
+    const auto read_length = [&] (size_t& length) {
+        if (length != 15)
+            return true;
+        uint8_t b;
+        do {
+            if (ip == iend)
+                return false;
+            b = *ip++;
+            length += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < iend) {
+        const uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (!read_length (literals) || (size_t) (iend - ip) < literals || (size_t) (oend - op) < literals)
+            return false;
+        memcpy (op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == iend)
+            break; // the last sequence has no match.
+
+        if (iend - ip < 2)
+            return false;
+        const size_t offset = (size_t) ip[0] | ((size_t) ip[1] << 8);
+        ip += 2;
+        size_t match = token & 15;
+        if (offset == 0 || offset > (size_t) (op - z_dst) || !read_length (match))
+            return false;
+        match += 4;
+        if ((size_t) (oend - op) < match)
+            return false;
+        const uint8_t* m = op - offset;
+        for (size_t i = 0; i < match; ++i) // byte by byte, as the match can overlap what it's writing.
+            op[i] = m[i];
+        op += match;
+    }
+    return op == oend;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+asset_store::asset_store () : executable_directory (find_executable_directory ()) {}
+
+bool asset_store::open_archive (const char* z_path) {
+    std::lock_guard<std::mutex> lock (mutex);
+    if (packed.is_open ())
+        packed.close ();
+    const std::string path = resolve (z_path);
+    std::error_code error;
+    packed_time = std::filesystem::last_write_time (path, error);
+    return packed.open (path.c_str ());
+}
+
+void asset_store::close () {
+    std::lock_guard<std::mutex> lock (mutex);
+    packed.close ();
+    loose.clear ();
+    replaced.clear ();
+}
+
+std::string asset_store::resolve (const char* z_path) const {
+    const std::filesystem::path path (z_path);
+    if (path.is_absolute () || executable_directory.empty ())
+        return z_path;
+    std::error_code error;
+    const std::filesystem::path beside = std::filesystem::path (executable_directory) / path;
+    return std::filesystem::exists (beside, error) ? beside.string () : std::string (z_path);
+}
+
+std::optional<dataspan> asset_store::get (const char* z_path) {
+    std::lock_guard<std::mutex> lock (mutex);
+    const std::string path = resolve (z_path);
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time (path, error);
+    const bool exists = !error;
+
+    if (packed.is_open () && (!exists || time <= packed_time)) {
+        if (const auto contents = packed.find (z_path); contents.has_value ())
+            return contents;
+    }
+    if (!exists)
+        return std::nullopt;
+
+    auto it = loose.find (path);
+    if (it != loose.end () && (it->second.time != time || it->second.file.size () != std::filesystem::file_size (path, error))) {
+        replaced.emplace_back (replaced_file { std::move (it->second.file), frame });
+        loose.erase (it);
+        it = loose.end ();
+    }
+    if (it == loose.end ()) {
+        loose_file f;
+        if (!f.file.open (path.c_str (), mapped_file::access::read_only))
+            return std::nullopt;
+        f.time = time;
+        it = loose.emplace (path, std::move (f)).first;
+    }
+    return it->second.file.span ();
+}
+
+void asset_store::end_frame () {
+    std::lock_guard<std::mutex> lock (mutex);
+    ++frame;
+    replaced.erase (std::remove_if (replaced.begin (), replaced.end (), [this] (const replaced_file& x) {
+        return frame > x.frame + REPLACED_FRAMES;
+    }), replaced.end ());
+}
+
+asset_store& get_assets () {
+    static asset_store assets;
+    return assets;
+}
+
+}
@@ -0,0 +1,122 @@
+// SGE-ARCHIVE
+// ---------------------------------- //
+// Packed, memory mapped assets.
+// ---------------------------------- //
+// * A .sgepak (built by pak.py, or the sgepak target) holds shaders & app data in a single file: a header, a table of
+//   contents sorted by name, the names & then each entry's contents, all aligned so they're used in place (i.e. as
+//   SPIR-V) straight from the mapping, without being read or copied.
+// * Entries can be compressed (as LZ4 blocks), they're decompressed once, when first asked for, into memory owned by the
+//   archive. Each has an FNV-1a hash of its uncompressed contents, checked when it's first asked for.
+// * Assets that aren't in the archive (or all of them, without one) are read from loose files, which are mapped too, as
+//   are those whose loose file is newer than the archive (i.e. shaders rebuilt or hot reloaded since it was packed).
+// * Relative paths (the archive's included) are looked for beside the executable first, then in the working directory.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_mapped_file.hh"
+
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+
+namespace sge::utils {
+
+class archive {
+public:
+    static constexpr uint32_t   current_version = 1;
+    static constexpr size_t     alignment = 64; // of the table of contents & each entry's contents.
+    static constexpr uint32_t   flag_lz4 = 1; // the entry is compressed.
+
+    struct header {
+        char                    magic[8]; // "SGEPAK\0\0"
+        uint32_t                version;
+        uint32_t                num_entries;
+        uint64_t                toc_offset;
+        uint64_t                names_offset; // names aren't null terminated.
+        uint64_t                names_size;
+    };
+
+    struct toc_entry {
+        uint64_t                offset;
+        uint64_t                stored_size; // in the archive.
+        uint64_t                size; // once decompressed.
+        uint64_t                hash; // FNV-1a of the decompressed contents.
+        uint32_t                name_offset; // into the names.
+        uint32_t                name_size;
+        uint32_t                flags;
+        uint32_t                reserved;
+    };
+
+    static_assert (sizeof (header) == 40 && sizeof (toc_entry) == 48); // must match pak.py.
+
+    bool                        open                (const char* path);
+    void                        close               ();
+
+    bool                        is_open             () const { return file.is_open (); }
+    size_t                      get_num_entries     () const { return num_entries; }
+
+    // an entry's contents, valid until the archive is closed, or nullopt if there's no such entry (or it's corrupt).
+    std::optional<dataspan>     find                (std::string_view name);
+
+private:
+    enum class status : uint8_t { unchecked, ok, corrupt };
+
+    mapped_file                 file;
+    const toc_entry*            toc = nullptr;
+    const char*                 names = nullptr;
+    uint32_t                    num_entries = 0;
+    std::vector<status>         statuses; // per entry.
+    std::vector<std::vector<uint8_t>> decompressed; // per entry, empty unless it's compressed & has been asked for.
+
+    std::string_view            get_name            (const toc_entry&) const;
+};
+
+// LZ4 block decompression, false if the input is malformed or doesn't decompress to exactly the output's size.
+bool lz4_decompress (const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size);
+
+// Where the engine reads shaders from & apps can read data from, safe to use from any thread.
+class asset_store {
+public:
+    static const uint32_t REPLACED_FRAMES = 3; // frames the old contents of a changed loose file stay valid for.
+
+    asset_store ();
+
+    // an archive to look in before loose files, false (after which only loose files are used) if it can't be opened.
+    bool                        open_archive        (const char* path);
+    void                        close               ();
+
+    // the contents of the asset at path (its name in the archive, or a file), valid until the store is closed.
+    // * a loose file that has changed since it was last asked for is mapped again, the old contents stay valid for
+    //   REPLACED_FRAMES more frames (so must be copied by anything that keeps them for longer).
+    std::optional<dataspan>     get                 (const char* path);
+
+    // called by the engine once a frame, unmaps the old contents of changed loose files that have had their frames.
+    void                        end_frame           ();
+
+private:
+    struct loose_file {
+        mapped_file             file;
+        std::filesystem::file_time_type time;
+    };
+
+    struct replaced_file {
+        mapped_file             file;
+        uint64_t                frame; // it was replaced in.
+    };
+
+    const std::string           executable_directory; // empty if it can't be found.
+    std::mutex                  mutex;
+    archive                     packed;
+    std::filesystem::file_time_type packed_time; // of the archive's file.
+    std::unordered_map<std::string, loose_file> loose; // by resolved path, mapped when first asked for.
+    std::vector<replaced_file>  replaced; // loose files that have since changed, kept mapped for whoever still uses them.
+    uint64_t                    frame = 0;
+
+    std::string                 resolve             (const char* path) const;
+};
+
+// the process wide store, whose archive (configuration.archive_path) the engine opens at startup.
+asset_store& get_assets ();
+
+}
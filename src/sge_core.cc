@@ -1,4 +1,7 @@
 #include "sge_core.hh"
+#include "sge_replay.hh"
+#include "sge_memory.hh"
+#include "sge_archive.hh"
 
 #include "sge_app_interface.hh"
 
@@ -23,11 +26,14 @@ bool guid::operator < (const guid& other) const {
 }
 
 guid guid::random () {
-    std::random_device rd;
-    auto seed_data = std::array<int, std::mt19937::state_size> {};
-    std::generate (std::begin (seed_data), std::end (seed_data), std::ref (rd));
-    std::seed_seq seq (std::begin (seed_data), std::end (seed_data));
-    std::mt19937 generator (seq);
+    // seeding is expensive so only do it once per thread.
+    thread_local std::mt19937 generator = [] () {
+        std::random_device rd;
+        auto seed_data = std::array<int, std::mt19937::state_size> {};
+        std::generate (std::begin (seed_data), std::end (seed_data), std::ref (rd));
+        std::seed_seq seq (std::begin (seed_data), std::end (seed_data));
+        return std::mt19937 (seq);
+    } ();
     std::uniform_int_distribution<uint32_t>  distribution;
     guid g;
     for (int i = 0; i < 16; i += 4)
@@ -56,10 +62,117 @@ std::string guid::str () const {
 
 //--------------------------------------------------------------------------------------------------------------------//
 
-api_impl::api_impl (const core::engine_state& z_state, core::engine_tasks& z_tasks, std::unordered_map<size_t, std::unique_ptr<runtime::extension>>& z_exts)
+void extension_registry::add (size_t z_id, runtime::extension* z_extension) {
+    if (z_id >= lookup.size ())
+        lookup.resize (z_id + 1, INVALID_INDEX);
+    assert (lookup[z_id] == INVALID_INDEX); // extensions can only be registered once.
+    lookup[z_id] = extensions.size ();
+    extensions.emplace_back (std::unique_ptr<runtime::extension> (z_extension));
+    ids.emplace_back (z_id);
+    stages.emplace_back (0);
+    update_times.emplace_back (0.0f);
+}
+
+// null if no extension of that type was registered, callers that need it to exist check.
+runtime::extension* extension_registry::get (size_t z_id) const {
+    if (z_id >= lookup.size () || lookup[z_id] == INVALID_INDEX)
+        return nullptr;
+    return extensions[lookup[z_id]].get ();
+}
+
+void extension_registry::sort () {
+    const size_t n = extensions.size ();
+
+    std::vector<std::vector<size_t>> successors (n);
+    std::vector<uint32_t> in_degree (n, 0);
+    std::vector<std::vector<size_t>> writers (n);
+
+    auto add_edge = [&] (size_t from, size_t to) { successors[from].emplace_back (to); in_degree[to]++; };
+    // dependencies on extensions that aren't registered order nothing, those that use them check they exist.
+    auto index_of = [this] (size_t id) { return id < lookup.size () ? lookup[id] : INVALID_INDEX; };
+
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t id : extensions[i]->get_write_dependencies ()) {
+            const size_t target = index_of (id);
+            if (target == INVALID_INDEX)
+                continue;
+            assert (target != i);
+            add_edge (target, i);
+            if (!writers[target].empty ()) // multiple writers of the same extension run in registration order.
+                add_edge (writers[target].back (), i);
+            writers[target].emplace_back (i);
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t id : extensions[i]->get_read_dependencies ()) {
+            const size_t target = index_of (id);
+            if (target == INVALID_INDEX)
+                continue;
+            assert (target != i);
+            add_edge (target, i);
+            for (size_t w : writers[target]) {
+                if (w != i) add_edge (w, i);
+            }
+        }
+    }
+
+    // kahn's algorithm, an extension's stage is one more than that of its latest dependency.
+    std::vector<uint32_t> stage (n, 0);
+    std::vector<size_t> visited;
+    visited.reserve (n);
+    for (size_t i = 0; i < n; ++i) {
+        if (in_degree[i] == 0)
+            visited.emplace_back (i);
+    }
+    for (size_t k = 0; k < visited.size (); ++k) {
+        const size_t i = visited[k];
+        for (size_t j : successors[i]) {
+            stage[j] = std::max (stage[j], stage[i] + 1);
+            if (--in_degree[j] == 0)
+                visited.emplace_back (j);
+        }
+    }
+    assert (visited.size () == n); // cyclic dependencies between extensions.
+
+    std::vector<size_t> order (n);
+    std::iota (order.begin (), order.end (), 0);
+    std::stable_sort (order.begin (), order.end (), [&stage] (size_t a, size_t b) { return stage[a] < stage[b]; });
+
+    std::vector<std::unique_ptr<runtime::extension>> sorted_extensions (n);
+    std::vector<size_t> sorted_ids (n);
+    stage_count = 0;
+    for (size_t k = 0; k < n; ++k) {
+        sorted_extensions[k] = std::move (extensions[order[k]]);
+        sorted_ids[k] = ids[order[k]];
+        stages[k] = stage[order[k]];
+        update_times[k] = 0.0f;
+        lookup[sorted_ids[k]] = k;
+        stage_count = std::max (stage_count, stages[k] + 1);
+    }
+    extensions.swap (sorted_extensions);
+    ids.swap (sorted_ids);
+}
+
+void extension_registry::clear () {
+    // tear down in reverse dependency order.
+    while (!extensions.empty ())
+        extensions.pop_back ();
+    ids.clear ();
+    stages.clear ();
+    update_times.clear ();
+    lookup.clear ();
+    stage_count = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+api_impl::api_impl (const core::engine_state& z_state, core::engine_tasks& z_tasks, const extension_registry& z_exts, jobs::scheduler& z_jobs, logger& z_logger)
     : engine_state (z_state)
     , engine_tasks (z_tasks)
     , engine_extensions (z_exts)
+    , engine_jobs (z_jobs)
+    , engine_logger (z_logger)
 {}
 
 bool api_impl::system__get_state_bool (runtime::system_bool_state z) const {
@@ -78,6 +191,7 @@ int api_impl::system__get_state_int (runtime::system_int_state z) const {
         case runtime::system_int_state::canvas_offset_y: return engine_state.graphics.get_user_viewport_y();
         case runtime::system_int_state::canvas_width: return engine_state.graphics.get_user_viewport_width ();
         case runtime::system_int_state::canvas_height: return engine_state.graphics.get_user_viewport_height ();
+        case runtime::system_int_state::specialization: return engine_state.graphics.compute_target->get_specialization ();
         default: assert (false); return 0;
     }
 }
@@ -346,6 +460,7 @@ void api_impl::system__set_state_int (runtime::system_int_state z, int v) {
     switch (z){
         case runtime::system_int_state::canvas_width: engine_tasks.change_canvas_width = v; break;
         case runtime::system_int_state::canvas_height: engine_tasks.change_canvas_height = v; break;
+        case runtime::system_int_state::specialization: engine_tasks.change_specialization = v; break;
         default: break;
     }
 }
@@ -357,47 +472,29 @@ void api_impl::system__set_state_string (runtime::system_string_state z, const c
     }
 }
 
+void api_impl::readback__request (uint32_t z_x, uint32_t z_y, uint32_t z_width, uint32_t z_height, const runtime::readback_fn& z_callback) {
+    engine_tasks.readback_requests.emplace_back (readback_request { z_x, z_y, z_width, z_height, z_callback });
+}
+
 runtime::extension* api_impl::extension_get  (size_t id) const {
-    assert (engine_extensions.find(id) != engine_extensions.end());
-    runtime::extension* ext = engine_extensions.at(id).get();
-    assert (ext);
-    return ext;
+    return engine_extensions.get (id);
 };
 
 
 void api_impl::tty__log (runtime::log_level level, const wchar_t* channel, const wchar_t* message)  const {
-
-    engine_tasks.new_logs.emplace_back (log{ guid::random (), std::chrono::high_resolution_clock::now (), level, channel, message });
+    engine_logger.submit (level, channel, message);
 }
 
+void api_impl::jobs__run (const jobs::job_fn& z_fn, jobs::counter* z_counter) const { engine_jobs.run (z_fn, z_counter); }
+void api_impl::jobs__parallel_for (uint32_t z_count, uint32_t z_grain, const jobs::range_fn& z_fn) const { engine_jobs.parallel_for (z_count, z_grain, z_fn); }
+void api_impl::jobs__wait (const jobs::counter& z_counter) const { engine_jobs.wait (z_counter); }
+uint32_t api_impl::jobs__get_thread_count () const { return engine_jobs.thread_count (); }
 
+std::optional<dataspan> api_impl::assets__get (const char* z_path) const { return sge::utils::get_assets ().get (z_path); }
 
-//--------------------------------------------------------------------------------------------------------------------//
-
-void engine::process_user_log (const log& z_log) {
-
-    const char* level;
-    switch (z_log.level) {
-        case runtime::log_level::debug: level = "DEBUG"; break;
-        case runtime::log_level::info: level = "INFO"; break;
-        case runtime::log_level::warning: level = "WARN"; break;
-        case runtime::log_level::error: level = "ERROR"; break;
-    };
 
-#if TARGET_WIN32
-    OutputDebugString ("[");
-    OutputDebugString (level);
-    OutputDebugString ("][");
-    OutputDebugStringW (z_log.channel.c_str ());
-    OutputDebugString ("] ");
-    OutputDebugStringW (z_log.message.c_str());
-    OutputDebugString ("\n");
-#else
-    printf ("%lld [%s][%ls] %ls \n", z_log.timestamp.time_since_epoch ().count (), level, z_log.channel.c_str (), z_log.message.c_str ());
-#endif
 
-    // todo: probably want to persist this lot somewhere and also provide access to it.
-}
+//--------------------------------------------------------------------------------------------------------------------//
 
 void engine::process_user_tasks (struct engine_state& engine_state, struct engine_tasks& engine_tasks) {
     if (engine_tasks.change_imgui_enabled.has_value ()) {
@@ -433,18 +530,19 @@ void engine::process_user_tasks (struct engine_state& engine_state, struct engin
         engine_state.host.container_just_changed = true;
     }
 
+    if (engine_tasks.change_specialization.has_value ()) {
+        engine_state.graphics.compute_target->set_specialization (engine_tasks.change_specialization.value ());
+        engine_tasks.change_specialization.reset ();
+    }
+
+    for (const auto& r : engine_tasks.readback_requests)
+        engine_state.graphics.readback->request (r.x, r.y, r.width, r.height, r.callback);
+    engine_tasks.readback_requests.clear ();
+
     if (engine_tasks.shutdown_request.has_value ()) {
         engine_state.host.shutdown_request_fn.value() ();
         engine_tasks.shutdown_request.reset ();
     }
-
-    {
-        for (int i = 0; i < engine_tasks.new_logs.size (); ++i) {
-            process_user_log (engine_tasks.new_logs[i]);
-        }
-        engine_tasks.new_logs.clear ();
-    }
-
 }
 
 void engine::provide_imgui_with_input_info (struct engine_state& engine_state) {
@@ -479,6 +577,52 @@ void engine::provide_imgui_with_input_info (struct engine_state& engine_state) {
 }
 
 
+void engine::update_extensions (extension_registry& z_registry, jobs::scheduler& z_jobs) {
+
+    auto timed_update = [&z_registry] (size_t i) {
+        SGE_MEMORY_ZONE ("extensions");
+        const auto t0 = std::chrono::high_resolution_clock::now ();
+        z_registry.extensions[i]->invoke_update ();
+        const auto t1 = std::chrono::high_resolution_clock::now ();
+        z_registry.update_times[i] = (float) std::chrono::duration<double, std::milli> (t1 - t0).count ();
+    };
+
+    // stage by stage, concurrent extensions are farmed out to the job system (apart from the last which is run here)
+    // and the rest are updated on this thread in the meantime.
+    const size_t n = z_registry.size ();
+    size_t begin = 0;
+    while (begin < n) {
+        size_t end = begin;
+        while (end < n && z_registry.stages[end] == z_registry.stages[begin])
+            ++end;
+
+        std::optional<size_t> local;
+        jobs::counter stage_counter;
+        for (size_t i = begin; i < end; ++i) {
+            const auto& ext = z_registry.extensions[i];
+            if (!ext->is_active ()) { z_registry.update_times[i] = 0.0f; continue; }
+            if (!ext->is_concurrent_update ()) continue;
+            if (local.has_value ())
+                z_jobs.run ([&timed_update, l = local.value ()] () { timed_update (l); }, &stage_counter);
+            local = i;
+        }
+
+        if (local.has_value ())
+            timed_update (local.value ());
+
+        for (size_t i = begin; i < end; ++i) {
+            const auto& ext = z_registry.extensions[i];
+            if (!ext->is_concurrent_update () && ext->is_active ()) // concurrent ones may still be running.
+                timed_update (i);
+        }
+
+        z_jobs.wait (stage_counter);
+        for (size_t i = begin; i < end; ++i)
+            z_registry.extensions[i]->invoke_apply_requests ();
+        begin = end;
+    }
+}
+
 engine::engine () {
 
     app::initialise ();
@@ -523,6 +667,27 @@ void engine::setup (
 
     engine_tasks->change_window_title = configuration.app_name;
 
+    {
+        const int hardware_threads = (int) std::thread::hardware_concurrency ();
+        const int worker_count = configuration.job_worker_count >= 0
+            ? configuration.job_worker_count
+            : std::max (hardware_threads - 1, 0);
+        engine_jobs = std::make_unique<jobs::scheduler> ((uint32_t) worker_count);
+    }
+
+    engine_logger = std::make_unique<logger> ();
+    engine_logger->add_sink (std::make_unique<stdout_log_sink> ());
+    if (!configuration.log_path.empty ())
+        engine_logger->add_sink (std::make_unique<file_log_sink> (configuration.log_path.c_str ()));
+    if (!configuration.log_database_path.empty ()
+        && engine_state->logging.open (configuration.log_database_path, (uint32_t) std::max (configuration.log_database_segments, 1)))
+        engine_logger->add_sink (std::make_unique<database_log_sink> (engine_state->logging));
+    engine_logger->start ();
+
+    // before the graphics, which load their shaders from it.
+    if (!configuration.archive_path.empty () && !sge::utils::get_assets ().open_archive (configuration.archive_path.c_str ()))
+        engine_logger->submit (runtime::log_level::warning, L"SGE", L"Failed to open the asset archive, reading loose files instead.");
+
 #if TARGET_WIN32
     engine_state->platform.hinst = z_hinst;
     engine_state->platform.hwnd = z_hwnd;
@@ -536,7 +701,15 @@ void engine::setup (
 #error
 #endif
 
-    engine_api = std::make_unique<api_impl> (*engine_state, *engine_tasks, engine_extensions);
+    engine_state->memory.warmup_frames = (uint32_t) std::max (configuration.allocation_warmup_frames, 0);
+    engine_state->memory.log_frame_allocations = configuration.log_frame_allocations;
+    engine_state->memory.assert_frame_allocations = configuration.assert_frame_allocations;
+
+    engine_replay = std::make_unique<replay_session> (configuration.replay_path, configuration.replay_timings_path);
+    if (configuration.replay_on_start && !engine_replay->start_replay ())
+        engine_logger->submit (runtime::log_level::error, L"SGE", L"Failed to open the input trace for replay.");
+
+    engine_api = std::make_unique<api_impl> (*engine_state, *engine_tasks, engine_extensions, *engine_jobs, *engine_logger);
 
     auto& standard_extensions = sge::app::internal::get_standard_extensions ();
 
@@ -545,14 +718,14 @@ void engine::setup (
         size_t id = standard_extensions.views[i].first;
         auto& new_fn = standard_extensions.views[i].second;
         runtime::view* view = new_fn (*engine_api);
-        engine_extensions[id] = std::unique_ptr<runtime::extension> (view);
+        engine_extensions.add (id, view);
     }
 
     for (int i = 0; i < standard_extensions.systems.size(); ++i) {
         size_t id = standard_extensions.systems[i].first;
         auto& new_fn = standard_extensions.systems[i].second;
         runtime::system* system = new_fn (*engine_api);
-        engine_extensions[id] = std::unique_ptr<runtime::extension> (system);
+        engine_extensions.add (id, system);
     }
 
     auto& user_extensions = sge::app::get_extensions ();
@@ -561,16 +734,19 @@ void engine::setup (
         size_t id = user_extensions.views[i].first;
         auto& new_fn = user_extensions.views[i].second;
         runtime::view* view = new_fn (*engine_api);
-        engine_extensions[id] = std::unique_ptr<runtime::extension> (view);
+        engine_extensions.add (id, view);
     }
 
     for (int i = 0; i < user_extensions.systems.size(); ++i) {
         size_t id = user_extensions.systems[i].first;
         auto& new_fn = user_extensions.systems[i].second;
         runtime::system* system = new_fn (*engine_api);
-        engine_extensions[id] = std::unique_ptr<runtime::extension> (system);
+        engine_extensions.add (id, system);
     }
 
+    // with everything registered (and dependencies declared) put the extensions into update order.
+    engine_extensions.sort ();
+
     user_response = std::make_unique<struct app::response> (app::get_content ().uniforms.size (), app::get_content ().blobs.size ());
     user_api = app::internal::create_user_api (*engine_api);
 
@@ -602,32 +778,54 @@ void engine::update (client_state& z_container, input_state& z_input) {
     }
 
     // copy new state provided by the host
-    engine_state->client = z_container;
-    engine_state->input = z_input;
+    {
+        SGE_MEMORY_ZONE ("input");
+        engine_state->client = z_container;
+        engine_state->input = z_input;
+    }
 
     // USER TASKS (from last frame)
-    process_user_tasks (*engine_state, *engine_tasks);
+    {
+        SGE_MEMORY_ZONE ("tasks");
+        process_user_tasks (*engine_state, *engine_tasks);
+    }
 
     // IMGUI
-    provide_imgui_with_input_info (*engine_state);
+    {
+        SGE_MEMORY_ZONE ("input");
+        provide_imgui_with_input_info (*engine_state);
+    }
 
-    // update all registered extensions
-    for (auto& kvp : engine_extensions) {
-        if (kvp.second->is_active())
-            kvp.second->invoke_update ();
+    // REPLAY (after imgui has seen the host's input, so that the debug ui remains usable)
+    {
+        SGE_MEMORY_ZONE ("replay");
+        engine_replay->begin_frame (*engine_state, *engine_tasks);
     }
 
+    // update all registered extensions
+    update_extensions (engine_extensions, *engine_jobs);
+
     // update the user's app
-    sge::app::update (*user_response, *user_api);
+    {
+        SGE_MEMORY_ZONE ("app");
+        sge::app::update (*user_response, *user_api);
+    }
     
     
     // VULKAN
-    engine_state->graphics.update (
-        user_response->push_constants_changed,
-        user_response->uniform_changes,
-        user_response->blob_changes,
-        engine_state->instrumentation.frameTimer // from last frame
-    );
+    {
+        SGE_MEMORY_ZONE ("graphics");
+        engine_state->graphics.update (
+            user_response->push_constants_changed,
+            user_response->uniform_changes,
+            user_response->blob_changes,
+            user_response->blob_dirty_ranges,
+            engine_state->instrumentation.frameTimer // from last frame
+        );
+    }
+
+    // ASSETS (the old contents of changed loose files are only kept for a few frames)
+    sge::utils::get_assets ().end_frame ();
 
     // INSTRUMENTATION
     {
@@ -636,6 +834,8 @@ void engine::update (client_state& z_container, input_state& z_input) {
         const auto tDiff = std::chrono::duration<double, std::milli> (tEnd - tStart).count ();
         engine_state->instrumentation.frameTimer = (float)tDiff / 1000.0f;
         engine_state->instrumentation.totalTimer += engine_state->instrumentation.frameTimer;
+        const float extensions_ms = std::accumulate (engine_extensions.update_times.begin (), engine_extensions.update_times.end (), 0.0f);
+        engine_replay->end_frame ((float) tDiff, extensions_ms);
         const float fpsTimer = (float)(std::chrono::duration<double, std::milli> (tEnd - engine_state->instrumentation.lastTimestamp).count ());
         if (fpsTimer > 1000.0f) {
             engine_state->instrumentation.lastFPS = static_cast<uint32_t>((float) engine_state->instrumentation.frameCounter * (1000.0f / fpsTimer));
@@ -645,6 +845,25 @@ void engine::update (client_state& z_container, input_state& z_input) {
         }
     }
 
+    // ALLOCATIONS
+    if constexpr (memory::is_tracking_enabled ()) {
+        memory_state& m = engine_state->memory;
+        const memory::frame_stats stats = memory::end_frame ();
+        m.allocation_history[m.allocation_history_offset] = (float) stats.allocations;
+        m.allocation_history_offset = (m.allocation_history_offset + 1) % (uint32_t) m.allocation_history.size ();
+        if (stats.frame >= m.warmup_frames && stats.allocations > 0) {
+            m.frames_allocating++;
+            m.last_frame_allocating = stats.frame;
+            if (m.log_frame_allocations) {
+                wchar_t message[128];
+                swprintf (message, 128, L"Frame %llu made %llu heap allocations (%llu bytes).",
+                    (unsigned long long) stats.frame, (unsigned long long) stats.allocations, (unsigned long long) stats.bytes);
+                engine_logger->submit (runtime::log_level::warning, L"SGE", message);
+            }
+            assert (!m.assert_frame_allocations && "Heap allocation in frame loop past warm-up, see Engine > Memory.");
+        }
+    }
+
 }
 
 void engine::stop () {
@@ -656,6 +875,12 @@ void engine::shutdown () {
     user_response.reset ();
     engine_extensions.clear ();
     engine_state->graphics.destroy ();
+    engine_api.reset ();
+    sge::utils::get_assets ().close ();
+    engine_log_search.reset ();
+    engine_replay.reset ();
+    engine_jobs.reset ();
+    engine_logger.reset ();
     engine_tasks.reset ();
     engine_state.reset ();
 }
@@ -677,11 +902,16 @@ void engine::shutdown () {
 //====================================================================================================================//
 
 void engine::imgui () {
+    SGE_MEMORY_EXEMPT_ZONE ("debug ui");
 
     static bool show_about_window = false;
     static bool show_engine_host_window = false;
     static bool show_engine_graphics_window = false;
     static bool show_engine_memory_window = false;
+    static bool show_engine_jobs_window = false;
+    static bool show_engine_extensions_window = false;
+    static bool show_engine_log_window = false;
+    static bool show_engine_replay_window = false;
     static bool show_dear_imgui_demo_window = false;
 
     // top level imgui fn, all imgui calls are from this call.
@@ -714,14 +944,29 @@ void engine::imgui () {
                 show_engine_memory_window = !show_engine_memory_window;
             }
 
+            if (ImGui::MenuItem("Jobs", NULL, show_engine_jobs_window)) {
+                show_engine_jobs_window = !show_engine_jobs_window;
+            }
+
+            if (ImGui::MenuItem("Extensions", NULL, show_engine_extensions_window)) {
+                show_engine_extensions_window = !show_engine_extensions_window;
+            }
+
+            if (ImGui::MenuItem("Logs", NULL, show_engine_log_window)) {
+                show_engine_log_window = !show_engine_log_window;
+            }
+
+            if (ImGui::MenuItem("Replay", NULL, show_engine_replay_window)) {
+                show_engine_replay_window = !show_engine_replay_window;
+            }
+
 
             ImGui::EndMenu();
         }
 
         if (ImGui::BeginMenu("Runtime")) {
-            for (auto& kvp : engine_extensions) {
-                const size_t id = kvp.first;
-                engine_extensions[id]->invoke_debug_menu();
+            for (auto& ext : engine_extensions.extensions) {
+                ext->invoke_debug_menu();
             }
             ImGui::EndMenu();
         }
@@ -739,18 +984,23 @@ void engine::imgui () {
 
         ImGui::EndMainMenuBar();
     }
-    for (auto& kvp : engine_extensions) {
-        const size_t id = kvp.first;
-        engine_extensions[id]->invoke_debug_ui();
+    for (auto& ext : engine_extensions.extensions) {
+        ext->invoke_debug_ui();
     }
 
     if (show_about_window)           about_window    (&show_about_window);
     if (show_engine_host_window)     host_window     (&show_engine_host_window);
     if (show_engine_graphics_window) graphics_window (&show_engine_graphics_window);
     if (show_engine_memory_window)   memory_window   (&show_engine_memory_window);
+    if (show_engine_jobs_window)     jobs_window     (&show_engine_jobs_window);
+    if (show_engine_extensions_window) extensions_window (&show_engine_extensions_window);
+    if (show_engine_log_window)      log_window      (&show_engine_log_window);
+    if (show_engine_replay_window)   replay_window   (&show_engine_replay_window);
 
     if (show_dear_imgui_demo_window) ImGui::ShowDemoWindow();
 
+    engine_state->graphics.overlay_ui ();
+
     sge::app::debug_ui (*user_response, *user_api);
 }
 
@@ -886,6 +1136,187 @@ void engine::memory_window (bool* show) {
     ImGui::Begin("SGE Memory", show, ImGuiWindowFlags_NoCollapse);
 
     //engine_state->graphics.kernel->custom_allocator->debug_ui_content();
+
+    if constexpr (!memory::is_tracking_enabled ()) {
+        ImGui::Text ("Allocation tracking is disabled, build with SGE_ALLOCATION_TRACKING defined.");
+    }
+    else {
+        const memory_state& m = engine_state->memory;
+        const memory::frame_stats& last = memory::get_last_frame ();
+        ImGui::Text ("frame: %llu, allocations: %llu, bytes: %llu", (unsigned long long) last.frame, (unsigned long long) last.allocations, (unsigned long long) last.bytes);
+        ImGui::Text ("frames past warm-up (%u) that allocated: %llu", m.warmup_frames, (unsigned long long) m.frames_allocating);
+        if (m.frames_allocating > 0) {
+            ImGui::SameLine ();
+            ImGui::Text ("(last: %llu)", (unsigned long long) m.last_frame_allocating);
+        }
+        ImGui::PlotHistogram ("##allocations", m.allocation_history.data (), (int) m.allocation_history.size (), (int) m.allocation_history_offset, "allocations per frame", 0.0f, FLT_MAX, ImVec2 (0, 60));
+
+        ImGui::Separator ();
+        ImGui::Columns (5, "memory_zones");
+        ImGui::Text ("zone"); ImGui::NextColumn ();
+        ImGui::Text ("allocs"); ImGui::NextColumn ();
+        ImGui::Text ("bytes"); ImGui::NextColumn ();
+        ImGui::Text ("frees"); ImGui::NextColumn ();
+        ImGui::Text ("total allocs"); ImGui::NextColumn ();
+        ImGui::Separator ();
+        for (memory::zone_id i = 0; i < memory::get_zone_count (); ++i) {
+            const memory::zone_stats& z = last.zones[i];
+            ImGui::Text ("%s%s", memory::get_zone_name (i), memory::is_zone_exempt (i) ? " (exempt)" : ""); ImGui::NextColumn ();
+            ImGui::Text ("%llu", (unsigned long long) z.allocations); ImGui::NextColumn ();
+            ImGui::Text ("%llu", (unsigned long long) z.bytes); ImGui::NextColumn ();
+            ImGui::Text ("%llu", (unsigned long long) z.frees); ImGui::NextColumn ();
+            ImGui::Text ("%llu", (unsigned long long) memory::get_total (i).allocations); ImGui::NextColumn ();
+        }
+        ImGui::Columns (1);
+    }
+
+    ImGui::End ();
+}
+
+void engine::jobs_window (bool* show) {
+    ImGui::SetNextWindowPos(ImVec2 (100, 130), ImGuiCond_Once);
+    ImGui::Begin("SGE Jobs", show, ImGuiWindowFlags_NoCollapse);
+
+    engine_jobs->debug_ui ();
+
+    ImGui::End ();
+}
+
+void engine::extensions_window (bool* show) {
+    ImGui::SetNextWindowPos(ImVec2 (100, 130), ImGuiCond_Once);
+    ImGui::Begin("SGE Extensions", show, ImGuiWindowFlags_NoCollapse);
+
+    ImGui::Text ("Stages: %u", engine_extensions.stage_count);
+    ImGui::Columns (4);
+    ImGui::Text ("extension"); ImGui::NextColumn ();
+    ImGui::Text ("stage"); ImGui::NextColumn ();
+    ImGui::Text ("concurrent"); ImGui::NextColumn ();
+    ImGui::Text ("update (ms)"); ImGui::NextColumn ();
+    ImGui::Separator ();
+    for (size_t i = 0; i < engine_extensions.size (); ++i) {
+        const auto& ext = engine_extensions.extensions[i];
+        ImGui::Text ("%s", ext->get_display_name ().c_str ()); ImGui::NextColumn ();
+        ImGui::Text ("%u", engine_extensions.stages[i]); ImGui::NextColumn ();
+        ImGui::Text ("%s", ext->is_concurrent_update () ? "yes" : "no"); ImGui::NextColumn ();
+        ImGui::Text ("%.4f", engine_extensions.update_times[i]); ImGui::NextColumn ();
+    }
+    ImGui::Columns (1);
+
+    ImGui::End ();
+}
+
+void engine::replay_window (bool* show) {
+    ImGui::SetNextWindowPos(ImVec2 (100, 130), ImGuiCond_Once);
+    ImGui::Begin("SGE Replay", show, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize);
+
+    engine_replay->debug_ui ();
+
+    ImGui::End ();
+}
+
+void engine::log_window (bool* show) {
+    ImGui::SetNextWindowSize (ImVec2 (640, 360), ImGuiCond_Once);
+    ImGui::SetNextWindowPos (ImVec2 (100, 130), ImGuiCond_Once);
+    ImGui::Begin ("SGE Logs", show, ImGuiWindowFlags_NoCollapse);
+
+    const log_database& database = engine_state->logging;
+    if (!database.is_open ()) {
+        ImGui::Text ("The log database is disabled (see configuration.log_database_path).");
+        ImGui::End ();
+        return;
+    }
+
+    if (!engine_log_search)
+        engine_log_search = std::make_unique<log_search> (database, *engine_jobs);
+
+    static log_query query;
+    static char text[128] = "";
+    static bool auto_scroll = true;
+
+    const runtime::log_level levels[] = { runtime::log_level::debug, runtime::log_level::info, runtime::log_level::warning, runtime::log_level::error };
+    for (auto level : levels) {
+        const uint32_t bit = 1u << (uint32_t) level;
+        bool enabled = (query.level_mask & bit) != 0;
+        char label[32];
+        snprintf (label, sizeof (label), "%s (%llu)", to_string (level), (unsigned long long) database.level_count (level));
+        if (ImGui::Checkbox (label, &enabled))
+            query.level_mask = enabled ? (query.level_mask | bit) : (query.level_mask & ~bit);
+        ImGui::SameLine ();
+    }
+    ImGui::Checkbox ("Auto-scroll", &auto_scroll);
+
+    {
+        const auto channels = database.get_channels ();
+        const char* current = "(all)";
+        for (auto& c : channels)
+            if (c.first == query.channel_hash) current = c.second.c_str ();
+        ImGui::SetNextItemWidth (160);
+        if (ImGui::BeginCombo ("Channel", current)) {
+            if (ImGui::Selectable ("(all)", query.channel_hash == 0)) query.channel_hash = 0;
+            for (auto& c : channels)
+                if (ImGui::Selectable (c.second.c_str (), c.first == query.channel_hash)) query.channel_hash = c.first;
+            ImGui::EndCombo ();
+        }
+    }
+    ImGui::SameLine ();
+    {
+        // the start is fixed when chosen (rather than following the clock) so the search isn't restarted every frame.
+        const int64_t range_us[] = { 0, 0, 600000000ll, 3600000000ll, 86400000000ll };
+        static int range = 0;
+        ImGui::SetNextItemWidth (140);
+        if (ImGui::Combo ("Time", &range, "All time\0This session\0Last 10 minutes\0Last hour\0Last day\0")) {
+            const int64_t now = log_database::to_timestamp (std::chrono::system_clock::now ());
+            query.time_begin = range == 0 ? INT64_MIN : range == 1 ? database.opened_at () : now - range_us[range];
+        }
+    }
+    ImGui::SameLine ();
+    ImGui::SetNextItemWidth (240);
+    if (ImGui::InputText ("Search", text, sizeof (text)))
+        query.text = text;
+
+    // without any filter the rows map directly onto the database, otherwise they come from the background search.
+    const bool filtered = !query.is_unfiltered ();
+    const uint64_t first = database.first ();
+    size_t row_count;
+    if (filtered) {
+        engine_log_search->update (query);
+        row_count = engine_log_search->result_count ();
+        ImGui::Text ("%zu matches%s", row_count, engine_log_search->is_searching () ? " (searching...)" : "");
+    }
+    else {
+        row_count = (size_t) (database.count () - first);
+        ImGui::Text ("%zu logs in %u segments", row_count, database.segment_count ());
+    }
+    ImGui::Separator ();
+
+    ImGui::BeginChild ("logs", ImVec2 (0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+    ImGuiListClipper clipper;
+    clipper.Begin ((int) row_count);
+    std::vector<uint64_t> rows;
+    while (clipper.Step ()) {
+        const size_t begin = (size_t) clipper.DisplayStart;
+        const size_t n = (size_t) (clipper.DisplayEnd - clipper.DisplayStart);
+        rows.resize (n);
+        if (filtered) rows.resize (engine_log_search->get_results (begin, n, rows.data ()));
+        else std::iota (rows.begin (), rows.end (), first + begin);
+
+        stored_log r;
+        for (uint64_t index : rows) {
+            if (!database.get (index, r)) { ImGui::TextDisabled ("(rolled off)"); continue; }
+            const auto level = (runtime::log_level) r.level;
+            const ImVec4 colour
+                = level == runtime::log_level::error ? ImVec4 (1.0f, 0.4f, 0.4f, 1.0f)
+                : level == runtime::log_level::warning ? ImVec4 (1.0f, 0.8f, 0.4f, 1.0f)
+                : level == runtime::log_level::debug ? ImVec4 (0.6f, 0.6f, 0.6f, 1.0f)
+                : ImVec4 (1.0f, 1.0f, 1.0f, 1.0f);
+            ImGui::TextColored (colour, "%llu [%s][%s] %s", (unsigned long long) r.id, to_string (level), r.channel, r.message);
+        }
+    }
+    clipper.End ();
+    if (auto_scroll && ImGui::GetScrollY () >= ImGui::GetScrollMaxY ())
+        ImGui::SetScrollHereY (1.0f);
+    ImGui::EndChild ();
+
     ImGui::End ();
 }
 
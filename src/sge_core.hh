@@ -8,10 +8,14 @@
 
 #include "sge.hh"
 #include "sge_runtime.hh"
+#include "sge_jobs.hh"
+#include "sge_logging.hh"
 #include "sge_vk.hh"
 
 namespace sge::core {
 
+class replay_session;
+
 struct guid {
     uint8_t data[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
     static guid empty;
@@ -115,19 +119,6 @@ typedef std::function <void (const char*)>  string_fn;
 typedef std::function <void (bool)>         bool_fn;
 typedef std::function <void (int, int)>     point_fn;
 
-
-struct log {
-    guid id;
-    std::chrono::high_resolution_clock::time_point timestamp;
-    runtime::log_level level;
-    std::wstring channel;
-    std::wstring message;
-};
-
-struct log_database {
-    std::vector<log> logs;
-};
-
 // collection of copided information about the host
 // (the host is the authority on this data).
 struct host_state {
@@ -173,6 +164,17 @@ struct instrumentation_state {
     std::chrono::high_resolution_clock::time_point lastTimestamp;
 };
 
+// see sge_memory.hh, only populated when SGE_ALLOCATION_TRACKING is defined.
+struct memory_state {
+    uint32_t warmup_frames = 0;
+    bool log_frame_allocations = false;
+    bool assert_frame_allocations = false;
+    uint64_t frames_allocating = 0; // number of frames past warm-up that allocated.
+    uint64_t last_frame_allocating = 0;
+    std::array<float, 128> allocation_history = {}; // allocations per frame, ring buffer.
+    uint32_t allocation_history_offset = 0;
+};
+
 
 typedef struct vk::vk graphics_state;
 
@@ -191,11 +193,17 @@ struct engine_state {
     // engine state
     host_state host;
     instrumentation_state instrumentation;
+    memory_state memory;
     graphics_state graphics;
 
     log_database logging;
 };
 
+struct readback_request {
+    uint32_t                            x, y, width, height;
+    runtime::readback_fn                callback;
+};
+
 // Stuff for the engine to do when it gets round to it.
 // Every user interaction with the engine at runtime should be here.
 struct engine_tasks {
@@ -204,11 +212,32 @@ struct engine_tasks {
     std::optional<std::string>          change_window_title;
     std::optional<int>                  change_canvas_width;
     std::optional<int>                  change_canvas_height;
+    std::optional<int>                  change_specialization;
+    std::vector<readback_request>       readback_requests;
     std::optional<std::monostate>       shutdown_request;
-    std::vector<log>                    new_logs;
 };
 
 
+// Engine extensions, stored contiguously in dependency order.
+// * extensions are grouped into stages, those within a stage have no dependencies upon one another.
+// * ordering is deterministic: ties are broken by registration order.
+struct extension_registry {
+    std::vector<std::unique_ptr<runtime::extension>>    extensions;
+    std::vector<size_t>                                 ids;
+    std::vector<uint32_t>                               stages;         // non-decreasing.
+    std::vector<float>                                  update_times;   // milliseconds, last frame.
+    std::vector<size_t>                                 lookup;         // type id -> index, type ids are dense.
+    uint32_t                                            stage_count = 0;
+
+    static const size_t INVALID_INDEX = (size_t) -1;
+
+    void                add             (size_t, runtime::extension*);
+    runtime::extension* get             (size_t)                        const; // null if not registered.
+    void                sort            ();
+    void                clear           ();
+    size_t              size            ()                              const { return extensions.size (); }
+};
+
 //----------------------------------------------------------------------------------------------------------------//
     
 
@@ -218,10 +247,12 @@ struct engine_tasks {
 class api_impl : public runtime::api {
     const core::engine_state& engine_state;
     core::engine_tasks& engine_tasks;
-    std::unordered_map<size_t, std::unique_ptr<runtime::extension>>& engine_extensions;
+    const extension_registry& engine_extensions;
+    jobs::scheduler& engine_jobs;
+    logger& engine_logger;
 public:
 
-    api_impl (const core::engine_state&, core::engine_tasks&, std::unordered_map<size_t, std::unique_ptr<runtime::extension>>&);
+    api_impl (const core::engine_state&, core::engine_tasks&, const extension_registry&, jobs::scheduler&, logger&);
 
     bool                    system__get_state_bool              (runtime::system_bool_state)                    const;
     int                     system__get_state_int               (runtime::system_int_state)                     const;
@@ -249,6 +280,15 @@ public:
     void                    input__touches                      (uint32_t*, uint32_t*, int*, int*)              const;
 
     void                    tty__log                             (runtime::log_level, const wchar_t*, const wchar_t*)  const;
+
+    void                    readback__request                   (uint32_t, uint32_t, uint32_t, uint32_t, const runtime::readback_fn&);
+
+    void                    jobs__run                           (const jobs::job_fn&, jobs::counter*)           const;
+    void                    jobs__parallel_for                  (uint32_t, uint32_t, const jobs::range_fn&)     const;
+    void                    jobs__wait                          (const jobs::counter&)                          const;
+    uint32_t                jobs__get_thread_count              ()                                              const;
+
+    std::optional<dataspan> assets__get                         (const char*)                                   const;
     
     runtime::extension*     extension_get                       (size_t)                                        const;
 };
@@ -259,8 +299,12 @@ class engine {
 
     std::unique_ptr<engine_state>                       engine_state;
     std::unique_ptr<engine_tasks>                       engine_tasks;
+    std::unique_ptr<jobs::scheduler>                    engine_jobs;
+    std::unique_ptr<logger>                             engine_logger;
+    std::unique_ptr<log_search>                         engine_log_search; // created when the log window is first opened.
+    std::unique_ptr<replay_session>                     engine_replay;
     std::unique_ptr<api_impl>                           engine_api;
-    std::unordered_map<size_t, std::unique_ptr<runtime::extension>> engine_extensions = {};
+    extension_registry                                  engine_extensions;
     std::unique_ptr<app::response>                      user_response;
     app::api*                                           user_api;
 
@@ -297,11 +341,15 @@ public:
     void host_window (bool*);
     void graphics_window (bool*);
     void memory_window (bool*);
+    void jobs_window (bool*);
+    void extensions_window (bool*);
+    void log_window (bool*);
+    void replay_window (bool*);
 
 private:
-    static void process_user_log (const log&);
     static void process_user_tasks (struct engine_state&, struct engine_tasks&);
     static void provide_imgui_with_input_info (struct engine_state&);
+    static void update_extensions (extension_registry&, jobs::scheduler&);
 };
 
 }
@@ -0,0 +1,110 @@
+#include "sge_file_watcher.hh"
+
+#include <sys/stat.h>
+#if TARGET_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace sge::utils {
+
+static void split_path (const std::string& z_path, std::string& z_directory, std::string& z_name) {
+    const size_t slash = z_path.find_last_of ("/\\");
+    z_directory = slash == std::string::npos ? "." : z_path.substr (0, slash);
+    z_name = slash == std::string::npos ? z_path : z_path.substr (slash + 1);
+}
+
+static void get_file_status (const std::string& z_path, int64_t& z_modified, int64_t& z_size) {
+#if TARGET_WIN32
+    struct _stat64 s;
+    if (_stat64 (z_path.c_str (), &s) != 0) { z_modified = 0; z_size = -1; return; }
+    z_modified = (int64_t) s.st_mtime;
+#else
+    struct stat s;
+    if (stat (z_path.c_str (), &s) != 0) { z_modified = 0; z_size = -1; return; }
+#if TARGET_MACOSX
+    z_modified = (int64_t) s.st_mtimespec.tv_sec * 1000000000ll + s.st_mtimespec.tv_nsec;
+#else
+    z_modified = (int64_t) s.st_mtim.tv_sec * 1000000000ll + s.st_mtim.tv_nsec;
+#endif
+#endif
+    z_size = (int64_t) s.st_size;
+}
+
+file_watcher::~file_watcher () {
+#if TARGET_LINUX
+    if (descriptor >= 0)
+        ::close (descriptor);
+#endif
+}
+
+bool file_watcher::watch (const std::string& z_path) {
+    for (const auto& e : entries)
+        if (e.path == z_path)
+            return true;
+
+    entry e;
+    e.path = z_path;
+    split_path (z_path, e.directory, e.name);
+    get_file_status (z_path, e.modified, e.size);
+
+#if TARGET_LINUX
+    if (descriptor < 0) {
+        descriptor = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+        if (descriptor < 0)
+            return false;
+    }
+    const bool directory_watched = std::any_of (directories.begin (), directories.end (), [&e] (const auto& kvp) { return kvp.second == e.directory; });
+    if (!directory_watched) {
+        const int wd = inotify_add_watch (descriptor, e.directory.c_str (), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+        if (wd < 0)
+            return false;
+        directories[wd] = e.directory;
+    }
+#endif
+
+    entries.emplace_back (std::move (e));
+    return true;
+}
+
+void file_watcher::poll (std::vector<std::string>& z_changed) {
+    const auto mark_changed = [&z_changed] (const std::string& path) {
+        if (std::find (z_changed.begin (), z_changed.end (), path) == z_changed.end ())
+            z_changed.emplace_back (path);
+    };
+
+#if TARGET_LINUX
+    if (descriptor < 0)
+        return;
+    alignas (struct inotify_event) char buffer[4096];
+    for (;;) {
+        const ssize_t length = ::read (descriptor, buffer, sizeof (buffer));
+        if (length <= 0)
+            break;
+        for (char* p = buffer; p < buffer + length; ) {
+            const struct inotify_event* event = (const struct inotify_event*) p;
+            p += sizeof (struct inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+            const auto d = directories.find (event->wd);
+            if (d == directories.end ())
+                continue;
+            for (const auto& e : entries)
+                if (e.directory == d->second && e.name == event->name)
+                    mark_changed (e.path);
+        }
+    }
+#else
+    for (auto& e : entries) {
+        int64_t modified, size;
+        get_file_status (e.path, modified, size);
+        if (modified != e.modified || size != e.size) {
+            e.modified = modified;
+            e.size = size;
+            mark_changed (e.path);
+        }
+    }
+#endif
+}
+
+}
@@ -0,0 +1,45 @@
+// SGE-FILE-WATCHER
+// ---------------------------------- //
+// Change notifications for files.
+// ---------------------------------- //
+// * On Linux this uses inotify on the parent directories of the watched files, so files that are replaced (written
+//   to a temporary and renamed, as many editors and tools do) are still picked up. Elsewhere modification times and
+//   sizes are compared on each poll.
+
+#pragma once
+
+#include "sge.hh"
+
+namespace sge::utils {
+
+class file_watcher {
+public:
+    file_watcher () = default;
+    ~file_watcher ();
+
+    file_watcher (const file_watcher&) = delete;
+    file_watcher& operator = (const file_watcher&) = delete;
+
+    // the file need not exist yet.
+    bool            watch           (const std::string& path);
+
+    // appends the paths of watched files that have changed since the last poll, doesn't block.
+    void            poll            (std::vector<std::string>& changed);
+
+private:
+    struct entry {
+        std::string     path;
+        std::string     directory;
+        std::string     name;
+        int64_t         modified = 0;
+        int64_t         size = -1;
+    };
+
+    std::vector<entry>                      entries;
+#if TARGET_LINUX
+    int                                     descriptor = -1;
+    std::unordered_map<int, std::string>    directories; // watch descriptor -> directory.
+#endif
+};
+
+}
@@ -1,5 +1,17 @@
+// SGE-FIXED
+// ---------------------------------- //
+// Containers with fixed inline storage.
+// ---------------------------------- //
+// * Intended for hot paths, nothing here allocates apart from a small_vector that has outgrown its inline storage.
+// * Elements are only constructed when they are added and are destroyed when they are removed.
+
 #pragma once
 
+#include "sge.hh"
+
+#include <atomic>
+#include <new>
+
 namespace sge::fixed {
 
 //--------------------------------------------------------------------------------------------------------------------//
@@ -66,8 +78,9 @@ template<typename TP, size_t SZ> inline void swap      (array<TP, SZ>& left, arr
 
 //--------------------------------------------------------------------------------------------------------------------//
 
-template<typename TP, size_t SZ> struct vector {
-
+// A vector with inline storage for at most SZ elements.
+template<typename TP, size_t SZ> class static_vector {
+public:
     typedef TP                                      value_type;
     typedef TP*                                     pointer;
     typedef const TP*                               const_pointer;
@@ -79,48 +92,239 @@ template<typename TP, size_t SZ> struct vector {
     typedef std::ptrdiff_t                          difference_type;
     typedef std::reverse_iterator<iterator>         reverse_iterator;
     typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
-    
 
-    ~vector () { clear(); }
+    static_vector () = default;
+    static_vector (std::initializer_list<TP> l)     { assert (l.size () <= SZ); for (const auto& x : l) push_back (x); }
+    static_vector (size_type n, const TP& x)        { resize (n, x); }
+    static_vector (const static_vector& o)          { for (const auto& x : o) push_back (x); }
+    static_vector (static_vector&& o)               { for (auto& x : o) push_back (std::move (x)); o.clear (); }
+    ~static_vector ()                               { clear (); }
 
-    void                      fill        (const value_type& x) { std::fill_n (begin (), SZ, x); current_size = SZ; }
-    void                      swap        (vector& x)           { assert (false); }
+    static_vector& operator = (const static_vector& o) { if (this != &o) { clear (); for (const auto& x : o) push_back (x); } return *this; }
+    static_vector& operator = (static_vector&& o)      { if (this != &o) { clear (); for (auto& x : o) push_back (std::move (x)); o.clear (); } return *this; }
 
-    
-    iterator                  begin       ()       { return iterator (std::addressof (content[0])); }
-    const_iterator            begin       () const { return const_iterator (std::addressof (content[0])); }
-    iterator                  end         ()       { return iterator (std::addressof (content[current_size])); }
-    const_iterator            end         () const { return const_iterator (std::addressof (content[current_size])); }
+    void                      push_back   (const TP& x)         { emplace_back (x); }
+    void                      push_back   (TP&& x)              { emplace_back (std::move (x)); }
+    template<typename... AR>
+    reference                 emplace_back (AR&&... args)       { assert (current_size < SZ); TP* p = new (data () + current_size) TP (std::forward<AR> (args)...); ++current_size; return *p; }
+    void                      pop_back    ()                    { assert (current_size > 0); data ()[--current_size].~TP (); }
+    void                      clear       ()                    { while (current_size) pop_back (); }
+    void                      resize      (size_type n)         { assert (n <= SZ); while (current_size > n) pop_back (); while (current_size < n) emplace_back (); }
+    void                      resize      (size_type n, const TP& x) { assert (n <= SZ); while (current_size > n) pop_back (); while (current_size < n) emplace_back (x); }
+    iterator                  erase       (const_iterator it)   { iterator p = begin () + (it - cbegin ()); std::move (p + 1, end (), p); pop_back (); return p; }
+    void                      fill        (const value_type& x) { resize (SZ, x); std::fill_n (begin (), SZ, x); }
+    void                      swap        (static_vector& x)    { static_vector t (std::move (x)); x = std::move (*this); *this = std::move (t); }
+
+    iterator                  begin       ()       { return iterator (data ()); }
+    const_iterator            begin       () const { return const_iterator (data ()); }
+    iterator                  end         ()       { return iterator (data () + current_size); }
+    const_iterator            end         () const { return const_iterator (data () + current_size); }
     reverse_iterator          rbegin      ()       { return reverse_iterator (end ()); }
     const_reverse_iterator    rbegin      () const { return const_reverse_iterator (end ()); }
     reverse_iterator          rend        ()       { return reverse_iterator (begin ()); }
     const_reverse_iterator    rend        () const { return const_reverse_iterator (begin ()); }
-    const_iterator            cbegin      () const { return const_iterator (std::addressof (content[0])); }
-    const_iterator            cend        () const { return const_iterator (std::addressof (content[current_size])); }
-    const_reverse_iterator    crbegin     () const { return const_reverse_iterator (end ()); }
-    const_reverse_iterator    crend       () const { return const_reverse_iterator (begin ()); }
-    
-    constexpr size_type       size        () const { return current_size; }
+    const_iterator            cbegin      () const { return begin (); }
+    const_iterator            cend        () const { return end (); }
+    const_reverse_iterator    crbegin     () const { return rbegin (); }
+    const_reverse_iterator    crend       () const { return rend (); }
+
+    size_type                 size        () const { return current_size; }
+    constexpr size_type       capacity    () const { return SZ; }
     constexpr size_type       max_size    () const { return SZ; }
-    constexpr bool            empty       () const { return current_size == 0; }
+    bool                      empty       () const { return current_size == 0; }
+    bool                      full        () const { return current_size == SZ; }
 
-    reference                 operator[]  (size_type n)       { assert (n < current_size); return content[n]; }
-    const_reference           operator[]  (size_type n) const { assert (n < current_size); return content[n]; }
+    reference                 operator[]  (size_type n)       { assert (n < current_size); return data ()[n]; }
+    const_reference           operator[]  (size_type n) const { assert (n < current_size); return data ()[n]; }
 
-    reference                 at          (size_type n)       { assert (n < current_size); return content[n]; }
-    const_reference           at          (size_type n) const { assert (n < current_size); return content[n]; }
+    reference                 at          (size_type n)       { assert (n < current_size); return data ()[n]; }
+    const_reference           at          (size_type n) const { assert (n < current_size); return data ()[n]; }
 
-    reference                 front       ()       { return *begin (); }
-    const_reference           front       () const { return *begin (); }
-    reference                 back        ()       { return SZ ? *(end () - 1) : *end (); }
-    const_reference           back        () const { return SZ ? *(end () - 1) : *end (); }
-    TP*                       data        ()       { return std::addressof (content[0]); }
-    const TP*                 data        () const { return std::addressof (content[0]); }
+    reference                 front       ()       { assert (current_size); return *begin (); }
+    const_reference           front       () const { assert (current_size); return *begin (); }
+    reference                 back        ()       { assert (current_size); return *(end () - 1); }
+    const_reference           back        () const { assert (current_size); return *(end () - 1); }
+    TP*                       data        ()       { return std::launder (reinterpret_cast<TP*> (storage)); }
+    const TP*                 data        () const { return std::launder (reinterpret_cast<const TP*> (storage)); }
 
 private:
-    size_type current_size;
-    value_type content[SZ ? SZ : 1];
+    size_type current_size = 0;
+    alignas (TP) unsigned char storage[sizeof (TP) * (SZ ? SZ : 1)];
 };
 
-    
+template<typename TP, size_t SZ> inline bool operator==(const static_vector<TP, SZ>& left, const static_vector<TP, SZ>& right) { return left.size () == right.size () && std::equal (left.begin (), left.end (), right.begin ()); }
+template<typename TP, size_t SZ> inline bool operator!=(const static_vector<TP, SZ>& left, const static_vector<TP, SZ>& right) { return !(left == right); }
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+// A vector with inline storage for SZ elements that moves to the heap (growing geometrically) if it needs more.
+template<typename TP, size_t SZ> class small_vector {
+public:
+    typedef TP                                      value_type;
+    typedef TP*                                     pointer;
+    typedef const TP*                               const_pointer;
+    typedef value_type&                             reference;
+    typedef const value_type&                       const_reference;
+    typedef value_type*                             iterator;
+    typedef const value_type*                       const_iterator;
+    typedef size_t                                  size_type;
+    typedef std::ptrdiff_t                          difference_type;
+    typedef std::reverse_iterator<iterator>         reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+
+    small_vector () = default;
+    small_vector (std::initializer_list<TP> l)      { reserve (l.size ()); for (const auto& x : l) push_back (x); }
+    small_vector (size_type n, const TP& x)         { resize (n, x); }
+    small_vector (const small_vector& o)            { reserve (o.size ()); for (const auto& x : o) push_back (x); }
+    small_vector (small_vector&& o)                 { take (std::move (o)); }
+    ~small_vector ()                                { clear (); release (); }
+
+    small_vector& operator = (const small_vector& o) { if (this != &o) { clear (); reserve (o.size ()); for (const auto& x : o) push_back (x); } return *this; }
+    small_vector& operator = (small_vector&& o)      { if (this != &o) { clear (); release (); take (std::move (o)); } return *this; }
+
+    void                      push_back   (const TP& x)         { emplace_back (x); }
+    void                      push_back   (TP&& x)              { emplace_back (std::move (x)); }
+    template<typename... AR>
+    reference                 emplace_back (AR&&... args) {
+        if (current_size == current_capacity) {
+            // construct the new element before moving the old ones as the arguments may refer to one of them.
+            const size_type n = current_capacity * 2;
+            TP* p = static_cast<TP*> (::operator new (sizeof (TP) * n));
+            new (p + current_size) TP (std::forward<AR> (args)...);
+            relocate (p, n);
+        }
+        else new (elements + current_size) TP (std::forward<AR> (args)...);
+        return elements[current_size++];
+    }
+    void                      pop_back    ()                    { assert (current_size > 0); elements[--current_size].~TP (); }
+    void                      clear       ()                    { while (current_size) pop_back (); }
+    void                      reserve     (size_type n)         { if (n > current_capacity) relocate (static_cast<TP*> (::operator new (sizeof (TP) * n)), n); }
+    void                      resize      (size_type n)         { reserve (n); while (current_size > n) pop_back (); while (current_size < n) emplace_back (); }
+    void                      resize      (size_type n, const TP& x) { reserve (n); while (current_size > n) pop_back (); while (current_size < n) emplace_back (x); }
+    iterator                  erase       (const_iterator it)   { iterator p = begin () + (it - cbegin ()); std::move (p + 1, end (), p); pop_back (); return p; }
+
+    iterator                  begin       ()       { return elements; }
+    const_iterator            begin       () const { return elements; }
+    iterator                  end         ()       { return elements + current_size; }
+    const_iterator            end         () const { return elements + current_size; }
+    reverse_iterator          rbegin      ()       { return reverse_iterator (end ()); }
+    const_reverse_iterator    rbegin      () const { return const_reverse_iterator (end ()); }
+    reverse_iterator          rend        ()       { return reverse_iterator (begin ()); }
+    const_reverse_iterator    rend        () const { return const_reverse_iterator (begin ()); }
+    const_iterator            cbegin      () const { return begin (); }
+    const_iterator            cend        () const { return end (); }
+
+    size_type                 size        () const { return current_size; }
+    size_type                 capacity    () const { return current_capacity; }
+    bool                      empty       () const { return current_size == 0; }
+    bool                      is_inline   () const { return elements == inline_data (); }
+
+    reference                 operator[]  (size_type n)       { assert (n < current_size); return elements[n]; }
+    const_reference           operator[]  (size_type n) const { assert (n < current_size); return elements[n]; }
+
+    reference                 front       ()       { assert (current_size); return elements[0]; }
+    const_reference           front       () const { assert (current_size); return elements[0]; }
+    reference                 back        ()       { assert (current_size); return elements[current_size - 1]; }
+    const_reference           back        () const { assert (current_size); return elements[current_size - 1]; }
+    TP*                       data        ()       { return elements; }
+    const TP*                 data        () const { return elements; }
+
+private:
+    static_assert (SZ > 0, "small_vector needs some inline storage");
+
+    TP*       inline_data () const { return std::launder (reinterpret_cast<TP*> (const_cast<unsigned char*> (storage))); }
+
+    // moves the elements into new heap storage (which already holds anything constructed past the current size).
+    void relocate (TP* p, size_type n) {
+        for (size_type i = 0; i < current_size; ++i) {
+            new (p + i) TP (std::move (elements[i]));
+            elements[i].~TP ();
+        }
+        release ();
+        elements = p;
+        current_capacity = n;
+    }
+
+    void release () {
+        if (!is_inline ()) ::operator delete (elements);
+        elements = inline_data ();
+        current_capacity = SZ;
+    }
+
+    void take (small_vector&& o) {
+        if (o.is_inline ()) {
+            for (auto& x : o) push_back (std::move (x));
+            o.clear ();
+        }
+        else { // steal the heap storage.
+            elements = o.elements; current_size = o.current_size; current_capacity = o.current_capacity;
+            o.elements = o.inline_data (); o.current_size = 0; o.current_capacity = SZ;
+        }
+    }
+
+    alignas (TP) unsigned char storage[sizeof (TP) * SZ];
+    TP*       elements = inline_data ();
+    size_type current_size = 0;
+    size_type current_capacity = SZ;
+};
+
+// The dirty ranges of a blob for a frame, rarely more than a few.
+typedef small_vector<byterange, 8> byterange_list;
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+// Lock-free ring buffer for passing elements from one producer thread to one consumer thread.
+// * push must only be called by the producer and pop by the consumer, both fail rather than block.
+template<typename TP, size_t SZ> class spsc_ring {
+public:
+    spsc_ring () = default;
+    ~spsc_ring () { TP x; while (pop (x)) {} }
+
+    spsc_ring (const spsc_ring&) = delete;
+    spsc_ring& operator = (const spsc_ring&) = delete;
+
+    bool                      push        (const TP& x)   { return emplace (x); }
+    bool                      push        (TP&& x)        { return emplace (std::move (x)); }
+
+    template<typename... AR>
+    bool emplace (AR&&... args) {
+        const size_t t = tail.load (std::memory_order_relaxed);
+        if (t - head.load (std::memory_order_acquire) == SZ)
+            return false; // full.
+        new (slot (t)) TP (std::forward<AR> (args)...);
+        tail.store (t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop (TP& x) {
+        const size_t h = head.load (std::memory_order_relaxed);
+        if (h == tail.load (std::memory_order_acquire))
+            return false; // empty.
+        TP* p = slot (h);
+        x = std::move (*p);
+        p->~TP ();
+        head.store (h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // only a snapshot when called whilst the other side is active.
+    size_t                    size        () const { return tail.load (std::memory_order_acquire) - head.load (std::memory_order_acquire); }
+    bool                      empty       () const { return size () == 0; }
+    constexpr size_t          capacity    () const { return SZ; }
+
+private:
+    static_assert (SZ > 0 && (SZ & (SZ - 1)) == 0, "spsc_ring capacity must be a power of two");
+
+    TP* slot (size_t i) { return std::launder (reinterpret_cast<TP*> (storage + sizeof (TP) * (i & (SZ - 1)))); }
+
+    alignas (64) std::atomic<size_t> head = { 0 }; // next to pop, written by the consumer.
+    alignas (64) std::atomic<size_t> tail = { 0 }; // next to push, written by the producer.
+    alignas (64) alignas (TP) unsigned char storage[sizeof (TP) * SZ];
+};
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+// Linear search, for the small containers above this is quicker than hashing.
+template<typename CT, typename TP> inline bool contains (const CT& container, const TP& x) { return std::find (container.begin (), container.end (), x) != container.end (); }
+
 }
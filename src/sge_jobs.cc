@@ -0,0 +1,325 @@
+#include "sge_jobs.hh"
+
+namespace sge::jobs {
+
+namespace {
+    const uint32_t INVALID_THREAD_INDEX = 0xFFFFFFFF;
+
+    thread_local const scheduler* tls_scheduler = nullptr;
+    thread_local uint32_t tls_thread_index = INVALID_THREAD_INDEX;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+bool deque::push (job* z) {
+    const int64_t b = bottom.load (std::memory_order_relaxed);
+    const int64_t t = top.load (std::memory_order_acquire);
+    if (b - t >= CAPACITY)
+        return false;
+    buffer[b & (CAPACITY - 1)].store (z, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    bottom.store (b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+job* deque::pop () {
+    const int64_t b = bottom.load (std::memory_order_relaxed) - 1;
+    bottom.store (b, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    int64_t t = top.load (std::memory_order_relaxed);
+
+    if (t > b) { // empty
+        bottom.store (b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    job* j = buffer[b & (CAPACITY - 1)].load (std::memory_order_relaxed);
+    if (t == b) { // last item, race against stealers.
+        if (!top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            j = nullptr;
+        bottom.store (b + 1, std::memory_order_relaxed);
+    }
+    return j;
+}
+
+job* deque::steal () {
+    int64_t t = top.load (std::memory_order_acquire);
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    const int64_t b = bottom.load (std::memory_order_acquire);
+
+    if (t >= b)
+        return nullptr;
+
+    job* j = buffer[t & (CAPACITY - 1)].load (std::memory_order_relaxed);
+    if (!top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr; // lost the race.
+    return j;
+}
+
+int64_t deque::size () const {
+    const int64_t b = bottom.load (std::memory_order_relaxed);
+    const int64_t t = top.load (std::memory_order_relaxed);
+    return std::max (b - t, (int64_t) 0);
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+scheduler::scheduler (uint32_t z_worker_count) {
+    assert (tls_scheduler == nullptr); // one scheduler per thread.
+
+    for (uint32_t i = 0; i < z_worker_count + 1; ++i)
+        contexts.emplace_back (std::make_unique<thread_context> ());
+
+    tls_scheduler = this;
+    tls_thread_index = 0;
+
+    workers.reserve (z_worker_count);
+    for (uint32_t i = 0; i < z_worker_count; ++i)
+        workers.emplace_back (&scheduler::worker_main, this, i + 1);
+}
+
+scheduler::~scheduler () {
+    assert (current_thread_index () == 0);
+
+    // drain anything still queued so that no job is left holding a counter.
+    while (pending.load () > 0) {
+        if (job* j = next_job (0)) execute (j);
+        else std::this_thread::yield ();
+    }
+
+    running.store (false);
+    {
+        std::lock_guard<std::mutex> lock (sleep_mutex);
+        sleep_condition.notify_all ();
+    }
+    for (auto& w : workers)
+        w.join ();
+
+    workers.clear ();
+    contexts.clear ();
+
+    tls_scheduler = nullptr;
+    tls_thread_index = INVALID_THREAD_INDEX;
+}
+
+bool scheduler::is_scheduler_thread () const { return tls_scheduler == this; }
+
+uint32_t scheduler::current_thread_index () const {
+    assert (is_scheduler_thread ()); // jobs can only be submitted from the creating thread or from within jobs.
+    return tls_thread_index;
+}
+
+job* scheduler::allocate () {
+    const uint32_t idx = current_thread_index ();
+    thread_context& ctx = *contexts[idx];
+    bool is_stalled = false;
+    bool is_stuck = false;
+    while (true) {
+        // slots are mostly freed in the order they were taken, so the next one is usually free.
+        for (uint32_t i = 0; i < JOB_POOL_SIZE; ++i) {
+            job* j = &ctx.pool[ctx.pool_index];
+            ctx.pool_index = (ctx.pool_index + 1) & (JOB_POOL_SIZE - 1);
+            if (!j->in_use.load (std::memory_order_acquire)) {
+                j->in_use.store (true, std::memory_order_relaxed);
+                if (is_stalled)
+                    stalled.fetch_sub (ctx.depth);
+                return j;
+            }
+        }
+        // every slot is queued, running or waiting on a dependency: help out until one finishes.
+        if (job* j = next_job (idx)) {
+            if (is_stalled)
+                stalled.fetch_sub (ctx.depth);
+            is_stalled = false;
+            is_stuck = false;
+            execute (j);
+            continue;
+        }
+        if (!is_stalled)
+            stalled.fetch_add (ctx.depth);
+        is_stalled = true;
+
+        // nothing is queued & the only jobs running are those under threads stuck here, so nothing can free a slot. A job
+        // that finished just before this may have freed one though, so the slots are checked once more first.
+        const bool was_stuck = is_stuck;
+        is_stuck = pending.load () == 0 && executing.load () == stalled.load ();
+        if (is_stuck && was_stuck) {
+            std::cout << "jobs: all " << JOB_POOL_SIZE << " job slots of thread " << idx << " are held by jobs waiting on dependencies that can't complete." << std::endl;
+            assert (false);
+        }
+        if (!is_stuck)
+            std::this_thread::yield ();
+    }
+}
+
+void scheduler::run (const job_fn& z_fn, counter* z_signal, const counter* z_dependency) {
+    job* j = allocate ();
+    j->bind (z_fn);
+    j->signal = z_signal;
+    j->dependency = z_dependency;
+    submit (j);
+}
+
+void scheduler::parallel_for (uint32_t z_count, uint32_t z_grain, const range_fn& z_fn, counter* z_signal) {
+    if (z_count == 0)
+        return;
+
+    uint32_t grain = z_grain;
+    if (grain == 0) // aim for a few chunks per thread so stealing can even out uneven work.
+        grain = std::max (1u, z_count / (thread_count () * 4));
+
+    for (uint32_t begin = 0; begin < z_count; begin += grain) {
+        const uint32_t end = std::min (begin + grain, z_count);
+        job* j = allocate ();
+        const range_fn* fn = &z_fn;
+        j->bind ([fn, begin, end] () { (*fn) (begin, end); });
+        j->signal = z_signal;
+        j->dependency = nullptr;
+        submit (j);
+    }
+}
+
+void scheduler::parallel_for (uint32_t z_count, uint32_t z_grain, const range_fn& z_fn) {
+    counter c;
+    parallel_for (z_count, z_grain, z_fn, &c);
+    wait (c);
+}
+
+void scheduler::submit (job* z) {
+    if (z->signal)
+        z->signal->value.fetch_add (1, std::memory_order_relaxed);
+
+    if (z->dependency) {
+        std::lock_guard<std::mutex> lock (waiting_mutex);
+        if (!z->dependency->is_complete ()) {
+            waiting.emplace_back (z);
+            return;
+        }
+    }
+
+    enqueue (z);
+}
+
+void scheduler::enqueue (job* z) {
+    thread_context& ctx = *contexts[current_thread_index ()];
+    pending.fetch_add (1, std::memory_order_release);
+    if (!ctx.queue.push (z)) {
+        // the deque is full, run it here rather than dropping it.
+        executing.fetch_add (1);
+        pending.fetch_sub (1, std::memory_order_relaxed);
+        execute (z);
+        return;
+    }
+    sleep_condition.notify_one ();
+}
+
+job* scheduler::next_job (uint32_t z_thread_index) {
+    thread_context& ctx = *contexts[z_thread_index];
+
+    if (job* j = ctx.queue.pop ()) {
+        executing.fetch_add (1);
+        pending.fetch_sub (1, std::memory_order_relaxed);
+        return j;
+    }
+
+    const uint32_t n = thread_count ();
+    for (uint32_t i = 1; i < n; ++i) {
+        const uint32_t victim = (z_thread_index + i) % n;
+        if (job* j = contexts[victim]->queue.steal ()) {
+            executing.fetch_add (1);
+            pending.fetch_sub (1, std::memory_order_relaxed);
+            ctx.stolen.fetch_add (1, std::memory_order_relaxed);
+            return j;
+        }
+    }
+    return nullptr;
+}
+
+// the caller has already counted the job as executing, it stops being so only once any jobs it frees are enqueued.
+void scheduler::execute (job* z) {
+    thread_context& ctx = *contexts[current_thread_index ()];
+    ++ctx.depth;
+    z->fn (*z);
+    --ctx.depth;
+    ctx.executed.fetch_add (1, std::memory_order_relaxed);
+
+    // the slot can be reused as soon as it's released, so nothing of the job is touched afterwards.
+    counter* const signal = z->signal;
+    z->fn = nullptr;
+    z->in_use.store (false, std::memory_order_release);
+
+    if (signal) {
+        if (signal->value.fetch_sub (1, std::memory_order_acq_rel) == 1)
+            release_waiting ();
+    }
+    executing.fetch_sub (1);
+}
+
+void scheduler::release_waiting () {
+    // jobs are enqueued outside of the lock as enqueuing can end up executing a job directly.
+    while (true) {
+        job* ready = nullptr;
+        {
+            std::lock_guard<std::mutex> lock (waiting_mutex);
+            for (size_t i = 0; i < waiting.size (); ++i) {
+                if (waiting[i]->dependency->is_complete ()) {
+                    ready = waiting[i];
+                    waiting[i] = waiting.back ();
+                    waiting.pop_back ();
+                    break;
+                }
+            }
+        }
+        if (!ready)
+            return;
+        enqueue (ready);
+    }
+}
+
+void scheduler::wait (const counter& z) {
+    const uint32_t idx = current_thread_index ();
+    while (!z.is_complete ()) {
+        if (job* j = next_job (idx)) execute (j);
+        else std::this_thread::yield ();
+    }
+}
+
+void scheduler::worker_main (uint32_t z_thread_index) {
+    tls_scheduler = this;
+    tls_thread_index = z_thread_index;
+
+    while (running.load (std::memory_order_acquire)) {
+        if (job* j = next_job (z_thread_index)) {
+            execute (j);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock (sleep_mutex);
+        sleep_condition.wait_for (lock, std::chrono::milliseconds (1), [this] () {
+            return pending.load (std::memory_order_acquire) > 0 || !running.load (std::memory_order_acquire);
+        });
+    }
+
+    tls_scheduler = nullptr;
+    tls_thread_index = INVALID_THREAD_INDEX;
+}
+
+void scheduler::debug_ui () {
+    ImGui::Text ("Threads: %u (%u workers)", thread_count (), worker_count ());
+    ImGui::Text ("Pending jobs: %d", pending.load ());
+    ImGui::Columns (4);
+    ImGui::Text ("thread"); ImGui::NextColumn ();
+    ImGui::Text ("queued"); ImGui::NextColumn ();
+    ImGui::Text ("executed"); ImGui::NextColumn ();
+    ImGui::Text ("stolen"); ImGui::NextColumn ();
+    ImGui::Separator ();
+    for (uint32_t i = 0; i < thread_count (); ++i) {
+        const thread_context& ctx = *contexts[i];
+        ImGui::Text (i == 0 ? "main" : "worker %u", i); ImGui::NextColumn ();
+        ImGui::Text ("%lld", (long long) ctx.queue.size ()); ImGui::NextColumn ();
+        ImGui::Text ("%llu", (unsigned long long) ctx.executed.load ()); ImGui::NextColumn ();
+        ImGui::Text ("%llu", (unsigned long long) ctx.stolen.load ()); ImGui::NextColumn ();
+    }
+    ImGui::Columns (1);
+}
+
+}
@@ -0,0 +1,143 @@
+// SGE-JOBS
+// ---------------------------------- //
+// A small work-stealing job system.
+// ---------------------------------- //
+// * Each thread owned by the scheduler (the thread that creates it plus N workers) has its own Chase-Lev deque.
+// * Owners push/pop at the bottom of their deque, idle threads steal from the top of other deques.
+// * Completion is tracked with counters, a job can be held back until a counter reaches zero.
+// * Waiting on a counter never blocks, the waiting thread executes pending jobs until the counter completes.
+
+#pragma once
+
+#include "sge.hh"
+
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+
+namespace sge::jobs {
+
+// Tracks the number of outstanding jobs associated with it.
+struct counter {
+    std::atomic<int32_t> value = { 0 };
+    bool is_complete () const { return value.load (std::memory_order_acquire) == 0; }
+};
+
+typedef std::function<void ()>                      job_fn;
+typedef std::function<void (uint32_t, uint32_t)>    range_fn; // [begin, end)
+
+struct job {
+    static const size_t PAYLOAD_SIZE = 64;  // fits a job_fn (on all the platforms built for) or a parallel_for chunk.
+
+    void (*fn) (job&) = nullptr;            // runs the callable held in the payload, then destroys it.
+    alignas (std::max_align_t) unsigned char payload[PAYLOAD_SIZE];
+    counter* signal = nullptr;              // decremented once the job has run.
+    const counter* dependency = nullptr;    // the job is not made available until this reaches zero.
+    std::atomic<bool> in_use = { false };   // set from allocation until the job has run, only then is its slot reused.
+
+    // stores a copy of the callable in the payload, jobs are never heap allocated.
+    template<typename FN> void bind (const FN& z) {
+        static_assert (sizeof (FN) <= PAYLOAD_SIZE && alignof (FN) <= alignof (std::max_align_t), "callable too big for a job's payload");
+        new (payload) FN (z);
+        fn = [] (job& j) {
+            FN* f = std::launder (reinterpret_cast<FN*> (j.payload));
+            (*f) ();
+            f->~FN ();
+        };
+    }
+};
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+// Fixed capacity Chase-Lev deque.
+// * push & pop must only be called by the owning thread, steal can be called from any thread.
+// * See: Lê, Pop, Cohen, Zappa Nardelli - Correct and Efficient Work-Stealing for Weak Memory Models (2013).
+class deque {
+public:
+    static const int64_t CAPACITY = 4096; // must be a power of two.
+
+    bool    push    (job*);
+    job*    pop     ();
+    job*    steal   ();
+    int64_t size    () const;
+
+private:
+    static_assert ((CAPACITY & (CAPACITY - 1)) == 0, "deque capacity must be a power of two");
+
+    alignas (64) std::atomic<int64_t> top = { 0 };
+    alignas (64) std::atomic<int64_t> bottom = { 0 };
+    std::array<std::atomic<job*>, CAPACITY> buffer;
+};
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+class scheduler {
+public:
+    // Jobs are taken from a per-thread ring, a slot is only reused once the job in it has run. A thread with this many
+    // jobs in flight runs other jobs whilst it waits for a slot to free up, if none can ever free up (every job left is
+    // held back by a dependency that nothing running can complete) it asserts rather than spinning forever.
+    static const uint32_t JOB_POOL_SIZE = 4096;
+
+    // worker_count: number of threads to spawn in addition to the calling thread.
+    scheduler (uint32_t worker_count);
+    ~scheduler ();
+
+    scheduler (const scheduler&) = delete;
+    scheduler& operator = (const scheduler&) = delete;
+
+    // Enqueues a job, if a signal counter is provided it is incremented now and decremented once the job has run.
+    void            run                     (const job_fn&, counter* = nullptr, const counter* dependency = nullptr);
+
+    // Splits [0, count) into chunks of at most `grain` elements (0 picks a grain automatically) and runs them as jobs.
+    // * the range function is referenced, not copied, it must outlive the signal counter.
+    void            parallel_for            (uint32_t count, uint32_t grain, const range_fn&, counter*);
+
+    // As above but waits for completion, the calling thread helps out.
+    void            parallel_for            (uint32_t count, uint32_t grain, const range_fn&);
+
+    // Executes pending jobs on the calling thread until the counter reaches zero.
+    void            wait                    (const counter&);
+
+    uint32_t        worker_count            () const { return (uint32_t) workers.size (); }
+    uint32_t        thread_count            () const { return (uint32_t) contexts.size (); }
+    bool            is_scheduler_thread     () const;
+
+    void            debug_ui                ();
+
+private:
+    struct thread_context {
+        deque                   queue;
+        std::array<job, JOB_POOL_SIZE> pool;
+        uint32_t                pool_index = 0;
+        std::atomic<uint64_t>   executed = { 0 };
+        std::atomic<uint64_t>   stolen = { 0 };
+        int32_t                 depth = 0; // jobs being executed, nested, on the owning thread.
+    };
+
+    uint32_t        current_thread_index    () const;
+    job*            allocate                ();
+    void            submit                  (job*);
+    void            enqueue                 (job*);
+    job*            next_job                (uint32_t);
+    void            execute                 (job*);
+    void            release_waiting         ();
+    void            worker_main             (uint32_t);
+
+    std::vector<std::unique_ptr<thread_context>> contexts; // index zero is the thread that created the scheduler.
+    std::vector<std::thread>    workers;
+
+    std::atomic<bool>           running = { true };
+    std::atomic<int32_t>        pending = { 0 };
+    std::atomic<int32_t>        executing = { 0 }; // counted from when a job is taken from a deque, before it's no longer pending.
+    std::atomic<int32_t>        stalled = { 0 }; // of those executing, the ones under a thread stuck waiting for a free slot.
+
+    std::mutex                  sleep_mutex;
+    std::condition_variable     sleep_condition;
+
+    std::mutex                  waiting_mutex;
+    std::vector<job*>           waiting;
+};
+
+}
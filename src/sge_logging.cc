@@ -0,0 +1,644 @@
+#include "sge_logging.hh"
+
+#include <charconv>
+#include <filesystem>
+
+namespace sge::core {
+
+const char* to_string (runtime::log_level z) {
+    switch (z) {
+        case runtime::log_level::debug: return "DEBUG";
+        case runtime::log_level::info: return "INFO";
+        case runtime::log_level::warning: return "WARN";
+        case runtime::log_level::error: return "ERROR";
+        default: assert (false); return "";
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+namespace {
+    // Header at the start of each segment file, padded to the size of a record so that records stay aligned.
+    struct segment_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint32_t capacity;
+        uint32_t reserved;
+        uint64_t first;  // sequence number of the first record in the segment.
+        uint64_t count;  // number of records written so far.
+        uint8_t padding[sizeof (stored_log) - 40];
+    };
+    static_assert (sizeof (segment_header) == sizeof (stored_log), "");
+
+    const char SEGMENT_MAGIC[8] = { 'S', 'G', 'E', 'L', 'O', 'G', '\0', '\0' };
+    const uint32_t SEGMENT_VERSION = 2; // 2: timestamps are microseconds since the unix epoch.
+    const size_t SEGMENT_SIZE = sizeof (segment_header) + (size_t) log_database::SEGMENT_CAPACITY * sizeof (stored_log);
+
+    // Encodes a wide string as utf-8, truncating on a code point boundary.
+    template<size_t N> void to_utf8 (char (&dest)[N], const wchar_t* src) {
+        size_t n = 0;
+        for (size_t i = 0; src[i] != L'\0'; ++i) {
+            uint32_t c = (uint32_t) src[i];
+            if constexpr (sizeof (wchar_t) == 2) { // utf-16 surrogate pairs.
+                if (c >= 0xD800 && c < 0xDC00 && src[i + 1] >= 0xDC00 && src[i + 1] < 0xE000)
+                    c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t) src[++i] - 0xDC00);
+            }
+            char bytes[4]; size_t len;
+            if (c < 0x80)         { bytes[0] = (char) c; len = 1; }
+            else if (c < 0x800)   { bytes[0] = (char) (0xC0 | (c >> 6)); bytes[1] = (char) (0x80 | (c & 0x3F)); len = 2; }
+            else if (c < 0x10000) { bytes[0] = (char) (0xE0 | (c >> 12)); bytes[1] = (char) (0x80 | ((c >> 6) & 0x3F)); bytes[2] = (char) (0x80 | (c & 0x3F)); len = 3; }
+            else                  { bytes[0] = (char) (0xF0 | (c >> 18)); bytes[1] = (char) (0x80 | ((c >> 12) & 0x3F)); bytes[2] = (char) (0x80 | ((c >> 6) & 0x3F)); bytes[3] = (char) (0x80 | (c & 0x3F)); len = 4; }
+            if (n + len > N - 1)
+                break;
+            memcpy (dest + n, bytes, len);
+            n += len;
+        }
+        memset (dest + n, 0, N - n);
+    }
+
+    bool contains_case_insensitive (const char* haystack, const std::string& needle) {
+        const size_t n = needle.size ();
+        for (const char* h = haystack; *h != '\0'; ++h) {
+            size_t i = 0;
+            while (i < n && h[i] != '\0' && tolower ((unsigned char) h[i]) == tolower ((unsigned char) needle[i]))
+                ++i;
+            if (i == n)
+                return true;
+        }
+        return n == 0;
+    }
+}
+
+log_database::~log_database () {
+    close ();
+}
+
+bool log_database::open (const std::string& z_base_path, uint32_t z_max_segments) {
+    assert (!is_open ());
+    assert (z_max_segments > 0);
+    std::lock_guard<std::mutex> lock (mutex);
+    base_path = z_base_path;
+    max_segments = z_max_segments;
+    opened = to_timestamp (std::chrono::system_clock::now ());
+    load_segments ();
+    if (segments.empty () && !add_segment ()) {
+        max_segments = 0;
+        return false;
+    }
+    return true;
+}
+
+void log_database::close () {
+    std::lock_guard<std::mutex> lock (mutex);
+    for (auto& segment : segments)
+        segment->file.flush (0, segment->file.size ());
+    segments.clear ();
+    max_segments = 0;
+}
+
+// Picks up where the last session left off: the newest run of segments that follow on from one another is kept (up to
+// the maximum) & its indices rebuilt, appending then continues in the newest. Anything older, or damaged, is deleted.
+void log_database::load_segments () {
+    namespace fs = std::filesystem;
+    const fs::path base (base_path);
+    const fs::path directory = base.has_parent_path () ? base.parent_path () : fs::path (".");
+    const std::string prefix = base.filename ().string () + ".";
+    const std::string suffix = ".sgelog";
+
+    std::vector<uint32_t> numbers;
+    std::error_code error;
+    for (fs::directory_iterator it (directory, error), end; !error && it != end; it.increment (error)) {
+        const std::string name = it->path ().filename ().string ();
+        if (name.size () <= prefix.size () + suffix.size ()
+            || name.compare (0, prefix.size (), prefix) != 0
+            || name.compare (name.size () - suffix.size (), suffix.size (), suffix) != 0)
+            continue;
+        const char* const first = name.data () + prefix.size ();
+        const char* const last = name.data () + name.size () - suffix.size ();
+        uint32_t number;
+        const auto [end_of_number, result] = std::from_chars (first, last, number);
+        if (result == std::errc () && end_of_number == last)
+            numbers.emplace_back (number);
+    }
+    if (numbers.empty ())
+        return;
+    std::sort (numbers.begin (), numbers.end ());
+    next_segment_number = numbers.back () + 1;
+
+    std::vector<std::unique_ptr<segment>> kept; // newest first.
+    auto n = numbers.rbegin ();
+    for (; n != numbers.rend () && kept.size () < max_segments; ++n) {
+        auto s = std::make_unique<segment> ();
+        s->path = segment_path (*n);
+        // checked first, as opening it read_write would resize it.
+        if (fs::file_size (s->path, error) != SEGMENT_SIZE || !s->file.open (s->path.c_str (), utils::mapped_file::access::read_write, SEGMENT_SIZE))
+            break;
+        const segment_header& header = *(const segment_header*) s->file.data ();
+        const bool valid = memcmp (header.magic, SEGMENT_MAGIC, sizeof (SEGMENT_MAGIC)) == 0
+            && header.version == SEGMENT_VERSION
+            && header.record_size == sizeof (stored_log)
+            && header.capacity == SEGMENT_CAPACITY
+            && header.count <= SEGMENT_CAPACITY
+            && (kept.empty () || (header.count == SEGMENT_CAPACITY && header.first + SEGMENT_CAPACITY == kept.back ()->first));
+        if (!valid)
+            break;
+        s->first = header.first;
+        kept.emplace_back (std::move (s));
+    }
+    for (; n != numbers.rend (); ++n)
+        std::remove (segment_path (*n).c_str ());
+    if (kept.empty ())
+        return;
+
+    segments.assign (std::make_move_iterator (kept.rbegin ()), std::make_move_iterator (kept.rend ()));
+    time_marks_first = segments.front ()->first;
+    const segment& newest = *segments.back ();
+    total = newest.first + ((const segment_header*) newest.file.data ())->count;
+    for (uint64_t i = segments.front ()->first; i < total; ++i)
+        index_record (*record (i), i);
+}
+
+std::string log_database::segment_path (uint32_t z_number) const {
+    return base_path + "." + std::to_string (z_number) + ".sgelog";
+}
+
+bool log_database::add_segment () {
+    auto s = std::make_unique<segment> ();
+    s->path = segment_path (next_segment_number);
+    s->first = total;
+    if (!s->file.open (s->path.c_str (), utils::mapped_file::access::read_write, SEGMENT_SIZE))
+        return false;
+
+    ++next_segment_number;
+    segment_header& header = *(segment_header*) s->file.data ();
+    memset (&header, 0, sizeof (segment_header));
+    memcpy (header.magic, SEGMENT_MAGIC, sizeof (SEGMENT_MAGIC));
+    header.version = SEGMENT_VERSION;
+    header.record_size = sizeof (stored_log);
+    header.capacity = SEGMENT_CAPACITY;
+    header.first = s->first;
+    header.count = 0;
+
+    if (!segments.empty ()) { // the previous segment is complete, push it all out.
+        auto& previous = segments.back ()->file;
+        previous.flush (0, previous.size ());
+    }
+    segments.emplace_back (std::move (s));
+    return true;
+}
+
+void log_database::roll_off_segment () {
+    assert (!segments.empty ());
+    const uint64_t new_first = segments.front ()->first + SEGMENT_CAPACITY;
+    for (auto& index : level_indices)
+        prune (index, new_first);
+    for (auto& kvp : channel_indices)
+        prune (kvp.second.index, new_first);
+    const size_t blocks = (size_t) ((new_first - time_marks_first) / TIME_BLOCK);
+    time_marks.erase (time_marks.begin (), time_marks.begin () + std::min (blocks, time_marks.size ()));
+    time_marks_first += (uint64_t) blocks * TIME_BLOCK;
+
+    segments.front ()->file.close ();
+    std::remove (segments.front ()->path.c_str ());
+    segments.erase (segments.begin ());
+}
+
+void log_database::prune (record_index& z_index, uint64_t z_first) {
+    auto end = std::lower_bound (z_index.records.begin (), z_index.records.end (), z_first);
+    z_index.pruned += (uint64_t) (end - z_index.records.begin ());
+    z_index.records.erase (z_index.records.begin (), end);
+}
+
+void log_database::append (const log& z_log) {
+    if (!is_open ())
+        return;
+
+    std::lock_guard<std::mutex> lock (mutex);
+    if (total - segments.back ()->first == SEGMENT_CAPACITY) {
+        if (segments.size () == max_segments)
+            roll_off_segment ();
+        if (!add_segment ()) { // out of disk space or similar, stop persisting logs rather than losing the ones we have.
+            max_segments = 0;
+            return;
+        }
+    }
+
+    segment& s = *segments.back ();
+    const uint64_t index = total - s.first;
+    stored_log& r = *(stored_log*) (s.file.data () + sizeof (segment_header) + index * sizeof (stored_log));
+    r.id = z_log.id;
+    r.timestamp = (int64_t) to_timestamp (z_log.timestamp);
+    r.level = (uint32_t) z_log.level;
+    to_utf8 (r.channel, z_log.channel);
+    to_utf8 (r.message, z_log.message);
+    r.channel_hash = hash_channel (r.channel);
+    ((segment_header*) s.file.data ())->count = index + 1;
+
+    index_record (r, total);
+    ++total;
+}
+
+void log_database::index_record (const stored_log& z_log, uint64_t z_index) {
+    if (z_log.level < level_indices.size ()) // only not so if read back from a damaged segment.
+        level_indices[z_log.level].records.emplace_back (z_index);
+    const size_t block = (size_t) ((z_index - time_marks_first) / TIME_BLOCK);
+    if (block == time_marks.size ())
+        time_marks.emplace_back (time_marks.empty () ? z_log.timestamp : std::max (time_marks.back (), z_log.timestamp));
+    else
+        time_marks.back () = std::max (time_marks.back (), z_log.timestamp);
+    channel_index& ci = channel_indices[z_log.channel_hash];
+    if (ci.name.empty ())
+        ci.name.assign (z_log.channel, strnlen (z_log.channel, stored_log::MAX_CHANNEL_LENGTH));
+    ci.index.records.emplace_back (z_index);
+}
+
+void log_database::flush () {
+    std::lock_guard<std::mutex> lock (mutex);
+    if (segments.empty ())
+        return;
+    auto& file = segments.back ()->file;
+    const size_t used = sizeof (segment_header) + (size_t) (total - segments.back ()->first) * sizeof (stored_log);
+    file.flush (0, used);
+}
+
+uint64_t log_database::first () const {
+    std::lock_guard<std::mutex> lock (mutex);
+    return segments.empty () ? total : segments.front ()->first;
+}
+
+uint64_t log_database::count () const {
+    std::lock_guard<std::mutex> lock (mutex);
+    return total;
+}
+
+uint32_t log_database::segment_count () const {
+    std::lock_guard<std::mutex> lock (mutex);
+    return (uint32_t) segments.size ();
+}
+
+const stored_log* log_database::record (uint64_t z_index) const {
+    if (segments.empty () || z_index < segments.front ()->first || z_index >= total)
+        return nullptr;
+    // all segments other than the last are full, so the segment can be found directly.
+    const size_t s = (size_t) ((z_index - segments.front ()->first) / SEGMENT_CAPACITY);
+    const segment& seg = *segments[s];
+    return (const stored_log*) (seg.file.data () + sizeof (segment_header) + (z_index - seg.first) * sizeof (stored_log));
+}
+
+bool log_database::get (uint64_t z_index, stored_log& z_out) const {
+    std::lock_guard<std::mutex> lock (mutex);
+    const stored_log* r = record (z_index);
+    if (!r)
+        return false;
+    z_out = *r;
+    return true;
+}
+
+uint64_t log_database::find_time (int64_t z_timestamp) const {
+    std::lock_guard<std::mutex> lock (mutex);
+    return time_lower_bound (z_timestamp);
+}
+
+// Wall clock timestamps aren't sorted (the clock can be adjusted) so records aren't searched directly, but the latest
+// timestamp up to the end of each block is, which never decreases.
+uint64_t log_database::time_lower_bound (int64_t z_timestamp) const {
+    const uint64_t lo = segments.empty () ? total : segments.front ()->first;
+    const size_t block = (size_t) (std::lower_bound (time_marks.begin (), time_marks.end (), z_timestamp) - time_marks.begin ());
+    return std::min (std::max (lo, time_marks_first + (uint64_t) block * TIME_BLOCK), total);
+}
+
+uint64_t log_database::level_count (runtime::log_level z_level) const {
+    std::lock_guard<std::mutex> lock (mutex);
+    return (uint64_t) level_indices[(size_t) z_level].records.size ();
+}
+
+std::vector<std::pair<uint32_t, std::string>> log_database::get_channels () const {
+    std::vector<std::pair<uint32_t, std::string>> result;
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        result.reserve (channel_indices.size ());
+        for (auto& kvp : channel_indices)
+            result.emplace_back (kvp.first, kvp.second.name);
+    }
+    std::sort (result.begin (), result.end (), [] (const auto& a, const auto& b) { return a.second < b.second; });
+    return result;
+}
+
+size_t log_database::candidates (const log_query& z_query, uint64_t& z_cursor, size_t z_max, uint64_t* z_out) const {
+    std::lock_guard<std::mutex> lock (mutex);
+    // the start of a time range narrows any source to the records that could be in it, the end can't be found the
+    // same way (later records can have earlier timestamps) so is left to `matches`.
+    uint64_t lo = segments.empty () ? total : segments.front ()->first;
+    const uint64_t hi = total;
+    if (z_query.time_begin != INT64_MIN)
+        lo = std::max (lo, time_lower_bound (z_query.time_begin));
+
+    // pick the narrowest index, the meaning of the cursor depends on the source but is fixed for a given query.
+    const record_index* source = nullptr;
+    if (z_query.channel_hash != 0) {
+        auto it = channel_indices.find (z_query.channel_hash);
+        if (it == channel_indices.end ())
+            return 0;
+        source = &it->second.index;
+    }
+    else if (z_query.level_mask != 0 && (z_query.level_mask & (z_query.level_mask - 1)) == 0) {
+        size_t level = 0;
+        while (!(z_query.level_mask & (1u << level))) ++level;
+        if (level >= level_indices.size ())
+            return 0;
+        source = &level_indices[level];
+    }
+
+    size_t n = 0;
+    if (source) { // cursor is a position in the index.
+        const uint64_t start = source->pruned + (uint64_t) (std::lower_bound (source->records.begin (), source->records.end (), lo) - source->records.begin ());
+        uint64_t position = std::max (z_cursor, start);
+        for (; position < source->size () && n < z_max; ++position) {
+            const uint64_t r = source->records[(size_t) (position - source->pruned)];
+            if (r >= hi)
+                break;
+            z_out[n++] = r;
+        }
+        z_cursor = position;
+    }
+    else { // cursor is a record number.
+        uint64_t position = std::max (z_cursor, lo);
+        for (; position < hi && n < z_max; ++position)
+            z_out[n++] = position;
+        z_cursor = position;
+    }
+    return n;
+}
+
+size_t log_database::filter (const log_query& z_query, uint64_t* z_records, size_t z_count) const {
+    std::lock_guard<std::mutex> lock (mutex);
+    size_t n = 0;
+    for (size_t i = 0; i < z_count; ++i) {
+        const stored_log* r = record (z_records[i]);
+        if (r && matches (z_query, *r))
+            z_records[n++] = z_records[i];
+    }
+    return n;
+}
+
+bool log_database::matches (const log_query& z_query, const stored_log& z_log) {
+    if (!(z_query.level_mask & (1u << z_log.level))) return false;
+    if (z_query.channel_hash != 0 && z_query.channel_hash != z_log.channel_hash) return false;
+    if (z_log.timestamp < z_query.time_begin || z_log.timestamp >= z_query.time_end) return false;
+    if (!z_query.text.empty () && !contains_case_insensitive (z_log.message, z_query.text)) return false;
+    return true;
+}
+
+int64_t log_database::to_timestamp (std::chrono::system_clock::time_point z) {
+    return (int64_t) std::chrono::duration_cast<std::chrono::microseconds> (z.time_since_epoch ()).count ();
+}
+
+uint32_t log_database::hash_channel (const char* z) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (; *z != '\0'; ++z) {
+        hash ^= (uint8_t) *z;
+        hash *= 16777619u;
+    }
+    return hash == 0 ? 1 : hash; // zero is reserved to mean any channel.
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+log_search::log_search (const log_database& z_database, jobs::scheduler& z_scheduler)
+    : database (z_database)
+    , scheduler (z_scheduler)
+{}
+
+log_search::~log_search () {
+    generation.fetch_add (1);
+    scheduler.wait (in_flight);
+}
+
+void log_search::update (const log_query& z_query) {
+    if (!has_query || z_query != query) {
+        generation.fetch_add (1); // anything in flight gives up at its next check.
+        query = z_query;
+        has_query = true;
+        restart = true;
+    }
+
+    if (!in_flight.is_complete ())
+        return;
+
+    // nothing to do until the query changes or more records arrive, unless the last search stopped part way.
+    const uint64_t count = database.count ();
+    if (!restart && caught_up && count == searched_count)
+        return;
+
+    if (restart) {
+        std::lock_guard<std::mutex> lock (results_mutex);
+        results.clear ();
+        cursor = 0;
+        restart = false;
+    }
+
+    searched_count = count;
+    caught_up = false;
+    const uint64_t g = generation.load ();
+    scheduler.run ([this, q = query, g] () { search (q, g); }, &in_flight);
+}
+
+void log_search::search (const log_query& z_query, uint64_t z_generation) {
+    // only one search job is ever in flight, so the cursor & scratch space are safe to use here.
+    scratch.resize (CHUNK_SIZE);
+    const size_t n = database.candidates (z_query, cursor, CHUNK_SIZE, scratch.data ());
+
+    // a batch at a time, so the database's lock isn't held for long (appends wait on it).
+    size_t found = 0;
+    for (size_t i = 0; i < n; i += BATCH_SIZE) {
+        if (generation.load (std::memory_order_relaxed) != z_generation)
+            return;
+        const size_t batch = std::min (BATCH_SIZE, n - i);
+        const size_t matched = database.filter (z_query, scratch.data () + i, batch);
+        std::copy (scratch.begin () + i, scratch.begin () + i + matched, scratch.begin () + found);
+        found += matched;
+    }
+    caught_up = n < CHUNK_SIZE;
+
+    std::lock_guard<std::mutex> lock (results_mutex);
+    if (generation.load () == z_generation)
+        results.insert (results.end (), scratch.begin (), scratch.begin () + found);
+}
+
+size_t log_search::result_count () const {
+    std::lock_guard<std::mutex> lock (results_mutex);
+    return results.size ();
+}
+
+size_t log_search::get_results (size_t z_begin, size_t z_max, uint64_t* z_out) const {
+    std::lock_guard<std::mutex> lock (results_mutex);
+    if (z_begin >= results.size ())
+        return 0;
+    const size_t n = std::min (z_max, results.size () - z_begin);
+    memcpy (z_out, results.data () + z_begin, n * sizeof (uint64_t));
+    return n;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+void stdout_log_sink::write (const log&, const char* z_formatted) {
+#if TARGET_WIN32
+    OutputDebugString (z_formatted);
+#else
+    fputs (z_formatted, stdout);
+#endif
+}
+
+void stdout_log_sink::flush () {
+#if !TARGET_WIN32
+    fflush (stdout);
+#endif
+}
+
+file_log_sink::file_log_sink (const char* z_path) {
+    file = fopen (z_path, "w");
+    assert (file);
+}
+
+file_log_sink::~file_log_sink () {
+    if (file) fclose (file);
+}
+
+void file_log_sink::write (const log&, const char* z_formatted) {
+    if (file) fputs (z_formatted, file);
+}
+
+void file_log_sink::flush () {
+    if (file) fflush (file);
+}
+
+void database_log_sink::write (const log& z_log, const char*) {
+    database.append (z_log);
+}
+
+void database_log_sink::flush () {
+    database.flush ();
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+namespace {
+    template<size_t N> void copy_truncated (wchar_t (&dest)[N], const wchar_t* src) {
+        size_t i = 0;
+        if (src) {
+            for (; i < N - 1 && src[i] != L'\0'; ++i)
+                dest[i] = src[i];
+        }
+        dest[i] = L'\0';
+    }
+}
+
+logger::logger () : ring (std::make_unique<std::array<cell, CAPACITY>> ()) {
+    for (size_t i = 0; i < CAPACITY; ++i)
+        (*ring)[i].sequence.store (i, std::memory_order_relaxed);
+}
+
+logger::~logger () {
+    stop ();
+}
+
+void logger::add_sink (std::unique_ptr<log_sink> z) {
+    assert (!running.load ());
+    sinks.emplace_back (std::move (z));
+}
+
+void logger::start () {
+    assert (!running.load ());
+    running.store (true);
+    sink_thread = std::thread (&logger::sink_main, this);
+}
+
+void logger::stop () {
+    if (!running.load ())
+        return;
+    {
+        std::lock_guard<std::mutex> lock (sleep_mutex);
+        running.store (false);
+    }
+    sleep_condition.notify_one ();
+    sink_thread.join ();
+
+    while (drain ()) {}
+    for (auto& sink : sinks)
+        sink->flush ();
+}
+
+bool logger::submit (runtime::log_level z_level, const wchar_t* z_channel, const wchar_t* z_message) {
+    cell* c = nullptr;
+    uint64_t position = enqueue_position.load (std::memory_order_relaxed);
+    while (true) {
+        c = &(*ring)[position & (CAPACITY - 1)];
+        const uint64_t sequence = c->sequence.load (std::memory_order_acquire);
+        const int64_t difference = (int64_t) sequence - (int64_t) position;
+        if (difference == 0) {
+            if (enqueue_position.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0) { // full.
+            dropped.fetch_add (1, std::memory_order_relaxed);
+            return false;
+        }
+        else position = enqueue_position.load (std::memory_order_relaxed);
+    }
+
+    c->record.id = position;
+    c->record.timestamp = std::chrono::system_clock::now ();
+    c->record.level = z_level;
+    copy_truncated (c->record.channel, z_channel);
+    copy_truncated (c->record.message, z_message);
+    c->sequence.store (position + 1, std::memory_order_release);
+
+    // only bother waking the sink early if it is falling behind, otherwise it'll pick this up on its next pass.
+    if (position - dequeue_position.load (std::memory_order_relaxed) == CAPACITY / 2)
+        sleep_condition.notify_one ();
+
+    return true;
+}
+
+bool logger::drain () {
+    bool any = false;
+    char channel[log::MAX_CHANNEL_LENGTH * 4];
+    char message[log::MAX_MESSAGE_LENGTH * 4];
+    char formatted[sizeof (channel) + sizeof (message) + 64];
+    uint64_t position = dequeue_position.load (std::memory_order_relaxed);
+    while (true) {
+        cell& c = (*ring)[position & (CAPACITY - 1)];
+        const uint64_t sequence = c.sequence.load (std::memory_order_acquire);
+        if (sequence != position + 1)
+            break;
+
+        // converted here rather than with %ls, which fails on anything but ascii in the default "C" locale.
+        const log& record = c.record;
+        to_utf8 (channel, record.channel);
+        to_utf8 (message, record.message);
+        if (snprintf (formatted, sizeof (formatted), "%lld [%s][%s] %s\n",
+            (long long) log_database::to_timestamp (record.timestamp), to_string (record.level), channel, message) < 0)
+            snprintf (formatted, sizeof (formatted), "[%s] (unformattable log)\n", to_string (record.level));
+        for (auto& sink : sinks)
+            sink->write (record, formatted);
+
+        c.sequence.store (position + CAPACITY, std::memory_order_release);
+        dequeue_position.store (++position, std::memory_order_relaxed);
+        any = true;
+    }
+    return any;
+}
+
+void logger::sink_main () {
+    while (running.load ()) {
+        if (drain ()) {
+            for (auto& sink : sinks)
+                sink->flush ();
+        }
+        std::unique_lock<std::mutex> lock (sleep_mutex);
+        sleep_condition.wait_for (lock, std::chrono::milliseconds (4), [this] () { return !running.load (); });
+    }
+}
+
+}
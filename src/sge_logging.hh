@@ -0,0 +1,261 @@
+// SGE-LOGGING
+// ---------------------------------- //
+// Asynchronous logging backend.
+// ---------------------------------- //
+// * Producers (any thread) copy a fixed size record into a lock-free MPSC ring, nothing is allocated or formatted.
+// * A background sink thread drains the ring, formats each record once and hands it to every sink.
+// * If the ring is full the record is dropped (and counted) rather than stalling the producer.
+// * Logs are persisted to memory mapped segment files, indexed by level, channel and time, and can be searched
+//   incrementally on the job system.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_runtime.hh"
+#include "sge_jobs.hh"
+#include "sge_mapped_file.hh"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace sge::core {
+
+struct log {
+    static const size_t MAX_CHANNEL_LENGTH = 32;  // including terminator, longer channels are truncated.
+    static const size_t MAX_MESSAGE_LENGTH = 256; // including terminator, longer messages are truncated.
+
+    uint64_t id; // monotonically increasing, unique per logger.
+    std::chrono::system_clock::time_point timestamp; // wall clock, so the logs of different sessions can be ordered.
+    runtime::log_level level;
+    wchar_t channel[MAX_CHANNEL_LENGTH];
+    wchar_t message[MAX_MESSAGE_LENGTH];
+};
+
+// Persistent representation of a log, fixed size so that records can be addressed by sequence number.
+struct stored_log {
+    static const size_t MAX_CHANNEL_LENGTH = 32;  // utf-8 bytes including terminator.
+    static const size_t MAX_MESSAGE_LENGTH = 200; // utf-8 bytes including terminator.
+
+    uint64_t id;
+    int64_t timestamp; // microseconds since the unix epoch.
+    uint32_t level;
+    uint32_t channel_hash;
+    char channel[MAX_CHANNEL_LENGTH];
+    char message[MAX_MESSAGE_LENGTH];
+};
+static_assert (sizeof (stored_log) == 256, "stored logs are expected to be 256 bytes");
+
+struct log_query {
+    uint32_t level_mask = 0xF;          // bit per runtime::log_level.
+    uint32_t channel_hash = 0;          // zero matches all channels.
+    int64_t time_begin = INT64_MIN;     // inclusive.
+    int64_t time_end = INT64_MAX;       // exclusive.
+    std::string text;                   // case insensitive substring of the message, empty matches everything.
+
+    bool is_unfiltered () const { return level_mask == 0xF && channel_hash == 0 && time_begin == INT64_MIN && time_end == INT64_MAX && text.empty (); }
+    bool operator == (const log_query& q) const { return level_mask == q.level_mask && channel_hash == q.channel_hash && time_begin == q.time_begin && time_end == q.time_end && text == q.text; }
+    bool operator != (const log_query& q) const { return !(*this == q); }
+};
+
+// Append only store of logs, held in memory mapped segment files (<base_path>.<n>.sgelog).
+// * opening continues from the segments of earlier sessions, rather than overwriting them.
+// * once the maximum number of segments is reached the oldest is rolled off (and deleted).
+// * appended to by the sink thread only, everything else is thread safe.
+class log_database {
+public:
+    static const uint32_t SEGMENT_CAPACITY = 1 << 16; // records per segment (16MB).
+    static const uint32_t TIME_BLOCK = 1 << 10; // records per entry of the time index, divides SEGMENT_CAPACITY.
+
+    log_database () = default;
+    ~log_database ();
+
+    bool            open                (const std::string& base_path, uint32_t max_segments);
+    void            close               ();
+    bool            is_open             () const { return max_segments > 0; }
+
+    void            append              (const log&);
+    void            flush               ();
+
+    uint64_t        first               () const; // oldest record still available.
+    uint64_t        count               () const; // one past the newest record.
+    uint32_t        segment_count       () const;
+    int64_t         opened_at           () const { return opened; } // timestamp of this session opening the database.
+    bool            get                 (uint64_t, stored_log&) const;
+
+    uint64_t        find_time           (int64_t) const; // a record before which every timestamp is earlier than the one given.
+    uint64_t        level_count         (runtime::log_level) const;
+    std::vector<std::pair<uint32_t, std::string>> get_channels () const;
+
+    // Copies up to `max` candidate record numbers for the query into `out`, starting from (and advancing) `cursor`.
+    // * the candidates come from whichever index narrows the query the most, they still need testing with `matches`.
+    size_t          candidates          (const log_query&, uint64_t& cursor, size_t max, uint64_t* out) const;
+    size_t          filter              (const log_query&, uint64_t* records, size_t count) const; // keeps, in order, the records still available that match.
+    static bool     matches             (const log_query&, const stored_log&);
+
+    static uint32_t hash_channel        (const char*);
+    static int64_t  to_timestamp        (std::chrono::system_clock::time_point); // as stored.
+
+private:
+    struct segment {
+        utils::mapped_file file;
+        std::string path;
+        uint64_t first;
+    };
+
+    // absolute positions are stable as older entries are pruned.
+    struct record_index {
+        std::vector<uint64_t> records;
+        uint64_t pruned = 0;
+        uint64_t size () const { return pruned + records.size (); }
+    };
+
+    struct channel_index {
+        std::string name;
+        record_index index;
+    };
+
+    const stored_log* record            (uint64_t) const; // lock must be held.
+    uint64_t        time_lower_bound    (int64_t) const; // lock must be held.
+    void            load_segments       ();
+    std::string     segment_path        (uint32_t) const;
+    bool            add_segment         ();
+    void            index_record        (const stored_log&, uint64_t);
+    void            roll_off_segment    ();
+    static void     prune               (record_index&, uint64_t);
+
+    std::string                                 base_path;
+    uint32_t                                    max_segments = 0;
+    uint32_t                                    next_segment_number = 0;
+    std::vector<std::unique_ptr<segment>>       segments;
+    std::array<record_index, 4>                 level_indices;
+    std::unordered_map<uint32_t, channel_index> channel_indices;
+    std::vector<int64_t>                        time_marks; // the latest timestamp up to the end of each block of records.
+    uint64_t                                    time_marks_first = 0; // the record the first block starts at.
+    uint64_t                                    total = 0;
+    int64_t                                     opened = 0;
+    mutable std::mutex                          mutex;
+};
+
+// Runs a query over the log database a chunk at a time on the job system, picking up new records as they arrive.
+class log_search {
+public:
+    static const size_t CHUNK_SIZE = 1 << 15; // candidates examined per job.
+    static const size_t BATCH_SIZE = 1 << 10; // candidates filtered per lock of the database.
+
+    log_search (const log_database&, jobs::scheduler&);
+    ~log_search ();
+
+    // Called once per frame on the main thread, restarts the search if the query has changed otherwise continues it.
+    void            update              (const log_query&);
+
+    size_t          result_count        () const;
+    size_t          get_results         (size_t begin, size_t max, uint64_t* out) const;
+    bool            is_searching        () const { return !in_flight.is_complete (); }
+
+private:
+    void            search              (const log_query&, uint64_t generation);
+
+    const log_database&         database;
+    jobs::scheduler&            scheduler;
+
+    log_query                   query;
+    bool                        has_query = false;
+    bool                        restart = false;
+    std::atomic<uint64_t>       generation = { 0 };
+    jobs::counter               in_flight;
+
+    uint64_t                    cursor = 0;     // only touched by the search job (or when none is in flight).
+    bool                        caught_up = false; // likewise, the last search reached the end of the candidates.
+    uint64_t                    searched_count = 0; // records in the database when the last search was started.
+    std::vector<uint64_t>       scratch;
+
+    std::vector<uint64_t>       results;
+    mutable std::mutex          results_mutex;
+};
+
+const char* to_string (runtime::log_level);
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+// Sinks are only ever called from the sink thread.
+class log_sink {
+public:
+    virtual ~log_sink () {};
+    virtual void write (const log&, const char* formatted) = 0;
+    virtual void flush () {};
+};
+
+class stdout_log_sink : public log_sink {
+public:
+    void write (const log&, const char*) override;
+    void flush () override;
+};
+
+class file_log_sink : public log_sink {
+    FILE* file = nullptr;
+public:
+    file_log_sink (const char* path);
+    ~file_log_sink ();
+    void write (const log&, const char*) override;
+    void flush () override;
+};
+
+class database_log_sink : public log_sink {
+    log_database& database;
+public:
+    database_log_sink (log_database& z) : database (z) {}
+    void write (const log&, const char*) override;
+    void flush () override;
+};
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+class logger {
+public:
+    static const size_t CAPACITY = 1024; // records, must be a power of two.
+
+    logger ();
+    ~logger ();
+
+    logger (const logger&) = delete;
+    logger& operator = (const logger&) = delete;
+
+    // sinks must be added before the logger is started.
+    void            add_sink                (std::unique_ptr<log_sink>);
+    void            start                   ();
+    void            stop                    (); // drains anything outstanding and flushes the sinks.
+
+    // thread safe & lock free, returns false if the record was dropped.
+    bool            submit                  (runtime::log_level, const wchar_t* channel, const wchar_t* message);
+
+    uint64_t        submitted_count         () const { return enqueue_position.load (std::memory_order_relaxed); }
+    uint64_t        dropped_count           () const { return dropped.load (std::memory_order_relaxed); }
+
+private:
+    static_assert ((CAPACITY & (CAPACITY - 1)) == 0, "logger capacity must be a power of two");
+
+    // See: Vyukov - Bounded MPMC queue (used here with a single consumer).
+    struct cell {
+        std::atomic<uint64_t> sequence;
+        log record;
+    };
+
+    bool            drain                   ();
+    void            sink_main               ();
+
+    std::unique_ptr<std::array<cell, CAPACITY>> ring;
+
+    alignas (64) std::atomic<uint64_t> enqueue_position = { 0 };
+    alignas (64) std::atomic<uint64_t> dequeue_position = { 0 };
+    alignas (64) std::atomic<uint64_t> dropped = { 0 };
+
+    std::vector<std::unique_ptr<log_sink>> sinks;
+
+    std::thread                 sink_thread;
+    std::atomic<bool>           running = { false };
+    std::mutex                  sleep_mutex;
+    std::condition_variable     sleep_condition;
+};
+
+}
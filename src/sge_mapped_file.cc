@@ -0,0 +1,126 @@
+#include "sge_mapped_file.hh"
+
+#if !TARGET_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sge::utils {
+
+mapped_file::~mapped_file () {
+    close ();
+}
+
+mapped_file::mapped_file (mapped_file&& other) {
+    *this = std::move (other);
+}
+
+mapped_file& mapped_file::operator = (mapped_file&& other) {
+    if (this != &other) {
+        close ();
+        std::swap (address, other.address);
+        std::swap (length, other.length);
+#if TARGET_WIN32
+        std::swap (file, other.file);
+        std::swap (mapping, other.mapping);
+#else
+        std::swap (descriptor, other.descriptor);
+#endif
+    }
+    return *this;
+}
+
+#if TARGET_WIN32
+
+bool mapped_file::open (const char* z_path, access z_access, size_t z_size) {
+    assert (!is_open ());
+    const bool rw = z_access == access::read_write;
+
+    file = CreateFileA (z_path, rw ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+        rw ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER sz;
+    if (rw) sz.QuadPart = (LONGLONG) z_size;
+    else GetFileSizeEx (file, &sz);
+
+    if (sz.QuadPart == 0) { close (); return false; }
+
+    mapping = CreateFileMappingA (file, NULL, rw ? PAGE_READWRITE : PAGE_READONLY, sz.HighPart, sz.LowPart, NULL);
+    if (mapping == NULL) { close (); return false; }
+
+    address = (uint8_t*) MapViewOfFile (mapping, rw ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (!address) { close (); return false; }
+
+    length = (size_t) sz.QuadPart;
+    return true;
+}
+
+void mapped_file::close () {
+    if (address) UnmapViewOfFile (address);
+    if (mapping != NULL) CloseHandle (mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle (file);
+    address = nullptr;
+    length = 0;
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+}
+
+void mapped_file::flush (size_t z_offset, size_t z_size) {
+    assert (z_offset + z_size <= length);
+    if (address) FlushViewOfFile (address + z_offset, z_size);
+}
+
+#else
+
+bool mapped_file::open (const char* z_path, access z_access, size_t z_size) {
+    assert (!is_open ());
+    const bool rw = z_access == access::read_write;
+
+    descriptor = ::open (z_path, rw ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (descriptor < 0)
+        return false;
+
+    size_t sz = z_size;
+    if (rw) {
+        if (ftruncate (descriptor, (off_t) sz) != 0) { close (); return false; }
+    }
+    else {
+        struct stat st;
+        if (fstat (descriptor, &st) != 0) { close (); return false; }
+        sz = (size_t) st.st_size;
+    }
+
+    if (sz == 0) { close (); return false; }
+
+    void* p = mmap (nullptr, sz, rw ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, descriptor, 0);
+    if (p == MAP_FAILED) { close (); return false; }
+
+    address = (uint8_t*) p;
+    length = sz;
+    return true;
+}
+
+void mapped_file::close () {
+    if (address) munmap (address, length);
+    if (descriptor >= 0) ::close (descriptor);
+    address = nullptr;
+    length = 0;
+    descriptor = -1;
+}
+
+void mapped_file::flush (size_t z_offset, size_t z_size) {
+    assert (z_offset + z_size <= length);
+    if (!address) return;
+    // msync needs a page aligned address.
+    const size_t page = (size_t) sysconf (_SC_PAGESIZE);
+    const size_t begin = (z_offset / page) * page;
+    msync (address + begin, z_offset + z_size - begin, MS_ASYNC);
+}
+
+#endif
+
+}
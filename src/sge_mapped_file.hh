@@ -0,0 +1,48 @@
+// SGE-MAPPED-FILE
+// ---------------------------------- //
+// Memory mapped files.
+// ---------------------------------- //
+
+#pragma once
+
+#include "sge.hh"
+
+namespace sge::utils {
+
+class mapped_file {
+public:
+    enum class access { read_only, read_write };
+
+    mapped_file () = default;
+    ~mapped_file ();
+
+    mapped_file (const mapped_file&) = delete;
+    mapped_file& operator = (const mapped_file&) = delete;
+    mapped_file (mapped_file&&);
+    mapped_file& operator = (mapped_file&&);
+
+    // read_only maps the whole of an existing file, size is ignored.
+    // read_write creates the file if needed and sets its length to size before mapping it.
+    bool            open            (const char* path, access, size_t size = 0);
+    void            close           ();
+
+    // writes dirty pages in the given range back to disk (read_write only), doesn't wait for completion.
+    void            flush           (size_t offset, size_t size);
+
+    bool            is_open         () const { return address != nullptr; }
+    uint8_t*        data            () const { return address; }
+    size_t          size            () const { return length; }
+    dataspan        span            () const { return { address, length }; }
+
+private:
+    uint8_t*        address = nullptr;
+    size_t          length = 0;
+#if TARGET_WIN32
+    HANDLE          file = INVALID_HANDLE_VALUE;
+    HANDLE          mapping = NULL;
+#else
+    int             descriptor = -1;
+#endif
+};
+
+}
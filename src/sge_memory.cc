@@ -0,0 +1,217 @@
+#include "sge_memory.hh"
+
+#include <mutex>
+#include <new>
+
+namespace sge::memory {
+
+#if SGE_ALLOCATION_TRACKING
+
+//--------------------------------------------------------------------------------------------------------------------//
+// Everything touched from the allocation hooks is constant initialised so that it is usable before (and after) any
+// static constructors run and so that counting never allocates.
+
+struct zone_counters {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> frees;
+};
+
+static zone_counters                counters[MAX_ZONES];
+static const char*                  zone_names[MAX_ZONES] = { "other" };
+static bool                         zone_exempt[MAX_ZONES] = {};
+static std::atomic<uint32_t>        zone_count { 1 };
+static std::mutex                   zone_mutex;
+
+static thread_local zone_id         current_zone = 0;
+
+static frame_stats                  last_frame;
+static zone_stats                   totals[MAX_ZONES];
+static uint64_t                     frame_index = 0;
+
+static inline void record_allocation (size_t z_size) {
+    zone_counters& c = counters[current_zone];
+    c.allocations.fetch_add (1, std::memory_order_relaxed);
+    c.bytes.fetch_add (z_size, std::memory_order_relaxed);
+}
+
+static inline void record_free () {
+    counters[current_zone].frees.fetch_add (1, std::memory_order_relaxed);
+}
+
+zone_id register_zone (const char* z_name, bool z_exempt) {
+    std::lock_guard<std::mutex> lock (zone_mutex);
+    const uint32_t count = zone_count.load (std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i)
+        if (strcmp (zone_names[i], z_name) == 0)
+            return i;
+    assert (count < MAX_ZONES);
+    if (count == MAX_ZONES)
+        return 0;
+    zone_names[count] = z_name;
+    zone_exempt[count] = z_exempt;
+    zone_count.store (count + 1, std::memory_order_release);
+    return count;
+}
+
+const char* get_zone_name (zone_id z) { assert (z < get_zone_count ()); return zone_names[z]; }
+bool is_zone_exempt (zone_id z) { assert (z < get_zone_count ()); return zone_exempt[z]; }
+uint32_t get_zone_count () { return zone_count.load (std::memory_order_acquire); }
+
+frame_stats end_frame () {
+    frame_stats stats = {};
+    stats.frame = frame_index++;
+    const uint32_t count = get_zone_count ();
+    for (uint32_t i = 0; i < count; ++i) {
+        zone_stats& z = stats.zones[i];
+        z.allocations = counters[i].allocations.exchange (0, std::memory_order_relaxed);
+        z.bytes = counters[i].bytes.exchange (0, std::memory_order_relaxed);
+        z.frees = counters[i].frees.exchange (0, std::memory_order_relaxed);
+        totals[i].allocations += z.allocations;
+        totals[i].bytes += z.bytes;
+        totals[i].frees += z.frees;
+        if (!zone_exempt[i]) {
+            stats.allocations += z.allocations;
+            stats.bytes += z.bytes;
+        }
+    }
+    last_frame = stats;
+    return stats;
+}
+
+const frame_stats& get_last_frame () { return last_frame; }
+const zone_stats& get_total (zone_id z) { assert (z < MAX_ZONES); return totals[z]; }
+
+scoped_zone::scoped_zone (zone_id z) : previous (current_zone) { current_zone = z; }
+scoped_zone::~scoped_zone () { current_zone = previous; }
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+#if TARGET_LINUX
+extern "C" {
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+}
+static inline void* raw_malloc (size_t z_size) { return __libc_malloc (z_size); }
+static inline void* raw_aligned_malloc (size_t z_size, size_t z_align) { return __libc_memalign (z_align, z_size); }
+static inline void raw_free (void* z) { __libc_free (z); }
+static inline void raw_aligned_free (void* z) { __libc_free (z); }
+#elif TARGET_WIN32
+static inline void* raw_malloc (size_t z_size) { return ::malloc (z_size); }
+static inline void* raw_aligned_malloc (size_t z_size, size_t z_align) { return _aligned_malloc (z_size, z_align); }
+static inline void raw_free (void* z) { ::free (z); }
+static inline void raw_aligned_free (void* z) { _aligned_free (z); }
+#else
+static inline void* raw_malloc (size_t z_size) { return ::malloc (z_size); }
+static inline void* raw_aligned_malloc (size_t z_size, size_t z_align) {
+    void* p = nullptr;
+    if (posix_memalign (&p, std::max (z_align, sizeof (void*)), z_size) != 0)
+        return nullptr;
+    return p;
+}
+static inline void raw_free (void* z) { ::free (z); }
+static inline void raw_aligned_free (void* z) { ::free (z); }
+#endif
+
+static inline void* tracked_malloc (size_t z_size) {
+    record_allocation (z_size);
+    return raw_malloc (z_size > 0 ? z_size : 1);
+}
+
+static inline void* tracked_aligned_malloc (size_t z_size, size_t z_align) {
+    record_allocation (z_size);
+    return raw_aligned_malloc (z_size > 0 ? z_size : 1, z_align);
+}
+
+static inline void tracked_free (void* z) {
+    if (!z) return;
+    record_free ();
+    raw_free (z);
+}
+
+static inline void tracked_aligned_free (void* z) {
+    if (!z) return;
+    record_free ();
+    raw_aligned_free (z);
+}
+
+static void* tracked_new (size_t z_size) {
+    void* p = tracked_malloc (z_size);
+    if (!p) throw std::bad_alloc ();
+    return p;
+}
+
+static void* tracked_aligned_new (size_t z_size, std::align_val_t z_align) {
+    void* p = tracked_aligned_malloc (z_size, (size_t) z_align);
+    if (!p) throw std::bad_alloc ();
+    return p;
+}
+
+#else
+
+static frame_stats                  empty_frame;
+static zone_stats                   empty_zone;
+
+zone_id register_zone (const char*, bool) { return 0; }
+const char* get_zone_name (zone_id) { return "other"; }
+bool is_zone_exempt (zone_id) { return false; }
+uint32_t get_zone_count () { return 1; }
+frame_stats end_frame () { return {}; }
+const frame_stats& get_last_frame () { return empty_frame; }
+const zone_stats& get_total (zone_id) { return empty_zone; }
+
+#endif
+
+}
+
+#if SGE_ALLOCATION_TRACKING
+
+//--------------------------------------------------------------------------------------------------------------------//
+// Global replacements.
+
+using namespace sge::memory;
+
+void* operator new (size_t z_size) { return tracked_new (z_size); }
+void* operator new[] (size_t z_size) { return tracked_new (z_size); }
+void* operator new (size_t z_size, const std::nothrow_t&) noexcept { return tracked_malloc (z_size); }
+void* operator new[] (size_t z_size, const std::nothrow_t&) noexcept { return tracked_malloc (z_size); }
+void* operator new (size_t z_size, std::align_val_t z_align) { return tracked_aligned_new (z_size, z_align); }
+void* operator new[] (size_t z_size, std::align_val_t z_align) { return tracked_aligned_new (z_size, z_align); }
+void* operator new (size_t z_size, std::align_val_t z_align, const std::nothrow_t&) noexcept { return tracked_aligned_malloc (z_size, (size_t) z_align); }
+void* operator new[] (size_t z_size, std::align_val_t z_align, const std::nothrow_t&) noexcept { return tracked_aligned_malloc (z_size, (size_t) z_align); }
+
+void operator delete (void* z) noexcept { tracked_free (z); }
+void operator delete[] (void* z) noexcept { tracked_free (z); }
+void operator delete (void* z, size_t) noexcept { tracked_free (z); }
+void operator delete[] (void* z, size_t) noexcept { tracked_free (z); }
+void operator delete (void* z, const std::nothrow_t&) noexcept { tracked_free (z); }
+void operator delete[] (void* z, const std::nothrow_t&) noexcept { tracked_free (z); }
+void operator delete (void* z, std::align_val_t) noexcept { tracked_aligned_free (z); }
+void operator delete[] (void* z, std::align_val_t) noexcept { tracked_aligned_free (z); }
+void operator delete (void* z, size_t, std::align_val_t) noexcept { tracked_aligned_free (z); }
+void operator delete[] (void* z, size_t, std::align_val_t) noexcept { tracked_aligned_free (z); }
+void operator delete (void* z, std::align_val_t, const std::nothrow_t&) noexcept { tracked_aligned_free (z); }
+void operator delete[] (void* z, std::align_val_t, const std::nothrow_t&) noexcept { tracked_aligned_free (z); }
+
+#if TARGET_LINUX
+// Interposes the C allocator too, so that allocations from C libraries (and from operator new in libraries that do
+// not see the replacements above) are counted.
+extern "C" {
+void* malloc (size_t z_size) { return tracked_malloc (z_size); }
+void free (void* z) { tracked_free (z); }
+void* calloc (size_t z_count, size_t z_size) {
+    record_allocation (z_count * z_size);
+    return __libc_calloc (z_count, z_size);
+}
+void* realloc (void* z, size_t z_size) {
+    if (z_size > 0) record_allocation (z_size);
+    if (z) record_free ();
+    return __libc_realloc (z, z_size);
+}
+}
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+// SGE-MEMORY
+// ---------------------------------- //
+// Heap allocation tracking.
+// ---------------------------------- //
+// * Opt-in, define SGE_ALLOCATION_TRACKING to replace global operator new/delete (and, on Linux, to interpose
+//   malloc/calloc/realloc/free) with versions that count allocations, otherwise everything here compiles away.
+// * Allocations are attributed to the zone active on the allocating thread, zones nest and default to "other".
+// * Counters are per frame, the engine closes each frame with `end_frame`.
+
+#pragma once
+
+#include "sge.hh"
+
+#include <atomic>
+
+namespace sge::memory {
+
+static const uint32_t MAX_ZONES = 32;
+
+typedef uint32_t zone_id;
+
+struct zone_stats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+};
+
+struct frame_stats {
+    uint64_t frame = 0;             // index of the frame these stats are for.
+    uint64_t allocations = 0;       // excluding exempt zones.
+    uint64_t bytes = 0;             // excluding exempt zones.
+    std::array<zone_stats, MAX_ZONES> zones;
+};
+
+constexpr bool is_tracking_enabled () {
+#if SGE_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Exempt zones (i.e. debug ui) are still counted but do not count towards the frame totals.
+zone_id             register_zone       (const char* name, bool exempt = false);
+const char*         get_zone_name       (zone_id);
+bool                is_zone_exempt      (zone_id);
+uint32_t            get_zone_count      ();
+
+// Closes the current frame, returns its stats and resets the per-frame counters.
+frame_stats         end_frame           ();
+const frame_stats&  get_last_frame      ();
+const zone_stats&   get_total           (zone_id); // since startup, only updated by `end_frame`.
+
+class scoped_zone {
+public:
+#if SGE_ALLOCATION_TRACKING
+    scoped_zone (zone_id);
+    ~scoped_zone ();
+private:
+    zone_id previous;
+#else
+    scoped_zone (zone_id) {}
+#endif
+    scoped_zone (const scoped_zone&) = delete;
+    scoped_zone& operator = (const scoped_zone&) = delete;
+};
+
+}
+
+#define SGE_MEMORY_CONCAT_INNER(a, b) a ## b
+#define SGE_MEMORY_CONCAT(a, b) SGE_MEMORY_CONCAT_INNER(a, b)
+
+// Attributes allocations made on this thread, until the end of the enclosing scope, to the named zone.
+#if SGE_ALLOCATION_TRACKING
+#define SGE_MEMORY_ZONE(name) \
+    static const sge::memory::zone_id SGE_MEMORY_CONCAT(sge_memory_zone_id_, __LINE__) = sge::memory::register_zone (name); \
+    const sge::memory::scoped_zone SGE_MEMORY_CONCAT(sge_memory_zone_, __LINE__) (SGE_MEMORY_CONCAT(sge_memory_zone_id_, __LINE__))
+#define SGE_MEMORY_EXEMPT_ZONE(name) \
+    static const sge::memory::zone_id SGE_MEMORY_CONCAT(sge_memory_zone_id_, __LINE__) = sge::memory::register_zone (name, true); \
+    const sge::memory::scoped_zone SGE_MEMORY_CONCAT(sge_memory_zone_, __LINE__) (SGE_MEMORY_CONCAT(sge_memory_zone_id_, __LINE__))
+#else
+#define SGE_MEMORY_ZONE(name)
+#define SGE_MEMORY_EXEMPT_ZONE(name)
+#endif
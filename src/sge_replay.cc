@@ -0,0 +1,357 @@
+#include "sge_replay.hh"
+
+namespace sge::core {
+
+namespace {
+    const char TRACE_MAGIC[8] = { 'S', 'G', 'E', 'I', 'N', 'P', 'U', 'T' };
+    const uint32_t TRACE_VERSION = 1;
+    const size_t TRACE_HEADER_SIZE = 16; // magic, version, reserved.
+
+    enum frame_flags : uint8_t { FRAME_CLIENT = 1 << 0 };
+
+    template<typename T> void put (std::vector<uint8_t>& z_buffer, const T& z_value) {
+        static_assert (std::is_trivially_copyable<T>::value, "");
+        const size_t offset = z_buffer.size ();
+        z_buffer.resize (offset + sizeof (T));
+        memcpy (z_buffer.data () + offset, &z_value, sizeof (T));
+    }
+
+    // reads are bounds checked against the end of the frame.
+    struct reader {
+        const uint8_t* p;
+        const uint8_t* end;
+        template<typename T> bool get (T& z_value) {
+            if (p + sizeof (T) > end) return false;
+            memcpy (&z_value, p, sizeof (T));
+            p += sizeof (T);
+            return true;
+        }
+    };
+
+    void put_client (std::vector<uint8_t>& z_buffer, const client_state& z) {
+        put<uint8_t> (z_buffer, z.is_resizing ? 1 : 0);
+        const int32_t values[] = {
+            z.window_width, z.window_height, z.window_position_x, z.window_position_y,
+            z.container_width, z.container_height, z.container_position_x, z.container_position_y,
+            z.max_container_width, z.max_container_height };
+        for (int32_t v : values) put (z_buffer, v);
+    }
+
+    bool get_client (reader& z_reader, client_state& z) {
+        uint8_t resizing;
+        int32_t v[10];
+        if (!z_reader.get (resizing)) return false;
+        for (auto& x : v) if (!z_reader.get (x)) return false;
+        z.is_resizing = resizing != 0;
+        z.window_width = v[0]; z.window_height = v[1]; z.window_position_x = v[2]; z.window_position_y = v[3];
+        z.container_width = v[4]; z.container_height = v[5]; z.container_position_x = v[6]; z.container_position_y = v[7];
+        z.max_container_width = v[8]; z.max_container_height = v[9];
+        return true;
+    }
+
+    bool operator != (const client_state& a, const client_state& b) {
+        return a.is_resizing != b.is_resizing
+            || a.window_width != b.window_width || a.window_height != b.window_height
+            || a.window_position_x != b.window_position_x || a.window_position_y != b.window_position_y
+            || a.container_width != b.container_width || a.container_height != b.container_height
+            || a.container_position_x != b.container_position_x || a.container_position_y != b.container_position_y
+            || a.max_container_width != b.max_container_width || a.max_container_height != b.max_container_height;
+    }
+
+    void put_control (std::vector<uint8_t>& z_buffer, input_control_identifier z_id, const input_control_value& z_value) {
+        put<uint16_t> (z_buffer, (uint16_t) z_id);
+        put<uint8_t> (z_buffer, (uint8_t) z_value.index ());
+        std::visit ([&z_buffer] (const auto& v) {
+            using T = std::decay_t<decltype (v)>;
+            if constexpr (std::is_same_v<T, input_binary_control>) put<uint8_t> (z_buffer, v ? 1 : 0);
+            else if constexpr (std::is_same_v<T, input_quaternary_control>) put<uint8_t> (z_buffer, (v.first ? 1 : 0) | (v.second ? 2 : 0));
+            else if constexpr (std::is_same_v<T, input_character_control>) put<uint32_t> (z_buffer, (uint32_t) v);
+            else if constexpr (std::is_same_v<T, input_digital_control>) put<int32_t> (z_buffer, (int32_t) v);
+            else if constexpr (std::is_same_v<T, input_point_control>) { put<int32_t> (z_buffer, v.x); put<int32_t> (z_buffer, v.y); }
+            else if constexpr (std::is_same_v<T, input_analogue_control>) put<float> (z_buffer, v);
+        }, z_value);
+    }
+
+    bool get_control (reader& z_reader, input_state& z_input) {
+        uint16_t id; uint8_t type;
+        if (!z_reader.get (id) || !z_reader.get (type)) return false;
+        if (id >= (uint16_t) input_control_identifier::COUNT) return false;
+        input_control_value value;
+        switch (type) {
+            case 0: { uint8_t v; if (!z_reader.get (v)) return false; value = input_binary_control (v != 0); break; }
+            case 1: { uint8_t v; if (!z_reader.get (v)) return false; value = input_quaternary_control ((v & 1) != 0, (v & 2) != 0); break; }
+            case 2: { uint32_t v; if (!z_reader.get (v)) return false; value = (input_character_control) v; break; }
+            case 3: { int32_t v; if (!z_reader.get (v)) return false; value = (input_digital_control) v; break; }
+            case 4: { int32_t x, y; if (!z_reader.get (x) || !z_reader.get (y)) return false; value = input_point_control (x, y); break; }
+            case 5: { float v; if (!z_reader.get (v)) return false; value = (input_analogue_control) v; break; }
+            default: return false;
+        }
+        z_input[(input_control_identifier) id] = value;
+        return true;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+input_recorder::~input_recorder () {
+    close ();
+}
+
+bool input_recorder::open (const char* z_path) {
+    assert (!is_open ());
+    file = fopen (z_path, "wb");
+    if (!file)
+        return false;
+
+    uint8_t header[TRACE_HEADER_SIZE] = {};
+    memcpy (header, TRACE_MAGIC, sizeof (TRACE_MAGIC));
+    memcpy (header + 8, &TRACE_VERSION, sizeof (TRACE_VERSION));
+    fwrite (header, 1, sizeof (header), file);
+
+    frames = 0;
+    bytes = sizeof (header);
+    previous = replay_frame ();
+    return true;
+}
+
+void input_recorder::close () {
+    if (file) fclose (file);
+    file = nullptr;
+}
+
+void input_recorder::record (const replay_frame& z_frame) {
+    assert (is_open ());
+    buffer.clear ();
+
+    const bool client_changed = frames == 0 || z_frame.client != previous.client;
+    put<float> (buffer, z_frame.dt);
+    put<float> (buffer, z_frame.total_time);
+    put<uint8_t> (buffer, client_changed ? FRAME_CLIENT : 0);
+    if (client_changed)
+        put_client (buffer, z_frame.client);
+
+    // removed controls.
+    const size_t removed_offset = buffer.size ();
+    uint16_t removed = 0;
+    put<uint16_t> (buffer, 0);
+    for (auto& kvp : previous.input) {
+        if (z_frame.input.find (kvp.first) == z_frame.input.end ()) {
+            put<uint16_t> (buffer, (uint16_t) kvp.first);
+            ++removed;
+        }
+    }
+    memcpy (buffer.data () + removed_offset, &removed, sizeof (removed));
+
+    // added or changed controls.
+    const size_t changed_offset = buffer.size ();
+    uint16_t changed = 0;
+    put<uint16_t> (buffer, 0);
+    for (auto& kvp : z_frame.input) {
+        auto it = previous.input.find (kvp.first);
+        if (it == previous.input.end () || !(it->second == kvp.second)) {
+            put_control (buffer, kvp.first, kvp.second);
+            ++changed;
+        }
+    }
+    memcpy (buffer.data () + changed_offset, &changed, sizeof (changed));
+
+    const uint32_t size = (uint32_t) buffer.size ();
+    fwrite (&size, sizeof (size), 1, file);
+    fwrite (buffer.data (), 1, buffer.size (), file);
+
+    bytes += sizeof (size) + buffer.size ();
+    ++frames;
+    previous = z_frame;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+bool input_player::open (const char* z_path) {
+    assert (!is_open ());
+    if (!file.open (z_path, utils::mapped_file::access::read_only))
+        return false;
+
+    const uint8_t* data = file.data ();
+    const size_t size = file.size ();
+    uint32_t version = 0;
+    if (size < TRACE_HEADER_SIZE || memcmp (data, TRACE_MAGIC, sizeof (TRACE_MAGIC)) != 0) { close (); return false; }
+    memcpy (&version, data + 8, sizeof (version));
+    if (version != TRACE_VERSION) { close (); return false; }
+
+    // index the frames, a trailing partial frame (from a recording that was cut short) is ignored.
+    size_t offset = TRACE_HEADER_SIZE;
+    while (offset + sizeof (uint32_t) <= size) {
+        uint32_t frame_size;
+        memcpy (&frame_size, data + offset, sizeof (frame_size));
+        offset += sizeof (frame_size);
+        if (offset + frame_size > size)
+            break;
+        offsets.emplace_back (offset);
+        offset += frame_size;
+    }
+
+    rewind ();
+    return true;
+}
+
+void input_player::close () {
+    file.close ();
+    offsets.clear ();
+    next = 0;
+    frame = replay_frame ();
+    changed_client = false;
+}
+
+void input_player::rewind () {
+    next = 0;
+    frame = replay_frame ();
+    changed_client = false;
+}
+
+bool input_player::advance () {
+    if (at_end ())
+        return false;
+
+    const uint8_t* data = file.data ();
+    uint32_t frame_size;
+    memcpy (&frame_size, data + offsets[next] - sizeof (uint32_t), sizeof (frame_size));
+    reader r { data + offsets[next], data + offsets[next] + frame_size };
+
+    replay_frame f = frame;
+    uint8_t flags = 0;
+    uint16_t removed = 0, changed = 0;
+    bool ok = r.get (f.dt) && r.get (f.total_time) && r.get (flags);
+    if (ok && (flags & FRAME_CLIENT))
+        ok = get_client (r, f.client);
+    ok = ok && r.get (removed);
+    for (uint16_t i = 0; ok && i < removed; ++i) {
+        uint16_t id;
+        ok = r.get (id);
+        if (ok) f.input.erase ((input_control_identifier) id);
+    }
+    ok = ok && r.get (changed);
+    for (uint16_t i = 0; ok && i < changed; ++i)
+        ok = get_control (r, f.input);
+
+    assert (ok);
+    if (!ok) { // corrupt, treat it as the end of the trace.
+        offsets.resize (next);
+        return false;
+    }
+
+    frame = std::move (f);
+    changed_client = (flags & FRAME_CLIENT) != 0;
+    ++next;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+replay_session::replay_session (const std::string& z_trace_path, const std::string& z_timings_path)
+    : trace_path (z_trace_path)
+    , timings_path (z_timings_path)
+{}
+
+replay_session::~replay_session () {
+    stop_recording ();
+    stop_replay ();
+}
+
+bool replay_session::start_recording () {
+    if (is_replaying () || is_recording ())
+        return false;
+    return recorder.open (trace_path.c_str ());
+}
+
+void replay_session::stop_recording () {
+    recorder.close ();
+}
+
+bool replay_session::start_replay () {
+    if (is_replaying () || is_recording ())
+        return false;
+    if (!player.open (trace_path.c_str ()))
+        return false;
+    if (!timings_path.empty ()) {
+        timings = fopen (timings_path.c_str (), "w");
+        if (timings) fputs ("frame,dt_ms,frame_ms,extensions_ms\n", timings);
+    }
+    paused = false;
+    step_requested = false;
+    return true;
+}
+
+void replay_session::stop_replay () {
+    player.close ();
+    if (timings) fclose (timings);
+    timings = nullptr;
+}
+
+void replay_session::begin_frame (engine_state& z_state, engine_tasks& z_tasks) {
+    advanced = false;
+
+    if (is_recording ()) {
+        replay_frame f;
+        f.dt = z_state.instrumentation.frameTimer;
+        f.total_time = z_state.instrumentation.totalTimer;
+        f.client = z_state.client;
+        f.input = z_state.input;
+        recorder.record (f);
+        return;
+    }
+
+    if (!is_replaying ())
+        return;
+
+    if (!paused || step_requested) {
+        advanced = player.advance ();
+        if (!advanced) paused = true; // hold the last frame once the trace is exhausted.
+        step_requested = false;
+    }
+
+    const replay_frame& f = player.current ();
+    if (advanced && player.client_changed ()) { // match the recorded canvas size, otherwise timings aren't comparable.
+        if (f.client.container_width != z_state.client.container_width) z_tasks.change_canvas_width = f.client.container_width;
+        if (f.client.container_height != z_state.client.container_height) z_tasks.change_canvas_height = f.client.container_height;
+    }
+
+    z_state.input = f.input;
+    z_state.instrumentation.frameTimer = advanced ? f.dt : 0.0f;
+    z_state.instrumentation.totalTimer = f.total_time;
+}
+
+void replay_session::end_frame (float z_frame_ms, float z_extensions_ms) {
+    if (advanced && timings) {
+        fprintf (timings, "%u,%.4f,%.4f,%.4f\n", player.position () - 1, player.current ().dt * 1000.0f, z_frame_ms, z_extensions_ms);
+        if (player.at_end ()) fflush (timings);
+    }
+}
+
+void replay_session::debug_ui () {
+    ImGui::Text ("Trace: %s", trace_path.c_str ());
+
+    if (is_recording ()) {
+        ImGui::Text ("Recording: %u frames (%.1f KB)", recorder.frame_count (), (double) recorder.byte_count () / 1024.0);
+        if (ImGui::Button ("Stop recording")) stop_recording ();
+        return;
+    }
+
+    if (is_replaying ()) {
+        ImGui::Text ("Replaying: frame %u / %u%s", player.position (), player.frame_count (), player.at_end () ? " (end)" : "");
+        ImGui::ProgressBar (player.frame_count () ? (float) player.position () / (float) player.frame_count () : 0.0f);
+        if (ImGui::Button (paused ? "Resume" : "Pause")) paused = !paused;
+        ImGui::SameLine ();
+        if (ImGui::Button ("Step")) { paused = true; step (); }
+        ImGui::SameLine ();
+        if (ImGui::Button ("Restart")) player.rewind ();
+        ImGui::SameLine ();
+        if (ImGui::Button ("Stop replay")) stop_replay ();
+        return;
+    }
+
+    if (ImGui::Button ("Record")) start_recording ();
+    ImGui::SameLine ();
+    if (ImGui::Button ("Replay")) start_replay ();
+}
+
+}
@@ -0,0 +1,119 @@
+// SGE-REPLAY
+// ---------------------------------- //
+// Recording & deterministic playback of
+// engine input.
+// ---------------------------------- //
+// * A trace holds, per frame, the time step, the total time, the container state and the changes to the input
+//   state since the previous frame (controls that were added/changed and controls that were removed).
+// * Traces are written through a buffered file and memory mapped for playback.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_core.hh"
+#include "sge_mapped_file.hh"
+
+namespace sge::core {
+
+struct replay_frame {
+    float dt = 0.0f;
+    float total_time = 0.0f;
+    client_state client;
+    input_state input;
+};
+
+class input_recorder {
+public:
+    input_recorder () = default;
+    ~input_recorder ();
+
+    input_recorder (const input_recorder&) = delete;
+    input_recorder& operator = (const input_recorder&) = delete;
+
+    bool            open                (const char* path);
+    void            close               ();
+    bool            is_open             () const { return file != nullptr; }
+
+    void            record              (const replay_frame&);
+
+    uint32_t        frame_count         () const { return frames; }
+    uint64_t        byte_count          () const { return bytes; }
+
+private:
+    FILE*                   file = nullptr;
+    uint32_t                frames = 0;
+    uint64_t                bytes = 0;
+    replay_frame            previous;
+    std::vector<uint8_t>    buffer;
+};
+
+class input_player {
+public:
+    bool            open                (const char* path);
+    void            close               ();
+    bool            is_open             () const { return file.is_open (); }
+
+    // Applies the next frame of the trace, returns false (leaving the current frame untouched) at the end.
+    bool            advance             ();
+    void            rewind              ();
+
+    const replay_frame& current         () const { return frame; }
+    bool            client_changed      () const { return changed_client; } // in the frame last applied.
+    uint32_t        position            () const { return next; } // number of frames applied so far.
+    uint32_t        frame_count         () const { return (uint32_t) offsets.size (); }
+    bool            at_end              () const { return next == frame_count (); }
+
+private:
+    utils::mapped_file      file;
+    std::vector<size_t>     offsets;    // start of each frame's payload.
+    uint32_t                next = 0;
+    replay_frame            frame;
+    bool                    changed_client = false;
+};
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+// Drives recording & playback from the engine's frame loop.
+// * whilst replaying the host's input is replaced by the trace (after ImGui has seen it, so the debug ui still
+//   works) and the recorded time steps are forced, pausing holds the current frame with a time step of zero.
+// * of the recorded container state only the canvas size is replayed, asked of the host at the start & whenever it
+//   changed whilst recording (the host may not honour it, i.e. in fullscreen). The window's size & position and the
+//   maximum container size stay as the host has them, the engine has no way to set them.
+// * per-frame timings of a replay are written out as csv so that runs of different builds can be compared.
+class replay_session {
+public:
+    replay_session (const std::string& trace_path, const std::string& timings_path);
+    ~replay_session ();
+
+    bool            start_recording     ();
+    void            stop_recording      ();
+    bool            start_replay        ();
+    void            stop_replay         ();
+
+    bool            is_recording        () const { return recorder.is_open (); }
+    bool            is_replaying        () const { return player.is_open (); }
+
+    void            set_paused          (bool z) { paused = z; }
+    bool            is_paused           () const { return paused; }
+    void            step                () { step_requested = true; }
+
+    // Called once the host state for the frame is in place and before anything consumes it.
+    void            begin_frame         (engine_state&, engine_tasks&);
+    void            end_frame           (float frame_ms, float extensions_ms);
+
+    void            debug_ui            ();
+
+private:
+    const std::string       trace_path;
+    const std::string       timings_path;
+
+    input_recorder          recorder;
+    input_player            player;
+    FILE*                   timings = nullptr;
+
+    bool                    paused = false;
+    bool                    step_requested = false;
+    bool                    advanced = false; // a frame of the trace was applied this frame.
+};
+
+}
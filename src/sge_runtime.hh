@@ -4,6 +4,8 @@
 
 #include "sge_math.hh"
 #include "sge_utils.hh"
+#include "sge_fixed.hh"
+#include "sge_jobs.hh"
 
 // SGE-RUNTIME
 // ---------------------------------- //
@@ -52,12 +54,25 @@ enum class system_int_state     {
     //   however, right now ImGui is used by both the engine and the user and has no awareness of this - this means
     //   that the user can position ImGui UI outside of the cavas viewport within which they should be confined to.
     canvas_offset_x, canvas_offset_y, // todo: investigate a better solution.
+    // Index of the active entry in sge::app::content::specializations, a change takes effect from the next frame.
+    specialization,
     COUNT };
 
 enum class system_string_state  { title, gpu_name, engine_version, COUNT };
 
 enum class log_level { debug, info, warning, error, };
 
+// Pixels read back from the compute output, see api::readback__request.
+struct readback_view {
+    uint64_t                frame; // the graphics frame the output was computed on.
+    uint32_t                x, y, width, height;
+    uint32_t                texel_size; // in bytes, of the output's format.
+    uint32_t                row_pitch; // in bytes.
+    const uint8_t*          data; // mapped device memory, only valid until the callback returns, null if the readback was dropped.
+};
+
+typedef std::function<void (const readback_view&)> readback_fn;
+
 class extension;
 
 // the runtime api is a low level interface for interacting with SGE at runtime.
@@ -93,6 +108,22 @@ struct api {
     virtual void                    input__touches                      (uint32_t*, uint32_t*, int*, int*)              const = 0;
 
     virtual void                    tty__log                            (log_level, const wchar_t*, const wchar_t*)     const = 0;
+
+    // copies a region of the compute output (all zero for the whole of it) back to the host after the next dispatch,
+    // the callback runs on the main thread a few frames later (or without data on the next, if it had to be dropped).
+    virtual void                    readback__request                   (uint32_t, uint32_t, uint32_t, uint32_t, const readback_fn&) = 0;
+
+    // the job system is safe to use from any extension (including views) as kicking work off doesn't change engine state.
+    // * jobs can only be submitted from the main thread or from within other jobs.
+    virtual void                    jobs__run                           (const jobs::job_fn&, jobs::counter*)           const = 0;
+    virtual void                    jobs__parallel_for                  (uint32_t, uint32_t, const jobs::range_fn&)     const = 0;
+    virtual void                    jobs__wait                          (const jobs::counter&)                          const = 0;
+    virtual uint32_t                jobs__get_thread_count              ()                                              const = 0;
+
+    // a file's contents, from the asset archive if there is one (without copying, unless it's compressed) or else the
+    // file itself (memory mapped), valid until the engine shuts down, or for a few frames once a loose file changes (the
+    // next call maps it again). nullopt if it doesn't exist.
+    virtual std::optional<dataspan> assets__get                         (const char*)                                   const = 0;
   //virtual void                    tty_retrieve                        ()                                              const = 0;
     
     virtual extension*              extension_get                       (size_t)                                        const = 0; // needs a better home...
@@ -101,8 +132,11 @@ struct api {
 
 // todo: move extensions away from here.
 
-template<typename T> struct type { static void id() {} };
-template<typename T> size_t type_id() { return reinterpret_cast<size_t>(&type<T>::id); }
+// Extension types are given dense ids, handed out in the order they are first asked for.
+// * the engine asks for the ids of the standard extensions, then the user's, when registering them,
+//   so the assignment (and therefore iteration order) is the same from run to run.
+namespace internal { inline size_t next_type_id () { static std::atomic<size_t> counter = { 0 }; return counter++; } }
+template<typename T> size_t type_id() { static const size_t id = internal::next_type_id (); return id; }
 
 class extension {
 public:
@@ -110,6 +144,14 @@ public:
 
     void invoke_update () { update (); };
 
+    // applies what was requested during the update, called on the main thread once the update's stage is done.
+    void invoke_apply_requests () {
+        if (requested_active.has_value ()) {
+            set_active (requested_active.value ());
+            requested_active.reset ();
+        }
+    }
+
     void invoke_debug_menu () {
         if (utils::get_flag_at_mask (configuration_state, config_flags::MANAGED_DEBUG_UI)) {
             if (utils::get_flag_at_mask (runtime_state, runtime_flags::ACTIVE)) {
@@ -143,9 +185,13 @@ public:
     };
 
     bool is_active () const { return utils::get_flag_at_mask (runtime_state, runtime_flags::ACTIVE); }
+    bool is_concurrent_update () const { return utils::get_flag_at_mask (configuration_state, config_flags::CONCURRENT_UPDATE); }
     void set_active (const bool v) { utils::set_flag_at_mask (runtime_state, runtime_flags::ACTIVE, v); }
 
     const std::string& get_display_name () const { return display_name; }
+
+    const std::vector<size_t>& get_read_dependencies () const { return read_dependencies; }
+    const std::vector<size_t>& get_write_dependencies () const { return write_dependencies; }
 protected:
 
     extension (const uint32_t z_configuration, const std::string_view z_display_name)
@@ -157,9 +203,19 @@ protected:
     virtual void managed_debug_ui () {};
     virtual void custom_debug_ui () {};
 
+    // Dependencies must be declared in the constructor, the engine uses them to order extension updates.
+    // * reads<T>: this extension's update uses T's state, so runs after T (and after anything that writes T).
+    // * writes<T>: this extension's update changes T's state, so runs after T and before anything that reads T.
+    template<typename T> void reads () { read_dependencies.emplace_back (type_id<T> ()); }
+    template<typename T> void writes () { write_dependencies.emplace_back (type_id<T> ()); }
+
+    // as set_active but safe to call from a concurrent update, the change is applied once the update's stage is done.
+    void request_active (const bool v) { requested_active = v; }
+
     enum config_flags : uint8_t {
         MANAGED_DEBUG_UI = 1 << 0, // does the extension have a managed debug_ui? i.e.
         CUSTOM_DEBUG_UI  = 1 << 1, // does the extension have a custom debug_ui?
+        CONCURRENT_UPDATE = 1 << 2, // is the extension's update safe to run on a worker thread alongside other such extensions? (it must only read from the runtime api & its own state).
     };
 
     enum runtime_flags : uint8_t {
@@ -172,10 +228,42 @@ protected:
     uint32_t runtime_state;
     const std::string display_name;
 
+    std::vector<size_t> read_dependencies;
+    std::vector<size_t> write_dependencies;
+
+    std::optional<bool> requested_active; // by the update, applied once its stage is done.
+
     static const uint32_t default_configuration = MANAGED_DEBUG_UI;
     static const uint32_t default_initial_runtime = ACTIVE | CUSTOM_DEBUG_UI_ACTIVE;
 };
 
+// A typed handle to an extension, resolved through the runtime api on first use and cached thereafter,
+// after which access is a plain pointer dereference.
+template<typename T> class ext_handle {
+    const api* runtime = nullptr;
+    mutable T* pointer = nullptr;
+public:
+    ext_handle () = default;
+    explicit ext_handle (const api& z) : runtime (&z) {}
+
+    // null if no such extension is registered.
+    T* try_get () const {
+        if (!pointer) {
+            static_assert (std::is_base_of<extension, T>::value, "T must inherit from extension");
+            assert (runtime);
+            pointer = static_cast<T*> (runtime->extension_get (type_id<T> ()));
+        }
+        return pointer;
+    }
+    T* get () const {
+        T* const p = try_get ();
+        assert (p);
+        return p;
+    }
+    T* operator -> () const { return get (); }
+    T& operator * () const { return *get (); }
+};
+
 // runtime views have readonly (const) access to the runtime api.
 class view : public extension {
 protected:
@@ -7,18 +7,93 @@
 #pragma once
 
 #include "sge.hh"
+#include "sge_fixed.hh"
+
+#if TARGET_WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace sge::utils {
 
-inline void get_file_stream (std::vector<uint8_t>& output, const char* path) {
-    std::ifstream input (path, std::ios::binary);
-    std::vector<char> bytes ((std::istreambuf_iterator<char>(input)), (std::istreambuf_iterator<char>()));
-    assert (bytes.size () > 0);
-    output.resize (bytes.size ());
-    for (int i = 0; i < bytes.size (); ++i) {
-        output[i] = (uint8_t) bytes[i];
+// a missing or empty file is not an error, for assets (which are) see sge_archive.hh.
+inline bool read_file (std::vector<uint8_t>& output, const char* path) {
+    FILE* file = fopen (path, "rb");
+    if (!file) return false;
+    fseek (file, 0, SEEK_END);
+    const long size = ftell (file);
+    fseek (file, 0, SEEK_SET);
+    output.resize (size > 0 ? (size_t) size : 0);
+    const bool ok = size > 0 && fread (output.data (), 1, output.size (), file) == output.size ();
+    fclose (file);
+    return ok;
+}
+
+// writes to a temporary file alongside the destination and renames it into place, so readers (and crashes) only ever
+// see the old or the new contents.
+inline bool write_file_atomic (const char* path, const void* data, size_t size) {
+    const std::string temp_path = std::string (path) + ".tmp";
+    FILE* file = fopen (temp_path.c_str (), "wb");
+    if (!file) return false;
+    bool ok = fwrite (data, 1, size, file) == size && fflush (file) == 0;
+#if TARGET_WIN32
+    ok = ok && _commit (_fileno (file)) == 0;
+#else
+    ok = ok && fsync (fileno (file)) == 0;
+#endif
+    ok = fclose (file) == 0 && ok;
+#if TARGET_WIN32
+    ok = ok && MoveFileExA (temp_path.c_str (), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && ::rename (temp_path.c_str (), path) == 0;
+#endif
+    if (!ok) ::remove (temp_path.c_str ());
+    return ok;
+}
+
+// 64-bit FNV-1a, chain calls by passing the previous result as the seed.
+inline uint64_t hash_fnv1a (const void* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+    const uint8_t* bytes = (const uint8_t*) data;
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// appends the ranges of `data` that differ from `shadow` to `ranges`, compared a block at a time (memcmp is vectorised)
+// with neighbouring blocks merged, and brings the shadow up to date.
+inline void diff_blocks (fixed::byterange_list& ranges, const void* data, void* shadow, size_t size, size_t block_size = 256) {
+    const uint8_t* current = (const uint8_t*) data;
+    uint8_t* previous = (uint8_t*) shadow;
+    for (size_t offset = 0; offset < size; offset += block_size) {
+        const size_t n = std::min (block_size, size - offset);
+        if (memcmp (current + offset, previous + offset, n) == 0)
+            continue;
+        memcpy (previous + offset, current + offset, n);
+        if (!ranges.empty () && ranges.back ().offset + ranges.back ().size == offset)
+            ranges.back ().size += n;
+        else
+            ranges.emplace_back (byterange { offset, n });
+    }
+}
+
+// sorts ranges & merges those that overlap or touch.
+inline void coalesce (fixed::byterange_list& ranges) {
+    if (ranges.size () < 2)
+        return;
+    std::sort (ranges.begin (), ranges.end (), [] (const byterange& a, const byterange& b) { return a.offset < b.offset; });
+    size_t n = 0;
+    for (size_t i = 1; i < ranges.size (); ++i) {
+        byterange& last = ranges[n];
+        if (ranges[i].offset <= last.offset + last.size)
+            last.size = std::max (last.offset + last.size, ranges[i].offset + ranges[i].size) - last.offset;
+        else
+            ranges[++n] = ranges[i];
     }
-    input.close ();
+    ranges.resize (n + 1);
 }
 
 template <typename T>
@@ -1,6 +1,8 @@
 #include "sge_vk.hh"
 
 #include "sge_vk_context.hh"
+#include "sge_fixed.hh"
+#include "sge_utils.hh"
 #include "imgui_ext.hh"
 
 namespace sge::vk {
@@ -17,6 +19,11 @@ VkViewport vk::calculate_canvas_viewport () {
     }
 }
 
+const texture& vk::get_canvas_texture () const {
+    const texture* secondary = compute_target->get_secondary_texture ();
+    return state.show_secondary_output && secondary ? *secondary : compute_target->get_pre_render_texture ();
+}
+
 VkExtent2D vk::calculate_compute_size () {
     const auto e = presentation->extent();
     if (state.imgui_on) {
@@ -37,7 +44,8 @@ void vk::create (int w, int h) {
 #endif
 
     // Create kernal
-    kernel = std::make_unique<class kernel> ();
+    const auto& configuration = sge::app::get_configuration ();
+    kernel = std::make_unique<class kernel> (configuration.pipeline_cache_path, configuration.device, configuration.split_frame);
     kernel->create ();
 
     // Create presentation
@@ -62,20 +70,51 @@ void vk::create_systems (const std::function<void ()>& z_imgui_fn) {
     compute_target = std::make_unique<class compute_target> (
         kernel->primary_context (),
         kernel->primary_compute_queue_id (),
+        kernel->primary_transfer_queue_id (),
         sge::app::get_content (),
         [this]() { return state.compute_size; }
         );
     compute_target->create ();
 
+    const sge::app::content& content = sge::app::get_content ();
+    if (content.detect_changes) { // as created.
+        for (const dataspan& u : content.uniforms)
+            state.uniform_shadows.emplace_back ((const uint8_t*) u.address, (const uint8_t*) u.address + u.size);
+        for (const dataspan& b : content.blobs)
+            state.blob_shadows.emplace_back ((const uint8_t*) b.address, (const uint8_t*) b.address + b.size);
+        state.blob_spans = content.blobs;
+    }
+
+    if (sge::app::get_configuration ().split_frame) {
+        split_frame = std::make_unique<class split_frame> (
+            *kernel.get (),
+            *compute_target.get (),
+            sge::app::get_content (),
+            [this]() { return state.compute_size; });
+        if (!split_frame->is_active ())
+            split_frame.reset ();
+    }
+
+    readback = std::make_unique<class readback> (
+        kernel->primary_context (),
+        kernel->primary_transfer_queue_id (),
+        kernel->primary_compute_queue_id (),
+        (uint32_t) std::max (sge::app::get_configuration ().readback_slots, 1));
+
     canvas_render = std::make_unique<class canvas_render> (
         kernel->primary_context (),
         kernel->primary_graphics_queue_id (),
         *presentation.get (),
-        [this]() { return compute_target->get_pre_render_texture ().descriptor; },
+        [this]() -> const texture& { return get_canvas_texture (); },
         [this]() {
             return state.canvas_viewport;
         }
     );
+    canvas_render::display display;
+    display.mode = canvas_render::get_default_display_mode (get_canvas_texture ().format);
+    display.exposure = sge::app::get_content ().output_exposure;
+    display.range = sge::app::get_content ().output_range;
+    canvas_render->set_display (display);
     canvas_render->create_resources (canvas_render::all_resources);
 
     // ImGUI
@@ -86,14 +125,25 @@ void vk::create_systems (const std::function<void ()>& z_imgui_fn) {
         z_imgui_fn);
     imgui->create_resources (imgui::static_resources);
 
+    const auto fence_create_info = utils::init_VkFenceCreateInfo ();
+    vk_assert (vkCreateFence (kernel->primary_context ().logical_device, &fence_create_info, kernel->primary_context ().allocation_callbacks, &state.frame_fence));
 }
 void vk::destroy () {
+    vk_assert (vkDeviceWaitIdle (kernel->primary_context ().logical_device));
+    vkDestroyFence (kernel->primary_context ().logical_device, state.frame_fence, kernel->primary_context ().allocation_callbacks);
+    state.frame_fence = VK_NULL_HANDLE;
+    state.frame_in_flight = false;
+
     imgui->destroy_resources (imgui::all_resources);
     imgui.reset ();
 
     canvas_render->destroy_resources (canvas_render::all_resources);
     canvas_render.reset ();
 
+    readback.reset ();
+
+    split_frame.reset ();
+
     compute_target->destroy ();
     compute_target.reset ();
 
@@ -104,7 +154,12 @@ void vk::destroy () {
     kernel.reset ();
 }
 
-void submit (const VkCommandBuffer& command_buffer, const VkQueue& queue, const std::vector<VkSemaphore>& wait_on, const std::vector <VkPipelineStageFlags>& pipelineStageFlags, const std::vector <VkSemaphore>& signals) {
+// submissions only ever involve a handful of semaphores, keep them on the stack.
+typedef fixed::static_vector<VkSemaphore, 4>            semaphore_list;
+typedef fixed::static_vector<VkPipelineStageFlags, 4>   stage_flag_list;
+
+void submit (const VkCommandBuffer& command_buffer, const VkQueue& queue, const semaphore_list& wait_on, const stage_flag_list& pipelineStageFlags, const semaphore_list& signals, const VkFence fence = VK_NULL_HANDLE) {
+    assert (wait_on.size () == pipelineStageFlags.size ());
     auto submitInfo = utils::init_VkSubmitInfo();
     submitInfo.waitSemaphoreCount = (uint32_t) wait_on.size ();
     submitInfo.pWaitSemaphores = wait_on.data ();
@@ -113,41 +168,50 @@ void submit (const VkCommandBuffer& command_buffer, const VkQueue& queue, const
     submitInfo.pCommandBuffers = &command_buffer;
     submitInfo.signalSemaphoreCount = (uint32_t) signals.size ();
     submitInfo.pSignalSemaphores = signals.data ();
-    vk_assert (vkQueueSubmit (queue, 1, &submitInfo, VK_NULL_HANDLE));
+    vk_assert (vkQueueSubmit (queue, 1, &submitInfo, fence));
 }
 
-void submit (const VkCommandBuffer& command_buffer, const VkQueue& queue, const VkSemaphore wait_on, const VkPipelineStageFlags stageFlag, const VkSemaphore signal) {
-    const std::vector<VkSemaphore> wx = { wait_on };
-    const std::vector <VkPipelineStageFlags> sf = { stageFlag };
-    const std::vector <VkSemaphore> sx = { signal };
-    submit (command_buffer, queue, wx, sf, sx);
+void submit (const VkCommandBuffer& command_buffer, const VkQueue& queue, const VkSemaphore wait_on, const VkPipelineStageFlags stageFlag, const VkSemaphore signal, const VkFence fence = VK_NULL_HANDLE) {
+    submit (command_buffer, queue, semaphore_list { wait_on }, stage_flag_list { stageFlag }, semaphore_list { signal }, fence);
 }
 
-void submit (const VkCommandBuffer& command_buffer, const VkQueue& queue, const std::vector<VkSemaphore>& wait_on, const std::vector <VkPipelineStageFlags>& stageFlags, const VkSemaphore signal) {
-    const std::vector <VkSemaphore> sx = { signal };
-    submit (command_buffer, queue, wait_on, stageFlags, sx);
+void submit (const VkCommandBuffer& command_buffer, const VkQueue& queue, const semaphore_list& wait_on, const stage_flag_list& stageFlags, const VkSemaphore signal, const VkFence fence = VK_NULL_HANDLE) {
+    submit (command_buffer, queue, wait_on, stageFlags, semaphore_list { signal }, fence);
 }
 
 VkSemaphore vk::submit_all (image_index image_index) {
     // system enqueues
-    compute_target->enqueue ();
+    const VkSemaphore readback_ready = readback->record (compute_target->get_pre_render_texture (), state.frame);
+    VkSemaphore compute_finished = compute_target->get_compute_finished ();
+    if (split_frame) {
+        split_frame->enqueue ();
+        compute_target->enqueue ();
+        compute_finished = split_frame->composite (readback_ready);
+    }
+    else {
+        compute_target->enqueue (readback_ready);
+    }
+    readback->submit ();
 
     if (state.imgui_on) {
         imgui->record (image_index);
     }
 
-    std::vector<VkSemaphore> wait_on = { presentation->image_available (), compute_target->get_compute_finished () };
-    std::vector<VkPipelineStageFlags> stage_flags = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT  };
+    const semaphore_list wait_on = { presentation->image_available (), compute_finished };
+    const stage_flag_list stage_flags = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT  };
 
     assert (wait_on.size () == stage_flags.size ());
 
     // todo: switch to using: https://www.khronos.org/blog/vulkan-timeline-semaphores
+    // the last graphics submission signals the frame fence, by which time all of the frame's work is done.
     submit (
         canvas_render->get_command_buffer (image_index),
         canvas_render->get_queue (),
         wait_on,
         stage_flags,
-        canvas_render->get_render_finished ());
+        canvas_render->get_render_finished (),
+        state.imgui_on ? VK_NULL_HANDLE : state.frame_fence);
+    state.frame_in_flight = true;
 
     if (state.imgui_on) {
         submit (
@@ -155,7 +219,8 @@ VkSemaphore vk::submit_all (image_index image_index) {
             imgui->get_queue (),
             canvas_render->get_render_finished (),
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            imgui->get_render_finished ());
+            imgui->get_render_finished (),
+            state.frame_fence);
         return imgui->get_render_finished ();
     }
     else {
@@ -163,7 +228,16 @@ VkSemaphore vk::submit_all (image_index image_index) {
     }
 }
 
-void vk::update (bool& push_flag, std::vector<bool>& ubo_flags, std::vector<std::optional<dataspan>>& sbo_flags, float dt) {
+void vk::update (bool& push_flag, std::vector<bool>& ubo_flags, std::vector<std::optional<dataspan>>& sbo_flags, std::vector<fixed::byterange_list>& sbo_ranges, float dt) {
+    // the last frame must be done before its command buffers are reused or anything it uses is recreated. Waiting for it
+    // here, rather than for the device to go idle at the end of it, lets its uploads, dispatch & rendering overlap the
+    // host's work for this frame (input, extensions, the app's update).
+    if (state.frame_in_flight) {
+        vk_assert (vkWaitForFences (kernel->primary_context ().logical_device, 1, &state.frame_fence, VK_TRUE, UINT64_MAX));
+        vk_assert (vkResetFences (kernel->primary_context ().logical_device, 1, &state.frame_fence));
+        state.frame_in_flight = false;
+    }
+
     const auto surface_status = presentation->check_surface_status ();
     const bool surface_ok = surface_status == presentation::surface_status::OK;
     const bool surface_minimised = surface_status == presentation::surface_status::ZERO;
@@ -177,7 +251,8 @@ void vk::update (bool& push_flag, std::vector<bool>& ubo_flags, std::vector<std:
         {
             const presentation::swapchain_status* swapchain_issue = std::get_if<presentation::swapchain_status> (&swapchain_status);
             if (swapchain_issue && (*swapchain_issue == presentation::swapchain_status::OUT_OF_DATE || *swapchain_issue == presentation::swapchain_status::SUBOPTIMAL)) {
-                // an issue we can deal with, fix it and crack on
+                // an issue we can deal with, fix it and crack on (once the last frame's presentation is done with the swapchain).
+                vk_assert (vkDeviceWaitIdle (kernel->primary_context ().logical_device));
                 presentation->destroy_resources (presentation::transient_resources);
                 presentation->create_resources (presentation::transient_resources);
 
@@ -208,22 +283,32 @@ void vk::update (bool& push_flag, std::vector<bool>& ubo_flags, std::vector<std:
         const VkExtent2D required_compute_size = calculate_compute_size ();
         const VkViewport required_canvas_viewport = calculate_canvas_viewport ();
         const bool compute_size_needs_refresh = !utils::equal (required_compute_size, state.compute_size);
-        const bool canvas_viewport_needs_refresh = !utils::equal (required_canvas_viewport, state.canvas_viewport) || compute_size_needs_refresh;
+        const bool canvas_viewport_needs_refresh = !utils::equal (required_canvas_viewport, state.canvas_viewport) || compute_size_needs_refresh || state.canvas_needs_refresh;
+        state.canvas_needs_refresh = false;
 
         if (canvas_viewport_needs_refresh)  canvas_render->destroy_resources (canvas_render::transient_resources);
+        if (compute_size_needs_refresh && split_frame) split_frame->destroy_r ();
         if (compute_size_needs_refresh)     compute_target->destroy_r ();
 
         state.compute_size = required_compute_size;
         state.canvas_viewport = required_canvas_viewport;
 
         if (compute_size_needs_refresh)     compute_target->create_r ();
+        if (compute_size_needs_refresh && split_frame) split_frame->create_r ();
         if (canvas_viewport_needs_refresh)  canvas_render->create_resources (canvas_render::transient_resources);
     }
 
     // pre-update
+    if (sge::app::get_content ().detect_changes)
+        detect_changes (ubo_flags, sbo_flags, sbo_ranges);
+    if (split_frame) // first, as the compute target clears the flags.
+        split_frame->update (surface_changed ? surface_changed : push_flag, ubo_flags, sbo_flags, sbo_ranges);
     compute_target->update ( // todo: better abstract this logic into the compute_target
         surface_changed ? surface_changed : push_flag, // make sure user push constant ranges get updated imediately as some user apps need to response this frame to surface changes - i.e. the lazy update mode in the raymarching demo
-        ubo_flags, sbo_flags); // these can wait until the next frame for now
+        ubo_flags, sbo_flags, sbo_ranges); // these can wait until the next frame for now
+
+    // callbacks of readbacks that have finished since last frame, before this frame's are recorded.
+    readback->update ();
 
     if (surface_ok && swapchain_ok) {
         const uint32_t image_index = std::get<sge::vk::image_index> (swapchain_status);
@@ -238,8 +323,42 @@ void vk::update (bool& push_flag, std::vector<bool>& ubo_flags, std::vector<std:
 
     // post-update
     compute_target->end_of_frame ();
+    if (split_frame)
+        split_frame->end_of_frame ();
+    state.frame++;
+}
 
-    vk_assert (vkDeviceWaitIdle (kernel->primary_context ().logical_device));
+// Compares each uniform & blob with a copy of what was last uploaded, flagging those that differ & narrowing blob
+// changes to the blocks that differ. Blobs that have moved or been resized are uploaded whole.
+void vk::detect_changes (std::vector<bool>& z_ubo_flags, std::vector<std::optional<dataspan>>& z_sbo_flags, std::vector<fixed::byterange_list>& z_sbo_ranges) {
+    const sge::app::content& content = sge::app::get_content ();
+
+    for (size_t i = 0; i < content.uniforms.size (); ++i) {
+        const dataspan& u = content.uniforms[i];
+        std::vector<uint8_t>& shadow = state.uniform_shadows[i];
+        if (memcmp (u.address, shadow.data (), u.size) != 0) {
+            memcpy (shadow.data (), u.address, u.size);
+            z_ubo_flags[i] = true;
+        }
+    }
+
+    for (size_t i = 0; i < content.blobs.size (); ++i) {
+        z_sbo_ranges[i].clear ();
+        // where the blob is now, as flagged or else as the content has it (so moves needn't be flagged either), the last
+        // span may have been freed so isn't compared.
+        const dataspan ds = z_sbo_flags[i].has_value () ? z_sbo_flags[i].value () : content.blobs[i];
+        if (ds != state.blob_spans[i]) {
+            state.blob_spans[i] = ds;
+            state.blob_shadows[i].assign ((const uint8_t*) ds.address, (const uint8_t*) ds.address + ds.size);
+            z_sbo_flags[i] = ds;
+            continue;
+        }
+        sge::utils::diff_blocks (z_sbo_ranges[i], ds.address, state.blob_shadows[i].data (), ds.size);
+        if (z_sbo_ranges[i].empty ())
+            z_sbo_flags[i].reset ();
+        else
+            z_sbo_flags[i] = ds;
+    }
 }
 
 void vk::debug_ui () {
@@ -248,11 +367,50 @@ void vk::debug_ui () {
 
     ImGui::Separator ();
 
+    compute_target->debug_ui ();
+
+    if (split_frame) {
+        ImGui::Separator ();
+        split_frame->debug_ui ();
+    }
+
+    ImGui::Separator ();
+
+    // changes are picked up at the start of the next frame, with the canvas's transient resources.
+    canvas_render::display display = canvas_render->get_display ();
+    ImGui::Text ("Canvas");
+    if (compute_target->get_secondary_texture () && ImGui::Checkbox ("Show secondary output", &state.show_secondary_output)) {
+        const VkFormat format = get_canvas_texture ().format;
+        display.mode = format == VK_FORMAT_R32_UINT && state.show_secondary_output ? canvas_render::display_mode::hashed : canvas_render::get_default_display_mode (format);
+        state.canvas_needs_refresh = true;
+    }
+    int mode = (int) display.mode;
+    if (ImGui::Combo ("Display", &mode, "As is\0Tonemapped\0Grey\0Hashed\0")) {
+        display.mode = (canvas_render::display_mode) mode;
+        state.canvas_needs_refresh = true;
+    }
+    if (ImGui::DragFloat ("Exposure", &display.exposure, 0.01f, 0.0f, 64.0f))
+        state.canvas_needs_refresh = true;
+    if (ImGui::DragFloat ("Range", &display.range, 0.01f, 0.0001f, 1000000.0f))
+        state.canvas_needs_refresh = true;
+    if (state.canvas_needs_refresh)
+        canvas_render->set_display (display);
+
+    ImGui::Separator ();
+
     kernel->debug_ui ();
 
+    ImGui::Separator ();
+
+    readback->debug_ui ();
+
     ImGui::Separator ();
     
     imgui->debug_ui ();
 }
 
+void vk::overlay_ui () {
+    compute_target->overlay_ui ();
+}
+
 };
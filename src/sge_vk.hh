@@ -10,6 +10,8 @@
 #include "sge_vk_presentation.hh"
 #include "sge_vk_compute_target.hh"
 #include "sge_vk_canvas_render.hh"
+#include "sge_vk_readback.hh"
+#include "sge_vk_split_frame.hh"
 #include "sge_vk_imgui.hh"
 
 namespace sge::vk {
@@ -17,13 +19,23 @@ namespace sge::vk {
         std::unique_ptr<kernel>             kernel;
         std::unique_ptr<presentation>       presentation;
         std::unique_ptr<compute_target>     compute_target;
+        std::unique_ptr<split_frame>        split_frame; // null unless the output is being split across devices.
         std::unique_ptr<canvas_render>      canvas_render;
+        std::unique_ptr<readback>           readback;
         std::unique_ptr<imgui>              imgui;
 
         struct {
             bool                                imgui_on = true;
             VkExtent2D                          compute_size;
             VkViewport                          canvas_viewport;
+            std::vector<std::vector<uint8_t>>   uniform_shadows; // copies of what was last uploaded, if the content detects changes.
+            std::vector<std::vector<uint8_t>>   blob_shadows;
+            std::vector<dataspan>               blob_spans; // where each blob currently is, if the content detects changes.
+            bool                                show_secondary_output = false;
+            bool                                canvas_needs_refresh = false; // after the displayed texture or how it's displayed changes.
+            uint64_t                            frame = 0;
+            VkFence                             frame_fence = VK_NULL_HANDLE; // signalled once a frame's graphics work, which waits on its compute work, is done.
+            bool                                frame_in_flight = false;
         } state;
 
 #if TARGET_WIN32
@@ -38,7 +50,7 @@ namespace sge::vk {
 
         void create_systems (const std::function <void()>&);
         void destroy ();
-        void update (bool&, std::vector<bool>&, std::vector<std::optional<dataspan>>&, float);
+        void update (bool&, std::vector<bool>&, std::vector<std::optional<dataspan>>&, std::vector<fixed::byterange_list>&, float);
 
         int get_user_viewport_x      () const { return state.canvas_viewport.x; }
         int get_user_viewport_y      () const { return state.canvas_viewport.y; }
@@ -46,12 +58,15 @@ namespace sge::vk {
         int get_user_viewport_height () const { return state.canvas_viewport.height; }
 
         void debug_ui ();
+        void overlay_ui ();
 
     private:
 
         VkSemaphore submit_all (image_index);
+        void detect_changes (std::vector<bool>&, std::vector<std::optional<dataspan>>&, std::vector<fixed::byterange_list>&);
         VkExtent2D calculate_compute_size ();
         VkViewport calculate_canvas_viewport ();
+        const texture& get_canvas_texture () const;
 
     };
 
@@ -0,0 +1,259 @@
+#include "sge_vk_blob_streamer.hh"
+
+#include "sge_vk_uploader.hh"
+
+namespace sge::vk {
+
+blob_streamer::blob_streamer (const struct context& z_context, class uploader& z_uploader, const std::vector<sge::app::streamed_blob>& z_blobs)
+    : context (z_context)
+    , uploader (z_uploader)
+{
+    streams.resize (z_blobs.size ());
+    for (size_t i = 0; i < z_blobs.size (); ++i)
+        create_stream (streams[i], z_blobs[i]);
+    thread = std::thread (&blob_streamer::worker, this);
+}
+
+blob_streamer::~blob_streamer () {
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        stop = true;
+    }
+    condition.notify_all ();
+    thread.join ();
+    for (stream& s : streams) {
+        uploader.discard (s.pool.buffer);
+        destroy_stream (s);
+    }
+}
+
+void blob_streamer::create_stream (stream& z_stream, const sge::app::streamed_blob& z_blob) {
+    assert (z_blob.page_size > 0 && z_blob.page_size % 4 == 0);
+    assert (z_blob.pool_pages > 0 && z_blob.max_loads_per_frame > 0);
+
+    z_stream.path = z_blob.path;
+    if (!z_stream.file.open (z_blob.path.c_str (), sge::utils::mapped_file::access::read_only))
+        std::cout << "Failed to map streamed blob " << z_blob.path << ", it will read as empty.\n";
+
+    const size_t file_pages = (z_stream.file.size () + z_blob.page_size - 1) / z_blob.page_size;
+    assert (file_pages <= std::numeric_limits<uint32_t>::max () - 1);
+    z_stream.page_size = z_blob.page_size;
+    z_stream.num_pages = (uint32_t) std::max<size_t> (file_pages, 1);
+    z_stream.pool_pages = std::min (z_blob.pool_pages, z_stream.num_pages); // no point in a pool bigger than the file.
+    z_stream.max_loads = std::min (z_blob.max_loads_per_frame, z_stream.pool_pages);
+
+    const VkDeviceSize page_table_size = (num_header_words + z_stream.num_pages) * sizeof (uint32_t);
+    context.create_buffer (
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &z_stream.page_table,
+        page_table_size,
+        nullptr,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    z_stream.page_table.map ();
+    uint32_t* const page_table = (uint32_t*) z_stream.page_table.mapped;
+    memset (page_table, 0, page_table_size);
+    page_table[0] = frame;
+    page_table[1] = z_stream.page_size;
+    page_table[2] = z_stream.num_pages;
+    page_table[3] = z_stream.pool_pages;
+
+    context.create_buffer (
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &z_stream.pool,
+        (VkDeviceSize) z_stream.pool_pages * z_stream.page_size);
+
+    // cached memory makes scanning it on the host far quicker.
+    context.create_buffer (
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &z_stream.feedback,
+        z_stream.num_pages * sizeof (uint32_t),
+        nullptr,
+        VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    z_stream.feedback.map ();
+    memset (z_stream.feedback.mapped, 0, z_stream.num_pages * sizeof (uint32_t));
+
+    context.create_buffer (
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &z_stream.staging,
+        (VkDeviceSize) z_stream.max_loads * z_stream.page_size);
+    z_stream.staging.map ();
+
+    z_stream.slot_pages.assign (z_stream.pool_pages, ~0u);
+    z_stream.slot_stamps.assign (z_stream.pool_pages, 0);
+    z_stream.pending.assign (z_stream.num_pages, false);
+    z_stream.free_staging.resize (z_stream.max_loads);
+    std::iota (z_stream.free_staging.rbegin (), z_stream.free_staging.rend (), 0u); // taken from the back.
+}
+
+void blob_streamer::destroy_stream (stream& z_stream) {
+    z_stream.staging.destroy (context.allocation_callbacks);
+    z_stream.feedback.destroy (context.allocation_callbacks);
+    z_stream.pool.destroy (context.allocation_callbacks);
+    z_stream.page_table.destroy (context.allocation_callbacks);
+    z_stream.file.close ();
+}
+
+void blob_streamer::update () {
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        std::swap (placing, ready);
+    }
+    for (const request& r : placing)
+        streams[r.stream].loaded.emplace_back (r.page, r.staging_page);
+    placing.clear ();
+
+    bool requested = false;
+    for (size_t i = 0; i < streams.size (); ++i)
+        requested |= update_stream (i);
+    if (requested)
+        condition.notify_one ();
+
+    frame = frame == std::numeric_limits<uint32_t>::max () ? 1 : frame + 1;
+    for (stream& s : streams)
+        ((uint32_t*) s.page_table.mapped)[0] = frame;
+}
+
+bool blob_streamer::update_stream (size_t z_index) {
+    stream& z_stream = streams[z_index];
+    uint32_t* const slots = (uint32_t*) z_stream.page_table.mapped + num_header_words;
+    const uint32_t* const feedback = (const uint32_t*) z_stream.feedback.mapped;
+
+    // the last frame's copies are done (the dispatch waited on them), so the staging they read from can be reused.
+    z_stream.free_staging.insert (z_stream.free_staging.end (), z_stream.copying_staging.begin (), z_stream.copying_staging.end ());
+    z_stream.copying_staging.clear ();
+
+    // pages the last dispatch wanted: resident ones are marked as used, the others are to be loaded.
+    z_stream.missing.clear ();
+    z_stream.num_wanted = 0;
+    z_stream.num_missing = 0;
+    for (uint32_t page = 0; page < z_stream.num_pages; ++page) {
+        if (feedback[page] != frame)
+            continue;
+        z_stream.num_wanted++;
+        if (slots[page] != 0)
+            z_stream.slot_stamps[slots[page] - 1] = frame;
+        else {
+            z_stream.num_missing++;
+            if (!z_stream.pending[page])
+                z_stream.missing.emplace_back (page);
+        }
+    }
+
+    // pages the worker has read go in free slots first (stamped zero), then the least recently used, never those wanted
+    // by the last dispatch.
+    if (!z_stream.loaded.empty ()) {
+        const uint32_t num_candidates = std::min ((uint32_t) z_stream.loaded.size (), z_stream.pool_pages);
+        z_stream.victims.resize (z_stream.pool_pages);
+        std::iota (z_stream.victims.begin (), z_stream.victims.end (), 0u);
+        std::partial_sort (z_stream.victims.begin (), z_stream.victims.begin () + num_candidates, z_stream.victims.end (),
+            [&] (uint32_t a, uint32_t b) {
+                const bool free_a = z_stream.slot_stamps[a] == 0, free_b = z_stream.slot_stamps[b] == 0;
+                if (free_a != free_b) return free_a;
+                return frame - z_stream.slot_stamps[a] > frame - z_stream.slot_stamps[b]; // older first, wrapping is fine.
+            });
+
+        z_stream.regions.clear ();
+        uint32_t num_placed = 0;
+        for (; num_placed < num_candidates; ++num_placed) {
+            const uint32_t slot = z_stream.victims[num_placed];
+            if (z_stream.slot_stamps[slot] == frame)
+                break; // the pool is full of pages still in use, the rest will have to wait.
+
+            const auto [page, staging_page] = z_stream.loaded[num_placed];
+            const uint32_t evicted = z_stream.slot_pages[slot];
+            if (evicted != ~0u) {
+                slots[evicted] = 0;
+                z_stream.num_evictions++;
+            }
+            z_stream.regions.emplace_back (VkBufferCopy { (VkDeviceSize) staging_page * z_stream.page_size, (VkDeviceSize) slot * z_stream.page_size, z_stream.page_size });
+            z_stream.slot_pages[slot] = page;
+            z_stream.slot_stamps[slot] = frame;
+            z_stream.pending[page] = false;
+            z_stream.copying_staging.emplace_back (staging_page);
+            z_stream.num_loads++;
+        }
+
+        // the page table is host coherent & only points at the new pages once their copies are queued, ahead of the
+        // next dispatch.
+        if (!z_stream.regions.empty ()) {
+            uploader.copy (z_stream.staging.buffer, z_stream.pool.buffer, z_stream.regions.data (), (uint32_t) z_stream.regions.size (), z_stream.pool_written);
+            z_stream.pool_written = true;
+            for (uint32_t i = 0; i < num_placed; ++i)
+                slots[z_stream.loaded[i].first] = z_stream.victims[i] + 1;
+        }
+        z_stream.loaded.erase (z_stream.loaded.begin (), z_stream.loaded.begin () + num_placed);
+    }
+
+    // as many of the missing pages as there's staging for are handed to the worker.
+    const size_t num_requests = std::min (z_stream.missing.size (), z_stream.free_staging.size ());
+    if (num_requests == 0)
+        return false;
+    std::lock_guard<std::mutex> lock (mutex);
+    for (size_t i = 0; i < num_requests; ++i) {
+        const uint32_t page = z_stream.missing[i];
+        z_stream.pending[page] = true;
+        requests.emplace_back (request { z_index, page, z_stream.free_staging.back () });
+        z_stream.free_staging.pop_back ();
+    }
+    return true;
+}
+
+void blob_streamer::worker () {
+    std::unique_lock<std::mutex> lock (mutex);
+    while (true) {
+        condition.wait (lock, [this] { return stop || !requests.empty (); });
+        if (stop)
+            return;
+        const request r = requests.front ();
+        requests.pop_front ();
+        lock.unlock ();
+        read_page (streams[r.stream], r.page, r.staging_page);
+        lock.lock ();
+        ready.emplace_back (r);
+    }
+}
+
+// Reading the mapped file is what pages it in from disk, only the worker does so. The staging page is the request's
+// alone until it's placed, & the rest of the stream doesn't change once it's created.
+void blob_streamer::read_page (const stream& z_stream, uint32_t z_page, uint32_t z_staging_page) const {
+    const size_t file_size = z_stream.file.size ();
+    const size_t offset = (size_t) z_page * z_stream.page_size;
+    const size_t size = offset < file_size ? std::min<size_t> (z_stream.page_size, file_size - offset) : 0;
+    uint8_t* const destination = (uint8_t*) z_stream.staging.mapped + (size_t) z_staging_page * z_stream.page_size;
+    if (size)
+        memcpy (destination, z_stream.file.data () + offset, size);
+    memset (destination + size, 0, z_stream.page_size - size);
+}
+
+void blob_streamer::record_barrier (VkCommandBuffer z_command_buffer) const {
+    std::vector<VkBufferMemoryBarrier> barriers;
+    for (const stream& s : streams) {
+        auto barrier = utils::init_VkBufferMemoryBarrier ();
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = s.feedback.buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        barriers.emplace_back (barrier);
+    }
+    vkCmdPipelineBarrier (z_command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, (uint32_t) barriers.size (), barriers.data (), 0, nullptr);
+}
+
+void blob_streamer::debug_ui () {
+    ImGui::Text ("Streamed blobs");
+    for (const stream& s : streams) {
+        const uint32_t resident = (uint32_t) std::count_if (s.slot_pages.begin (), s.slot_pages.end (), [] (uint32_t x) { return x != ~0u; });
+        const uint32_t reading = s.max_loads - (uint32_t) (s.free_staging.size () + s.copying_staging.size () + s.loaded.size ());
+        ImGui::BulletText ("%s: %u/%u pages resident (%u KiB each), %u wanted, %u missing, %u reading, %llu loads, %llu evictions",
+            s.path.c_str (), resident, s.num_pages, s.page_size / 1024, s.num_wanted, s.num_missing, reading,
+            (unsigned long long) s.num_loads, (unsigned long long) s.num_evictions);
+    }
+}
+
+}
@@ -0,0 +1,116 @@
+// SGE-VK-BLOB-STREAMER
+// ---------------------------------- //
+// Blobs paged in from disk as the
+// shader asks for them.
+// ---------------------------------- //
+// * Each streamed blob is a memory mapped file split into fixed size pages, of which only a fixed size pool is resident
+//   on the device at once, so it can be far bigger than device (or host) memory.
+// * The shader sees three storage buffers per streamed blob, bound in this order:
+//     page table - { uint frame; uint page_size; uint num_pages; uint pool_pages; uint slots[num_pages]; } where a
+//                  page's slot is its index in the pool plus one, or zero if it isn't resident.
+//     pool       - pool_pages * page_size bytes, a resident page's bytes start at (slot - 1) * page_size.
+//     feedback   - uint[num_pages], the shader writes `frame` into the entry of every page it wants (resident or not).
+// * After each frame the feedback is read back on the host: pages wanted that are resident are marked as used, those
+//   that aren't are read from the file into staging by a worker thread (up to a limit in flight), so the frame never
+//   waits on the disk. Pages that have been read are copied into the pool in place of the least recently used, on the
+//   transfer queue ahead of the next dispatch, & only then does the page table point at them. The shader must cope
+//   with missing pages (i.e. skipping or approximating them) until they arrive, so frame time & quality degrade
+//   gracefully when the working set exceeds the pool.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_app_interface.hh"
+#include "sge_mapped_file.hh"
+#include "sge_vk_buffer.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace sge::vk {
+
+class uploader;
+
+class blob_streamer {
+public:
+    static constexpr uint32_t num_header_words = 4; // of the page table, before the slots.
+    static constexpr uint32_t num_bindings_per_blob = 3;
+
+    blob_streamer (const struct context&, class uploader&, const std::vector<sge::app::streamed_blob>&);
+    ~blob_streamer ();
+
+    // reads what the last dispatch asked for, requests the missing pages from the worker, queues the copies of those
+    // it has read & updates the page tables, the last dispatch must have finished.
+    void                                update                                  ();
+
+    // makes the feedback written by the dispatch visible to the host, recorded after it.
+    void                                record_barrier                          (VkCommandBuffer) const;
+
+    size_t                              get_num_blobs                           () const { return streams.size (); }
+    const VkDescriptorBufferInfo*       get_page_table                          (size_t blob) const { return &streams[blob].page_table.descriptor; }
+    const VkDescriptorBufferInfo*       get_pool                                (size_t blob) const { return &streams[blob].pool.descriptor; }
+    const VkDescriptorBufferInfo*       get_feedback                            (size_t blob) const { return &streams[blob].feedback.descriptor; }
+
+    void                                debug_ui                                ();
+
+private:
+    struct stream {
+        std::string                     path;
+        sge::utils::mapped_file         file;
+        uint32_t                        page_size = 0;
+        uint32_t                        num_pages = 0;
+        uint32_t                        pool_pages = 0;
+        uint32_t                        max_loads = 0; // in flight at once, pages of staging.
+        device_buffer                   page_table; // host visible & persistently mapped.
+        device_buffer                   pool;
+        device_buffer                   feedback; // host visible & persistently mapped.
+        device_buffer                   staging; // host visible & persistently mapped, max_loads pages.
+        std::vector<uint32_t>           slot_pages; // the page in each slot of the pool, or ~0u if it's free.
+        std::vector<uint32_t>           slot_stamps; // the last frame each slot was wanted.
+        std::vector<bool>               pending; // per page, being read or read but not yet in the pool.
+        std::vector<uint32_t>           free_staging; // pages of staging not in use.
+        std::vector<uint32_t>           copying_staging; // pages of staging copied from by the last frame.
+        std::vector<std::pair<uint32_t, uint32_t>> loaded; // pages read & the page of staging they're in, to be placed.
+        std::vector<uint32_t>           missing; // scratch, pages wanted that aren't resident or pending.
+        std::vector<uint32_t>           victims; // scratch, slots in the order they're to be reused.
+        std::vector<VkBufferCopy>       regions; // scratch.
+        bool                            pool_written = false; // once, the pool's contents must be kept by later loads.
+        uint32_t                        num_wanted = 0; // last frame.
+        uint32_t                        num_missing = 0; // last frame, including those pending.
+        uint64_t                        num_loads = 0;
+        uint64_t                        num_evictions = 0;
+    };
+
+    struct request {
+        size_t                          stream;
+        uint32_t                        page;
+        uint32_t                        staging_page;
+    };
+
+    const context&                      context;
+    uploader&                           uploader;
+    std::vector<stream>                 streams;
+    uint32_t                            frame = 1; // the stamp the next dispatch writes into the feedback, never zero.
+
+    std::thread                         thread;
+    std::mutex                          mutex;
+    std::condition_variable             condition;
+
+    // guarded by mutex
+    bool                                stop = false;
+    std::deque<request>                 requests; // for the worker.
+    std::vector<request>                ready; // read by the worker, not yet placed.
+
+    std::vector<request>                placing; // main thread only, scratch.
+
+    void                                create_stream                           (stream&, const sge::app::streamed_blob&);
+    void                                destroy_stream                          (stream&);
+    bool                                update_stream                           (size_t); // true if it requested any pages.
+    void                                worker                                  ();
+    void                                read_page                               (const stream&, uint32_t page, uint32_t staging_page) const;
+};
+
+}
@@ -2,6 +2,7 @@
 
 #include "sge_vk_presentation.hh"
 #include "sge_utils.hh"
+#include "sge_archive.hh"
 
 namespace sge::vk {
 
@@ -16,6 +17,16 @@ canvas_render::canvas_render (const struct context& context, const queue_identif
     state.current_viewport = get_viewport_fn ();
 }
 
+canvas_render::display_mode canvas_render::get_default_display_mode (VkFormat z_format) {
+    switch (z_format) {
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return display_mode::tonemapped;
+        case VK_FORMAT_R32_SFLOAT:
+        case VK_FORMAT_R32_UINT: return display_mode::grey;
+        default: return display_mode::direct;
+    }
+}
+
 //--------------------------------------------------------------------------------------------------------------------//
 
 void canvas_render::create_resources (resource_flags flags) {
@@ -117,7 +128,9 @@ void canvas_render::create_descriptor_set () {
     const auto allocate_info = utils::init_VkDescriptorSetAllocateInfo (state.descriptor_pool, layouts, 1);
     vk_assert (vkAllocateDescriptorSets (context.logical_device, &allocate_info, &state.descriptor_set));
 
-    VkDescriptorImageInfo ii = compute_tex ();
+    const texture& tex = compute_tex ();
+    VkDescriptorImageInfo ii = tex.descriptor;
+    state.uint_texture = tex.format == VK_FORMAT_R32_UINT;
 
     std::vector<VkWriteDescriptorSet> write_descriptor_sets = {
         utils::init_VkWriteDescriptorSet (
@@ -140,12 +153,13 @@ void canvas_render::destroy_descriptor_set () {
 
 void canvas_render::create_pipeline () {
 
-    std::vector<uint8_t> vert;
-    std::vector<uint8_t> frag;
-    sge::utils::get_file_stream (vert, "sge_canvas_render.vert.spv");
-    sge::utils::get_file_stream (frag, "sge_canvas_render.frag.spv");
-    VkShaderModule vertex_shader       = utils::create_shader_module (context.logical_device, context.allocation_callbacks, vert);
-    VkShaderModule fragment_shader     = utils::create_shader_module (context.logical_device, context.allocation_callbacks, frag);
+    const auto vert = sge::utils::get_assets ().get ("sge_canvas_render.vert.spv");
+    const auto frag = sge::utils::get_assets ().get ("sge_canvas_render.frag.spv");
+    const auto uint_frag = sge::utils::get_assets ().get ("sge_canvas_render_uint.frag.spv");
+    assert (vert.has_value () && frag.has_value () && uint_frag.has_value ());
+    VkShaderModule vertex_shader       = utils::create_shader_module (context.logical_device, context.allocation_callbacks, vert.value ());
+    VkShaderModule fragment_shader     = utils::create_shader_module (context.logical_device, context.allocation_callbacks, frag.value ());
+    VkShaderModule uint_fragment_shader = utils::create_shader_module (context.logical_device, context.allocation_callbacks, uint_frag.value ());
 
     const auto vertex_shader_stage_info      = utils::init_VkPipelineShaderStageCreateInfo (VK_SHADER_STAGE_VERTEX_BIT, vertex_shader, "main");
     const auto fragment_shader_stage_info    = utils::init_VkPipelineShaderStageCreateInfo (VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader, "main");
@@ -167,7 +181,10 @@ void canvas_render::create_pipeline () {
     colour_blending.blendConstants[2] = 0.0f;
     colour_blending.blendConstants[3] = 0.0f;
 
-    const auto pipeline_layout_info = utils::init_VkPipelineLayoutCreateInfo(1, &state.descriptor_set_layout);
+    auto pipeline_layout_info = utils::init_VkPipelineLayoutCreateInfo(1, &state.descriptor_set_layout);
+    const VkPushConstantRange push_constant_range = utils::init_VkPushConstantRange (VK_SHADER_STAGE_FRAGMENT_BIT, sizeof (display));
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
 
     vk_assert (vkCreatePipelineLayout (context.logical_device, &pipeline_layout_info, context.allocation_callbacks, &state.pipeline_layout));
 
@@ -190,8 +207,12 @@ void canvas_render::create_pipeline () {
     pipeline_info.subpass = 0;
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-    vk_assert (vkCreateGraphicsPipelines (context.logical_device, VK_NULL_HANDLE, 1, &pipeline_info, context.allocation_callbacks, &state.pipeline));
+    vk_assert (vkCreateGraphicsPipelines (context.logical_device, context.logical_device_info.pipeline_cache, 1, &pipeline_info, context.allocation_callbacks, &state.pipeline));
+
+    shader_stages[1] = utils::init_VkPipelineShaderStageCreateInfo (VK_SHADER_STAGE_FRAGMENT_BIT, uint_fragment_shader, "main");
+    vk_assert (vkCreateGraphicsPipelines (context.logical_device, context.logical_device_info.pipeline_cache, 1, &pipeline_info, context.allocation_callbacks, &state.uint_pipeline));
 
+    vkDestroyShaderModule (context.logical_device, uint_fragment_shader, context.allocation_callbacks);
     vkDestroyShaderModule (context.logical_device, fragment_shader, context.allocation_callbacks);
     vkDestroyShaderModule (context.logical_device, vertex_shader, context.allocation_callbacks);
 }
@@ -200,6 +221,8 @@ void canvas_render::destroy_pipeline () {
 
     vkDestroyPipeline (context.logical_device, state.pipeline, context.allocation_callbacks);
     state.pipeline = VK_NULL_HANDLE;
+    vkDestroyPipeline (context.logical_device, state.uint_pipeline, context.allocation_callbacks);
+    state.uint_pipeline = VK_NULL_HANDLE;
     vkDestroyPipelineLayout (context.logical_device, state.pipeline_layout, context.allocation_callbacks);
     state.pipeline_layout = VK_NULL_HANDLE;
 }
@@ -243,8 +266,9 @@ void canvas_render::create_command_buffer () {
         vkCmdSetScissor(state.command_buffers[i], 0, 1, &scissor);
 
         vkCmdBeginRenderPass (state.command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline (state.command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline);
+        vkCmdBindPipeline (state.command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, state.uint_texture ? state.uint_pipeline : state.pipeline);
         vkCmdBindDescriptorSets (state.command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline_layout, 0, 1, &state.descriptor_set, 0, NULL);
+        vkCmdPushConstants (state.command_buffers[i], state.pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof (display), &state.display);
         vkCmdDraw (state.command_buffers[i], 3, 1, 0, 0);
         vkCmdEndRenderPass (state.command_buffers[i]);
 
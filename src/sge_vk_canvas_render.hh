@@ -18,9 +18,20 @@ class presentation;
 class canvas_render {
 public:
 
-    typedef std::function<const VkDescriptorImageInfo&()> tex_fn;
+    typedef std::function<const texture&()> tex_fn;
     typedef std::function<VkViewport ()> viewport_fn;
 
+    // how the texture is shown, matches the fragment shaders' push constants.
+    enum class display_mode : int32_t { direct, tonemapped, grey, hashed };
+
+    struct display {
+        display_mode                    mode = display_mode::direct;
+        float                           exposure = 1.0f;
+        float                           range = 1.0f;
+    };
+
+    static display_mode                 get_default_display_mode                (VkFormat);
+
     enum resource_bit : uint32_t {
         SYNCHRONISATION = (1 << 0),
         DESCRIPTOR_SET_LAYOUT = (1 << 1),
@@ -53,6 +64,9 @@ public:
     void                                create_resources                        (resource_flags);
     void                                destroy_resources                       (resource_flags);
 
+    const display&                      get_display                             ()                const { return state.display; }
+    void                                set_display                             (const display& z)      { state.display = z; } // takes effect when the command buffers are next created.
+
     //void                                refresh_command_buffers                 ();
 
 private:
@@ -83,6 +97,9 @@ private:
         VkDescriptorSet                 descriptor_set                          = VK_NULL_HANDLE;
         VkPipelineLayout                pipeline_layout                         = VK_NULL_HANDLE;
         VkPipeline                      pipeline                                = VK_NULL_HANDLE;
+        VkPipeline                      uint_pipeline                           = VK_NULL_HANDLE; // for integer textures.
+        bool                            uint_texture                            = false; // set with the descriptor set.
+        struct display                  display;
         std::vector<VkCommandBuffer>    command_buffers;
     };
 
@@ -0,0 +1,416 @@
+#include "sge_vk_compute_graph.hh"
+
+#include "sge_utils.hh"
+#include "sge_archive.hh"
+
+namespace sge::vk {
+
+static VkFormat get_format (sge::app::transient_format z) {
+    switch (z) {
+        case sge::app::transient_format::rgba8: return VK_FORMAT_R8G8B8A8_UNORM;
+        case sge::app::transient_format::rgba16f: return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case sge::app::transient_format::rgba32f: return VK_FORMAT_R32G32B32A32_SFLOAT;
+        case sge::app::transient_format::r32f: return VK_FORMAT_R32_SFLOAT;
+        case sge::app::transient_format::rg32f: return VK_FORMAT_R32G32_SFLOAT;
+        case sge::app::transient_format::r32ui: return VK_FORMAT_R32_UINT;
+        default: assert (false); return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static VkExtent2D scale_extent (VkExtent2D z_extent, float z_scale) {
+    return {
+        std::max (1u, (uint32_t) (z_extent.width * z_scale + 0.5f)),
+        std::max (1u, (uint32_t) (z_extent.height * z_scale + 0.5f)) };
+}
+
+static bool overlaps (int z_first_a, int z_last_a, int z_first_b, int z_last_b) {
+    return z_first_a <= z_last_b && z_first_b <= z_last_a;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+compute_graph::compute_graph (const struct context& z_context, const struct sge::app::content& z_content)
+    : context (z_context)
+    , content (z_content)
+{
+    shader_code.resize (content.passes.size ());
+    for (int i = 0; i < content.passes.size (); ++i) {
+        const auto& p = content.passes[i];
+        for (const auto& name : p.reads) assert (name == "output" || find_resource (name) != output);
+        for (const auto& name : p.writes) assert (name == "output" || find_resource (name) != output);
+        for (const auto& name : p.writes) assert (name != "secondary" || content.secondary_output.has_value ());
+        for (const auto& name : p.reads) assert (name != "secondary" || content.secondary_output.has_value ());
+        const auto spirv = sge::utils::get_assets ().get (p.shader_path.c_str ());
+        assert (spirv.has_value ());
+        shader_code[i] = spirv.value ();
+    }
+    cull_passes ();
+}
+
+compute_graph::~compute_graph () {
+    assert (passes.empty () && resources.empty ()); // destroy first.
+}
+
+int compute_graph::find_resource (const std::string& z_name) const {
+    if (z_name == "secondary")
+        return secondary;
+    const int num_images = (int) content.transient_images.size ();
+    for (int i = 0; i < num_images; ++i)
+        if (content.transient_images[i].name == z_name)
+            return i;
+    for (int i = 0; i < content.transient_buffers.size (); ++i)
+        if (content.transient_buffers[i].name == z_name)
+            return num_images + i;
+    return output;
+}
+
+// Walks back from the outputs keeping each pass that writes something a later live pass (or an output) needs.
+void compute_graph::cull_passes () {
+    const int num_resources = (int) (content.transient_images.size () + content.transient_buffers.size ());
+    const auto slot = [num_resources] (int i) { return i < 0 ? num_resources - 1 - i : i; };
+    std::vector<bool> needed (num_resources + 2, false);
+    needed[slot (output)] = true;
+    needed[slot (secondary)] = content.secondary_output.has_value ();
+
+    culled.assign (content.passes.size (), true);
+    for (int i = (int) content.passes.size () - 1; i >= 0; --i) {
+        const auto& p = content.passes[i];
+        if (std::none_of (p.writes.begin (), p.writes.end (), [&] (const std::string& name) { return needed[slot (find_resource (name))]; }))
+            continue;
+        culled[i] = false;
+        for (const auto& name : p.reads)
+            needed[slot (find_resource (name))] = true;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+void compute_graph::create (VkExtent2D z_output_size, const texture& z_output, const texture* z_secondary, const std::vector<device_buffer>& z_uniforms, const std::vector<device_buffer>& z_blobs) {
+    output_image = z_output.image;
+    secondary_image = z_secondary ? z_secondary->image : VK_NULL_HANDLE;
+    resources.resize (content.transient_images.size () + content.transient_buffers.size ());
+
+    for (int i = 0; i < content.passes.size (); ++i) {
+        if (culled[i])
+            continue;
+        pass p;
+        p.index = i;
+        for (const auto& name : content.passes[i].reads) p.reads.emplace_back (find_resource (name));
+        for (const auto& name : content.passes[i].writes) p.writes.emplace_back (find_resource (name));
+        for (int r : p.reads) if (r >= 0) resources[r].last_pass = (int) passes.size ();
+        for (int r : p.writes) if (r >= 0) resources[r].last_pass = (int) passes.size ();
+        for (int r : p.reads) if (r >= 0 && resources[r].first_pass < 0) resources[r].first_pass = (int) passes.size ();
+        for (int r : p.writes) if (r >= 0 && resources[r].first_pass < 0) resources[r].first_pass = (int) passes.size ();
+        passes.emplace_back (std::move (p));
+    }
+
+    create_resources (z_output_size);
+    alias_resources ();
+
+    for (pass& p : passes) {
+        p.extent = z_output_size;
+        for (int r : p.writes) {
+            if (r < 0) break;
+            if (resources[r].is_image) { p.extent = resources[r].extent; break; }
+        }
+        create_pass (p, z_output, z_secondary, z_uniforms, z_blobs);
+    }
+
+    create_barriers ();
+}
+
+void compute_graph::create_resources (VkExtent2D z_output_size) {
+    const int num_images = (int) content.transient_images.size ();
+    for (int i = 0; i < resources.size (); ++i) {
+        resource& r = resources[i];
+        if (r.first_pass < 0)
+            continue; // only used by culled passes.
+
+        VkMemoryRequirements requirements;
+        if (i < num_images) {
+            const auto& desc = content.transient_images[i];
+            r.is_image = true;
+            r.format = get_format (desc.format);
+            r.extent = scale_extent (z_output_size, desc.scale);
+
+            VkFormatProperties format_properties;
+            vkGetPhysicalDeviceFormatProperties (context.physical_device, r.format, &format_properties);
+            assert (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+
+            auto image_create_info = utils::init_VkImageCreateInfo ();
+            image_create_info.imageType = VK_IMAGE_TYPE_2D;
+            image_create_info.format = r.format;
+            image_create_info.extent = { r.extent.width, r.extent.height, 1 };
+            image_create_info.mipLevels = 1;
+            image_create_info.arrayLayers = 1;
+            image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+            image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            image_create_info.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+            vk_assert (vkCreateImage (context.logical_device, &image_create_info, context.allocation_callbacks, &r.image));
+            vkGetImageMemoryRequirements (context.logical_device, r.image, &requirements);
+        }
+        else {
+            const auto& desc = content.transient_buffers[i - num_images];
+            const VkExtent2D extent = scale_extent (z_output_size, desc.scale);
+            const VkDeviceSize size = desc.per_pixel ? desc.size * extent.width * extent.height : desc.size;
+            assert (size > 0);
+
+            auto buffer_create_info = utils::init_VkBufferCreateInfo (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, size);
+            buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            vk_assert (vkCreateBuffer (context.logical_device, &buffer_create_info, context.allocation_callbacks, &r.buffer));
+            vkGetBufferMemoryRequirements (context.logical_device, r.buffer, &requirements);
+            r.buffer_descriptor = { r.buffer, 0, VK_WHOLE_SIZE };
+        }
+        r.size = requirements.size;
+        r.memory_type_bits = requirements.memoryTypeBits;
+    }
+}
+
+// Largest first, each resource goes into the first block not in use by another during its lifetime. Everything is
+// bound at offset zero so alignment is never an issue.
+void compute_graph::alias_resources () {
+    std::vector<int> order;
+    for (int i = 0; i < resources.size (); ++i)
+        if (resources[i].first_pass >= 0)
+            order.emplace_back (i);
+    std::stable_sort (order.begin (), order.end (), [this] (int l, int r) { return resources[l].size > resources[r].size; });
+
+    for (int i : order) {
+        resource& r = resources[i];
+        for (int b = 0; b < blocks.size () && r.block < 0; ++b) {
+            const memory_block& block = blocks[b];
+            if (!(block.memory_type_bits & r.memory_type_bits))
+                continue;
+            const bool available = std::none_of (block.resources.begin (), block.resources.end (), [&] (int other) {
+                return overlaps (r.first_pass, r.last_pass, resources[other].first_pass, resources[other].last_pass);
+            });
+            if (available)
+                r.block = b;
+        }
+        if (r.block < 0) {
+            r.block = (int) blocks.size ();
+            blocks.emplace_back ();
+        }
+        memory_block& block = blocks[r.block];
+        block.resources.emplace_back (i);
+        block.size = std::max (block.size, r.size);
+        block.memory_type_bits &= r.memory_type_bits;
+    }
+
+    for (memory_block& block : blocks) {
+        VkMemoryRequirements requirements = {};
+        requirements.size = block.size;
+        requirements.memoryTypeBits = block.memory_type_bits;
+        auto memory_allocate_info = utils::init_VkMemoryAllocateInfo ();
+        memory_allocate_info.allocationSize = block.size;
+        memory_allocate_info.memoryTypeIndex = utils::choose_memory_type (context.physical_device, requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vk_assert (vkAllocateMemory (context.logical_device, &memory_allocate_info, context.allocation_callbacks, &block.memory));
+    }
+
+    for (resource& r : resources) {
+        if (r.block < 0)
+            continue;
+        if (r.is_image) {
+            vk_assert (vkBindImageMemory (context.logical_device, r.image, blocks[r.block].memory, 0));
+            VkImageViewCreateInfo view = utils::init_VkImageViewCreateInfo ();
+            view.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            view.format = r.format;
+            view.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+            view.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+            view.image = r.image;
+            vk_assert (vkCreateImageView (context.logical_device, &view, context.allocation_callbacks, &r.view));
+            r.image_descriptor = utils::init_VkDescriptorImageInfo (VK_NULL_HANDLE, r.view, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        else {
+            vk_assert (vkBindBufferMemory (context.logical_device, r.buffer, blocks[r.block].memory, 0));
+        }
+    }
+}
+
+// A barrier is needed before a pass reads or writes what an earlier one wrote, or writes what an earlier one read.
+// Transient images start each frame undefined (their memory may have been used by another resource since) and move to
+// the general layout on first use, the outputs stay in the general layout throughout.
+void compute_graph::create_barriers () {
+    const int num_resources = (int) resources.size ();
+    const auto slot = [num_resources] (int i) { return i < 0 ? num_resources - 1 - i : i; };
+    std::vector<VkAccessFlags> pending (resources.size () + 2, 0); // accesses since the last barrier.
+    std::vector<bool> used (resources.size () + 2, false);
+
+    for (pass& p : passes) {
+        std::vector<std::pair<int, VkAccessFlags>> accesses;
+        const auto add = [&] (int r, VkAccessFlags access) {
+            auto existing = std::find_if (accesses.begin (), accesses.end (), [r] (const auto& x) { return x.first == r; });
+            if (existing != accesses.end ()) existing->second |= access;
+            else accesses.emplace_back (r, access);
+        };
+        for (int r : p.reads) add (r, VK_ACCESS_SHADER_READ_BIT);
+        for (int r : p.writes) add (r, VK_ACCESS_SHADER_WRITE_BIT);
+
+        for (const auto& [r, access] : accesses) {
+            const int s = slot (r);
+            const bool first_use = !used[s] && r >= 0;
+            VkAccessFlags src = pending[s];
+            const bool needed = first_use
+                || (src & VK_ACCESS_SHADER_WRITE_BIT)
+                || ((src & VK_ACCESS_SHADER_READ_BIT) && (access & VK_ACCESS_SHADER_WRITE_BIT));
+            used[s] = true;
+            if (!needed) {
+                pending[s] |= access;
+                continue;
+            }
+            if (first_use)
+                src = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT; // by whatever last used the memory.
+            pending[s] = access;
+
+            if (r < 0 || resources[r].is_image) {
+                auto barrier = utils::init_VkImageMemoryBarrier ();
+                barrier.srcAccessMask = src;
+                barrier.dstAccessMask = access;
+                barrier.oldLayout = first_use ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_GENERAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+                barrier.image = r == output ? output_image : r == secondary ? secondary_image : resources[r].image;
+                barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+                p.image_barriers.emplace_back (barrier);
+            }
+            else {
+                auto barrier = utils::init_VkBufferMemoryBarrier ();
+                barrier.srcAccessMask = src;
+                barrier.dstAccessMask = access;
+                barrier.buffer = resources[r].buffer;
+                p.buffer_barriers.emplace_back (barrier);
+            }
+        }
+    }
+}
+
+void compute_graph::create_pass (pass& z_pass, const texture& z_output, const texture* z_secondary, const std::vector<device_buffer>& z_uniforms, const std::vector<device_buffer>& z_blobs) {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    std::vector<VkWriteDescriptorSet> writes;
+    uint32_t num_images = 0, num_buffers = 0;
+    const auto add_image = [&] (const VkDescriptorImageInfo* info) {
+        bindings.emplace_back (utils::init_VkDescriptorSetLayoutBinding (VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, (uint32_t) bindings.size ()));
+        writes.emplace_back (utils::init_VkWriteDescriptorSet (VK_NULL_HANDLE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, bindings.back ().binding, info, 1));
+        num_images++;
+    };
+    const auto add_buffer = [&] (VkDescriptorType type, const VkDescriptorBufferInfo* info) {
+        bindings.emplace_back (utils::init_VkDescriptorSetLayoutBinding (type, VK_SHADER_STAGE_COMPUTE_BIT, (uint32_t) bindings.size ()));
+        writes.emplace_back (utils::init_VkWriteDescriptorSet (VK_NULL_HANDLE, type, bindings.back ().binding, info, 1));
+        if (type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) num_buffers++;
+    };
+    const auto add_resource = [&] (int r) {
+        if (r < 0) return;
+        if (resources[r].is_image) add_image (&resources[r].image_descriptor);
+        else add_buffer (VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &resources[r].buffer_descriptor);
+    };
+
+    add_image (&z_output.descriptor);
+    for (const auto& u : z_uniforms) add_buffer (VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &u.descriptor);
+    for (const auto& b : z_blobs) add_buffer (VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &b.descriptor);
+    if (z_secondary) add_image (&z_secondary->descriptor);
+    for (int r : z_pass.reads) add_resource (r);
+    for (int r : z_pass.writes) add_resource (r);
+
+    auto descriptor_set_layout_create_info = utils::init_VkDescriptorSetLayoutCreateInfo (bindings);
+    vk_assert (vkCreateDescriptorSetLayout (context.logical_device, &descriptor_set_layout_create_info, context.allocation_callbacks, &z_pass.descriptor_set_layout));
+
+    std::vector<VkDescriptorPoolSize> pool_sizes = { utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, num_images) };
+    if (z_uniforms.size ()) pool_sizes.emplace_back (utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (uint32_t) z_uniforms.size ()));
+    if (num_buffers) pool_sizes.emplace_back (utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, num_buffers));
+    auto descriptor_pool_create_info = utils::init_VkDescriptorPoolCreateInfo (pool_sizes, 1);
+    vk_assert (vkCreateDescriptorPool (context.logical_device, &descriptor_pool_create_info, context.allocation_callbacks, &z_pass.descriptor_pool));
+
+    auto descriptor_set_allocate_info = utils::init_VkDescriptorSetAllocateInfo (z_pass.descriptor_pool, &z_pass.descriptor_set_layout, 1);
+    vk_assert (vkAllocateDescriptorSets (context.logical_device, &descriptor_set_allocate_info, &z_pass.descriptor_set));
+    for (auto& write : writes)
+        write.dstSet = z_pass.descriptor_set;
+    vkUpdateDescriptorSets (context.logical_device, (uint32_t) writes.size (), writes.data (), 0, nullptr);
+
+    auto pipeline_layout_create_info = utils::init_VkPipelineLayoutCreateInfo (1, &z_pass.descriptor_set_layout);
+    VkPushConstantRange push_constant_range;
+    if (content.push_constants.has_value ()) {
+        push_constant_range = utils::init_VkPushConstantRange (VK_SHADER_STAGE_COMPUTE_BIT, (uint32_t) content.push_constants.value ().size);
+        pipeline_layout_create_info.pushConstantRangeCount = 1;
+        pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+    }
+    vk_assert (vkCreatePipelineLayout (context.logical_device, &pipeline_layout_create_info, context.allocation_callbacks, &z_pass.pipeline_layout));
+
+    const VkShaderModule module = utils::create_shader_module (context.logical_device, context.allocation_callbacks, shader_code[z_pass.index]);
+    auto pipeline_create_info = utils::init_VkComputePipelineCreateInfo (z_pass.pipeline_layout);
+    pipeline_create_info.stage = utils::init_VkPipelineShaderStageCreateInfo (VK_SHADER_STAGE_COMPUTE_BIT, module, "main");
+    vk_assert (vkCreateComputePipelines (context.logical_device, context.logical_device_info.pipeline_cache, 1, &pipeline_create_info, context.allocation_callbacks, &z_pass.pipeline));
+    vkDestroyShaderModule (context.logical_device, module, context.allocation_callbacks);
+}
+
+void compute_graph::destroy () {
+    for (pass& p : passes) {
+        vkDestroyPipeline (context.logical_device, p.pipeline, context.allocation_callbacks);
+        vkDestroyPipelineLayout (context.logical_device, p.pipeline_layout, context.allocation_callbacks);
+        vkDestroyDescriptorPool (context.logical_device, p.descriptor_pool, context.allocation_callbacks);
+        vkDestroyDescriptorSetLayout (context.logical_device, p.descriptor_set_layout, context.allocation_callbacks);
+    }
+    passes.clear ();
+
+    for (resource& r : resources) {
+        vkDestroyImageView (context.logical_device, r.view, context.allocation_callbacks);
+        vkDestroyImage (context.logical_device, r.image, context.allocation_callbacks);
+        vkDestroyBuffer (context.logical_device, r.buffer, context.allocation_callbacks);
+    }
+    resources.clear ();
+
+    for (memory_block& block : blocks)
+        vkFreeMemory (context.logical_device, block.memory, context.allocation_callbacks);
+    blocks.clear ();
+
+    output_image = VK_NULL_HANDLE;
+    secondary_image = VK_NULL_HANDLE;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+void compute_graph::record (VkCommandBuffer z_command_buffer) {
+    const uint32_t workgroup_size_x = 16;
+    const uint32_t workgroup_size_y = 16;
+
+    for (const pass& p : passes) {
+        if (p.image_barriers.size () || p.buffer_barriers.size ()) {
+            vkCmdPipelineBarrier (
+                z_command_buffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                0, nullptr,
+                (uint32_t) p.buffer_barriers.size (), p.buffer_barriers.data (),
+                (uint32_t) p.image_barriers.size (), p.image_barriers.data ());
+        }
+        if (content.push_constants.has_value ()) {
+            vkCmdPushConstants (
+                z_command_buffer,
+                p.pipeline_layout,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                (uint32_t) content.push_constants.value ().size,
+                content.push_constants.value ().address);
+        }
+        vkCmdBindPipeline (z_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, p.pipeline);
+        vkCmdBindDescriptorSets (z_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, p.pipeline_layout, 0, 1, &p.descriptor_set, 0, nullptr);
+        vkCmdDispatch (
+            z_command_buffer,
+            (p.extent.width + workgroup_size_x - 1) / workgroup_size_x,
+            (p.extent.height + workgroup_size_y - 1) / workgroup_size_y,
+            1);
+    }
+}
+
+void compute_graph::debug_ui () {
+    ImGui::Text ("Compute graph");
+    for (int i = 0; i < content.passes.size (); ++i)
+        ImGui::BulletText ("%s%s", content.passes[i].name.c_str (), culled[i] ? " (culled)" : "");
+
+    VkDeviceSize unaliased = 0, aliased = 0;
+    for (const resource& r : resources) unaliased += r.size;
+    for (const memory_block& block : blocks) aliased += block.size;
+    ImGui::BulletText ("Transient memory: %.2f MB in %d blocks (%.2f MB unaliased)", aliased / (1024.0 * 1024.0), (int) blocks.size (), unaliased / (1024.0 * 1024.0));
+}
+
+}
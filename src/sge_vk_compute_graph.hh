@@ -0,0 +1,93 @@
+// SGE-VK-COMPUTE-GRAPH
+// ---------------------------------- //
+// Multi-pass user content.
+// ---------------------------------- //
+// * Built from sge::app::content::passes whenever the compute target's size dependent resources are (re)created.
+// * Barriers & layout transitions are worked out once, when built, from each pass's declared reads & writes, the
+//   recorded command buffer is then reused frame to frame.
+// * Transient resources whose lifetimes (first to last pass using them) don't overlap share device memory, so all of
+//   them are considered undefined before their first use in a frame.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_app_interface.hh"
+#include "sge_vk_buffer.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+#include "sge_vk_texture.hh"
+
+namespace sge::vk {
+
+class compute_graph {
+public:
+    compute_graph (const struct context&, const struct sge::app::content&);
+    ~compute_graph ();
+
+    void                                create                                  (VkExtent2D output_size, const texture& output, const texture* secondary, const std::vector<device_buffer>& uniforms, const std::vector<device_buffer>& blobs);
+    void                                destroy                                 ();
+    void                                record                                  (VkCommandBuffer);
+
+    void                                debug_ui                                ();
+
+private:
+    static const int                    output = -1; // resource index of the compute target's image.
+    static const int                    secondary = -2; // and of its secondary image, if the content has one.
+
+    struct resource {
+        bool                            is_image = false;
+        VkFormat                        format = VK_FORMAT_UNDEFINED;
+        VkExtent2D                      extent = { 0, 0 };
+        VkDeviceSize                    size = 0; // of its memory requirements.
+        uint32_t                        memory_type_bits = 0;
+        int                             first_pass = -1; // lifetime over the live passes.
+        int                             last_pass = -1;
+        int                             block = -1; // of memory it's bound to.
+        VkImage                         image = VK_NULL_HANDLE;
+        VkImageView                     view = VK_NULL_HANDLE;
+        VkBuffer                        buffer = VK_NULL_HANDLE;
+        VkDescriptorImageInfo           image_descriptor = {};
+        VkDescriptorBufferInfo          buffer_descriptor = {};
+    };
+
+    struct memory_block {
+        VkDeviceMemory                  memory = VK_NULL_HANDLE;
+        VkDeviceSize                    size = 0;
+        uint32_t                        memory_type_bits = ~0u;
+        std::vector<int>                resources;
+    };
+
+    struct pass {
+        int                             index; // into content.passes.
+        std::vector<int>                reads;
+        std::vector<int>                writes;
+        VkExtent2D                      extent = { 0, 0 }; // dispatched over.
+        VkDescriptorSetLayout           descriptor_set_layout = VK_NULL_HANDLE;
+        VkDescriptorPool                descriptor_pool = VK_NULL_HANDLE;
+        VkDescriptorSet                 descriptor_set = VK_NULL_HANDLE;
+        VkPipelineLayout                pipeline_layout = VK_NULL_HANDLE;
+        VkPipeline                      pipeline = VK_NULL_HANDLE;
+        std::vector<VkImageMemoryBarrier> image_barriers; // recorded before the dispatch.
+        std::vector<VkBufferMemoryBarrier> buffer_barriers;
+    };
+
+    const context&                      context;
+    const sge::app::content&            content;
+    std::vector<dataspan>               shader_code; // per content pass, SPIR-V used in place from the assets.
+    std::vector<bool>                   culled; // per content pass.
+
+    VkImage                             output_image = VK_NULL_HANDLE;
+    VkImage                             secondary_image = VK_NULL_HANDLE;
+    std::vector<resource>               resources; // images then buffers, as declared.
+    std::vector<memory_block>           blocks;
+    std::vector<pass>                   passes; // live ones only, in order.
+
+    int                                 find_resource                           (const std::string&) const;
+    void                                cull_passes                             ();
+    void                                create_resources                        (VkExtent2D);
+    void                                alias_resources                         ();
+    void                                create_barriers                         ();
+    void                                create_pass                             (pass&, const texture&, const texture*, const std::vector<device_buffer>&, const std::vector<device_buffer>&);
+};
+
+}
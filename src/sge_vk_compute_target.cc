@@ -1,25 +1,75 @@
 #include "sge_vk_compute_target.hh"
 
 #include "sge_vk_presentation.hh"
+#include "sge_vk_compute_graph.hh"
+#include "sge_vk_shader_compiler.hh"
+#include "sge_vk_shader_reload.hh"
+#include "sge_vk_workgroup_tuner.hh"
+#include "sge_vk_uploader.hh"
+#include "sge_vk_blob_streamer.hh"
+#include "sge_vk_texture_loader.hh"
 #include "sge_utils.hh"
+#include "sge_archive.hh"
 
 namespace sge::vk {
 
+static const sge::app::specialization unspecialized = {};
 
-compute_target::compute_target (const struct vk::context& z_context, const struct vk::queue_identifier& z_qid, const struct sge::app::content& z_content, const size_fn& z_size_fn)
+static VkFormat get_format (sge::app::output_format z) {
+    switch (z) {
+        case sge::app::output_format::rgba8: return VK_FORMAT_R8G8B8A8_UNORM;
+        case sge::app::output_format::rgba16f: return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case sge::app::output_format::rgba32f: return VK_FORMAT_R32G32B32A32_SFLOAT;
+        case sge::app::output_format::r32f: return VK_FORMAT_R32_SFLOAT;
+        case sge::app::output_format::r32ui: return VK_FORMAT_R32_UINT;
+        case sge::app::output_format::rgb10a2: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    }
+    return VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+static const char* get_name (sge::app::output_format z) {
+    switch (z) {
+        case sge::app::output_format::rgba8: return "rgba8";
+        case sge::app::output_format::rgba16f: return "rgba16f";
+        case sge::app::output_format::rgba32f: return "rgba32f";
+        case sge::app::output_format::r32f: return "r32f";
+        case sge::app::output_format::r32ui: return "r32ui";
+        case sge::app::output_format::rgb10a2: return "rgb10a2";
+    }
+    return "";
+}
+
+// What to try in place of a format the device can't write, nearest first (precision is kept over size).
+static std::vector<sge::app::output_format> get_fallbacks (sge::app::output_format z) {
+    using f = sge::app::output_format;
+    switch (z) {
+        case f::rgba16f: return { f::rgba32f, f::rgba8 };
+        case f::rgba32f: return { f::rgba16f, f::rgba8 };
+        case f::r32f: return { f::rgba32f, f::rgba16f };
+        case f::rgb10a2: return { f::rgba16f, f::rgba8 };
+        default: return {};
+    }
+}
+
+compute_target::compute_target (const struct vk::context& z_context, const struct vk::queue_identifier& z_qid, const struct vk::queue_identifier& z_transfer, const struct sge::app::content& z_content, const size_fn& z_size_fn)
     : context (z_context)
     , identifier (z_qid)
     , content (z_content)
     , get_size_fn (z_size_fn)
+    , uploader (std::make_unique<class uploader> (z_context, z_transfer, z_qid))
 {
 }
 
+compute_target::~compute_target () = default;
+
 
 void compute_target::end_of_frame () {
     const int num_blobs = content.blobs.size ();
 
     if (sge::utils::contains_value (state.pending_blob_changes)) {
 
+        // the frame just submitted uses the blobs (its uploads are acquired ahead of the dispatch), nothing else does.
+        vkWaitForFences (context.logical_device, 1, &state.fence, VK_TRUE, UINT64_MAX);
         destroy_rl ();
 
         for (int i = 0; i < num_blobs; ++i) {
@@ -35,6 +85,9 @@ void compute_target::end_of_frame () {
 
     state.pending_blob_changes.clear ();
     state.pending_blob_changes.resize (num_blobs);
+
+    state.frame++;
+    destroy_retired_pipelines (false);
 }
 
 void compute_target::create () {
@@ -44,22 +97,96 @@ void compute_target::create () {
     auto fenceCreateInfo = utils::init_VkFenceCreateInfo (VK_FENCE_CREATE_SIGNALED_BIT);
     vk_assert (vkCreateFence (context.logical_device, &fenceCreateInfo, context.allocation_callbacks, &state.fence));
 
+    for (const auto& specialization : content.specializations)
+        assert (specialization.workgroup_size_x > 0 && specialization.workgroup_size_y > 0);
+
+    const auto& configuration = sge::app::get_configuration ();
+    if (!leader)
+        compiler = std::make_unique<shader_compiler> (configuration.shader_cache_path);
+
+    if (!content.passes.empty ())
+        graph = std::make_unique<compute_graph> (context, content);
+    else
+        create_shader ();
+
+    if (!content.streamed_blobs.empty ()) {
+        assert (!graph); // passes only bind the blobs.
+        streamer = std::make_unique<blob_streamer> (context, *uploader, content.streamed_blobs);
+    }
+
+    if (!content.textures.empty ()) {
+        assert (!graph); // passes only bind the blobs.
+        textures = std::make_unique<texture_loader> (context, identifier, content.textures);
+    }
+
     create_r ();
 }
 
+// Loads (or compiles) the single shader of content that isn't a graph of passes.
+void compute_target::create_shader () {
+    const auto& configuration = sge::app::get_configuration ();
+    if (leader) {
+        assert (!leader->graph);
+        state.compute_shader_code = leader->state.compute_shader_code;
+        state.shader_generation = leader->state.shader_generation;
+    }
+    else
+        load_shader ();
+
+    if (configuration.autotune_workgroup_size && content.workgroup_size_ids.has_value ()) {
+        tuner = std::make_unique<workgroup_tuner> (context, identifier, configuration.pipeline_cache_path, configuration.autotune_frames);
+        select_workgroup_size ();
+    }
+}
+
+void compute_target::load_shader () {
+    const auto& configuration = sge::app::get_configuration ();
+    const std::string source_path = find_shader_source ();
+
+    shader_compiler::options shader_options;
+    shader_options.defines = content.shader_defines;
+    shader_options.optimise = configuration.optimise_shaders;
+
+    bool compiled = false;
+    if (!source_path.empty () && (configuration.runtime_shader_compilation || !content.shader_defines.empty ())) {
+        std::string log;
+        compiled = compiler->compile (source_path, shader_options, state.compute_shader_code, log);
+        if (!compiled)
+            std::cout << "Failed to compile " << source_path << ", falling back to " << content.shader_path << ":\n" << log << "\n";
+    }
+    if (!compiled) {
+        // copied, as the shader reloader swaps in new code.
+        const auto spirv = sge::utils::get_assets ().get (content.shader_path.c_str ());
+        assert (spirv.has_value ());
+        const uint8_t* bytes = (const uint8_t*) spirv->address;
+        state.compute_shader_code.assign (bytes, bytes + spirv->size);
+    }
+
+    if (configuration.enable_shader_hot_reload)
+        reloader = std::make_unique<shader_reloader> (context, content.shader_path, source_path, *compiler, shader_options, state.compute_shader_code);
+}
+
 void compute_target::create_r () {
 
 
     state.current_size = get_size_fn ();
     assert (state.current_size.width > 0 && state.current_size.height > 0);
 
-    prepare_texture_target (VK_FORMAT_R8G8B8A8_UNORM, state.current_size);
+    prepare_texture_target (state.compute_tex, choose_output_format (content.output), state.current_size);
+    if (content.secondary_output.has_value ())
+        prepare_texture_target (state.secondary_tex, choose_output_format (content.secondary_output.value ()), state.current_size);
     prepare_uniform_buffers ();
     prepare_blob_buffers ();
     create_rl ();
 }
 
 void compute_target::create_rl () {
+    if (graph) {
+        graph->create (state.current_size, state.compute_tex, get_secondary_texture (), state.uniform_buffers, state.blob_storage_buffers);
+        create_command_buffer ();
+        record_command_buffer (state.current_size);
+        return;
+    }
     create_descriptor_set_layout ();
     create_descriptor_set ();
     create_compute_pipeline ();
@@ -69,6 +196,10 @@ void compute_target::create_rl () {
 
 void compute_target::destroy_rl () {
     destroy_command_buffer ();
+    if (graph) {
+        graph->destroy ();
+        return;
+    }
     destroy_compute_pipeline ();
 
     vkDestroyDescriptorPool (context.logical_device, state.descriptor_pool, context.allocation_callbacks);
@@ -87,8 +218,21 @@ void compute_target::destroy_r () {
 }
 void compute_target::destroy () {
     destroy_r ();
+    textures.reset ();
+    streamer.reset ();
+    graph.reset ();
+    reloader.reset ();
+    compiler.reset ();
+    tuner.reset ();
+    destroy_retired_pipelines (true);
+
+    vkDestroyShaderModule (context.logical_device, state.compute_shader_module, context.allocation_callbacks);
+    state.compute_shader_module = VK_NULL_HANDLE;
 
     state.compute_tex.destroy ();
+    vkDestroyQueryPool (context.logical_device, state.band_query_pool, context.allocation_callbacks);
+    state.band_query_pool = VK_NULL_HANDLE;
+
     vkDestroySemaphore (context.logical_device, state.compute_complete, context.allocation_callbacks);
     state.compute_complete = VK_NULL_HANDLE;
 
@@ -97,14 +241,18 @@ void compute_target::destroy () {
 }
 
 
-void compute_target::enqueue () {
+void compute_target::enqueue (VkSemaphore z_also_signal) {
+    uploader->submit (); // only makes the dispatch wait if there's anything to upload.
+    if (textures)
+        textures->submit (); // likewise, only if any texture chunks were loaded.
+
     auto submitInfo = utils::init_VkSubmitInfo ();
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &state.command_buffer;
 
-    VkSemaphore signalSemaphores[] = { state.compute_complete };
-    submitInfo.signalSemaphoreCount = 1;
+    VkSemaphore signalSemaphores[] = { state.compute_complete, z_also_signal };
+    submitInfo.signalSemaphoreCount = z_also_signal != VK_NULL_HANDLE ? 2 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     vkWaitForFences (context.logical_device, 1, &state.fence, VK_TRUE, UINT64_MAX);
@@ -114,13 +262,38 @@ void compute_target::enqueue () {
 }
 
 
-void compute_target::update (bool& push_flag, std::vector<bool>& ubo_flags, std::vector<std::optional<dataspan>>& sbo_flags) {
+void compute_target::update (bool& push_flag, std::vector<bool>& ubo_flags, std::vector<std::optional<dataspan>>& sbo_flags, std::vector<fixed::byterange_list>& sbo_ranges) {
+
+    swap_in_reloaded_pipeline ();
+    read_band_timer ();
+
+    if (state.pending_specialization.has_value ()) {
+        state.specialization = state.pending_specialization.value ();
+        state.pending_specialization.reset ();
+        select_workgroup_size ();
+        update_reloader_target ();
+        record_command_buffer (state.current_size);
+    }
+
+    if (tuner && tuner->update ()) {
+        update_reloader_target ();
+        record_command_buffer (state.current_size);
+    }
 
     if (push_flag) {
         record_command_buffer (state.current_size);
         push_flag = false;
     }
 
+    // uniforms & direct blobs are written in place, so the last dispatch must be done with them (there's only ever one
+    // frame in flight, so this doesn't usually wait).
+    vkWaitForFences (context.logical_device, 1, &state.fence, VK_TRUE, UINT64_MAX);
+
+    if (streamer)
+        streamer->update ();
+    if (textures)
+        textures->update ();
+
     for (int i = 0; i < content.uniforms.size (); ++i) {
         if (ubo_flags[i]) {
             update_uniform_buffer (i);
@@ -134,13 +307,15 @@ void compute_target::update (bool& push_flag, std::vector<bool>& ubo_flags, std:
             dataspan& ds = sbo_flags[i].value ();
 
             if (ds == state.latest_blob_infos[i]) {
-                update_blob_buffer (i, ds);
+                sge::utils::coalesce (sbo_ranges[i]);
+                update_blob_buffer (i, ds, sbo_ranges[i]);
             }
             else {
-                state.pending_blob_changes[i] = ds;
+                state.pending_blob_changes[i] = ds; // recreated & uploaded whole.
             }
             sbo_flags[i].reset ();
         }
+        sbo_ranges[i].clear ();
     }
 }
 
@@ -152,7 +327,10 @@ void compute_target::prepare_uniform_buffers () {
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             &state.uniform_buffers[i],
-            u.size);
+            u.size,
+            nullptr,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); // saves the shader reading across the bus, where there's such memory.
+        state.uniform_buffers[i].map (); // persistently.
 
         update_uniform_buffer (i);
     }
@@ -160,10 +338,8 @@ void compute_target::prepare_uniform_buffers () {
 
 void compute_target::update_uniform_buffer (int ubo_idx) {
     auto& u = content.uniforms[ubo_idx];
-    state.uniform_buffers[ubo_idx].map ();
     assert (state.uniform_buffers[ubo_idx].size == u.size);
     memcpy (state.uniform_buffers[ubo_idx].mapped, u.address, u.size);
-    state.uniform_buffers[ubo_idx].unmap ();
 }
 
 void compute_target::destroy_uniform_buffers () {
@@ -173,18 +349,15 @@ void compute_target::destroy_uniform_buffers () {
     state.uniform_buffers.clear ();
 }
 
-void compute_target::copy_blob_from_staging_to_storage (int blob_idx) {
+void compute_target::upload_blob (int blob_idx) {
     assert (state.blob_staging_buffers[blob_idx].size == state.blob_storage_buffers[blob_idx].size);
-    VkCommandBuffer copy_command = context.create_command_buffer (VK_COMMAND_BUFFER_LEVEL_PRIMARY, identifier, true);
-    VkBufferCopy copy_region = {};
-    copy_region.size = state.blob_staging_buffers[blob_idx].size;
-    vkCmdCopyBuffer (
-        copy_command,
+    state.blob_copy_regions.clear ();
+    state.blob_copy_regions.emplace_back (VkBufferCopy { 0, 0, state.blob_staging_buffers[blob_idx].size });
+    uploader->copy (
         state.blob_staging_buffers[blob_idx].buffer,
         state.blob_storage_buffers[blob_idx].buffer,
-        1, &copy_region);
-
-    context.flush_command_buffer (copy_command, identifier, true);
+        state.blob_copy_regions.data (),
+        (uint32_t) state.blob_copy_regions.size ());
 }
 
 void compute_target::prepare_blob_buffers () {
@@ -192,6 +365,7 @@ void compute_target::prepare_blob_buffers () {
     state.blob_staging_buffers.resize (num_storage_buffers);
     state.blob_storage_buffers.resize (num_storage_buffers);
     state.latest_blob_infos.resize (num_storage_buffers);
+    state.direct_blobs.resize (num_storage_buffers);
     state.pending_blob_changes.resize (num_storage_buffers);
     for (int i = 0; i < num_storage_buffers; ++i) {
         auto& blob = content.blobs[i];
@@ -203,6 +377,8 @@ void compute_target::prepare_blob_buffer (int blob_idx, dataspan data) {
 
     state.latest_blob_infos[blob_idx].address = data.address;
     state.latest_blob_infos[blob_idx].size = data.size;
+    if (create_direct_blob_buffer (blob_idx, data))
+        return;
     // copy user data into a staging buffer
     context.create_buffer (
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -217,17 +393,99 @@ void compute_target::prepare_blob_buffer (int blob_idx, dataspan data) {
         &state.blob_storage_buffers[blob_idx],
         data.size);
     // copy the data from staging to gpu storage
-    copy_blob_from_staging_to_storage (blob_idx);
+    upload_blob (blob_idx);
 }
 
-void compute_target::update_blob_buffer (int blob_idx, dataspan data) {
+// Device local memory the host can write (resizable BAR, integrated & software devices) needs no staging buffer or
+// copy, the blob lives there persistently mapped. False if there's no such memory or no room left in it.
+bool compute_target::create_direct_blob_buffer (int blob_idx, dataspan data) {
+    device_buffer& storage = state.blob_storage_buffers[blob_idx];
+    storage.device = context.logical_device;
+
+    const auto buffer_create_info = utils::init_VkBufferCreateInfo (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, data.size);
+    vk_assert (vkCreateBuffer (context.logical_device, &buffer_create_info, context.allocation_callbacks, &storage.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements (context.logical_device, storage.buffer, &requirements);
+    const uint32_t memory_type = utils::try_choose_memory_type (context.physical_device, requirements,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties (context.physical_device, &memory_properties);
+
+    // without resizable BAR the window is only 256MiB & shared with the driver, so at most half of it is used.
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    if (memory_type != ~0u) {
+        const VkMemoryHeap& heap = memory_properties.memoryHeaps[memory_properties.memoryTypes[memory_type].heapIndex];
+        if (state.direct_blob_bytes + requirements.size <= heap.size / 2) {
+            auto memory_allocate_info = utils::init_VkMemoryAllocateInfo ();
+            memory_allocate_info.allocationSize = requirements.size;
+            memory_allocate_info.memoryTypeIndex = memory_type;
+            result = vkAllocateMemory (context.logical_device, &memory_allocate_info, context.allocation_callbacks, &storage.memory);
+        }
+    }
+    if (result != VK_SUCCESS) {
+        vkDestroyBuffer (context.logical_device, storage.buffer, context.allocation_callbacks);
+        storage.buffer = VK_NULL_HANDLE;
+        storage.memory = VK_NULL_HANDLE;
+        return false;
+    }
+
+    storage.alignment = requirements.alignment;
+    storage.size = data.size;
+    storage.usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    storage.memory_property_flags = memory_properties.memoryTypes[memory_type].propertyFlags;
+    storage.setup_descriptor ();
+    storage.bind ();
+    storage.map (); // persistently.
+    state.direct_blob_bytes += requirements.size;
+    state.direct_blobs[blob_idx] = true;
+
+    update_blob_buffer (blob_idx, data);
+    return true;
+}
+
+void compute_target::update_blob_buffer (int blob_idx, dataspan data, const fixed::byterange_list& ranges) {
+    state.blob_copy_regions.clear ();
+    if (ranges.empty ())
+        state.blob_copy_regions.emplace_back (VkBufferCopy { 0, 0, data.size });
+    for (const byterange& range : ranges) {
+        assert (range.offset + range.size <= data.size);
+        state.blob_copy_regions.emplace_back (VkBufferCopy { range.offset, range.offset, range.size });
+    }
+
+    const auto write = [&] (device_buffer& destination) {
+        for (const VkBufferCopy& region : state.blob_copy_regions)
+            memcpy ((uint8_t*) destination.mapped + region.dstOffset, (const uint8_t*) data.address + region.srcOffset, region.size);
+    };
+
+    if (state.direct_blobs[blob_idx]) {
+        device_buffer& storage = state.blob_storage_buffers[blob_idx];
+        write (storage);
+        if ((storage.memory_property_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+            storage.flush ();
+        return;
+    }
+
     state.blob_staging_buffers[blob_idx].map ();
-    state.blob_staging_buffers[blob_idx].copy (data.address, data.size);
+    write (state.blob_staging_buffers[blob_idx]);
     state.blob_staging_buffers[blob_idx].unmap ();
-    copy_blob_from_staging_to_storage (blob_idx);
+    uploader->copy (
+        state.blob_staging_buffers[blob_idx].buffer,
+        state.blob_storage_buffers[blob_idx].buffer,
+        state.blob_copy_regions.data (),
+        (uint32_t) state.blob_copy_regions.size (),
+        !ranges.empty ());
 }
 
 void compute_target::destroy_blob_buffer (int blob_idx) {
+    if (state.direct_blobs[blob_idx]) {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements (context.logical_device, state.blob_storage_buffers[blob_idx].buffer, &requirements);
+        state.direct_blob_bytes -= requirements.size;
+        state.direct_blobs[blob_idx] = false;
+    }
+    uploader->discard (state.blob_storage_buffers[blob_idx].buffer);
     state.blob_storage_buffers[blob_idx].destroy (context.allocation_callbacks);
     state.blob_staging_buffers[blob_idx].destroy (context.allocation_callbacks);
 }
@@ -239,14 +497,37 @@ void compute_target::destroy_blob_buffers () {
     }
     state.blob_storage_buffers.clear ();
     state.blob_staging_buffers.clear ();
+    state.direct_blobs.clear ();
 }
 
-void compute_target::prepare_texture_target (VkFormat format, const VkExtent2D sz) {
+// The format asked for if the device can both write it from a compute shader and sample it on the canvas, otherwise
+// the first of its fallbacks that it can.
+VkFormat compute_target::choose_output_format (sge::app::output_format z_format) const {
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    const auto supported = [&] (sge::app::output_format x) {
+        VkFormatProperties format_properties;
+        vkGetPhysicalDeviceFormatProperties (context.physical_device, get_format (x), &format_properties);
+        return (format_properties.optimalTilingFeatures & required) == required;
+    };
+    if (supported (z_format))
+        return get_format (z_format);
+    for (const auto fallback : get_fallbacks (z_format)) {
+        if (supported (fallback)) {
+            std::cout << "Output format " << get_name (z_format) << " isn't supported as a storage image, using " << get_name (fallback) << " in its place.\n";
+            return get_format (fallback);
+        }
+    }
+    assert (false); // rgba8, r32f & r32ui storage images are required by the spec.
+    return get_format (z_format);
+}
+
+void compute_target::prepare_texture_target (texture& z_tex, VkFormat format, const VkExtent2D sz) {
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties (context.physical_device, format, &formatProperties);
     assert (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
-    state.compute_tex.width = sz.width;
-    state.compute_tex.height = sz.height;
+    z_tex.format = format;
+    z_tex.width = sz.width;
+    z_tex.height = sz.height;
 
     auto imageCreateInfo = utils::init_VkImageCreateInfo ();
     imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -263,29 +544,31 @@ void compute_target::prepare_texture_target (VkFormat format, const VkExtent2D s
     auto memAllocInfo = utils::init_VkMemoryAllocateInfo ();
     VkMemoryRequirements memReqs;
 
-    vk_assert (vkCreateImage (context.logical_device, &imageCreateInfo, context.allocation_callbacks, &state.compute_tex.image));
-    vkGetImageMemoryRequirements (context.logical_device, state.compute_tex.image, &memReqs);
+    vk_assert (vkCreateImage (context.logical_device, &imageCreateInfo, context.allocation_callbacks, &z_tex.image));
+    vkGetImageMemoryRequirements (context.logical_device, z_tex.image, &memReqs);
     memAllocInfo.allocationSize = memReqs.size;
     memAllocInfo.memoryTypeIndex = utils::choose_memory_type (context.physical_device, memReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    vk_assert (vkAllocateMemory (context.logical_device, &memAllocInfo, context.allocation_callbacks, &state.compute_tex.device_memory));
-    vk_assert (vkBindImageMemory (context.logical_device, state.compute_tex.image, state.compute_tex.device_memory, 0));
+    vk_assert (vkAllocateMemory (context.logical_device, &memAllocInfo, context.allocation_callbacks, &z_tex.device_memory));
+    vk_assert (vkBindImageMemory (context.logical_device, z_tex.image, z_tex.device_memory, 0));
 
     VkCommandBuffer layoutCmd = context.create_command_buffer (VK_COMMAND_BUFFER_LEVEL_PRIMARY, identifier, true);
 
-    state.compute_tex.image_layout = VK_IMAGE_LAYOUT_GENERAL;
+    z_tex.image_layout = VK_IMAGE_LAYOUT_GENERAL;
     utils::set_image_layout (
         layoutCmd,
-        state.compute_tex.image,
+        z_tex.image,
         VK_IMAGE_ASPECT_COLOR_BIT,
         VK_IMAGE_LAYOUT_UNDEFINED,
-        state.compute_tex.image_layout);
+        z_tex.image_layout);
 
     VkQueue queue = context.get_queue (identifier);
     context.flush_command_buffer (layoutCmd, identifier, true);
 
     auto sampler = utils::init_VkSamplerCreateInfo ();
-    sampler.magFilter = VK_FILTER_LINEAR;
-    sampler.minFilter = VK_FILTER_LINEAR;
+    // the canvas only fetches texels, linear filtering is kept for the formats that allow it.
+    const VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    sampler.magFilter = filter;
+    sampler.minFilter = filter;
     sampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     sampler.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
     sampler.addressModeV = sampler.addressModeU;
@@ -296,24 +579,26 @@ void compute_target::prepare_texture_target (VkFormat format, const VkExtent2D s
     sampler.minLod = 0.0f;
     sampler.maxLod = 0.0f;
     sampler.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-    vk_assert (vkCreateSampler (context.logical_device, &sampler, context.allocation_callbacks, &state.compute_tex.sampler));
+    vk_assert (vkCreateSampler (context.logical_device, &sampler, context.allocation_callbacks, &z_tex.sampler));
 
     VkImageViewCreateInfo view = utils::init_VkImageViewCreateInfo ();
     view.viewType = VK_IMAGE_VIEW_TYPE_2D;
     view.format = format;
     view.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
     view.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-    view.image = state.compute_tex.image;
-    vk_assert (vkCreateImageView (context.logical_device, &view, context.allocation_callbacks, &state.compute_tex.view));
+    view.image = z_tex.image;
+    vk_assert (vkCreateImageView (context.logical_device, &view, context.allocation_callbacks, &z_tex.view));
 
-    state.compute_tex.descriptor.imageLayout = state.compute_tex.image_layout;
-    state.compute_tex.descriptor.imageView = state.compute_tex.view;
-    state.compute_tex.descriptor.sampler = state.compute_tex.sampler;
-    state.compute_tex.context = &context;
+    z_tex.descriptor.imageLayout = z_tex.image_layout;
+    z_tex.descriptor.imageView = z_tex.view;
+    z_tex.descriptor.sampler = z_tex.sampler;
+    z_tex.context = &context;
 }
 
 void compute_target::destroy_texture_target () {
     state.compute_tex.destroy ();
+    if (content.secondary_output.has_value ())
+        state.secondary_tex.destroy ();
 }
 
 void compute_target::create_descriptor_set_layout () {
@@ -341,6 +626,30 @@ void compute_target::create_descriptor_set_layout () {
                 idx++));
     }
 
+    if (content.secondary_output.has_value ()) {
+        descriptor_set_layout_bindings.emplace_back (
+            utils::init_VkDescriptorSetLayoutBinding (
+                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                idx++));
+    }
+
+    for (size_t i = 0; streamer && i < streamer->get_num_blobs () * blob_streamer::num_bindings_per_blob; ++i) {
+        descriptor_set_layout_bindings.emplace_back (
+            utils::init_VkDescriptorSetLayoutBinding (
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                idx++));
+    }
+
+    for (size_t i = 0; textures && i < textures->get_num_textures (); ++i) {
+        descriptor_set_layout_bindings.emplace_back (
+            utils::init_VkDescriptorSetLayoutBinding (
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                idx++));
+    }
+
     auto descriptor_set_layout_create_info = utils::init_VkDescriptorSetLayoutCreateInfo (descriptor_set_layout_bindings);
     vk_assert (vkCreateDescriptorSetLayout (
         context.logical_device,
@@ -350,13 +659,17 @@ void compute_target::create_descriptor_set_layout () {
 }
 
 void compute_target::create_descriptor_set () {
-    std::vector<VkDescriptorPoolSize> pool_sizes = { utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1), };
+    std::vector<VkDescriptorPoolSize> pool_sizes = { utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, content.secondary_output.has_value () ? 2 : 1), };
 
     if (content.uniforms.size ()) {
         pool_sizes.emplace_back (utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (uint32_t) content.uniforms.size ()));
     }
-    if (content.blobs.size ()) {
-        pool_sizes.emplace_back (utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (uint32_t)content.blobs.size ()));
+    const size_t num_storage_buffers = content.blobs.size () + (streamer ? streamer->get_num_blobs () * blob_streamer::num_bindings_per_blob : 0);
+    if (num_storage_buffers) {
+        pool_sizes.emplace_back (utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (uint32_t) num_storage_buffers));
+    }
+    if (textures) {
+        pool_sizes.emplace_back (utils::init_VkDescriptorPoolSize (VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (uint32_t) textures->get_num_textures ()));
     }
 
 
@@ -396,16 +709,42 @@ void compute_target::create_descriptor_set () {
                 &state.blob_storage_buffers[i].descriptor, 1));
     };
 
+    if (content.secondary_output.has_value ()) {
+        write_descriptor_sets.emplace_back (
+            utils::init_VkWriteDescriptorSet (
+                state.descriptor_set,
+                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                idx++,
+                &state.secondary_tex.descriptor, 1));
+    }
+
+    for (size_t i = 0; streamer && i < streamer->get_num_blobs (); ++i) {
+        for (const VkDescriptorBufferInfo* descriptor : { streamer->get_page_table (i), streamer->get_pool (i), streamer->get_feedback (i) }) {
+            write_descriptor_sets.emplace_back (
+                utils::init_VkWriteDescriptorSet (
+                    state.descriptor_set,
+                    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    idx++,
+                    descriptor, 1));
+        }
+    }
+
+    for (size_t i = 0; textures && i < textures->get_num_textures (); ++i) {
+        write_descriptor_sets.emplace_back (
+            utils::init_VkWriteDescriptorSet (
+                state.descriptor_set,
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                idx++,
+                textures->get_descriptor (i), 1));
+    }
+
     vkUpdateDescriptorSets (context.logical_device, (uint32_t) write_descriptor_sets.size (), write_descriptor_sets.data (), 0, nullptr);
 }
 
 void compute_target::create_compute_pipeline () {
 
-    std::vector<uint8_t> output;
-    sge::utils::get_file_stream (output, content.shader_path.c_str ());
-    state.compute_shader_module = utils::create_shader_module (context.logical_device, context.allocation_callbacks, output);
-
-    auto shader_stage_create_info = utils::init_VkPipelineShaderStageCreateInfo (VK_SHADER_STAGE_COMPUTE_BIT, state.compute_shader_module, "main");
+    if (state.compute_shader_module == VK_NULL_HANDLE)
+        state.compute_shader_module = utils::create_shader_module (context.logical_device, context.allocation_callbacks, state.compute_shader_code);
 
     auto pipeline_layout_create_info = utils::init_VkPipelineLayoutCreateInfo (1, &state.descriptor_set_layout);
 
@@ -423,24 +762,202 @@ void compute_target::create_compute_pipeline () {
 
     vk_assert (vkCreatePipelineLayout (context.logical_device, &pipeline_layout_create_info, context.allocation_callbacks, &state.pipeline_layout));
 
+    state.pipelines.assign (std::max<size_t> (content.specializations.size (), 1), specialized_pipeline {});
+    get_active_pipeline ();
+
+    update_reloader_target ();
+}
+
+VkPipeline compute_target::create_specialized_pipeline (int z_index) {
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t> data;
+    const auto specialization_info = get_specialization_info (z_index, entries, data);
+
     auto pipeline_create_info = utils::init_VkComputePipelineCreateInfo (state.pipeline_layout);
-    pipeline_create_info.stage = shader_stage_create_info;
+    pipeline_create_info.stage = utils::init_VkPipelineShaderStageCreateInfo (VK_SHADER_STAGE_COMPUTE_BIT, state.compute_shader_module, "main");
+    pipeline_create_info.stage.pSpecializationInfo = &specialization_info;
+    if (state.band.has_value ())
+        pipeline_create_info.flags |= VK_PIPELINE_CREATE_DISPATCH_BASE_BIT;
+
+    VkPipeline pipeline;
     vk_assert (vkCreateComputePipelines (
         context.logical_device,
-        VK_NULL_HANDLE,
+        context.logical_device_info.pipeline_cache,
         1,
         &pipeline_create_info,
         context.allocation_callbacks,
-        &state.pipeline));
+        &pipeline));
+    return pipeline;
+}
+
+// Builds the active pipeline if it hasn't been yet or if the workgroup size it should use has changed since it was.
+VkPipeline compute_target::get_active_pipeline () {
+    specialized_pipeline& active = state.pipelines[state.specialization];
+    const VkExtent2D workgroup_size = get_workgroup_size (state.specialization);
+    if (active.pipeline != VK_NULL_HANDLE && !utils::equal (active.workgroup_size, workgroup_size)) {
+        state.retired_pipelines.emplace_back (active.pipeline, state.frame);
+        active.pipeline = VK_NULL_HANDLE;
+    }
+    if (active.pipeline == VK_NULL_HANDLE) {
+        active.pipeline = create_specialized_pipeline (state.specialization);
+        active.workgroup_size = workgroup_size;
+    }
+    return active.pipeline;
+}
+
+// The autotuned size (only ever for the active specialization) takes precedence over the app's.
+VkExtent2D compute_target::get_workgroup_size (int z_index) const {
+    if (tuner && z_index == state.specialization && tuner->get_workgroup_size ().has_value ())
+        return tuner->get_workgroup_size ().value ();
+    const auto& specialization = get_specialization_desc (z_index);
+    return { specialization.workgroup_size_x, specialization.workgroup_size_y };
+}
+
+// Tells the tuner which shader is now being dispatched, tuning choices are keyed on the code & constants.
+void compute_target::select_workgroup_size () {
+    if (!tuner)
+        return;
+    const auto& specialization = get_specialization_desc (state.specialization);
+    uint64_t key = sge::utils::hash_fnv1a (state.compute_shader_code.data (), state.compute_shader_code.size ());
+    for (const auto& constant : specialization.constants)
+        key = sge::utils::hash_fnv1a (&constant, sizeof (constant), key);
+    tuner->select (key);
+}
+
+void compute_target::retire_pipelines () {
+    for (specialized_pipeline& x : state.pipelines) {
+        if (x.pipeline != VK_NULL_HANDLE)
+            state.retired_pipelines.emplace_back (x.pipeline, state.frame);
+        x.pipeline = VK_NULL_HANDLE;
+    }
+}
+
+const sge::app::specialization& compute_target::get_specialization_desc (int z_index) const {
+    return content.specializations.empty () ? unspecialized : content.specializations[z_index];
+}
+
+// Fills in the map entries & data for one of the app's specializations, the returned info points into both.
+VkSpecializationInfo compute_target::get_specialization_info (int z_index, std::vector<VkSpecializationMapEntry>& z_entries, std::vector<uint32_t>& z_data) const {
+    const auto& specialization = get_specialization_desc (z_index);
+    const auto add = [&] (uint32_t id, uint32_t value) {
+        z_entries.emplace_back (utils::init_VkSpecializationMapEntry (id, (uint32_t) (z_data.size () * sizeof (uint32_t)), sizeof (uint32_t)));
+        z_data.emplace_back (value);
+    };
+    for (const auto& constant : specialization.constants)
+        add (constant.first, constant.second);
+    if (content.workgroup_size_ids.has_value ()) {
+        const VkExtent2D workgroup_size = get_workgroup_size (z_index);
+        add (content.workgroup_size_ids.value ().first, workgroup_size.width);
+        add (content.workgroup_size_ids.value ().second, workgroup_size.height);
+    }
+    return utils::init_VkSpecializationInfo (z_entries, z_data.size () * sizeof (uint32_t), z_data.data ());
+}
+
+void compute_target::set_specialization (int z_index) {
+    assert (z_index >= 0 && z_index < (int) std::max<size_t> (content.specializations.size (), 1));
+    if (z_index < 0 || z_index >= (int) std::max<size_t> (content.specializations.size (), 1))
+        return;
+    state.pending_specialization = z_index;
+}
+
+// Points the shader reloader at the active specialization so that a reload replaces the pipeline in use.
+void compute_target::update_reloader_target () {
+    if (!reloader)
+        return;
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t> data;
+    const auto specialization_info = get_specialization_info (state.specialization, entries, data);
+    reloader->set_pipeline_layout (state.pipeline_layout, state.specialization, &specialization_info);
+}
+
+std::string compute_target::find_shader_source () const {
+    if (!content.shader_source_path.empty ())
+        return content.shader_source_path;
+    const std::string spv = ".spv";
+    if (content.shader_path.size () <= spv.size () || content.shader_path.compare (content.shader_path.size () - spv.size (), spv.size (), spv) != 0)
+        return {};
+    const std::string source_path = content.shader_path.substr (0, content.shader_path.size () - spv.size ());
+    FILE* file = fopen (source_path.c_str (), "rb");
+    if (!file)
+        return {};
+    fclose (file);
+    return source_path;
 }
 
 void compute_target::destroy_compute_pipeline () {
-    vkDestroyPipeline (context.logical_device, state.pipeline, context.allocation_callbacks);
-    state.pipeline = VK_NULL_HANDLE;
+    if (reloader) {
+        // the layout is about to go, wait for any build using it and keep the code of any pipeline built but not yet
+        // swapped in (the pipeline itself is rebuilt against the new layout).
+        reloader->set_pipeline_layout (VK_NULL_HANDLE);
+        if (auto r = reloader->take_result ()) {
+            state.compute_shader_code = std::move (r->spirv);
+            ++state.shader_generation;
+            vkDestroyPipeline (context.logical_device, r->pipeline, context.allocation_callbacks);
+            vkDestroyShaderModule (context.logical_device, state.compute_shader_module, context.allocation_callbacks);
+            state.compute_shader_module = VK_NULL_HANDLE;
+        }
+    }
+    for (const specialized_pipeline& x : state.pipelines)
+        vkDestroyPipeline (context.logical_device, x.pipeline, context.allocation_callbacks);
+    state.pipelines.clear ();
     vkDestroyPipelineLayout (context.logical_device, state.pipeline_layout, context.allocation_callbacks);
     state.pipeline_layout = VK_NULL_HANDLE;
+}
+
+// Called at the start of a frame, the replaced pipelines may still be in use by work in flight so they're retired
+// rather than destroyed, those of other specializations are rebuilt from the new code when next used.
+void compute_target::swap_in_reloaded_pipeline () {
+    if (leader)
+        follow_leader ();
+    if (!reloader)
+        return;
+    auto r = reloader->take_result ();
+    if (!r.has_value ())
+        return;
+    retire_pipelines ();
+    state.compute_shader_code = std::move (r->spirv);
+    ++state.shader_generation;
     vkDestroyShaderModule (context.logical_device, state.compute_shader_module, context.allocation_callbacks);
-    state.compute_shader_module = VK_NULL_HANDLE;
+    state.compute_shader_module = utils::create_shader_module (context.logical_device, context.allocation_callbacks, state.compute_shader_code);
+    select_workgroup_size ();
+
+    // keep the new pipeline unless the constants it was built with are out of date (the workgroup size can change
+    // whilst it's being built when autotuning) or it can't dispatch a band (the reloader doesn't build with the flag).
+    assert (r->specialization < (int) state.pipelines.size ());
+    std::vector<VkSpecializationMapEntry> entries;
+    std::vector<uint32_t> data;
+    const auto specialization_info = get_specialization_info (r->specialization, entries, data);
+    if (!state.band.has_value () && r->specialization_data.size () == specialization_info.dataSize && memcmp (r->specialization_data.data (), data.data (), specialization_info.dataSize) == 0)
+        state.pipelines[r->specialization] = { r->pipeline, get_workgroup_size (r->specialization) };
+    else
+        state.retired_pipelines.emplace_back (r->pipeline, state.frame);
+    update_reloader_target ();
+    record_command_buffer (state.current_size);
+}
+
+// Rebuilds from the leader's code if it has changed since last time, the leader is updated after its followers so they
+// pick up a reload a frame after it.
+void compute_target::follow_leader () {
+    if (leader->state.shader_generation == state.shader_generation)
+        return;
+    retire_pipelines ();
+    state.compute_shader_code = leader->state.compute_shader_code;
+    state.shader_generation = leader->state.shader_generation;
+    vkDestroyShaderModule (context.logical_device, state.compute_shader_module, context.allocation_callbacks);
+    state.compute_shader_module = utils::create_shader_module (context.logical_device, context.allocation_callbacks, state.compute_shader_code);
+    select_workgroup_size ();
+    record_command_buffer (state.current_size);
+}
+
+void compute_target::destroy_retired_pipelines (bool z_all) {
+    const uint64_t frames_in_flight = 2;
+    auto& retired = state.retired_pipelines;
+    retired.erase (std::remove_if (retired.begin (), retired.end (), [&] (const std::pair<VkPipeline, uint64_t>& x) {
+        if (!z_all && state.frame < x.second + frames_in_flight)
+            return false;
+        vkDestroyPipeline (context.logical_device, x.first, context.allocation_callbacks);
+        return true;
+    }), retired.end ());
 }
 
 void compute_target::create_command_buffer () {
@@ -460,6 +977,11 @@ void compute_target::destroy_command_buffer () {
 void compute_target::record_command_buffer (const VkExtent2D sz) {
     auto begin_info = utils::init_VkCommandBufferBeginInfo ();
     vk_assert (vkBeginCommandBuffer (state.command_buffer, &begin_info));
+    if (graph) {
+        graph->record (state.command_buffer);
+        vk_assert (vkEndCommandBuffer (state.command_buffer));
+        return;
+    }
     if (content.push_constants.has_value ()) {
         vkCmdPushConstants (
             state.command_buffer,
@@ -470,7 +992,10 @@ void compute_target::record_command_buffer (const VkExtent2D sz) {
             content.push_constants.value ().address);
     }
 
-    vkCmdBindPipeline (state.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, state.pipeline);
+    const VkPipeline pipeline = get_active_pipeline ();
+    const VkExtent2D workgroup_size = state.pipelines[state.specialization].workgroup_size;
+
+    vkCmdBindPipeline (state.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
     vkCmdBindDescriptorSets (
         state.command_buffer,
         VK_PIPELINE_BIND_POINT_COMPUTE,
@@ -482,18 +1007,101 @@ void compute_target::record_command_buffer (const VkExtent2D sz) {
         NULL);
 
 
-    const uint32_t workgroup_size_x = 16;
-    const uint32_t workgroup_size_y = 16;
     const uint32_t workgroup_size_z = 1;
 
-    vkCmdDispatch (
-        state.command_buffer,
-        (uint32_t) ceil (sz.width / float (workgroup_size_x)),
-        (uint32_t) ceil (sz.height / float (workgroup_size_y)),
-        workgroup_size_z);
+    if (tuner)
+        tuner->write_begin (state.command_buffer);
+    if (state.band.has_value ()) {
+        // the base offsets gl_WorkGroupID, so the shader sees the same coordinates as it would for the whole output.
+        const uint32_t first_row = std::min (state.band->first, sz.height);
+        const uint32_t end_row = std::min (state.band->first + state.band->second, sz.height);
+        const uint32_t first_group = first_row / workgroup_size.height;
+        const uint32_t end_group = (uint32_t) ceil (end_row / float (workgroup_size.height));
+        if (state.band_query_pool != VK_NULL_HANDLE) {
+            vkCmdResetQueryPool (state.command_buffer, state.band_query_pool, 0, 2);
+            vkCmdWriteTimestamp (state.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, state.band_query_pool, 0);
+        }
+        if (end_group > first_group) {
+            state.cmd_dispatch_base (
+                state.command_buffer,
+                0, first_group, 0,
+                (uint32_t) ceil (sz.width / float (workgroup_size.width)),
+                end_group - first_group,
+                workgroup_size_z);
+        }
+        if (state.band_query_pool != VK_NULL_HANDLE)
+            vkCmdWriteTimestamp (state.command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, state.band_query_pool, 1);
+    }
+    else {
+        vkCmdDispatch (
+            state.command_buffer,
+            (uint32_t) ceil (sz.width / float (workgroup_size.width)),
+            (uint32_t) ceil (sz.height / float (workgroup_size.height)),
+            workgroup_size_z);
+    }
+    if (streamer)
+        streamer->record_barrier (state.command_buffer);
+    if (tuner)
+        tuner->write_end (state.command_buffer);
     vk_assert (vkEndCommandBuffer (state.command_buffer));
 }
 
+void compute_target::follow (const compute_target& z_leader) {
+    assert (&z_leader != this);
+    leader = &z_leader;
+}
+
+void compute_target::set_band (uint32_t z_first_row, uint32_t z_num_rows) {
+    assert (!graph); // passes can read any part of what earlier passes wrote, so a graph can't be split.
+    const auto band = std::make_pair (z_first_row, z_num_rows);
+    if (state.band == band)
+        return;
+    if (!state.band.has_value ()) {
+        state.cmd_dispatch_base = (PFN_vkCmdDispatchBase) vkGetDeviceProcAddr (context.logical_device, "vkCmdDispatchBase");
+        assert (state.cmd_dispatch_base);
+        create_band_timer ();
+        retire_pipelines (); // rebuilt with VK_PIPELINE_CREATE_DISPATCH_BASE_BIT when next used.
+    }
+    state.band = band;
+    if (state.command_buffer != VK_NULL_HANDLE)
+        record_command_buffer (state.current_size);
+}
+
+void compute_target::create_band_timer () {
+    uint32_t num_queue_families = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties (context.physical_device, &num_queue_families, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families (num_queue_families);
+    vkGetPhysicalDeviceQueueFamilyProperties (context.physical_device, &num_queue_families, queue_families.data ());
+    const uint32_t valid_bits = queue_families[identifier.family_index].timestampValidBits;
+    if (valid_bits == 0)
+        return;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties (context.physical_device, &properties);
+    state.band_timestamp_period = properties.limits.timestampPeriod;
+    state.band_timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+    VkQueryPoolCreateInfo query_pool_create_info = {};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = 2;
+    vk_assert (vkCreateQueryPool (context.logical_device, &query_pool_create_info, context.allocation_callbacks, &state.band_query_pool));
+
+    // queries must be reset before their results can be asked for, even if they've never been written.
+    VkCommandBuffer reset_command = context.create_command_buffer (VK_COMMAND_BUFFER_LEVEL_PRIMARY, identifier, true);
+    vkCmdResetQueryPool (reset_command, state.band_query_pool, 0, 2);
+    context.flush_command_buffer (reset_command, identifier, true);
+}
+
+void compute_target::read_band_timer () {
+    if (state.band_query_pool == VK_NULL_HANDLE)
+        return;
+    uint64_t timestamps[2];
+    const VkResult r = vkGetQueryPoolResults (context.logical_device, state.band_query_pool, 0, 2, sizeof (timestamps), timestamps, sizeof (uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (r == VK_SUCCESS)
+        state.band_ms = (float) ((double) ((timestamps[1] - timestamps[0]) & state.band_timestamp_mask) * state.band_timestamp_period / 1000000.0);
+}
+
 void compute_target::run_command_buffer () {
     auto submit_info = utils::init_VkSubmitInfo ();
     submit_info.commandBufferCount = 1;
@@ -506,4 +1114,41 @@ void compute_target::run_command_buffer () {
     vkDestroyFence (context.logical_device, fence, context.allocation_callbacks);
 }
 
+void compute_target::overlay_ui () {
+    if (reloader)
+        reloader->overlay_ui ();
+}
+
+void compute_target::debug_ui () {
+    if (!content.specializations.empty ()) {
+        ImGui::Text ("Specializations");
+        for (int i = 0; i < (int) content.specializations.size (); ++i) {
+            const auto& specialization = content.specializations[i];
+            const std::string label = (specialization.name.empty () ? "#" + std::to_string (i) : specialization.name)
+                + " (" + std::to_string (specialization.workgroup_size_x) + "x" + std::to_string (specialization.workgroup_size_y)
+                + (i < (int) state.pipelines.size () && state.pipelines[i].pipeline != VK_NULL_HANDLE ? ", built)" : ")");
+            if (ImGui::RadioButton (label.c_str (), state.specialization == i))
+                set_specialization (i);
+        }
+    }
+    if (graph)
+        graph->debug_ui ();
+    if (tuner)
+        tuner->debug_ui ();
+    if (!state.direct_blobs.empty ()) {
+        const int num_direct = (int) std::count (state.direct_blobs.begin (), state.direct_blobs.end (), true);
+        ImGui::Text ("Blobs");
+        ImGui::BulletText ("%d written directly (%.2f MiB), %d staged", num_direct, state.direct_blob_bytes / (1024.0 * 1024.0), (int) state.direct_blobs.size () - num_direct);
+    }
+    if (streamer)
+        streamer->debug_ui ();
+    if (textures)
+        textures->debug_ui ();
+    uploader->debug_ui ();
+    if (compiler)
+        compiler->debug_ui ();
+    if (reloader)
+        reloader->debug_ui ();
+}
+
 }
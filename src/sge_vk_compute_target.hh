@@ -15,48 +15,96 @@
 namespace sge::vk {
 
 class presentation;
+class shader_reloader;
+class shader_compiler;
+class workgroup_tuner;
+class compute_graph;
+class uploader;
+class blob_streamer;
+class texture_loader;
 
 class compute_target {
 public:
     typedef std::function<VkExtent2D ()> size_fn;
 
-    compute_target (const struct context&, const struct queue_identifier&, const struct sge::app::content&, const size_fn&);
-    ~compute_target () {};
+    // blobs are uploaded on the `transfer` queue, which may be the compute queue's family or a dedicated one.
+    compute_target (const struct context&, const struct queue_identifier&, const struct queue_identifier& transfer, const struct sge::app::content&, const size_fn&);
+    ~compute_target ();
 
     void                                create                                  ();
     void                                destroy                                 ();
-    void                                enqueue                                 ();
-    void                                update                                  (bool&, std::vector<bool>&, std::vector<std::optional<dataspan>>&);
+    void                                enqueue                                 (VkSemaphore also_signal = VK_NULL_HANDLE); // i.e. for work on another queue that uses the output.
+    void                                update                                  (bool&, std::vector<bool>&, std::vector<std::optional<dataspan>>&, std::vector<fixed::byterange_list>&); // ranges narrow same sized blob changes.
     const texture&                      get_pre_render_texture                  () const { return state.compute_tex; }
+    const texture*                      get_secondary_texture                   () const { return content.secondary_output.has_value () ? &state.secondary_tex : nullptr; }
     void                                end_of_frame                            ();
     void                                create_r ();
     void                                destroy_r ();
     const VkSemaphore                   get_compute_finished ()                              const { return state.compute_complete; }
+    int                                 get_specialization                      () const { return state.specialization; }
+    void                                set_specialization                      (int); // takes effect at the start of the next update.
+
+    // Limits the dispatch to the rows [first_row, first_row + num_rows) of the output (workgroups straddling the
+    // edges are dispatched whole) for split-frame rendering, the band's GPU time is then measured each frame.
+    // * needs Vulkan 1.1 & single shader content, as bands are dispatched with vkCmdDispatchBase.
+    void                                set_band                                (uint32_t first_row, uint32_t num_rows);
+    std::optional<float>                get_band_ms                             () const { return state.band_ms; } // of the last frame, if measured.
+    uint32_t                            get_workgroup_height                    () const { return get_workgroup_size (state.specialization).height; }
+
+    // Before it's created: takes the shader from the leader (the same content on another device) rather than compiling
+    // or hot reloading it itself, so only the leader writes the shader cache & SPIR-V. Code the leader reloads is
+    // picked up at the start of the next update.
+    void                                follow                                  (const compute_target& leader);
+
+    void                                overlay_ui                              ();
+    void                                debug_ui                                ();
 
     int current_width () const { return state.current_size.width; }
     int current_height () const { return state.current_size.height; }
 private:
 
+    struct specialized_pipeline {
+        VkPipeline                      pipeline = VK_NULL_HANDLE;
+        VkExtent2D                      workgroup_size = { 0, 0 }; // that the pipeline was built with.
+    };
+
     struct state {
         texture                         compute_tex;
+        texture                         secondary_tex = {}; // only created if the content asks for it.
         VkDescriptorPool                descriptor_pool;
         VkDescriptorSet                 descriptor_set;
         VkDescriptorSetLayout           descriptor_set_layout;
-        VkPipeline                      pipeline;
+        std::vector<specialized_pipeline> pipelines; // one per specialization, each built when first used.
         VkPipelineLayout                pipeline_layout;
-        VkShaderModule                  compute_shader_module;
+        int                             specialization = 0; // index of the active pipeline.
+        std::optional<int>              pending_specialization;
+        std::vector<uint8_t>            compute_shader_code; // SPIR-V, read once and then kept up to date by the shader reloader.
+        VkShaderModule                  compute_shader_module = VK_NULL_HANDLE; // kept so other specializations can be built later.
+        uint64_t                        shader_generation = 0; // bumped whenever the code changes, so followers can tell.
+        std::vector<std::pair<VkPipeline, uint64_t>> retired_pipelines; // replaced pipelines & the frame they were replaced on.
+        uint64_t                        frame = 0;
         VkCommandPool                   command_pool;
-        VkCommandBuffer                 command_buffer;
+        VkCommandBuffer                 command_buffer = VK_NULL_HANDLE;
         VkSemaphore                     compute_complete;
         VkFence                         fence;
         std::vector<device_buffer>      uniform_buffers;
         std::vector<device_buffer>      blob_staging_buffers;
         std::vector<device_buffer>      blob_storage_buffers;
         std::vector<dataspan>           latest_blob_infos; // keep track of sizes needed for user storage blobs as these can change at runtime.
+        std::vector<bool>               direct_blobs; // written straight into device local memory the host can see, without staging.
+        VkDeviceSize                    direct_blob_bytes = 0;
+        fixed::small_vector<VkBufferCopy, 16> blob_copy_regions; // scratch.
 
         std::vector<std::optional<dataspan>> pending_blob_changes;
 
         VkExtent2D                      current_size = { 0, 0 };
+
+        std::optional<std::pair<uint32_t, uint32_t>> band; // first row & number of rows, if only part of the output is dispatched.
+        PFN_vkCmdDispatchBase           cmd_dispatch_base = nullptr;
+        VkQueryPool                     band_query_pool = VK_NULL_HANDLE; // null if the queue can't write timestamps.
+        float                           band_timestamp_period = 1.0f; // nanoseconds per tick.
+        uint64_t                        band_timestamp_mask = ~0ull;
+        std::optional<float>            band_ms;
     };
 
     const context&                      context;
@@ -64,7 +112,17 @@ private:
     const sge::app::content&            content;
     state                               state;
     const std::function<VkExtent2D()>   get_size_fn;
-
+    const compute_target*               leader = nullptr; // null unless following another target's shader.
+    std::unique_ptr<shader_compiler>    compiler; // null when following.
+    std::unique_ptr<shader_reloader>    reloader; // null unless shader hot reload is enabled.
+    std::unique_ptr<workgroup_tuner>    tuner; // null unless autotuning a shader with a specialized workgroup size.
+    std::unique_ptr<compute_graph>      graph; // null unless the content is a graph of passes rather than a single shader.
+    std::unique_ptr<uploader>           uploader; // blob copies, submitted ahead of the dispatch they're needed by.
+    std::unique_ptr<blob_streamer>      streamer; // null unless the content has streamed blobs.
+    std::unique_ptr<texture_loader>     textures; // null unless the content has textures.
+
+    void                                create_shader                           ();
+    void                                load_shader                             ();
     void                                create_rl ();
     void                                destroy_rl                              ();
     void                                create_buffer                           ();
@@ -72,19 +130,35 @@ private:
     void                                create_descriptor_set                   ();
     void                                create_compute_pipeline                 ();
     void                                destroy_compute_pipeline                ();
+    VkPipeline                          create_specialized_pipeline             (int);
+    VkExtent2D                          get_workgroup_size                      (int) const;
+    void                                select_workgroup_size                   ();
+    void                                retire_pipelines                        ();
+    VkPipeline                          get_active_pipeline                     ();
+    const sge::app::specialization&     get_specialization_desc                 (int) const;
+    VkSpecializationInfo                get_specialization_info                 (int, std::vector<VkSpecializationMapEntry>&, std::vector<uint32_t>&) const;
+    void                                update_reloader_target                  ();
+    std::string                         find_shader_source                      () const;
+    void                                swap_in_reloaded_pipeline               ();
+    void                                follow_leader                           ();
+    void                                destroy_retired_pipelines               (bool all);
     void                                create_command_buffer                   ();
     void                                destroy_command_buffer                  ();
     void                                record_command_buffer                   (VkExtent2D);
     void                                run_command_buffer                      ();
-    void                                prepare_texture_target                  (VkFormat, VkExtent2D);
+    void                                create_band_timer                       ();
+    void                                read_band_timer                         ();
+    VkFormat                            choose_output_format                    (sge::app::output_format) const;
+    void                                prepare_texture_target                  (texture&, VkFormat, VkExtent2D);
     void                                destroy_texture_target                  ();
     void                                prepare_uniform_buffers                 ();
     void                                update_uniform_buffer                   (int);
     void                                destroy_uniform_buffers                 ();
     void                                prepare_blob_buffers                    ();
     void                                prepare_blob_buffer                     (int, dataspan);
-    void                                copy_blob_from_staging_to_storage       (int);
-    void                                update_blob_buffer                      (int, dataspan);
+    void                                upload_blob                             (int);
+    bool                                create_direct_blob_buffer               (int, dataspan);
+    void                                update_blob_buffer                      (int, dataspan, const fixed::byterange_list& = {}); // all of it if no ranges are given.
     void                                destroy_blob_buffer                     (int);
     void                                destroy_blob_buffers                    ();
 
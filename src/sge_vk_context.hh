@@ -47,6 +47,15 @@ struct physical_device_info {
     const uint32_t driver_version;
     const uint32_t vulkan_api_version;
     const std::vector<queue_family_info> queue_families;
+    const uint32_t index; // in the order enumerated.
+    const VkPhysicalDeviceType type;
+    const VkDeviceSize device_local_memory; // size of the largest device local heap.
+    const uint32_t subgroup_size; // zero if unknown (needs Vulkan 1.1).
+    const VkPhysicalDeviceLimits limits;
+
+    bool supports (VkQueueFlags required_flags) const {
+        return std::any_of (queue_families.begin (), queue_families.end (), [=] (const queue_family_info& x) { return (x.flags & required_flags) == required_flags; });
+    }
 
     const queue_family_index best_queue_family_for (VkQueueFlags required_flags) const {
         uint32_t choice = 0;
@@ -67,6 +76,7 @@ struct physical_device_info {
 struct logical_device_info {
     std::unordered_map<queue_family_index, std::vector<VkQueue>> queues;
     std::unordered_map<queue_family_index, VkCommandPool> default_command_pools;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE; // shared by all pipelines created on the device, persisted by the kernel.
 };
 
 
@@ -141,7 +151,8 @@ struct context {
         VkMemoryPropertyFlags memory_property_flags,
         device_buffer* buffer,
         VkDeviceSize size,
-        void* data = nullptr) const {
+        void* data = nullptr,
+        VkMemoryPropertyFlags preferred_memory_property_flags = 0) const {
 
         buffer->device = logical_device;
 
@@ -152,7 +163,7 @@ struct context {
         auto alloc_info = utils::init_VkMemoryAllocateInfo ();
         vkGetBufferMemoryRequirements (logical_device, buffer->buffer, &memReqs);
         alloc_info.allocationSize = memReqs.size;
-        alloc_info.memoryTypeIndex = utils::choose_memory_type (physical_device, memReqs, memory_property_flags);
+        alloc_info.memoryTypeIndex = utils::choose_memory_type (physical_device, memReqs, memory_property_flags, preferred_memory_property_flags);
         vk_assert (vkAllocateMemory (logical_device, &alloc_info, allocation_callbacks, &buffer->memory));
 
         buffer->alignment = memReqs.alignment;
@@ -1,6 +1,7 @@
 #include "sge_vk_imgui.hh"
 
 #include "sge_utils.hh"
+#include "sge_archive.hh"
 #include "sge_vk_utils.hh"
 #include "sge_vk_presentation.hh" // todo, remove this dependency
 
@@ -231,13 +232,11 @@ void imgui::destroy_command_pool () {
 //--------------------------------------------------------------------------------------------------------------------//
 
 void imgui::create_shader () {
-    std::vector<uint8_t> vert_spirv, frag_spirv;
-    sge::utils::get_file_stream (vert_spirv, "sge_imgui.vert.spv");
-    sge::utils::get_file_stream (frag_spirv, "sge_imgui.frag.spv");
-    const auto vertex_create_info = vk::utils::init_VkShaderModuleCreateInfo (vert_spirv.size (), reinterpret_cast<const uint32_t*>(vert_spirv.data ()));
-    const auto fragment_create_info = vk::utils::init_VkShaderModuleCreateInfo (frag_spirv.size (), reinterpret_cast<const uint32_t*>(frag_spirv.data ()));
-    vk_assert (vkCreateShaderModule (context.logical_device, &vertex_create_info, context.allocation_callbacks, &state.shader.vertex));
-    vk_assert (vkCreateShaderModule (context.logical_device, &fragment_create_info, context.allocation_callbacks, &state.shader.fragment));
+    const auto vert_spirv = sge::utils::get_assets ().get ("sge_imgui.vert.spv");
+    const auto frag_spirv = sge::utils::get_assets ().get ("sge_imgui.frag.spv");
+    assert (vert_spirv.has_value () && frag_spirv.has_value ());
+    state.shader.vertex = vk::utils::create_shader_module (context.logical_device, context.allocation_callbacks, vert_spirv.value ());
+    state.shader.fragment = vk::utils::create_shader_module (context.logical_device, context.allocation_callbacks, frag_spirv.value ());
 }
 
 void imgui::destroy_shader () {
@@ -464,9 +463,6 @@ void imgui::destroy_index_buffer () {
 //--------------------------------------------------------------------------------------------------------------------//
 void imgui::create_pipeline () {
 
-    const auto pipeline_cache_info = utils::init_VkPipelineCacheCreateInfo ();
-    vk_assert (vkCreatePipelineCache (context.logical_device, &pipeline_cache_info, context.allocation_callbacks, &state.pipeline.cache));
-
     const auto push_constant_range = utils::init_VkPushConstantRange (VK_SHADER_STAGE_VERTEX_BIT, sizeof (push), 0);
     auto pipeline_layout_create_info = utils::init_VkPipelineLayoutCreateInfo (1, &state.font_descriptor.set_layout);
     pipeline_layout_create_info.pushConstantRangeCount = 1;
@@ -526,15 +522,13 @@ void imgui::create_pipeline () {
     pipeline_create_info.pStages = shaderStages.data ();
     pipeline_create_info.pVertexInputState = &vertex_input_state;
 
-    vk_assert (vkCreateGraphicsPipelines (context.logical_device, state.pipeline.cache, 1, &pipeline_create_info, context.allocation_callbacks, &state.pipeline.value));
+    vk_assert (vkCreateGraphicsPipelines (context.logical_device, context.logical_device_info.pipeline_cache, 1, &pipeline_create_info, context.allocation_callbacks, &state.pipeline.value));
 
 }
 
 void imgui::destroy_pipeline () {
-    vkDestroyPipelineCache (context.logical_device, state.pipeline.cache, context.allocation_callbacks);
     vkDestroyPipeline (context.logical_device, state.pipeline.value, context.allocation_callbacks);
     vkDestroyPipelineLayout (context.logical_device, state.pipeline.layout, context.allocation_callbacks);
-    state.pipeline.cache = VK_NULL_HANDLE;
     state.pipeline.value = VK_NULL_HANDLE;
     state.pipeline.layout = VK_NULL_HANDLE;
 }
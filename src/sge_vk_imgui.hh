@@ -101,7 +101,6 @@ private:
 
         VkSampler                           sampler                 = VK_NULL_HANDLE;
         struct {
-            VkPipelineCache                 cache                   = VK_NULL_HANDLE;
             VkPipelineLayout                layout                  = VK_NULL_HANDLE;
             VkPipeline                      value                   = VK_NULL_HANDLE;
         }                                   pipeline;
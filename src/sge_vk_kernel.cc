@@ -3,6 +3,9 @@
 #include "sge_vk_allocator.hh"
 #include "sge_vk_logging.hh"
 #include "sge_math.hh"
+#include "sge_utils.hh"
+
+#include <charconv>
 
 namespace sge::vk {
 
@@ -36,10 +39,105 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_report (VkDebugReportFlagsEXT flags,
 }
 
 //--------------------------------------------------------------------------------------------------------------------//
+// Pipeline cache files hold the driver's cache data behind a header identifying the device & driver that produced it,
+// a file that doesn't match the current device & driver (or that fails its checksum) is ignored.
+
+static const char           pipeline_cache_magic[8]         = { 'S', 'G', 'E', 'P', 'C', 'A', 'C', 'H' };
+static const uint32_t       pipeline_cache_version          = 1;
+
+struct pipeline_cache_header {
+    char                    magic[8];
+    uint32_t                version;
+    uint32_t                vendor_id;
+    uint32_t                device_id;
+    uint32_t                driver_version;
+    uint8_t                 uuid[VK_UUID_SIZE];
+    uint64_t                data_size;
+    uint64_t                data_hash;
+};
+
+static bool read_pipeline_cache_file (std::vector<uint8_t>& z_data, const std::string& z_path, const VkPhysicalDeviceProperties& z_properties) {
+    std::vector<uint8_t> file;
+    if (!sge::utils::read_file (file, z_path.c_str ()) || file.size () < sizeof (pipeline_cache_header))
+        return false;
+    pipeline_cache_header header;
+    memcpy (&header, file.data (), sizeof (pipeline_cache_header));
+    const uint8_t* data = file.data () + sizeof (pipeline_cache_header);
+    const size_t data_size = file.size () - sizeof (pipeline_cache_header);
+    if (memcmp (header.magic, pipeline_cache_magic, sizeof (pipeline_cache_magic)) != 0
+        || header.version != pipeline_cache_version
+        || header.vendor_id != z_properties.vendorID
+        || header.device_id != z_properties.deviceID
+        || header.driver_version != z_properties.driverVersion
+        || memcmp (header.uuid, z_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0
+        || header.data_size != data_size
+        || header.data_hash != sge::utils::hash_fnv1a (data, data_size))
+        return false;
+    z_data.assign (data, data + data_size);
+    return true;
+}
 
-kernel::kernel ()
+static bool write_pipeline_cache_file (const std::string& z_path, const VkPhysicalDeviceProperties& z_properties, const std::vector<uint8_t>& z_data) {
+    pipeline_cache_header header = {};
+    memcpy (header.magic, pipeline_cache_magic, sizeof (pipeline_cache_magic));
+    header.version = pipeline_cache_version;
+    header.vendor_id = z_properties.vendorID;
+    header.device_id = z_properties.deviceID;
+    header.driver_version = z_properties.driverVersion;
+    memcpy (header.uuid, z_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.data_size = z_data.size ();
+    header.data_hash = sge::utils::hash_fnv1a (z_data.data (), z_data.size ());
+    std::vector<uint8_t> file (sizeof (pipeline_cache_header) + z_data.size ());
+    memcpy (file.data (), &header, sizeof (pipeline_cache_header));
+    memcpy (file.data () + sizeof (pipeline_cache_header), z_data.data (), z_data.size ());
+    return sge::utils::write_file_atomic (z_path.c_str (), file.data (), file.size ());
+}
+
+static std::vector<uint8_t> get_pipeline_cache_data (VkDevice z_device, VkPipelineCache z_cache) {
+    size_t size = 0;
+    vk_assert (vkGetPipelineCacheData (z_device, z_cache, &size, nullptr));
+    std::vector<uint8_t> data (size);
+    vk_assert (vkGetPipelineCacheData (z_device, z_cache, &size, data.data ()));
+    data.resize (size);
+    return data;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+// Higher is better, negative if the device can't be the primary (which needs graphics & compute queues). The device
+// type outweighs everything else, the rest mostly separates devices of the same type.
+static int score_physical_device (const physical_device_info& z) {
+    if (!z.supports (VK_QUEUE_GRAPHICS_BIT) || !z.supports (VK_QUEUE_COMPUTE_BIT))
+        return -1;
+    int score = 0;
+    switch (z.type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score += 10000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += 5000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score += 2000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: score += 500; break; // software rasterisers.
+        default: break;
+    }
+    score += (int) std::min<VkDeviceSize> (z.device_local_memory >> 28, 256) * 10; // per 256MiB, up to 64GiB.
+    score += (int) z.subgroup_size;
+    score += (int) (z.limits.maxComputeSharedMemorySize >> 10);
+    score += (int) (z.limits.maxComputeWorkGroupInvocations >> 6);
+    // a compute queue apart from the graphics queue lets compute overlap with drawing.
+    if (std::any_of (z.queue_families.begin (), z.queue_families.end (), [] (const queue_family_info& x) { return x.supports_compute () && !x.supports_gfx (); }))
+        score += 250;
+    return score;
+}
+
+static std::string to_lower (std::string z) {
+    std::transform (z.begin (), z.end (), z.begin (), [] (unsigned char c) { return (char) tolower (c); });
+    return z;
+}
+
+kernel::kernel (const std::string& z_pipeline_cache_path, const std::string& z_device, bool z_all_devices)
+    : pipeline_cache_path (z_pipeline_cache_path)
+    , device_override (z_device)
+    , all_devices (z_all_devices)
 #if SGE_VK_USE_CUSTOM_ALLOCATOR
-    : custom_allocator (std::make_unique<allocator> ())
+    , custom_allocator (std::make_unique<allocator> ())
     , custom_allocator_callbacks (*custom_allocator.get ())
 #endif
 {
@@ -59,18 +157,30 @@ queue_identifier kernel::primary_graphics_queue_id () const {
 
 }
 queue_identifier kernel::primary_compute_queue_id () const {
+    return get_compute_queue_id (primary_context ());
+}
+
+queue_identifier kernel::get_compute_queue_id (const context& z_context) const {
     queue_identifier queue_identifier = {};
-    queue_identifier.physical_device = primary_context ().physical_device;
+    queue_identifier.physical_device = z_context.physical_device;
     queue_identifier.family_index
-        = primary_context ().physical_device_info.best_queue_family_for (VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
+        = z_context.physical_device_info.best_queue_family_for (VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
         //= primary_context ().physical_device_info.best_queue_family_for_compute ().index;
     queue_identifier.number = 0;
     return queue_identifier;
 }
+
+uint32_t kernel::get_api_version (const context& z_context) const {
+    return std::min (state.api_version, z_context.physical_device_info.vulkan_api_version);
+}
 queue_identifier kernel::primary_transfer_queue_id () const {
+    return get_transfer_queue_id (primary_context ());
+}
+
+queue_identifier kernel::get_transfer_queue_id (const context& z_context) const {
     queue_identifier queue_identifier = {};
-    queue_identifier.physical_device = primary_context ().physical_device;
-    queue_identifier.family_index = primary_context ().physical_device_info.best_queue_family_for (VK_QUEUE_TRANSFER_BIT);
+    queue_identifier.physical_device = z_context.physical_device;
+    queue_identifier.family_index = z_context.physical_device_info.best_queue_family_for (VK_QUEUE_TRANSFER_BIT);
     queue_identifier.number = 0;
     return queue_identifier;
 }
@@ -103,15 +213,16 @@ VkAllocationCallbacks* kernel::allocation_callbacks () const {
 void kernel::create () {
     create_instance ();
     get_physical_devices ();
+    select_physical_devices ();
     create_logical_devices ();
+    create_pipeline_caches ();
 
     // now copy data into contexts structure.
     // todo: simplify and remove duplication
 
     state.contexts.clear ();
-    for (auto& kvp : state.physical_device_info) {
-        VkPhysicalDevice physical_device = kvp.first;
-        const physical_device_info& physical_device_info = kvp.second;
+    for (const VkPhysicalDevice physical_device : state.selected) {
+        const physical_device_info& physical_device_info = state.physical_device_info.at (physical_device);
         VkDevice logical_device = get_logical_device (physical_device);
         logical_device_info& logical_device_info = state.logical_device_info[logical_device];
         state.contexts.emplace_back (context (
@@ -126,6 +237,7 @@ void kernel::create () {
 }
 
 void kernel::destroy () {
+    destroy_pipeline_caches ();
     for (auto kvp : state.logical_device_info) {
 
         for (auto kvp2 : kvp.second.default_command_pools)
@@ -135,6 +247,8 @@ void kernel::destroy () {
     }
     state.logical_device_info.clear ();
     state.physical_device_info.clear ();
+    state.scores.clear ();
+    state.selected.clear ();
     state.device_map.clear ();
     state.device_map_inv.clear ();
 #if TARGET_MACOSX
@@ -148,7 +262,16 @@ void kernel::destroy () {
 }
 
 void kernel::create_instance () {
-    const auto app_info = utils::init_VkApplicationInfo ("SGE App");
+    // Vulkan 1.1 is asked for where the loader has it (for vkCmdDispatchBase when splitting frames across devices),
+    // a 1.0 loader may reject anything but 1.0.
+    auto enumerate_instance_version = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr (VK_NULL_HANDLE, "vkEnumerateInstanceVersion");
+    uint32_t loader_version = VK_API_VERSION_1_0;
+    if (enumerate_instance_version)
+        enumerate_instance_version (&loader_version);
+    state.api_version = loader_version >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+
+    auto app_info = utils::init_VkApplicationInfo ("SGE App");
+    app_info.apiVersion = state.api_version;
     const auto instance_create_info = utils::init_VkInstanceCreateInfo (&app_info, required_instance_layers, required_instance_extensions);
     vk_assert (vkCreateInstance (&instance_create_info, allocation_callbacks (), &state.instance));
 
@@ -189,11 +312,36 @@ void kernel::get_physical_devices () {
     std::vector<VkPhysicalDevice> physical_devices (physical_device_count);
     vk_assert (vkEnumeratePhysicalDevices (state.instance, &physical_device_count, physical_devices.data ()));
 
+    // subgroup properties were only added in Vulkan 1.1.
+    const auto get_physical_device_properties_2 = state.api_version >= VK_API_VERSION_1_1
+        ? (PFN_vkGetPhysicalDeviceProperties2) vkGetInstanceProcAddr (state.instance, "vkGetPhysicalDeviceProperties2")
+        : nullptr;
+
     // get info
-    for (auto physical_device : physical_devices) {
-        
+    for (uint32_t index = 0; index < physical_device_count; ++index) {
+        const VkPhysicalDevice physical_device = physical_devices[index];
+
         VkPhysicalDeviceProperties vk_physical_device_properties = {};
         vkGetPhysicalDeviceProperties (physical_device, &vk_physical_device_properties);
+
+        VkPhysicalDeviceMemoryProperties vk_memory_properties = {};
+        vkGetPhysicalDeviceMemoryProperties (physical_device, &vk_memory_properties);
+        VkDeviceSize device_local_memory = 0;
+        for (uint32_t i = 0; i < vk_memory_properties.memoryHeapCount; ++i) {
+            if (vk_memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                device_local_memory = std::max (device_local_memory, vk_memory_properties.memoryHeaps[i].size);
+        }
+
+        uint32_t subgroup_size = 0;
+        if (get_physical_device_properties_2 && vk_physical_device_properties.apiVersion >= VK_API_VERSION_1_1) {
+            VkPhysicalDeviceSubgroupProperties vk_subgroup_properties = {};
+            vk_subgroup_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+            VkPhysicalDeviceProperties2 vk_physical_device_properties_2 = {};
+            vk_physical_device_properties_2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            vk_physical_device_properties_2.pNext = &vk_subgroup_properties;
+            get_physical_device_properties_2 (physical_device, &vk_physical_device_properties_2);
+            subgroup_size = vk_subgroup_properties.subgroupSize;
+        }
         
         uint32_t vk_queue_family_properties_count = 0;
         vkGetPhysicalDeviceQueueFamilyProperties (physical_device, &vk_queue_family_properties_count, nullptr);
@@ -225,14 +373,85 @@ void kernel::get_physical_devices () {
 
         }
 
-        state.physical_device_info.emplace (physical_device, vk::physical_device_info { vk_physical_device_properties.deviceName, vk_physical_device_properties.driverVersion, vk_physical_device_properties.apiVersion, queue_families });
+        state.physical_device_info.emplace (physical_device, vk::physical_device_info {
+            vk_physical_device_properties.deviceName,
+            vk_physical_device_properties.driverVersion,
+            vk_physical_device_properties.apiVersion,
+            queue_families,
+            index,
+            vk_physical_device_properties.deviceType,
+            device_local_memory,
+            subgroup_size,
+            vk_physical_device_properties.limits });
+    }
+}
+
+// The primary device is the one asked for (by name or index) if any, otherwise the best scoring. Other devices are only
+// selected (to get logical devices) if all of them are wanted, best scoring first.
+void kernel::select_physical_devices () {
+    const char* env = std::getenv ("SGE_DEVICE");
+    const std::string requested = env && *env ? std::string (env) : device_override;
+
+    std::vector<VkPhysicalDevice> candidates;
+    for (const auto& kvp : state.physical_device_info) {
+        state.scores[kvp.first] = score_physical_device (kvp.second);
+        candidates.emplace_back (kvp.first);
+    }
+    // ties go to the first enumerated so the choice is stable from run to run.
+    std::sort (candidates.begin (), candidates.end (), [this] (VkPhysicalDevice a, VkPhysicalDevice b) {
+        const int score_a = state.scores.at (a), score_b = state.scores.at (b);
+        return score_a != score_b ? score_a > score_b : state.physical_device_info.at (a).index < state.physical_device_info.at (b).index;
+    });
+
+    VkPhysicalDevice primary = VK_NULL_HANDLE;
+    if (!requested.empty ()) {
+        // an index too big to parse matches nothing.
+        const bool is_index = std::all_of (requested.begin (), requested.end (), [] (unsigned char c) { return isdigit (c) != 0; });
+        std::optional<uint32_t> index;
+        if (is_index) {
+            uint32_t parsed;
+            const auto [end, result] = std::from_chars (requested.data (), requested.data () + requested.size (), parsed);
+            if (result == std::errc () && end == requested.data () + requested.size ())
+                index = parsed;
+        }
+        for (const VkPhysicalDevice candidate : candidates) {
+            const auto& info = state.physical_device_info.at (candidate);
+            if (is_index ? index == info.index : to_lower (info.name).find (to_lower (requested)) != std::string::npos) {
+                primary = candidate;
+                break;
+            }
+        }
+        if (primary == VK_NULL_HANDLE)
+            std::cout << "No device matches \"" << requested << "\", using the best scoring one.\n";
+        else if (state.scores.at (primary) < 0) {
+            std::cout << state.physical_device_info.at (primary).name << " lacks a graphics or compute queue, using the best scoring device.\n";
+            primary = VK_NULL_HANDLE;
+        }
+    }
+    if (primary == VK_NULL_HANDLE && !candidates.empty () && state.scores.at (candidates.front ()) >= 0)
+        primary = candidates.front ();
+    assert (primary != VK_NULL_HANDLE); // no device has both graphics & compute queues.
+
+    state.selected = { primary };
+    if (all_devices) {
+        for (const VkPhysicalDevice candidate : candidates) {
+            if (candidate != primary && state.physical_device_info.at (candidate).supports (VK_QUEUE_COMPUTE_BIT))
+                state.selected.emplace_back (candidate);
+        }
+    }
+
+    std::cout << "\n" << " $$ Selecting physical-devices." << "\n";
+    for (const VkPhysicalDevice candidate : candidates) {
+        const auto& info = state.physical_device_info.at (candidate);
+        const bool selected = std::find (state.selected.begin (), state.selected.end (), candidate) != state.selected.end ();
+        std::cout << "  #" << info.index << " " << info.name << " (" << utils::to_string_VkPhysicalDeviceType (info.type) << "), score: " << state.scores.at (candidate)
+            << (candidate == primary ? ", primary" : selected ? ", selected" : "") << "\n";
     }
 }
 
 void kernel::create_logical_devices () {
     std::cout << "\n" << " $$ Creating logical-devices." << "\n";
-    for (const auto& kvp : state.physical_device_info) {
-        const auto physical_device = kvp.first;
+    for (const VkPhysicalDevice physical_device : state.selected) {
         vk::logging::cout_device_extension_properties (physical_device);
         std::cout << "\n";
         vk::logging::cout_physical_device_properties (physical_device);
@@ -241,10 +460,9 @@ void kernel::create_logical_devices () {
         vk::logging::cout_physical_device_queue_family_properties (physical_device);
         vk::logging::cout_physical_device_format_properties (physical_device, VK_FORMAT_R64G64B64A64_SFLOAT);
     }
-    for (const auto& kvp : state.physical_device_info) {
+    for (const VkPhysicalDevice physical_device : state.selected) {
 
-        const auto physical_device = kvp.first;
-        auto& physical_device_info = kvp.second;
+        auto& physical_device_info = state.physical_device_info.at (physical_device);
 
         std::vector<std::vector<float>> queue_priorities (physical_device_info.queue_families.size ());
         std::vector<VkDeviceQueueCreateInfo> queue_create_infos (physical_device_info.queue_families.size ());
@@ -292,6 +510,76 @@ void kernel::create_logical_devices () {
 
 }
 
+void kernel::create_pipeline_caches () {
+    for (auto& kvp : state.logical_device_info) {
+        const VkDevice logical_device = kvp.first;
+        const VkPhysicalDevice physical_device = get_physical_device (logical_device);
+
+        VkPhysicalDeviceProperties properties = {};
+        vkGetPhysicalDeviceProperties (physical_device, &properties);
+
+        auto& file = state.pipeline_cache_files[logical_device];
+        std::vector<uint8_t> data;
+        if (!pipeline_cache_path.empty ()) {
+            std::stringstream ss;
+            ss << pipeline_cache_path << "." << std::hex << properties.vendorID << "-" << properties.deviceID << ".bin";
+            file.path = ss.str ();
+            if (read_pipeline_cache_file (data, file.path, properties)) {
+                file.hash = sge::utils::hash_fnv1a (data.data (), data.size ());
+                file.loaded_size = data.size ();
+            }
+        }
+
+        auto pipeline_cache_info = utils::init_VkPipelineCacheCreateInfo ();
+        pipeline_cache_info.initialDataSize = data.size ();
+        pipeline_cache_info.pInitialData = data.empty () ? nullptr : data.data ();
+        vk_assert (vkCreatePipelineCache (logical_device, &pipeline_cache_info, allocation_callbacks (), &kvp.second.pipeline_cache));
+    }
+}
+
+void kernel::save_pipeline_caches () {
+    for (auto& kvp : state.logical_device_info) {
+        const VkDevice logical_device = kvp.first;
+        const VkPipelineCache pipeline_cache = kvp.second.pipeline_cache;
+        auto& file = state.pipeline_cache_files[logical_device];
+        if (file.path.empty () || pipeline_cache == VK_NULL_HANDLE)
+            continue;
+
+        VkPhysicalDeviceProperties properties = {};
+        vkGetPhysicalDeviceProperties (get_physical_device (logical_device), &properties);
+
+        // another instance of the app may have saved since this one loaded, merge its pipelines in rather than losing them.
+        std::vector<uint8_t> on_disk;
+        if (read_pipeline_cache_file (on_disk, file.path, properties) && sge::utils::hash_fnv1a (on_disk.data (), on_disk.size ()) != file.hash) {
+            auto pipeline_cache_info = utils::init_VkPipelineCacheCreateInfo ();
+            pipeline_cache_info.initialDataSize = on_disk.size ();
+            pipeline_cache_info.pInitialData = on_disk.data ();
+            VkPipelineCache other = VK_NULL_HANDLE;
+            vk_assert (vkCreatePipelineCache (logical_device, &pipeline_cache_info, allocation_callbacks (), &other));
+            vk_assert (vkMergePipelineCaches (logical_device, pipeline_cache, 1, &other));
+            vkDestroyPipelineCache (logical_device, other, allocation_callbacks ());
+        }
+
+        const std::vector<uint8_t> data = get_pipeline_cache_data (logical_device, pipeline_cache);
+        const uint64_t hash = sge::utils::hash_fnv1a (data.data (), data.size ());
+        if (hash == file.hash)
+            continue;
+        if (write_pipeline_cache_file (file.path, properties, data))
+            file.hash = hash;
+        else
+            std::cout << "Failed to write pipeline cache: " << file.path << "\n";
+    }
+}
+
+void kernel::destroy_pipeline_caches () {
+    save_pipeline_caches ();
+    for (auto& kvp : state.logical_device_info) {
+        vkDestroyPipelineCache (kvp.first, kvp.second.pipeline_cache, allocation_callbacks ());
+        kvp.second.pipeline_cache = VK_NULL_HANDLE;
+    }
+    state.pipeline_cache_files.clear ();
+}
+
 void kernel::debug_ui () {
 
     for (const auto& kvp : state.physical_device_info) {
@@ -302,11 +590,29 @@ void kernel::debug_ui () {
         ImGui::Text (physical_device_info.name.c_str ());
         if (primary_context ().physical_device == physical_device)
             ImGui::BulletText ("[PRIMARY]");
+        else if (std::find (state.selected.begin (), state.selected.end (), physical_device) == state.selected.end ())
+            ImGui::BulletText ("[UNUSED]");
+        ImGui::BulletText ("Type: %s, score: %d", utils::to_string_VkPhysicalDeviceType (physical_device_info.type).c_str (), state.scores.at (physical_device));
+        ImGui::BulletText ("Device local memory: %llu MiB", (unsigned long long) (physical_device_info.device_local_memory >> 20));
+        if (physical_device_info.subgroup_size)
+            ImGui::BulletText ("Subgroup size: %u", physical_device_info.subgroup_size);
         ImGui::BulletText ("Driver version: %s", utils::to_string_Version (physical_device_info.driver_version).c_str());
         ImGui::BulletText ("Vulkan API version: %s", utils::to_string_Version (physical_device_info.vulkan_api_version).c_str ());
 
     }
     ImGui::Separator ();
+
+    for (const auto& kvp : state.logical_device_info) {
+        const auto& file = state.pipeline_cache_files.at (kvp.first);
+        size_t size = 0;
+        vkGetPipelineCacheData (kvp.first, kvp.second.pipeline_cache, &size, nullptr);
+        ImGui::Text ("Pipeline cache: %zu bytes (%zu loaded from disk)", size, file.loaded_size);
+        if (!file.path.empty ())
+            ImGui::BulletText ("%s", file.path.c_str ());
+    }
+    if (ImGui::Button ("Save pipeline cache"))
+        save_pipeline_caches ();
+    ImGui::Separator ();
     /*
     for (const auto& kvp : state.logical_device_info) {
 
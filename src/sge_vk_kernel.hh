@@ -16,10 +16,18 @@ struct allocator;
 
 class kernel {
 public:
-    kernel ();
+    // `device` picks the primary device (see sge::app::configuration::device), only it gets a logical device unless
+    // `all_devices` is set, in which case every device that can compute does.
+    kernel (const std::string& pipeline_cache_path, const std::string& device, bool all_devices);
     ~kernel () = default;
 
     const context&                      primary_context                         () const;
+    const std::vector<context>&         get_contexts                            () const { return state.contexts; } // one per physical device, the primary first.
+
+    // the Vulkan version usable with the given device, the lower of the instance's & the device's.
+    uint32_t                            get_api_version                         (const context&) const;
+    queue_identifier                    get_compute_queue_id                    (const context&) const;
+    queue_identifier                    get_transfer_queue_id                   (const context&) const; // the dedicated (DMA) family, if there is one.
 
     queue_identifier                    primary_graphics_queue_id               () const;
     queue_identifier                    primary_compute_queue_id                () const;
@@ -32,6 +40,9 @@ public:
     void                                create                                  ();
     void                                destroy                                 ();
 
+    // writes the pipeline cache of each device to disk (also done on destroy).
+    void                                save_pipeline_caches                    ();
+
     void                                debug_ui ();
 
 
@@ -43,10 +54,15 @@ private:
 
     struct state {
         VkInstance                                                              instance = VK_NULL_HANDLE;
+        uint32_t                                                                api_version = VK_API_VERSION_1_0; // the instance was created with.
 
         // populated by: get_physical_devices
         std::unordered_map<VkPhysicalDevice, physical_device_info>              physical_device_info;
 
+        // populated by: select_physical_devices
+        std::unordered_map<VkPhysicalDevice, int>                               scores; // negative if unusable.
+        std::vector<VkPhysicalDevice>                                           selected; // those to create logical devices for, the primary first.
+
         // populated by: create_logical_devices
         std::unordered_map<VkDevice, logical_device_info>                       logical_device_info;
         std::unordered_map<VkDevice, VkPhysicalDevice>                          device_map;
@@ -55,8 +71,19 @@ private:
 
 
         VkDebugReportCallbackEXT                                                debug_report_callback;
+
+        // populated by: create_pipeline_caches
+        struct pipeline_cache_file {
+            std::string                                                         path;
+            uint64_t                                                            hash = 0; // of the cache data last read from or written to disk.
+            size_t                                                              loaded_size = 0;
+        };
+        std::unordered_map<VkDevice, pipeline_cache_file>                       pipeline_cache_files;
     };
 
+    const std::string                                                           pipeline_cache_path;
+    const std::string                                                           device_override;
+    const bool                                                                  all_devices;
     const std::unique_ptr<allocator>                                            custom_allocator;
     const std::optional<VkAllocationCallbacks>                                  custom_allocator_callbacks;
 
@@ -66,7 +93,10 @@ private:
     VkAllocationCallbacks*              allocation_callbacks                    () const;
     void                                create_instance                         ();
     void                                get_physical_devices                    ();
+    void                                select_physical_devices                 ();
     void                                create_logical_devices                  ();
+    void                                create_pipeline_caches                  ();
+    void                                destroy_pipeline_caches                 ();
 };
 
 }
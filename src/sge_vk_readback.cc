@@ -0,0 +1,214 @@
+#include "sge_vk_readback.hh"
+
+namespace sge::vk {
+
+readback::readback (const struct context& z_context, const struct queue_identifier& z_transfer, const struct queue_identifier& z_compute, uint32_t z_num_slots)
+    : context (z_context)
+    , identifier (z_transfer.family_index == z_compute.family_index ? z_transfer : z_compute)
+{
+    const auto command_pool_create_info = utils::init_VkCommandPoolCreateInfo (identifier.family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    vk_assert (vkCreateCommandPool (context.logical_device, &command_pool_create_info, context.allocation_callbacks, &command_pool));
+
+    slots.resize (std::max (z_num_slots, 1u));
+    for (slot& s : slots) {
+        const auto command_buffer_allocate_info = utils::init_VkCommandBufferAllocateInfo (command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+        vk_assert (vkAllocateCommandBuffers (context.logical_device, &command_buffer_allocate_info, &s.command_buffer));
+        const auto fence_create_info = utils::init_VkFenceCreateInfo ();
+        vk_assert (vkCreateFence (context.logical_device, &fence_create_info, context.allocation_callbacks, &s.fence));
+        const auto semaphore_create_info = utils::init_VkSemaphoreCreateInfo ();
+        vk_assert (vkCreateSemaphore (context.logical_device, &semaphore_create_info, context.allocation_callbacks, &s.compute_finished));
+    }
+}
+
+readback::~readback () {
+    for (slot& s : slots) {
+        if (s.in_flight)
+            vkWaitForFences (context.logical_device, 1, &s.fence, VK_TRUE, UINT64_MAX);
+        release (s);
+        vkDestroySemaphore (context.logical_device, s.compute_finished, context.allocation_callbacks);
+        vkDestroyFence (context.logical_device, s.fence, context.allocation_callbacks);
+    }
+    slots.clear ();
+    vkDestroyCommandPool (context.logical_device, command_pool, context.allocation_callbacks);
+}
+
+void readback::request (uint32_t z_x, uint32_t z_y, uint32_t z_width, uint32_t z_height, const runtime::readback_fn& z_callback) {
+    requests.emplace_back (pending { z_x, z_y, z_width, z_height, z_callback });
+}
+
+void readback::update () {
+    // finished in the order they were submitted, so the first still in flight ends the search.
+    for (uint32_t i = 0; i < slots.size (); ++i) {
+        slot& s = slots[(head + i) % slots.size ()];
+        if (!s.in_flight)
+            continue;
+        if (vkGetFenceStatus (context.logical_device, s.fence) != VK_SUCCESS)
+            break;
+
+        if (!s.coherent) {
+            auto range = utils::init_VkMappedMemoryRange ();
+            range.memory = s.memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vk_assert (vkInvalidateMappedMemoryRanges (context.logical_device, 1, &range));
+        }
+
+        for (const pending& r : s.requests) {
+            runtime::readback_view view;
+            view.frame = s.frame;
+            view.x = r.x;
+            view.y = r.y;
+            view.width = r.width;
+            view.height = r.height;
+            view.texel_size = s.texel_size;
+            view.row_pitch = r.width * s.texel_size;
+            view.data = s.mapped + r.offset;
+            r.callback (view);
+        }
+
+        num_completed += s.requests.size ();
+        s.requests.clear ();
+        s.in_flight = false;
+        vk_assert (vkResetFences (context.logical_device, 1, &s.fence));
+    }
+}
+
+VkSemaphore readback::record (const texture& z_output, uint64_t z_frame) {
+    assert (recorded < 0); // submit first.
+    if (requests.empty ())
+        return VK_NULL_HANDLE;
+
+    slot& s = slots[head];
+    if (s.in_flight) {
+        for (const pending& r : requests) {
+            runtime::readback_view view = {};
+            view.frame = z_frame;
+            r.callback (view); // without data, so consumers can account for the dropped frame.
+        }
+        num_dropped += requests.size ();
+        requests.clear ();
+        return VK_NULL_HANDLE;
+    }
+
+    s.texel_size = utils::get_texel_size (z_output.format);
+    VkDeviceSize size = 0;
+    for (pending& r : requests) {
+        if (r.x == 0 && r.y == 0 && r.width == 0 && r.height == 0) {
+            r.width = z_output.width;
+            r.height = z_output.height;
+        }
+        r.x = std::min (r.x, z_output.width);
+        r.y = std::min (r.y, z_output.height);
+        r.width = std::min (r.width, z_output.width - r.x);
+        r.height = std::min (r.height, z_output.height - r.y);
+        r.offset = size;
+        size += (VkDeviceSize) r.width * r.height * s.texel_size;
+        size = (size + 15) & ~(VkDeviceSize) 15; // copies must start on a multiple of the texel size.
+    }
+    reserve (s, std::max<VkDeviceSize> (size, 16));
+
+    copy_regions.clear ();
+    for (const pending& r : requests) {
+        if (r.width == 0 || r.height == 0)
+            continue;
+        VkBufferImageCopy region = {};
+        region.bufferOffset = r.offset;
+        region.bufferRowLength = 0; // tightly packed.
+        region.bufferImageHeight = 0;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageOffset = { (int32_t) r.x, (int32_t) r.y, 0 };
+        region.imageExtent = { r.width, r.height, 1 };
+        copy_regions.emplace_back (region);
+    }
+
+    vk_assert (vkResetCommandBuffer (s.command_buffer, 0));
+    const auto begin_info = utils::init_VkCommandBufferBeginInfo (VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vk_assert (vkBeginCommandBuffer (s.command_buffer, &begin_info));
+    if (copy_regions.size ()) {
+        // the output stays in the general layout, the semaphore wait orders this after the dispatch.
+        vkCmdCopyImageToBuffer (s.command_buffer, z_output.image, VK_IMAGE_LAYOUT_GENERAL, s.buffer, (uint32_t) copy_regions.size (), copy_regions.data ());
+
+        auto barrier = utils::init_VkBufferMemoryBarrier ();
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.buffer = s.buffer;
+        vkCmdPipelineBarrier (s.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+    vk_assert (vkEndCommandBuffer (s.command_buffer));
+
+    s.requests.swap (requests); // both keep their capacity, so steady state readback doesn't allocate.
+    s.frame = z_frame;
+    recorded = (int) head;
+    head = (head + 1) % (uint32_t) slots.size ();
+    return s.compute_finished;
+}
+
+void readback::submit () {
+    if (recorded < 0)
+        return;
+    slot& s = slots[recorded];
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    auto submit_info = utils::init_VkSubmitInfo ();
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &s.compute_finished;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &s.command_buffer;
+    vk_assert (vkQueueSubmit (context.get_queue (identifier), 1, &submit_info, s.fence));
+    s.in_flight = true;
+    recorded = -1;
+}
+
+// Slots keep their buffer between uses, it's only replaced when a frame asks for more than it holds.
+void readback::reserve (slot& z_slot, VkDeviceSize z_size) {
+    if (z_slot.capacity >= z_size)
+        return;
+    release (z_slot);
+
+    auto buffer_create_info = utils::init_VkBufferCreateInfo (VK_BUFFER_USAGE_TRANSFER_DST_BIT, z_size);
+    buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    vk_assert (vkCreateBuffer (context.logical_device, &buffer_create_info, context.allocation_callbacks, &z_slot.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements (context.logical_device, z_slot.buffer, &requirements);
+
+    // cached memory makes reading on the host far quicker, it's not always coherent though. The type chosen is checked
+    // rather than trusted, as the slot is mapped.
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties (context.physical_device, &memory_properties);
+    const auto is_host_visible = [&] (uint32_t x) { return x != ~0u && (memory_properties.memoryTypes[x].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0; };
+    uint32_t memory_type = utils::try_choose_memory_type (context.physical_device, requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    if (!is_host_visible (memory_type))
+        memory_type = utils::choose_memory_type (context.physical_device, requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    assert (is_host_visible (memory_type));
+
+    z_slot.coherent = (memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    auto memory_allocate_info = utils::init_VkMemoryAllocateInfo ();
+    memory_allocate_info.allocationSize = requirements.size;
+    memory_allocate_info.memoryTypeIndex = memory_type;
+    vk_assert (vkAllocateMemory (context.logical_device, &memory_allocate_info, context.allocation_callbacks, &z_slot.memory));
+    vk_assert (vkBindBufferMemory (context.logical_device, z_slot.buffer, z_slot.memory, 0));
+    vk_assert (vkMapMemory (context.logical_device, z_slot.memory, 0, VK_WHOLE_SIZE, 0, (void**) &z_slot.mapped));
+    z_slot.capacity = z_size;
+}
+
+void readback::release (slot& z_slot) {
+    if (z_slot.mapped)
+        vkUnmapMemory (context.logical_device, z_slot.memory);
+    z_slot.mapped = nullptr;
+    vkDestroyBuffer (context.logical_device, z_slot.buffer, context.allocation_callbacks);
+    z_slot.buffer = VK_NULL_HANDLE;
+    vkFreeMemory (context.logical_device, z_slot.memory, context.allocation_callbacks);
+    z_slot.memory = VK_NULL_HANDLE;
+    z_slot.capacity = 0;
+}
+
+void readback::debug_ui () {
+    const auto in_flight = std::count_if (slots.begin (), slots.end (), [] (const slot& s) { return s.in_flight; });
+    ImGui::Text ("Readback");
+    ImGui::BulletText ("%d of %d slots in flight", (int) in_flight, (int) slots.size ());
+    ImGui::BulletText ("%llu completed, %llu dropped", (unsigned long long) num_completed, (unsigned long long) num_dropped);
+}
+
+}
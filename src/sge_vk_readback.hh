@@ -0,0 +1,81 @@
+// SGE-VK-READBACK
+// ---------------------------------- //
+// Asynchronous copies of the compute
+// output back to the host.
+// ---------------------------------- //
+// * Requested regions are copied into a ring of persistently mapped host buffers after the frame's dispatch, each slot
+//   is then polled (never waited on) and its callbacks run once the copy is done, a few frames later.
+// * The callbacks are handed a view straight into the mapped memory, it's only valid until they return as the slot is
+//   then reused.
+// * If every slot is still in flight when a frame has requests they are dropped (their callbacks are handed a view
+//   without data), so a slow consumer costs frames of readback rather than frames of rendering.
+// * Copies go on the transfer queue when it's in the same family as the compute queue (so the output needn't change
+//   ownership), otherwise on the compute queue.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_runtime.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+#include "sge_vk_texture.hh"
+
+namespace sge::vk {
+
+class readback {
+public:
+    readback (const struct context&, const struct queue_identifier& transfer, const struct queue_identifier& compute, uint32_t num_slots);
+    ~readback ();
+
+    // a region of the output (clamped to it, all zero for the whole of it) to read back after the next dispatch.
+    void                                request                                 (uint32_t x, uint32_t y, uint32_t width, uint32_t height, const runtime::readback_fn&);
+
+    // runs the callbacks of finished copies & frees their slots, called once per frame.
+    void                                update                                  ();
+
+    // records the copies requested since the last frame into a free slot, the returned semaphore (null if there's
+    // nothing to copy) must be signalled by the compute submission that `submit` then waits on.
+    VkSemaphore                         record                                  (const texture&, uint64_t frame);
+    void                                submit                                  ();
+
+    void                                debug_ui                                ();
+
+private:
+    struct pending {
+        uint32_t                        x, y, width, height;
+        runtime::readback_fn            callback;
+        VkDeviceSize                    offset = 0; // into the slot's buffer.
+    };
+
+    struct slot {
+        VkBuffer                        buffer = VK_NULL_HANDLE;
+        VkDeviceMemory                  memory = VK_NULL_HANDLE;
+        VkDeviceSize                    capacity = 0;
+        bool                            coherent = true;
+        uint8_t*                        mapped = nullptr;
+        VkCommandBuffer                 command_buffer = VK_NULL_HANDLE;
+        VkFence                         fence = VK_NULL_HANDLE;
+        VkSemaphore                     compute_finished = VK_NULL_HANDLE;
+        std::vector<pending>            requests;
+        uint32_t                        texel_size = 0;
+        uint64_t                        frame = 0;
+        bool                            in_flight = false;
+    };
+
+    const context&                      context;
+    const queue_identifier              identifier; // the queue copies are submitted to.
+    VkCommandPool                       command_pool = VK_NULL_HANDLE;
+    std::vector<slot>                   slots;
+    std::vector<pending>                requests; // since the last frame.
+    fixed::small_vector<VkBufferImageCopy, 8> copy_regions; // scratch.
+    int                                 recorded = -1; // slot recorded this frame and awaiting submission.
+    uint32_t                            head = 0; // the next slot to record into, which is also the oldest in flight.
+
+    uint64_t                            num_completed = 0;
+    uint64_t                            num_dropped = 0;
+
+    void                                reserve                                 (slot&, VkDeviceSize);
+    void                                release                                 (slot&);
+};
+
+}
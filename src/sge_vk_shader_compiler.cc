@@ -0,0 +1,148 @@
+#include "sge_vk_shader_compiler.hh"
+
+#include "sge_utils.hh"
+
+#if TARGET_WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace sge::vk {
+
+#if TARGET_WIN32
+#define sge_popen _popen
+#define sge_pclose _pclose
+static const char* target_macro = "TARGET_WIN32=1";
+#elif TARGET_MACOSX
+#define sge_popen popen
+#define sge_pclose pclose
+static const char* target_macro = "TARGET_MACOSX=1";
+#else
+#define sge_popen popen
+#define sge_pclose pclose
+static const char* target_macro = "TARGET_LINUX=1";
+#endif
+
+// runs a command, capturing stdout & stderr, returns true if it exited successfully.
+static bool run (const std::string& z_command, std::string& z_output) {
+    FILE* pipe = sge_popen ((z_command + " 2>&1").c_str (), "r");
+    if (!pipe)
+        return false;
+    char buffer[512];
+    while (fgets (buffer, sizeof (buffer), pipe))
+        z_output += buffer;
+    return sge_pclose (pipe) == 0;
+}
+
+static std::string quote (const std::string& z) {
+    return "\"" + z + "\"";
+}
+
+static void make_directory (const std::string& z_path) {
+#if TARGET_WIN32
+    _mkdir (z_path.c_str ());
+#else
+    mkdir (z_path.c_str (), 0755);
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+shader_compiler::shader_compiler (const std::string& z_cache_path)
+    : cache_path (z_cache_path)
+{}
+
+void shader_compiler::probe () {
+    std::call_once (probe_flag, [this] {
+        std::string glslang_version, optimiser_version;
+        available = run ("glslangValidator --version", glslang_version);
+        optimiser_available = available && run ("spirv-opt --version", optimiser_version);
+        version = glslang_version + optimiser_version;
+        if (!cache_path.empty ())
+            make_directory (cache_path);
+        probed = true;
+    });
+}
+
+bool shader_compiler::is_available () {
+    probe ();
+    return available;
+}
+
+bool shader_compiler::compile (const std::string& z_source_path, const options& z_options, std::vector<uint8_t>& z_spirv, std::string& z_log) {
+    probe ();
+
+    std::vector<uint8_t> source;
+    if (!sge::utils::read_file (source, z_source_path.c_str ())) {
+        z_log = "Failed to read " + z_source_path;
+        return false;
+    }
+
+    const bool optimise = z_options.optimise && optimiser_available;
+
+    uint64_t key = sge::utils::hash_fnv1a (source.data (), source.size ());
+    key = sge::utils::hash_fnv1a (version.data (), version.size (), key);
+    key = sge::utils::hash_fnv1a (target_macro, strlen (target_macro), key);
+    key = sge::utils::hash_fnv1a (&optimise, sizeof (optimise), key);
+    for (const auto& define : z_options.defines) {
+        key = sge::utils::hash_fnv1a (define.first.data (), define.first.size () + 1, key); // include the terminator to separate name & value.
+        key = sge::utils::hash_fnv1a (define.second.data (), define.second.size () + 1, key);
+    }
+
+    char key_string[17];
+    snprintf (key_string, sizeof (key_string), "%016llx", (unsigned long long) key);
+    const std::string cached_path = cache_path.empty () ? std::string () : cache_path + "/" + key_string + ".spv";
+
+    if (!cached_path.empty () && sge::utils::read_file (z_spirv, cached_path.c_str ())) {
+        cache_hits++;
+        return true;
+    }
+    cache_misses++;
+
+    if (!available) {
+        z_log = "glslangValidator is not available (is the Vulkan SDK on the PATH?).";
+        return false;
+    }
+
+    const std::string temp_base = (cache_path.empty () ? z_source_path : cache_path + "/" + key_string) + "." + std::to_string (temp_counter++);
+    const std::string compiled_path = temp_base + ".spv";
+    const std::string optimised_path = temp_base + ".opt.spv";
+
+    std::string command = std::string ("glslangValidator -V -D") + target_macro;
+    for (const auto& define : z_options.defines)
+        command += " " + quote ("-D" + define.first + (define.second.empty () ? "" : "=" + define.second));
+    command += " -o " + quote (compiled_path) + " " + quote (z_source_path);
+
+    bool ok = run (command, z_log);
+    std::string result_path = compiled_path;
+    if (ok && optimise) {
+        ok = run ("spirv-opt -O " + quote (compiled_path) + " -o " + quote (optimised_path), z_log);
+        result_path = optimised_path;
+    }
+    ok = ok && sge::utils::read_file (z_spirv, result_path.c_str ());
+    ::remove (compiled_path.c_str ());
+    ::remove (optimised_path.c_str ());
+
+    if (!ok) {
+        if (z_log.empty ())
+            z_log = "Failed to compile " + z_source_path;
+        return false;
+    }
+
+    if (!cached_path.empty ())
+        sge::utils::write_file_atomic (cached_path.c_str (), z_spirv.data (), z_spirv.size ());
+    z_log.clear ();
+    return true;
+}
+
+void shader_compiler::debug_ui () {
+    ImGui::Text ("Shader compiler");
+    if (probed)
+        ImGui::BulletText ("glslangValidator: %s, spirv-opt: %s", available ? "found" : "not found", optimiser_available ? "found" : "not found");
+    else
+        ImGui::BulletText ("Not used yet");
+    ImGui::BulletText ("Cache: %s (%u hits, %u misses)", cache_path.empty () ? "(disabled)" : cache_path.c_str (), cache_hits.load (), cache_misses.load ());
+}
+
+}
@@ -0,0 +1,54 @@
+// SGE-VK-SHADER-COMPILER
+// ---------------------------------- //
+// Runtime GLSL to SPIR-V compilation.
+// ---------------------------------- //
+// * Drives the Vulkan SDK's glslangValidator (and spirv-opt, when present, for optimisation) so that shader variants
+//   can be generated from app supplied defines at runtime.
+// * Results are cached on disk keyed by a hash of the source, the defines, the options and the compiler versions, so
+//   only the first launch with a given variant pays for compilation. Files pulled in with #include are not part of
+//   the key.
+
+#pragma once
+
+#include "sge.hh"
+
+#include <mutex>
+
+namespace sge::vk {
+
+class shader_compiler {
+public:
+    typedef std::vector<std::pair<std::string, std::string>> define_list;
+
+    struct options {
+        define_list                     defines;
+        bool                            optimise = true;
+    };
+
+    shader_compiler (const std::string& cache_path);
+
+    // compiles the GLSL at the given path, from the cache when possible, thread safe. on failure `log` holds the
+    // compiler output.
+    bool                                compile                                 (const std::string& source_path, const options&, std::vector<uint8_t>& spirv, std::string& log);
+
+    bool                                is_available                            (); // glslangValidator could be run.
+
+    void                                debug_ui                                ();
+
+private:
+    const std::string                   cache_path;
+
+    std::once_flag                      probe_flag;
+    std::atomic<bool>                   probed = false;
+    bool                                available = false;
+    bool                                optimiser_available = false;
+    std::string                         version; // of glslangValidator & spirv-opt, part of the cache key.
+
+    std::atomic<uint32_t>               cache_hits = 0;
+    std::atomic<uint32_t>               cache_misses = 0;
+    std::atomic<uint32_t>               temp_counter = 0;
+
+    void                                probe                                   ();
+};
+
+}
@@ -0,0 +1,225 @@
+#include "sge_vk_shader_reload.hh"
+
+#include "sge_file_watcher.hh"
+#include "sge_utils.hh"
+
+namespace sge::vk {
+
+static const auto poll_interval = std::chrono::milliseconds (100);
+static const auto settle_time = std::chrono::milliseconds (150); // tools often write a file in several steps.
+static const auto notice_time = std::chrono::seconds (2);
+
+static const uint32_t spirv_magic = 0x07230203;
+
+static bool is_spirv (const std::vector<uint8_t>& z) {
+    uint32_t magic = 0;
+    if (z.size () < 20 || z.size () % 4 != 0) return false;
+    memcpy (&magic, z.data (), sizeof (uint32_t));
+    return magic == spirv_magic;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+shader_reloader::shader_reloader (const struct context& z_context, const std::string& z_spirv_path, const std::string& z_source_path, shader_compiler& z_compiler, const shader_compiler::options& z_options, const std::vector<uint8_t>& z_spirv)
+    : context (z_context)
+    , spirv_path (z_spirv_path)
+    , source_path (z_source_path)
+    , compiler (z_compiler)
+    , options (z_options)
+    , spirv_hash (sge::utils::hash_fnv1a (z_spirv.data (), z_spirv.size ()))
+{
+    thread = std::thread (&shader_reloader::worker, this);
+}
+
+shader_reloader::~shader_reloader () {
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        stop = true;
+    }
+    condition.notify_all ();
+    thread.join ();
+    if (ready.has_value ())
+        vkDestroyPipeline (context.logical_device, ready->pipeline, context.allocation_callbacks);
+}
+
+void shader_reloader::set_pipeline_layout (VkPipelineLayout z_layout, int z_specialization, const VkSpecializationInfo* z_info) {
+    std::unique_lock<std::mutex> lock (mutex);
+    if (z_layout == VK_NULL_HANDLE)
+        condition.wait (lock, [this] { return !building; });
+    layout = z_layout;
+    specialization = z_specialization;
+    specialization_entries.clear ();
+    specialization_data.clear ();
+    if (z_info) {
+        specialization_entries.assign (z_info->pMapEntries, z_info->pMapEntries + z_info->mapEntryCount);
+        const uint8_t* data = static_cast<const uint8_t*> (z_info->pData);
+        specialization_data.assign (data, data + z_info->dataSize);
+    }
+}
+
+std::optional<shader_reloader::result> shader_reloader::take_result () {
+    std::lock_guard<std::mutex> lock (mutex);
+    std::optional<result> r = std::move (ready);
+    ready.reset ();
+    return r;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+void shader_reloader::worker () {
+    sge::utils::file_watcher watcher;
+    watcher.watch (spirv_path);
+    if (!source_path.empty ())
+        watcher.watch (source_path);
+
+    bool source_changed = false;
+    bool spirv_changed = false;
+    auto last_change = std::chrono::steady_clock::now ();
+    std::vector<std::string> changed;
+
+    std::unique_lock<std::mutex> lock (mutex);
+    while (!stop) {
+        condition.wait_for (lock, poll_interval);
+        if (stop)
+            break;
+
+        lock.unlock ();
+        changed.clear ();
+        watcher.poll (changed);
+        for (const auto& path : changed) {
+            if (path == source_path) source_changed = true;
+            else spirv_changed = true;
+            last_change = std::chrono::steady_clock::now ();
+        }
+        lock.lock ();
+
+        if (force) {
+            force = false;
+            source_changed = !source_path.empty ();
+            spirv_changed = source_path.empty ();
+            spirv_hash = 0;
+        }
+
+        const bool settled = std::chrono::steady_clock::now () - last_change > settle_time;
+        if (!(source_changed || spirv_changed) || !settled || layout == VK_NULL_HANDLE || ready.has_value ())
+            continue;
+
+        building = true;
+        const VkPipelineLayout build_layout = layout;
+        const int build_specialization = specialization;
+        const std::vector<VkSpecializationMapEntry> build_entries = specialization_entries;
+        const std::vector<uint8_t> build_data = specialization_data;
+        const bool from_source = source_changed;
+        source_changed = spirv_changed = false;
+        lock.unlock ();
+
+        const auto t0 = std::chrono::steady_clock::now ();
+        std::vector<uint8_t> spirv;
+        std::string message;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        bool ok = from_source ? compile (spirv, message) : sge::utils::read_file (spirv, spirv_path.c_str ());
+        if (!ok && message.empty ())
+            message = "Failed to read " + spirv_path;
+        if (ok && !is_spirv (spirv)) {
+            message = spirv_path + " is not valid SPIR-V.";
+            ok = false;
+        }
+        const uint64_t hash = ok ? sge::utils::hash_fnv1a (spirv.data (), spirv.size ()) : 0;
+        const bool unchanged = ok && hash == spirv_hash;
+        if (ok && !unchanged) {
+            const auto build_info = utils::init_VkSpecializationInfo (build_entries, build_data.size (), build_data.data ());
+            ok = build (build_layout, build_entries.empty () ? nullptr : &build_info, spirv, pipeline, message);
+        }
+        const auto t1 = std::chrono::steady_clock::now ();
+
+        lock.lock ();
+        building = false;
+        if (!ok) {
+            error = message;
+            last_finished = t1;
+        }
+        else if (unchanged) {
+            error.clear ();
+        }
+        else {
+            spirv_hash = hash;
+            ready = result { pipeline, std::move (spirv), build_specialization, build_data };
+            error.clear ();
+            reload_count++;
+            last_build_ms = (float) std::chrono::duration<double, std::milli> (t1 - t0).count ();
+            last_finished = t1;
+        }
+        condition.notify_all ();
+    }
+}
+
+bool shader_reloader::compile (std::vector<uint8_t>& z_spirv, std::string& z_error) {
+    if (!compiler.compile (source_path, options, z_spirv, z_error))
+        return false;
+
+    // keep the SPIR-V on disk in step so that the next launch starts from it (unless this is a variant of it).
+    if (options.defines.empty ())
+        sge::utils::write_file_atomic (spirv_path.c_str (), z_spirv.data (), z_spirv.size ());
+    return true;
+}
+
+bool shader_reloader::build (VkPipelineLayout z_layout, const VkSpecializationInfo* z_specialization, const std::vector<uint8_t>& z_spirv, VkPipeline& z_pipeline, std::string& z_error) {
+    auto module_create_info = utils::init_VkShaderModuleCreateInfo (z_spirv.size (), reinterpret_cast<const uint32_t*> (z_spirv.data ()));
+    VkShaderModule module = VK_NULL_HANDLE;
+    VkResult r = vkCreateShaderModule (context.logical_device, &module_create_info, context.allocation_callbacks, &module);
+    if (r != VK_SUCCESS) {
+        z_error = "vkCreateShaderModule failed: " + utils::to_string_VkResult (r);
+        return false;
+    }
+
+    auto pipeline_create_info = utils::init_VkComputePipelineCreateInfo (z_layout);
+    pipeline_create_info.stage = utils::init_VkPipelineShaderStageCreateInfo (VK_SHADER_STAGE_COMPUTE_BIT, module, "main");
+    pipeline_create_info.stage.pSpecializationInfo = z_specialization;
+    r = vkCreateComputePipelines (context.logical_device, context.logical_device_info.pipeline_cache, 1, &pipeline_create_info, context.allocation_callbacks, &z_pipeline);
+    vkDestroyShaderModule (context.logical_device, module, context.allocation_callbacks);
+    if (r != VK_SUCCESS) {
+        z_error = "vkCreateComputePipelines failed: " + utils::to_string_VkResult (r);
+        z_pipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+void shader_reloader::overlay_ui () {
+    std::lock_guard<std::mutex> lock (mutex);
+    const bool recent = reload_count > 0 && std::chrono::steady_clock::now () - last_finished < notice_time;
+    if (error.empty () && !recent)
+        return;
+
+    ImGui::SetNextWindowPos (ImVec2 (10.0f, ImGui::GetIO ().DisplaySize.y - 10.0f), ImGuiCond_Always, ImVec2 (0.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha (0.75f);
+    ImGui::Begin ("##shader_reload", nullptr,
+        ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+        ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+    if (!error.empty ()) {
+        ImGui::TextColored (ImVec4 (1.0f, 0.4f, 0.4f, 1.0f), "Shader reload failed, still running the previous pipeline.");
+        ImGui::TextUnformatted (error.c_str ());
+    }
+    else {
+        ImGui::TextColored (ImVec4 (0.4f, 1.0f, 0.4f, 1.0f), "Shader reloaded (%.0f ms)", last_build_ms);
+    }
+    ImGui::End ();
+}
+
+void shader_reloader::debug_ui () {
+    std::lock_guard<std::mutex> lock (mutex);
+    ImGui::Text ("Shader hot reload");
+    ImGui::BulletText ("SPIR-V: %s", spirv_path.c_str ());
+    ImGui::BulletText ("Source: %s", source_path.empty () ? "(none)" : source_path.c_str ());
+    ImGui::BulletText ("Reloads: %u (last build %.1f ms)", reload_count, last_build_ms);
+    if (building)
+        ImGui::BulletText ("Building...");
+    if (ImGui::Button ("Reload shader")) {
+        force = true;
+        condition.notify_all ();
+    }
+}
+
+}
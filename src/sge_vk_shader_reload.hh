@@ -0,0 +1,78 @@
+// SGE-VK-SHADER-RELOAD
+// ---------------------------------- //
+// Background rebuilding of the compute
+// pipeline when its shader changes.
+// ---------------------------------- //
+// * A worker thread watches the SPIR-V (and the GLSL source, when known), recompiles the source with the shader
+//   compiler and builds the new pipeline, the compute target then swaps it in at the start of a frame.
+// * Failures never touch the running pipeline, they are reported by `overlay_ui` until the next successful build.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+#include "sge_vk_shader_compiler.hh"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace sge::vk {
+
+class shader_reloader {
+public:
+    struct result {
+        VkPipeline                      pipeline = VK_NULL_HANDLE;
+        std::vector<uint8_t>            spirv;
+        int                             specialization = 0; // index of the specialization the pipeline was built with.
+        std::vector<uint8_t>            specialization_data; // the constant values it was built with.
+    };
+
+    // `spirv` is the code the current pipeline was built from.
+    shader_reloader (const struct context&, const std::string& spirv_path, const std::string& source_path, shader_compiler&, const shader_compiler::options&, const std::vector<uint8_t>& spirv);
+    ~shader_reloader ();
+
+    // new pipelines are built against this layout with the given specialization (copied), VK_NULL_HANDLE suspends
+    // building (returning once any build in flight has finished) so that the layout can be destroyed.
+    void                                set_pipeline_layout                     (VkPipelineLayout, int specialization = 0, const VkSpecializationInfo* = nullptr);
+
+    // a pipeline built since the last call, ownership passes to the caller.
+    std::optional<result>               take_result                             ();
+
+    void                                overlay_ui                              ();
+    void                                debug_ui                                ();
+
+private:
+    const context&                      context;
+    const std::string                   spirv_path;
+    const std::string                   source_path;
+    shader_compiler&                    compiler;
+    const shader_compiler::options      options;
+
+    std::thread                         thread;
+    std::mutex                          mutex;
+    std::condition_variable             condition;
+
+    // guarded by mutex
+    bool                                stop = false;
+    bool                                building = false;
+    bool                                force = false;
+    VkPipelineLayout                    layout = VK_NULL_HANDLE;
+    int                                 specialization = 0;
+    std::vector<VkSpecializationMapEntry> specialization_entries;
+    std::vector<uint8_t>                specialization_data;
+    std::optional<result>               ready;
+    std::string                         error;
+    uint32_t                            reload_count = 0;
+    float                               last_build_ms = 0.0f;
+    std::chrono::steady_clock::time_point last_finished;
+
+    // worker only
+    uint64_t                            spirv_hash = 0; // of the SPIR-V of the last pipeline built.
+
+    void                                worker                                  ();
+    bool                                compile                                 (std::vector<uint8_t>&, std::string&);
+    bool                                build                                   (VkPipelineLayout, const VkSpecializationInfo*, const std::vector<uint8_t>&, VkPipeline&, std::string&);
+};
+
+}
@@ -0,0 +1,286 @@
+#include "sge_vk_split_frame.hh"
+
+namespace sge::vk {
+
+split_frame::split_frame (const kernel& z_kernel, compute_target& z_primary, const sge::app::content& z_content, const compute_target::size_fn& z_size_fn)
+    : context (z_kernel.primary_context ())
+    , identifier (z_kernel.primary_compute_queue_id ())
+    , primary (z_primary)
+{
+    if (!z_content.passes.empty () || z_content.secondary_output.has_value () || z_kernel.get_api_version (context) < VK_API_VERSION_1_1) {
+        std::cout << "Split-frame rendering needs Vulkan 1.1 & single shader content without a secondary output, using " << context.physical_device_info.name << " alone.\n";
+        return;
+    }
+
+    for (const struct context& device : z_kernel.get_contexts ()) {
+        if (device.physical_device == context.physical_device)
+            continue;
+        if (z_kernel.get_api_version (device) < VK_API_VERSION_1_1) {
+            std::cout << "Split-frame rendering: " << device.physical_device_info.name << " doesn't support Vulkan 1.1, leaving it out.\n";
+            continue;
+        }
+
+        helper h;
+        h.device = &device;
+        h.identifier = z_kernel.get_compute_queue_id (device);
+        h.target = std::make_unique<compute_target> (device, h.identifier, z_kernel.get_transfer_queue_id (device), z_content, z_size_fn);
+        h.target->set_band (0, 0); // before it's created so its pipelines are built to be dispatched in bands.
+        h.target->follow (primary); // only the primary compiles & reloads the shader.
+        h.target->create ();
+        if (h.target->get_pre_render_texture ().format != primary.get_pre_render_texture ().format) {
+            std::cout << "Split-frame rendering: " << device.physical_device_info.name << " can't write the primary's output format, leaving it out.\n";
+            h.target->destroy ();
+            continue;
+        }
+
+        const auto command_pool_create_info = utils::init_VkCommandPoolCreateInfo (h.identifier.family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+        vk_assert (vkCreateCommandPool (device.logical_device, &command_pool_create_info, device.allocation_callbacks, &h.command_pool));
+        const auto command_buffer_allocate_info = utils::init_VkCommandBufferAllocateInfo (h.command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+        vk_assert (vkAllocateCommandBuffers (device.logical_device, &command_buffer_allocate_info, &h.command_buffer));
+        const auto semaphore_create_info = utils::init_VkSemaphoreCreateInfo ();
+        vk_assert (vkCreateSemaphore (device.logical_device, &semaphore_create_info, device.allocation_callbacks, &h.compute_finished));
+        const auto fence_create_info = utils::init_VkFenceCreateInfo ();
+        vk_assert (vkCreateFence (device.logical_device, &fence_create_info, device.allocation_callbacks, &h.fence));
+
+        std::cout << "Split-frame rendering: sharing the output with " << device.physical_device_info.name << ".\n";
+        helpers.emplace_back (std::move (h));
+    }
+
+    if (helpers.empty ())
+        return;
+
+    const auto command_pool_create_info = utils::init_VkCommandPoolCreateInfo (identifier.family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    vk_assert (vkCreateCommandPool (context.logical_device, &command_pool_create_info, context.allocation_callbacks, &command_pool));
+    const auto command_buffer_allocate_info = utils::init_VkCommandBufferAllocateInfo (command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+    vk_assert (vkAllocateCommandBuffers (context.logical_device, &command_buffer_allocate_info, &command_buffer));
+    const auto semaphore_create_info = utils::init_VkSemaphoreCreateInfo ();
+    vk_assert (vkCreateSemaphore (context.logical_device, &semaphore_create_info, context.allocation_callbacks, &composite_finished));
+
+    bands.resize (helpers.size () + 1);
+    primary.set_band (0, 0);
+    create_staging ();
+    balance ();
+}
+
+split_frame::~split_frame () {
+    for (helper& h : helpers) {
+        vk_assert (vkDeviceWaitIdle (h.device->logical_device));
+        h.target->destroy ();
+        h.target.reset ();
+        h.staging.destroy (h.device->allocation_callbacks);
+        vkDestroyFence (h.device->logical_device, h.fence, h.device->allocation_callbacks);
+        vkDestroySemaphore (h.device->logical_device, h.compute_finished, h.device->allocation_callbacks);
+        vkDestroyCommandPool (h.device->logical_device, h.command_pool, h.device->allocation_callbacks);
+    }
+    helpers.clear ();
+
+    upload.destroy (context.allocation_callbacks);
+    vkDestroySemaphore (context.logical_device, composite_finished, context.allocation_callbacks);
+    vkDestroyCommandPool (context.logical_device, command_pool, context.allocation_callbacks);
+}
+
+void split_frame::create_r () {
+    for (helper& h : helpers)
+        h.target->create_r ();
+    create_staging ();
+}
+
+void split_frame::destroy_r () {
+    destroy_staging ();
+    for (helper& h : helpers)
+        h.target->destroy_r ();
+}
+
+// Staging covers the whole output (rather than a band) so rebalancing never needs to reallocate it.
+void split_frame::create_staging () {
+    if (!is_active ())
+        return;
+    const texture& output = primary.get_pre_render_texture ();
+    row_pitch = output.width * utils::get_texel_size (output.format);
+    const VkDeviceSize size = (VkDeviceSize) row_pitch * output.height;
+
+    context.create_buffer (VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &upload, size);
+    upload.map ();
+    for (helper& h : helpers) {
+        h.device->create_buffer (VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &h.staging, size);
+        h.staging.map ();
+    }
+}
+
+void split_frame::destroy_staging () {
+    if (!is_active ())
+        return;
+    for (helper& h : helpers) {
+        h.staging.unmap ();
+        h.staging.destroy (h.device->allocation_callbacks);
+    }
+    upload.unmap ();
+    upload.destroy (context.allocation_callbacks);
+}
+
+void split_frame::update (bool z_push_flag, const std::vector<bool>& z_ubo_flags, const std::vector<std::optional<dataspan>>& z_sbo_flags, const std::vector<fixed::byterange_list>& z_sbo_ranges) {
+    if (!is_active ())
+        return;
+    for (helper& h : helpers) {
+        // assigning keeps the scratch vectors' capacity, so this doesn't allocate frame to frame.
+        push_flag = z_push_flag;
+        ubo_flags = z_ubo_flags;
+        sbo_flags = z_sbo_flags;
+        sbo_ranges = z_sbo_ranges;
+        if (h.target->get_specialization () != primary.get_specialization ())
+            h.target->set_specialization (primary.get_specialization ());
+        h.target->update (push_flag, ubo_flags, sbo_flags, sbo_ranges);
+    }
+    balance ();
+}
+
+const compute_target& split_frame::get_target (size_t z_band) const {
+    return z_band == 0 ? primary : *helpers[z_band - 1].target;
+}
+
+// Rows are shared out in proportion to each device's rows per millisecond, in multiples of the tallest workgroup so
+// bands line up with workgroups (rows dispatched by two devices are only wasted work, the composite copies each band
+// from its own device). Every band keeps at least one multiple so it's still measured.
+void split_frame::balance () {
+    const uint32_t height = (uint32_t) primary.current_height ();
+    uint32_t granularity = 1;
+    bool measured = true;
+    for (size_t i = 0; i < bands.size (); ++i) {
+        band& b = bands[i];
+        const compute_target& target = get_target (i);
+        granularity = std::max (granularity, target.get_workgroup_height ());
+        const std::optional<float> ms = target.get_band_ms ();
+        if (ms.has_value () && ms.value () > 0.0f && b.num_rows > 0) {
+            const float rate = b.num_rows / ms.value ();
+            b.rows_per_ms = b.rows_per_ms > 0.0f ? b.rows_per_ms * 0.9f + rate * 0.1f : rate;
+        }
+        measured = measured && b.rows_per_ms > 0.0f;
+    }
+
+    float total = 0.0f;
+    for (const band& b : bands)
+        total += measured ? b.rows_per_ms : 1.0f;
+
+    uint32_t first_row = 0;
+    for (size_t i = 0; i < bands.size (); ++i) {
+        band& b = bands[i];
+        uint32_t num_rows = height - first_row;
+        if (i + 1 < bands.size ()) {
+            const float share = (measured ? b.rows_per_ms : 1.0f) / total;
+            const uint32_t reserved = (uint32_t) (bands.size () - 1 - i) * granularity; // for the bands after this.
+            num_rows = (uint32_t) (height * share + granularity * 0.5f) / granularity * granularity;
+            num_rows = std::min (std::max (num_rows, granularity), height > first_row + reserved ? height - first_row - reserved : 0u);
+        }
+        b.first_row = first_row;
+        b.num_rows = num_rows;
+        first_row += num_rows;
+    }
+
+    primary.set_band (bands[0].first_row, bands[0].num_rows);
+    for (size_t i = 0; i < helpers.size (); ++i)
+        helpers[i].target->set_band (bands[i + 1].first_row, bands[i + 1].num_rows);
+}
+
+void split_frame::enqueue () {
+    const texture& output = primary.get_pre_render_texture ();
+    for (size_t i = 0; i < helpers.size (); ++i) {
+        helper& h = helpers[i];
+        const band& b = bands[i + 1];
+        const texture& band_output = h.target->get_pre_render_texture ();
+
+        vk_assert (vkResetCommandBuffer (h.command_buffer, 0));
+        const auto begin_info = utils::init_VkCommandBufferBeginInfo (VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        vk_assert (vkBeginCommandBuffer (h.command_buffer, &begin_info));
+        if (b.num_rows > 0) {
+            VkBufferImageCopy region = {};
+            region.bufferOffset = (VkDeviceSize) b.first_row * row_pitch;
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            region.imageOffset = { 0, (int32_t) b.first_row, 0 };
+            region.imageExtent = { output.width, b.num_rows, 1 };
+            vkCmdCopyImageToBuffer (h.command_buffer, band_output.image, VK_IMAGE_LAYOUT_GENERAL, h.staging.buffer, 1, &region);
+
+            auto barrier = utils::init_VkBufferMemoryBarrier ();
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            barrier.buffer = h.staging.buffer;
+            vkCmdPipelineBarrier (h.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        }
+        vk_assert (vkEndCommandBuffer (h.command_buffer));
+
+        h.target->enqueue (h.compute_finished);
+
+        const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        auto submit_info = utils::init_VkSubmitInfo ();
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &h.compute_finished;
+        submit_info.pWaitDstStageMask = &wait_stage;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &h.command_buffer;
+        vk_assert (vkQueueSubmit (h.device->get_queue (h.identifier), 1, &submit_info, h.fence));
+        h.in_flight = true;
+    }
+}
+
+VkSemaphore split_frame::composite (VkSemaphore z_also_signal) {
+    const texture& output = primary.get_pre_render_texture ();
+    copy_regions.clear ();
+    for (size_t i = 0; i < helpers.size (); ++i) {
+        helper& h = helpers[i];
+        const band& b = bands[i + 1];
+        if (!h.in_flight)
+            continue;
+        vk_assert (vkWaitForFences (h.device->logical_device, 1, &h.fence, VK_TRUE, UINT64_MAX));
+        vk_assert (vkResetFences (h.device->logical_device, 1, &h.fence));
+        h.in_flight = false;
+        if (b.num_rows == 0)
+            continue;
+
+        const VkDeviceSize offset = (VkDeviceSize) b.first_row * row_pitch;
+        memcpy ((uint8_t*) upload.mapped + offset, (const uint8_t*) h.staging.mapped + offset, (size_t) b.num_rows * row_pitch);
+
+        VkBufferImageCopy region = {};
+        region.bufferOffset = offset;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageOffset = { 0, (int32_t) b.first_row, 0 };
+        region.imageExtent = { output.width, b.num_rows, 1 };
+        copy_regions.emplace_back (region);
+    }
+
+    vk_assert (vkResetCommandBuffer (command_buffer, 0));
+    const auto begin_info = utils::init_VkCommandBufferBeginInfo (VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vk_assert (vkBeginCommandBuffer (command_buffer, &begin_info));
+    if (copy_regions.size ()) // the output stays in the general layout, the semaphore wait orders this after the dispatch.
+        vkCmdCopyBufferToImage (command_buffer, upload.buffer, output.image, VK_IMAGE_LAYOUT_GENERAL, (uint32_t) copy_regions.size (), copy_regions.data ());
+    vk_assert (vkEndCommandBuffer (command_buffer));
+
+    const VkSemaphore wait_on = primary.get_compute_finished ();
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    const VkSemaphore signals[] = { composite_finished, z_also_signal };
+    auto submit_info = utils::init_VkSubmitInfo ();
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &wait_on;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    submit_info.signalSemaphoreCount = z_also_signal != VK_NULL_HANDLE ? 2 : 1;
+    submit_info.pSignalSemaphores = signals;
+    vk_assert (vkQueueSubmit (context.get_queue (identifier), 1, &submit_info, VK_NULL_HANDLE));
+    return composite_finished;
+}
+
+void split_frame::end_of_frame () {
+    for (helper& h : helpers)
+        h.target->end_of_frame ();
+}
+
+void split_frame::debug_ui () {
+    ImGui::Text ("Split frame");
+    for (size_t i = 0; i < bands.size (); ++i) {
+        const band& b = bands[i];
+        const std::optional<float> ms = get_target (i).get_band_ms ();
+        const std::string& name = i == 0 ? context.physical_device_info.name : helpers[i - 1].device->physical_device_info.name;
+        ImGui::BulletText ("%s: rows %u-%u, %.2f ms", name.c_str (), b.first_row, b.first_row + b.num_rows, ms.value_or (0.0f));
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+// SGE-VK-SPLIT-FRAME
+// ---------------------------------- //
+// Splits the compute output across
+// every device.
+// ---------------------------------- //
+// * The output is divided into horizontal bands, the primary device dispatches the first and every other device has
+//   its own compute target (with the uniforms & blobs replicated to it) dispatching one of the others.
+// * Each other device copies its band into host visible memory, from where it's copied on the host into an upload
+//   buffer on the primary device and then into the primary output after the primary's own dispatch.
+// * Bands are rebalanced every frame in proportion to each device's measured throughput.
+// * Only devices with Vulkan 1.1 (for vkCmdDispatchBase) & the same output format as the primary take part. The
+//   content must be a single shader without a secondary output, whose pixels don't depend on other pixels or frames.
+// * Can be tried without any GPUs by pointing VK_ICD_FILENAMES at two software drivers (i.e. lavapipe & SwiftShader).
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_app_interface.hh"
+#include "sge_vk_buffer.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+#include "sge_vk_kernel.hh"
+#include "sge_vk_compute_target.hh"
+
+namespace sge::vk {
+
+class split_frame {
+public:
+    split_frame (const kernel&, compute_target& primary, const sge::app::content&, const compute_target::size_fn&);
+    ~split_frame ();
+
+    // false if no other device could take part, in which case there's nothing to split.
+    bool                                is_active                               () const { return !helpers.empty (); }
+
+    // replicates the frame's changes to the other devices & rebalances the bands, must be called before the primary
+    // compute target's update as that clears the flags.
+    void                                update                                  (bool, const std::vector<bool>&, const std::vector<std::optional<dataspan>>&, const std::vector<fixed::byterange_list>&);
+
+    // submits the other devices' bands, before the primary compute target is enqueued so they all run at once.
+    void                                enqueue                                 ();
+
+    // waits on the other devices' bands & uploads them into the primary output after its dispatch, the returned
+    // semaphore (in place of the compute target's) is signalled once the output is complete, as is `also_signal`.
+    VkSemaphore                         composite                               (VkSemaphore also_signal = VK_NULL_HANDLE);
+
+    void                                create_r                                ();
+    void                                destroy_r                               ();
+    void                                end_of_frame                            ();
+
+    void                                debug_ui                                ();
+
+private:
+    struct helper {
+        const struct context*           device = nullptr;
+        queue_identifier                identifier;
+        std::unique_ptr<compute_target> target;
+        device_buffer                   staging; // host visible, as big as the whole output.
+        VkCommandPool                   command_pool = VK_NULL_HANDLE;
+        VkCommandBuffer                 command_buffer = VK_NULL_HANDLE; // copies the band into staging.
+        VkSemaphore                     compute_finished = VK_NULL_HANDLE;
+        VkFence                         fence = VK_NULL_HANDLE;
+        bool                            in_flight = false;
+    };
+
+    struct band {
+        uint32_t                        first_row = 0;
+        uint32_t                        num_rows = 0;
+        float                           rows_per_ms = 0.0f; // smoothed, zero until measured.
+    };
+
+    const context&                      context;
+    const queue_identifier              identifier; // of the primary's compute queue.
+    compute_target&                     primary;
+    std::vector<helper>                 helpers;
+    std::vector<band>                   bands; // the primary's then each helper's.
+
+    device_buffer                       upload; // host visible, on the primary device.
+    VkCommandPool                       command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer                     command_buffer = VK_NULL_HANDLE; // copies the helpers' bands into the output.
+    VkSemaphore                         composite_finished = VK_NULL_HANDLE;
+    uint32_t                            row_pitch = 0; // in bytes, of the output & staging buffers.
+
+    bool                                push_flag = false; // scratch copies of the frame's changes, one per helper.
+    std::vector<bool>                   ubo_flags;
+    std::vector<std::optional<dataspan>> sbo_flags;
+    std::vector<fixed::byterange_list> sbo_ranges;
+    fixed::small_vector<VkBufferImageCopy, 8> copy_regions;
+
+    const compute_target&               get_target                              (size_t band) const;
+    void                                balance                                 ();
+    void                                create_staging                          ();
+    void                                destroy_staging                         ();
+};
+
+}
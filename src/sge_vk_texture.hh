@@ -18,6 +18,7 @@ struct texture {
     VkImage image;
     VkImageLayout image_layout;
     VkDeviceMemory device_memory;
+    VkFormat format;
     VkImageView view;
     uint32_t width;
     uint32_t height;
@@ -54,6 +55,7 @@ struct texture {
         assert (buffer);
 
         this->context = &context;
+        this->format = format;
         width = texture_width;
         height = texture_height;
         mip_levels = 1;
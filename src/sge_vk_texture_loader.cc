@@ -0,0 +1,485 @@
+#include "sge_vk_texture_loader.hh"
+
+namespace sge::vk {
+
+namespace {
+
+VkFormat get_format (sge::app::texture_format z_format) {
+    switch (z_format) {
+        case sge::app::texture_format::r8:          return VK_FORMAT_R8_UNORM;
+        case sge::app::texture_format::rg8:         return VK_FORMAT_R8G8_UNORM;
+        case sge::app::texture_format::rgba8:       return VK_FORMAT_R8G8B8A8_UNORM;
+        case sge::app::texture_format::rgba8_srgb:  return VK_FORMAT_R8G8B8A8_SRGB;
+        case sge::app::texture_format::r16f:        return VK_FORMAT_R16_SFLOAT;
+        case sge::app::texture_format::rgba16f:     return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case sge::app::texture_format::r32f:        return VK_FORMAT_R32_SFLOAT;
+        case sge::app::texture_format::rgba32f:     return VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+    assert (false);
+    return VK_FORMAT_UNDEFINED;
+}
+
+constexpr size_t max_chunk_size = 4 * 1024 * 1024; // small enough that a texture's first rows arrive within a frame or two.
+constexpr size_t staging_alignment = 16; // a multiple of every format's texel size.
+
+}
+
+texture_loader::texture_loader (const struct context& z_context, const struct queue_identifier& z_compute, const std::vector<sge::app::texture_input>& z_inputs)
+    : context (z_context)
+    , compute (z_compute)
+    , graphics (z_compute)
+{
+    if (context.physical_device_info.supports (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT)) {
+        graphics.family_index = context.physical_device_info.best_queue_family_for (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT);
+        graphics.number = 0;
+        can_blit = true;
+    }
+
+    const auto graphics_command_pool_create_info = utils::init_VkCommandPoolCreateInfo (graphics.family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    vk_assert (vkCreateCommandPool (context.logical_device, &graphics_command_pool_create_info, context.allocation_callbacks, &graphics_command_pool));
+    const auto compute_command_pool_create_info = utils::init_VkCommandPoolCreateInfo (compute.family_index, 0);
+    vk_assert (vkCreateCommandPool (context.logical_device, &compute_command_pool_create_info, context.allocation_callbacks, &compute_command_pool));
+
+    const auto copy_allocate_info = utils::init_VkCommandBufferAllocateInfo (graphics_command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+    vk_assert (vkAllocateCommandBuffers (context.logical_device, &copy_allocate_info, &copy_command_buffer));
+    const auto acquire_allocate_info = utils::init_VkCommandBufferAllocateInfo (compute_command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+    vk_assert (vkAllocateCommandBuffers (context.logical_device, &acquire_allocate_info, &acquire_command_buffer));
+
+    // never changes, so it's recorded once: the semaphore wait alone would only hold back its own batch, this orders
+    // compute work submitted after it too.
+    const auto acquire_begin_info = utils::init_VkCommandBufferBeginInfo ();
+    vk_assert (vkBeginCommandBuffer (acquire_command_buffer, &acquire_begin_info));
+    VkMemoryBarrier memory_barrier = {};
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier (acquire_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+    vk_assert (vkEndCommandBuffer (acquire_command_buffer));
+
+    const auto semaphore_create_info = utils::init_VkSemaphoreCreateInfo ();
+    vk_assert (vkCreateSemaphore (context.logical_device, &semaphore_create_info, context.allocation_callbacks, &copied));
+    const auto fence_create_info = utils::init_VkFenceCreateInfo ();
+    vk_assert (vkCreateFence (context.logical_device, &fence_create_info, context.allocation_callbacks, &fence));
+
+    const auto& configuration = sge::app::get_configuration ();
+    context.create_buffer (
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &staging,
+        (VkDeviceSize) std::max (configuration.texture_staging_mb, 1) * 1024 * 1024);
+    staging.map ();
+    chunk_size = std::min<size_t> (max_chunk_size, staging.size / 4); // so several chunks are in flight at once.
+
+    entries.resize (z_inputs.size ());
+    for (size_t i = 0; i < z_inputs.size (); ++i) {
+        entries[i].input = z_inputs[i];
+        create_texture (entries[i]);
+    }
+    clear_textures ();
+
+    const int num_workers = std::min<int> (std::max (configuration.texture_loader_threads, 1), (int) entries.size ());
+    for (int i = 0; i < num_workers; ++i)
+        workers.emplace_back (&texture_loader::worker, this);
+}
+
+texture_loader::~texture_loader () {
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        stop = true;
+    }
+    condition.notify_all ();
+    for (std::thread& w : workers)
+        w.join ();
+
+    if (in_flight)
+        vkWaitForFences (context.logical_device, 1, &fence, VK_TRUE, UINT64_MAX);
+    for (entry& e : entries)
+        e.image.destroy ();
+    staging.destroy (context.allocation_callbacks);
+    vkDestroyFence (context.logical_device, fence, context.allocation_callbacks);
+    vkDestroySemaphore (context.logical_device, copied, context.allocation_callbacks);
+    vkDestroyCommandPool (context.logical_device, compute_command_pool, context.allocation_callbacks);
+    vkDestroyCommandPool (context.logical_device, graphics_command_pool, context.allocation_callbacks);
+}
+
+void texture_loader::create_texture (entry& z_entry) {
+    const sge::app::texture_input& input = z_entry.input;
+    const bool is_3d = input.type == sge::app::texture_type::image_3d;
+    const bool is_cube = input.type == sge::app::texture_type::cube;
+    assert (input.width > 0 && input.height > 0 && input.depth > 0 && input.layers > 0);
+
+    // a cube's faces all have the input's size, which Vulkan requires to be square. A cube that isn't is rejected: it's
+    // created square (so it can still be bound) but never loaded.
+    const bool is_bad_cube = is_cube && input.width != input.height;
+
+    texture& t = z_entry.image;
+    t.context = &context;
+    t.format = get_format (input.format);
+    t.width = is_bad_cube ? std::min (input.width, input.height) : input.width;
+    t.height = is_bad_cube ? t.width : input.height;
+    t.layer_count = is_cube ? 6 : input.type == sge::app::texture_type::image_2d_array ? input.layers : 1;
+    t.image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    z_entry.depth = is_3d ? input.depth : 1;
+    z_entry.row_size = t.width * utils::get_texel_size (t.format);
+    z_entry.num_rows = t.height * z_entry.depth * t.layer_count;
+
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties (context.physical_device, t.format, &format_properties);
+    const VkFormatFeatureFlags features = format_properties.optimalTilingFeatures;
+    const bool can_filter = features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    const bool can_mip = can_blit && can_filter && (features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) && (features & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+    t.mip_levels = input.mips && can_mip
+        ? (uint32_t) std::floor (std::log2 (std::max ({ t.width, t.height, z_entry.depth }))) + 1
+        : 1;
+
+    auto image_create_info = utils::init_VkImageCreateInfo ();
+    image_create_info.flags = is_cube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+    image_create_info.imageType = is_3d ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
+    image_create_info.format = t.format;
+    image_create_info.extent = { t.width, t.height, z_entry.depth };
+    image_create_info.mipLevels = t.mip_levels;
+    image_create_info.arrayLayers = t.layer_count;
+    image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    const uint32_t families[] = { graphics.family_index, compute.family_index };
+    if (graphics.family_index != compute.family_index) {
+        image_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        image_create_info.queueFamilyIndexCount = 2;
+        image_create_info.pQueueFamilyIndices = families;
+    }
+    else {
+        image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    vk_assert (vkCreateImage (context.logical_device, &image_create_info, context.allocation_callbacks, &t.image));
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements (context.logical_device, t.image, &memory_requirements);
+    auto alloc_info = utils::init_VkMemoryAllocateInfo ();
+    alloc_info.allocationSize = memory_requirements.size;
+    alloc_info.memoryTypeIndex = utils::choose_memory_type (context.physical_device, memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    vk_assert (vkAllocateMemory (context.logical_device, &alloc_info, context.allocation_callbacks, &t.device_memory));
+    vk_assert (vkBindImageMemory (context.logical_device, t.image, t.device_memory, 0));
+
+    const VkFilter filter = input.linear && can_filter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    const VkSamplerAddressMode address_mode = input.repeat ? VK_SAMPLER_ADDRESS_MODE_REPEAT : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    auto sampler_create_info = utils::init_VkSamplerCreateInfo ();
+    sampler_create_info.magFilter = filter;
+    sampler_create_info.minFilter = filter;
+    sampler_create_info.mipmapMode = filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_create_info.addressModeU = address_mode;
+    sampler_create_info.addressModeV = address_mode;
+    sampler_create_info.addressModeW = address_mode;
+    sampler_create_info.compareOp = VK_COMPARE_OP_NEVER;
+    sampler_create_info.maxLod = (float) t.mip_levels;
+    vk_assert (vkCreateSampler (context.logical_device, &sampler_create_info, context.allocation_callbacks, &t.sampler));
+
+    auto view_create_info = utils::init_VkImageViewCreateInfo ();
+    view_create_info.viewType
+        = is_3d ? VK_IMAGE_VIEW_TYPE_3D
+        : is_cube ? VK_IMAGE_VIEW_TYPE_CUBE
+        : input.type == sge::app::texture_type::image_2d_array ? VK_IMAGE_VIEW_TYPE_2D_ARRAY
+        : VK_IMAGE_VIEW_TYPE_2D;
+    view_create_info.format = t.format;
+    view_create_info.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+    view_create_info.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, t.mip_levels, 0, t.layer_count };
+    view_create_info.image = t.image;
+    vk_assert (vkCreateImageView (context.logical_device, &view_create_info, context.allocation_callbacks, &t.view));
+
+    t.descriptor.sampler = t.sampler;
+    t.descriptor.imageView = t.view;
+    t.descriptor.imageLayout = t.image_layout;
+
+    if (is_bad_cube) {
+        std::cout << "Texture " << input.path << " is a cube with " << input.width << "x" << input.height << " faces, which must be square, it will read as zero.\n";
+        z_entry.failed = true;
+    }
+
+    // a texture that can't fit a single row in the staging ring is never loaded.
+    else if (z_entry.row_size > staging.size) {
+        std::cout << "Texture " << input.path << " has rows larger than the texture staging memory, it will read as zero.\n";
+        z_entry.failed = true;
+    }
+}
+
+void texture_loader::clear_textures () {
+    if (entries.empty ())
+        return;
+
+    // once, at startup, so it's simplest to wait for it.
+    VkCommandBuffer command_buffer = context.create_command_buffer (VK_COMMAND_BUFFER_LEVEL_PRIMARY, graphics, true);
+    const VkClearColorValue zero = {};
+    for (const entry& e : entries) {
+        const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, e.image.mip_levels, 0, e.image.layer_count };
+        utils::set_image_layout (command_buffer, e.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+        vkCmdClearColorImage (command_buffer, e.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &zero, 1, &range);
+        utils::set_image_layout (command_buffer, e.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, range);
+    }
+    context.flush_command_buffer (command_buffer, graphics);
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+void texture_loader::worker () {
+    std::unique_lock<std::mutex> lock (mutex);
+    while (!stop && next_texture < entries.size ()) {
+        const size_t i = next_texture++;
+        lock.unlock ();
+        load (i);
+        lock.lock ();
+    }
+}
+
+void texture_loader::load (size_t z_texture) {
+    entry& e = entries[z_texture];
+    if (e.failed)
+        return;
+
+    sge::utils::mapped_file file;
+    if (!file.open (e.input.path.c_str (), sge::utils::mapped_file::access::read_only) || file.size () < (size_t) e.row_size * e.num_rows) {
+        std::cout << "Failed to load texture " << e.input.path << " (missing or too small), it will read as zero.\n";
+        std::lock_guard<std::mutex> lock (mutex);
+        e.failed = true;
+        return;
+    }
+
+    // reading the mapped file is what pages it in from disk, which happens here rather than on the main thread.
+    const uint32_t rows_per_chunk = (uint32_t) std::max<size_t> (chunk_size / e.row_size, 1);
+    for (uint32_t row = 0; row < e.num_rows; row += rows_per_chunk) {
+        const uint32_t num_rows = std::min (rows_per_chunk, e.num_rows - row);
+        const size_t size = (size_t) num_rows * e.row_size;
+        std::optional<size_t> offset;
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            condition.wait (lock, [&] { return stop || (offset = allocate (size)).has_value (); });
+            if (stop)
+                return;
+        }
+        memcpy ((uint8_t*) staging.mapped + *offset, file.data () + (size_t) row * e.row_size, size);
+        std::lock_guard<std::mutex> lock (mutex);
+        ready.emplace_back (chunk { z_texture, *offset, size, row, num_rows });
+    }
+
+    std::lock_guard<std::mutex> lock (mutex);
+    num_loaded++;
+}
+
+std::optional<size_t> texture_loader::allocate (size_t z_size) {
+    const size_t size = (z_size + staging_alignment - 1) & ~(staging_alignment - 1);
+    if (allocations.empty ())
+        ring_head = 0;
+
+    // the head never catches up with the tail, so they're only equal when the ring is empty.
+    size_t offset = ring_head;
+    if (allocations.empty ()) {
+        if (size > staging.size)
+            return std::nullopt;
+    }
+    else {
+        const size_t tail = allocations.front ().offset;
+        if (ring_head >= tail) {
+            if (ring_head + size > staging.size) {
+                if (size >= tail)
+                    return std::nullopt;
+                offset = 0; // wraps around, the space left at the end goes unused until the tail passes it.
+            }
+        }
+        else if (ring_head + size >= tail)
+            return std::nullopt;
+    }
+
+    allocations.emplace_back (allocation { offset, size });
+    ring_head = offset + size;
+    return offset;
+}
+
+//--------------------------------------------------------------------------------------------------------------------//
+
+void texture_loader::update () {
+    if (in_flight) {
+        vk_assert (vkWaitForFences (context.logical_device, 1, &fence, VK_TRUE, UINT64_MAX));
+        vk_assert (vkResetFences (context.logical_device, 1, &fence));
+        in_flight = false;
+    }
+
+    recording.clear ();
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        for (const chunk& c : in_flight_chunks) {
+            auto a = std::find_if (allocations.begin (), allocations.end (), [&] (const allocation& x) { return x.offset == c.offset; });
+            assert (a != allocations.end ());
+            a->released = true;
+        }
+        while (!allocations.empty () && allocations.front ().released)
+            allocations.pop_front ();
+        std::swap (recording, ready);
+    }
+    if (!in_flight_chunks.empty ())
+        condition.notify_all (); // workers waiting on staging memory.
+    in_flight_chunks.clear ();
+
+    if (recording.empty ())
+        return;
+
+    touched.clear ();
+    for (const chunk& c : recording)
+        if (std::find (touched.begin (), touched.end (), c.texture) == touched.end ())
+            touched.emplace_back (c.texture);
+
+    const auto begin_info = utils::init_VkCommandBufferBeginInfo (VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vk_assert (vkResetCommandBuffer (copy_command_buffer, 0));
+    vk_assert (vkBeginCommandBuffer (copy_command_buffer, &begin_info));
+
+    // the last dispatch (which sampled them) has finished, so only the layout needs to change.
+    barriers.clear ();
+    for (size_t i : touched) {
+        auto barrier = utils::init_VkImageMemoryBarrier ();
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.image = entries[i].image.image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, entries[i].image.layer_count };
+        barriers.emplace_back (barrier);
+    }
+    vkCmdPipelineBarrier (copy_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t) barriers.size (), barriers.data ());
+
+    for (const chunk& c : recording) {
+        entry& e = entries[c.texture];
+        record_copies (e, c);
+        e.rows_copied += c.num_rows;
+        num_bytes += c.size;
+    }
+
+    // textures that are now complete get their mips, the others go back to being sampled as they are.
+    barriers.clear ();
+    for (size_t i : touched) {
+        const entry& e = entries[i];
+        if (e.rows_copied == e.num_rows && e.image.mip_levels > 1) {
+            record_mips (e);
+            continue;
+        }
+        auto barrier = utils::init_VkImageMemoryBarrier ();
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0; // made visible by the semaphore.
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.image = e.image.image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, e.image.layer_count };
+        barriers.emplace_back (barrier);
+    }
+    if (!barriers.empty ())
+        vkCmdPipelineBarrier (copy_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t) barriers.size (), barriers.data ());
+
+    vk_assert (vkEndCommandBuffer (copy_command_buffer));
+    std::swap (in_flight_chunks, recording);
+    recorded = true;
+}
+
+void texture_loader::record_copies (const entry& z_entry, const chunk& z_chunk) {
+    const bool is_3d = z_entry.input.type == sge::app::texture_type::image_3d;
+    const uint32_t height = z_entry.image.height;
+
+    // one region for each layer (or slice) the chunk's rows are in.
+    regions.clear ();
+    const uint32_t end = z_chunk.first_row + z_chunk.num_rows;
+    for (uint32_t row = z_chunk.first_row; row < end;) {
+        const uint32_t slice = row / height;
+        const uint32_t y = row % height;
+        const uint32_t num_rows = std::min (end - row, height - y);
+        VkBufferImageCopy region = {};
+        region.bufferOffset = z_chunk.offset + (VkDeviceSize) (row - z_chunk.first_row) * z_entry.row_size;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, is_3d ? 0 : slice, 1 };
+        region.imageOffset = { 0, (int32_t) y, is_3d ? (int32_t) slice : 0 };
+        region.imageExtent = { z_entry.image.width, num_rows, 1 };
+        regions.emplace_back (region);
+        row += num_rows;
+    }
+    vkCmdCopyBufferToImage (copy_command_buffer, staging.buffer, z_entry.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t) regions.size (), regions.data ());
+}
+
+void texture_loader::record_mips (const entry& z_entry) {
+    const texture& t = z_entry.image;
+    const bool is_3d = z_entry.input.type == sge::app::texture_type::image_3d;
+
+    auto barrier = utils::init_VkImageMemoryBarrier ();
+    barrier.image = t.image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, t.layer_count };
+    const auto transition = [&] (uint32_t level, VkImageLayout from, VkImageLayout to, VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags src_stage) {
+        barrier.subresourceRange.baseMipLevel = level;
+        barrier.oldLayout = from;
+        barrier.newLayout = to;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        vkCmdPipelineBarrier (copy_command_buffer, src_stage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    };
+
+    // each level is blitted from the one before it, which is then left as a source.
+    transition (0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    int32_t width = (int32_t) t.width, height = (int32_t) t.height, depth = (int32_t) z_entry.depth;
+    for (uint32_t level = 1; level < t.mip_levels; ++level) {
+        const int32_t next_width = std::max (width / 2, 1);
+        const int32_t next_height = std::max (height / 2, 1);
+        const int32_t next_depth = is_3d ? std::max (depth / 2, 1) : 1;
+        transition (level, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+        VkImageBlit blit = {};
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, t.layer_count };
+        blit.srcOffsets[1] = { width, height, depth };
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, t.layer_count };
+        blit.dstOffsets[1] = { next_width, next_height, next_depth };
+        vkCmdBlitImage (copy_command_buffer, t.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, t.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        transition (level, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        width = next_width;
+        height = next_height;
+        depth = next_depth;
+    }
+
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, t.mip_levels, 0, t.layer_count };
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0; // made visible by the semaphore.
+    vkCmdPipelineBarrier (copy_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void texture_loader::submit () {
+    if (!recorded)
+        return;
+
+    auto copy_submit_info = utils::init_VkSubmitInfo ();
+    copy_submit_info.commandBufferCount = 1;
+    copy_submit_info.pCommandBuffers = &copy_command_buffer;
+    copy_submit_info.signalSemaphoreCount = 1;
+    copy_submit_info.pSignalSemaphores = &copied;
+    vk_assert (vkQueueSubmit (context.get_queue (graphics), 1, &copy_submit_info, VK_NULL_HANDLE));
+
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    auto acquire_submit_info = utils::init_VkSubmitInfo ();
+    acquire_submit_info.waitSemaphoreCount = 1;
+    acquire_submit_info.pWaitSemaphores = &copied;
+    acquire_submit_info.pWaitDstStageMask = &wait_stage;
+    acquire_submit_info.commandBufferCount = 1;
+    acquire_submit_info.pCommandBuffers = &acquire_command_buffer;
+    vk_assert (vkQueueSubmit (context.get_queue (compute), 1, &acquire_submit_info, fence));
+
+    recorded = false;
+    in_flight = true;
+}
+
+void texture_loader::debug_ui () {
+    uint32_t loaded, failed;
+    {
+        std::lock_guard<std::mutex> lock (mutex);
+        loaded = num_loaded;
+        failed = (uint32_t) std::count_if (entries.begin (), entries.end (), [] (const entry& e) { return e.failed; });
+    }
+    ImGui::Text ("Textures");
+    ImGui::BulletText ("%u/%u loaded (%u failed) by %u threads, %.2f MiB copied, %s", loaded, (uint32_t) entries.size (), failed, (uint32_t) workers.size (), num_bytes / (1024.0 * 1024.0), can_blit ? "mips blitted" : "no mips");
+    for (const entry& e : entries)
+        ImGui::BulletText ("%s: %ux%ux%u, %u layers, %u mips, %.0f%%", e.input.path.c_str (), e.image.width, e.image.height, e.depth, e.image.layer_count, e.image.mip_levels, 100.0 * e.rows_copied / e.num_rows);
+}
+
+}
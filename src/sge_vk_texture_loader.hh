@@ -0,0 +1,120 @@
+// SGE-VK-TEXTURE-LOADER
+// ---------------------------------- //
+// Content textures, loaded in the
+// background.
+// ---------------------------------- //
+// * Every texture is created up front (cleared to zero, with its full mip chain) so its descriptor never changes, and
+//   then filled in as it's loaded: worker threads read each file through a memory mapping a chunk of rows at a time
+//   into a host visible staging ring, and every frame the chunks that are ready are copied into their images.
+// * Once a texture's first mip level is complete the rest of the chain is generated with blits. Copies & blits are
+//   recorded on a graphics queue (blits need one) and the compute queue waits on them, only in frames that have any.
+// * Images are shared concurrently when the graphics & compute queues are in different families, so there are no
+//   ownership transfers. Between frames every image is left in SHADER_READ_ONLY_OPTIMAL, the layout it's bound in.
+// * Devices without a graphics queue (i.e. split-frame helpers) copy on the compute queue & don't generate mips.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_app_interface.hh"
+#include "sge_mapped_file.hh"
+#include "sge_vk_buffer.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+#include "sge_vk_texture.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace sge::vk {
+
+class texture_loader {
+public:
+    texture_loader (const struct context&, const struct queue_identifier& compute, const std::vector<sge::app::texture_input>&);
+    ~texture_loader ();
+
+    // records the copies of the chunks loaded since the last frame (and the mips of textures that are now complete),
+    // the last frame's submission must have finished.
+    void                                update                                  ();
+
+    // submits what update recorded, compute work submitted next waits for it.
+    void                                submit                                  ();
+
+    size_t                              get_num_textures                        () const { return entries.size (); }
+    const VkDescriptorImageInfo*        get_descriptor                          (size_t i) const { return &entries[i].image.descriptor; }
+
+    void                                debug_ui                                ();
+
+private:
+    struct entry {
+        sge::app::texture_input         input;
+        struct texture                  image = {};
+        uint32_t                        depth = 1;
+        uint32_t                        row_size = 0; // in bytes.
+        uint32_t                        num_rows = 0; // of the first mip level, over every layer or slice.
+        uint32_t                        rows_copied = 0; // main thread only.
+        bool                            failed = false; // guarded by mutex.
+    };
+
+    struct chunk {
+        size_t                          texture;
+        size_t                          offset; // into the staging ring.
+        size_t                          size;
+        uint32_t                        first_row;
+        uint32_t                        num_rows;
+    };
+
+    struct allocation {
+        size_t                          offset;
+        size_t                          size;
+        bool                            released = false;
+    };
+
+    const context&                      context;
+    const queue_identifier              compute;
+    queue_identifier                    graphics; // the compute queue if the device has no graphics queue.
+    bool                                can_blit = false;
+    std::vector<entry>                  entries;
+
+    device_buffer                       staging; // host visible & persistently mapped, the ring.
+    size_t                              chunk_size = 0; // in bytes, the most a chunk holds.
+
+    VkCommandPool                       graphics_command_pool = VK_NULL_HANDLE;
+    VkCommandPool                       compute_command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer                     copy_command_buffer = VK_NULL_HANDLE; // on the graphics queue.
+    VkCommandBuffer                     acquire_command_buffer = VK_NULL_HANDLE; // on the compute queue.
+    VkSemaphore                         copied = VK_NULL_HANDLE;
+    VkFence                             fence = VK_NULL_HANDLE;
+    bool                                recorded = false; // update recorded something for submit.
+    bool                                in_flight = false;
+
+    std::vector<std::thread>            workers;
+    std::mutex                          mutex;
+    std::condition_variable             condition;
+
+    // guarded by mutex
+    bool                                stop = false;
+    size_t                              next_texture = 0; // to be loaded by a worker.
+    std::deque<allocation>              allocations; // of the staging ring, oldest first.
+    size_t                              ring_head = 0;
+    std::vector<chunk>                  ready; // loaded, not yet recorded.
+    uint32_t                            num_loaded = 0;
+
+    // main thread only
+    std::vector<chunk>                  recording; // scratch.
+    std::vector<chunk>                  in_flight_chunks; // whose staging is freed once the submission finishes.
+    std::vector<size_t>                 touched; // scratch, textures with chunks this frame.
+    std::vector<VkBufferImageCopy>      regions; // scratch.
+    std::vector<VkImageMemoryBarrier>   barriers; // scratch.
+    uint64_t                            num_bytes = 0;
+
+    void                                create_texture                          (entry&);
+    void                                clear_textures                          ();
+    void                                worker                                  ();
+    void                                load                                    (size_t);
+    std::optional<size_t>               allocate                                (size_t); // with the mutex held.
+    void                                record_copies                           (const entry&, const chunk&);
+    void                                record_mips                             (const entry&);
+};
+
+}
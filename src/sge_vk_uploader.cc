@@ -0,0 +1,175 @@
+#include "sge_vk_uploader.hh"
+
+namespace sge::vk {
+
+uploader::uploader (const struct context& z_context, const struct queue_identifier& z_transfer, const struct queue_identifier& z_compute)
+    : context (z_context)
+    , transfer (z_transfer)
+    , compute (z_compute)
+    , dedicated (z_transfer.family_index != z_compute.family_index)
+{
+    const auto transfer_command_pool_create_info = utils::init_VkCommandPoolCreateInfo (transfer.family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    vk_assert (vkCreateCommandPool (context.logical_device, &transfer_command_pool_create_info, context.allocation_callbacks, &transfer_command_pool));
+    const auto compute_command_pool_create_info = utils::init_VkCommandPoolCreateInfo (compute.family_index, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    vk_assert (vkCreateCommandPool (context.logical_device, &compute_command_pool_create_info, context.allocation_callbacks, &compute_command_pool));
+
+    const auto copy_allocate_info = utils::init_VkCommandBufferAllocateInfo (transfer_command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+    vk_assert (vkAllocateCommandBuffers (context.logical_device, &copy_allocate_info, &copy_command_buffer));
+    const auto acquire_allocate_info = utils::init_VkCommandBufferAllocateInfo (compute_command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+    vk_assert (vkAllocateCommandBuffers (context.logical_device, &acquire_allocate_info, &acquire_command_buffer));
+    vk_assert (vkAllocateCommandBuffers (context.logical_device, &acquire_allocate_info, &release_command_buffer));
+
+    const auto semaphore_create_info = utils::init_VkSemaphoreCreateInfo ();
+    vk_assert (vkCreateSemaphore (context.logical_device, &semaphore_create_info, context.allocation_callbacks, &copied));
+    vk_assert (vkCreateSemaphore (context.logical_device, &semaphore_create_info, context.allocation_callbacks, &released));
+    const auto fence_create_info = utils::init_VkFenceCreateInfo ();
+    vk_assert (vkCreateFence (context.logical_device, &fence_create_info, context.allocation_callbacks, &fence));
+}
+
+uploader::~uploader () {
+    if (in_flight)
+        vkWaitForFences (context.logical_device, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkDestroyFence (context.logical_device, fence, context.allocation_callbacks);
+    vkDestroySemaphore (context.logical_device, released, context.allocation_callbacks);
+    vkDestroySemaphore (context.logical_device, copied, context.allocation_callbacks);
+    vkDestroyCommandPool (context.logical_device, compute_command_pool, context.allocation_callbacks);
+    vkDestroyCommandPool (context.logical_device, transfer_command_pool, context.allocation_callbacks);
+}
+
+void uploader::copy (VkBuffer z_src, VkBuffer z_dst, const VkBufferCopy* z_regions, uint32_t z_num_regions, bool z_partial) {
+    assert (z_num_regions > 0);
+    queue.emplace_back (pending { z_src, z_dst, regions.size (), z_num_regions, z_partial });
+    for (uint32_t i = 0; i < z_num_regions; ++i)
+        regions.emplace_back (z_regions[i]);
+}
+
+void uploader::discard (VkBuffer z_dst) {
+    queue.erase (std::remove_if (queue.begin (), queue.end (), [=] (const pending& x) { return x.dst == z_dst; }), queue.end ());
+}
+
+void uploader::submit () {
+    if (queue.empty ())
+        return;
+
+    // the command buffers are reused, so the last submission must be done with them.
+    if (in_flight) {
+        vk_assert (vkWaitForFences (context.logical_device, 1, &fence, VK_TRUE, UINT64_MAX));
+        vk_assert (vkResetFences (context.logical_device, 1, &fence));
+        in_flight = false;
+    }
+
+    barriers.clear ();
+    partial_barriers.clear ();
+    for (const pending& x : queue) {
+        const auto same_buffer = [&] (const VkBufferMemoryBarrier& b) { return b.buffer == x.dst; };
+        if (std::find_if (barriers.begin (), barriers.end (), same_buffer) != barriers.end ())
+            continue;
+        auto barrier = utils::init_VkBufferMemoryBarrier ();
+        barrier.buffer = x.dst;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        barrier.srcQueueFamilyIndex = dedicated ? transfer.family_index : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = dedicated ? compute.family_index : VK_QUEUE_FAMILY_IGNORED;
+        barriers.emplace_back (barrier);
+
+        // a whole copy into the same destination (i.e. just after it's created) means its contents needn't be kept.
+        const bool partial = std::none_of (queue.begin (), queue.end (), [&] (const pending& y) { return y.dst == x.dst && !y.partial; });
+        if (dedicated && partial) {
+            barrier.srcQueueFamilyIndex = compute.family_index;
+            barrier.dstQueueFamilyIndex = transfer.family_index;
+            partial_barriers.emplace_back (barrier);
+        }
+    }
+
+    const auto begin_info = utils::init_VkCommandBufferBeginInfo (VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    // destinations partially copied into are first released by the compute queue, after the last work that used them.
+    if (!partial_barriers.empty ()) {
+        vk_assert (vkResetCommandBuffer (release_command_buffer, 0));
+        vk_assert (vkBeginCommandBuffer (release_command_buffer, &begin_info));
+        for (VkBufferMemoryBarrier& barrier : partial_barriers) {
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = 0; // ignored for a release.
+        }
+        vkCmdPipelineBarrier (release_command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, (uint32_t) partial_barriers.size (), partial_barriers.data (), 0, nullptr);
+        vk_assert (vkEndCommandBuffer (release_command_buffer));
+
+        auto release_submit_info = utils::init_VkSubmitInfo ();
+        release_submit_info.commandBufferCount = 1;
+        release_submit_info.pCommandBuffers = &release_command_buffer;
+        release_submit_info.signalSemaphoreCount = 1;
+        release_submit_info.pSignalSemaphores = &released;
+        vk_assert (vkQueueSubmit (context.get_queue (compute), 1, &release_submit_info, VK_NULL_HANDLE));
+    }
+
+    // the acquire of those, copies, then the release of each destination.
+    vk_assert (vkResetCommandBuffer (copy_command_buffer, 0));
+    vk_assert (vkBeginCommandBuffer (copy_command_buffer, &begin_info));
+    if (!partial_barriers.empty ()) {
+        for (VkBufferMemoryBarrier& barrier : partial_barriers) {
+            barrier.srcAccessMask = 0; // ignored for an acquire.
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        }
+        vkCmdPipelineBarrier (copy_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, (uint32_t) partial_barriers.size (), partial_barriers.data (), 0, nullptr);
+    }
+    for (const pending& x : queue) {
+        vkCmdCopyBuffer (copy_command_buffer, x.src, x.dst, x.num_regions, &regions[x.first_region]);
+        for (uint32_t i = 0; i < x.num_regions; ++i)
+            num_bytes += regions[x.first_region + i].size;
+        num_regions += x.num_regions;
+    }
+    if (dedicated) {
+        for (VkBufferMemoryBarrier& barrier : barriers) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0; // ignored for a release.
+        }
+        vkCmdPipelineBarrier (copy_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, (uint32_t) barriers.size (), barriers.data (), 0, nullptr);
+    }
+    vk_assert (vkEndCommandBuffer (copy_command_buffer));
+
+    // the acquire of each destination, or just a barrier if ownership needn't change, orders compute work submitted
+    // after it (the semaphore wait alone would only hold back this batch).
+    vk_assert (vkResetCommandBuffer (acquire_command_buffer, 0));
+    vk_assert (vkBeginCommandBuffer (acquire_command_buffer, &begin_info));
+    for (VkBufferMemoryBarrier& barrier : barriers) {
+        barrier.srcAccessMask = dedicated ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT; // ignored for an acquire.
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    }
+    vkCmdPipelineBarrier (acquire_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, (uint32_t) barriers.size (), barriers.data (), 0, nullptr);
+    vk_assert (vkEndCommandBuffer (acquire_command_buffer));
+
+    auto copy_submit_info = utils::init_VkSubmitInfo ();
+    if (!partial_barriers.empty ()) {
+        copy_submit_info.waitSemaphoreCount = 1;
+        copy_submit_info.pWaitSemaphores = &released;
+        copy_submit_info.pWaitDstStageMask = &wait_stage;
+    }
+    copy_submit_info.commandBufferCount = 1;
+    copy_submit_info.pCommandBuffers = &copy_command_buffer;
+    copy_submit_info.signalSemaphoreCount = 1;
+    copy_submit_info.pSignalSemaphores = &copied;
+    vk_assert (vkQueueSubmit (context.get_queue (transfer), 1, &copy_submit_info, VK_NULL_HANDLE));
+
+    auto acquire_submit_info = utils::init_VkSubmitInfo ();
+    acquire_submit_info.waitSemaphoreCount = 1;
+    acquire_submit_info.pWaitSemaphores = &copied;
+    acquire_submit_info.pWaitDstStageMask = &wait_stage;
+    acquire_submit_info.commandBufferCount = 1;
+    acquire_submit_info.pCommandBuffers = &acquire_command_buffer;
+    vk_assert (vkQueueSubmit (context.get_queue (compute), 1, &acquire_submit_info, fence));
+    in_flight = true;
+
+    num_submits++;
+    num_copies += queue.size ();
+    queue.clear ();
+    regions.clear ();
+}
+
+void uploader::debug_ui () {
+    ImGui::Text ("Uploads");
+    ImGui::BulletText ("%s transfer queue", dedicated ? "Dedicated" : "Shared");
+    ImGui::BulletText ("%llu copies (%llu regions) in %llu submissions, %.2f MiB", (unsigned long long) num_copies, (unsigned long long) num_regions, (unsigned long long) num_submits, num_bytes / (1024.0 * 1024.0));
+}
+
+}
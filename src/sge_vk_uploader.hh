@@ -0,0 +1,75 @@
+// SGE-VK-UPLOADER
+// ---------------------------------- //
+// Staging to device copies on the
+// transfer queue.
+// ---------------------------------- //
+// * Copies are queued during the frame and submitted together on the transfer queue (the DMA engine, on devices that
+//   have one), rather than each being recorded, submitted & waited on by itself.
+// * When the transfer queue is in another family than the compute queue ownership of the destinations is released
+//   after the copies & acquired on the compute queue, which waits on a semaphore, so work submitted to the compute
+//   queue afterwards sees the new contents. Frames without uploads don't wait at all.
+// * Ownership is only handed back to the transfer queue first (released on the compute queue, which the transfer queue
+//   waits on) for partial copies, as those must keep the rest of the destination. Whole copies don't need its contents.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_fixed.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+
+namespace sge::vk {
+
+class uploader {
+public:
+    uploader (const struct context&, const struct queue_identifier& transfer, const struct queue_identifier& compute);
+    ~uploader ();
+
+    // queues copies into a buffer used by the compute queue, the source must stay as it is until they're made.
+    // `partial` if the regions don't cover all of the destination, whose other contents are kept.
+    void                                copy                                    (VkBuffer src, VkBuffer dst, const VkBufferCopy* regions, uint32_t num_regions, bool partial = false);
+
+    // forgets copies queued into a buffer that's about to be destroyed.
+    void                                discard                                 (VkBuffer dst);
+
+    // submits the queued copies & then, on the compute queue, what makes them visible to work submitted there next.
+    void                                submit                                  ();
+
+    void                                debug_ui                                ();
+
+private:
+    struct pending {
+        VkBuffer                        src;
+        VkBuffer                        dst;
+        size_t                          first_region; // into regions.
+        uint32_t                        num_regions;
+        bool                            partial;
+    };
+
+    const context&                      context;
+    const queue_identifier              transfer;
+    const queue_identifier              compute;
+    const bool                          dedicated; // the transfer queue is in its own family, so ownership is transferred.
+
+    VkCommandPool                       transfer_command_pool = VK_NULL_HANDLE;
+    VkCommandPool                       compute_command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer                     copy_command_buffer = VK_NULL_HANDLE; // on the transfer queue.
+    VkCommandBuffer                     acquire_command_buffer = VK_NULL_HANDLE; // on the compute queue.
+    VkCommandBuffer                     release_command_buffer = VK_NULL_HANDLE; // on the compute queue, ahead of partial copies.
+    VkSemaphore                         released = VK_NULL_HANDLE;
+    VkSemaphore                         copied = VK_NULL_HANDLE;
+    VkFence                             fence = VK_NULL_HANDLE; // signalled once the last submission's been acquired.
+    bool                                in_flight = false;
+
+    std::vector<pending>                queue;
+    fixed::small_vector<VkBufferCopy, 64> regions; // of all the queued copies, a frame's rarely outgrow the inline storage.
+    std::vector<VkBufferMemoryBarrier>  barriers; // scratch.
+    std::vector<VkBufferMemoryBarrier>  partial_barriers; // scratch, for destinations handed back to the transfer queue.
+
+    uint64_t                            num_submits = 0;
+    uint64_t                            num_copies = 0;
+    uint64_t                            num_regions = 0;
+    uint64_t                            num_bytes = 0;
+};
+
+}
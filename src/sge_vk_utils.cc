@@ -3,37 +3,28 @@
 namespace sge::vk::utils {
 
 uint32_t choose_memory_type (VkPhysicalDevice physical_device, const VkMemoryRequirements& memory_requirements, VkMemoryPropertyFlags required_flags, VkMemoryPropertyFlags preferred_flags) {
+    const uint32_t memory_type = try_choose_memory_type (physical_device, memory_requirements, required_flags, preferred_flags);
+    assert (memory_type != ~0u); // the device has no memory suitable for the resource.
+    return memory_type;
+}
+
+uint32_t try_choose_memory_type (VkPhysicalDevice physical_device, const VkMemoryRequirements& memory_requirements, VkMemoryPropertyFlags required_flags, VkMemoryPropertyFlags preferred_flags) {
 
     VkPhysicalDeviceMemoryProperties device_memory_properties;
     vkGetPhysicalDeviceMemoryProperties (physical_device, &device_memory_properties);
 
-    uint32_t selected_type = ~0u;
-    uint32_t memory_type;
-
-    for (memory_type = 0; memory_type < 32; ++memory_type) {
-        if (memory_requirements.memoryTypeBits & (1 << memory_type)) {
-            const VkMemoryType& type = device_memory_properties.memoryTypes[memory_type];
-            if ((type.propertyFlags & preferred_flags) == preferred_flags) {
-                selected_type = memory_type;
-                break;
-            }
-        }
-    }
-
-    if (selected_type != ~0u) {
-        for (memory_type = 0; memory_type < 32; ++memory_type) {
+    // the first type with both the required & preferred flags, otherwise the first with just the required ones.
+    for (const VkMemoryPropertyFlags flags : { required_flags | preferred_flags, required_flags }) {
+        for (uint32_t memory_type = 0; memory_type < device_memory_properties.memoryTypeCount; ++memory_type) {
             if (memory_requirements.memoryTypeBits & (1 << memory_type)) {
-
                 const VkMemoryType& type = device_memory_properties.memoryTypes[memory_type];
-                if ((type.propertyFlags & required_flags) == required_flags) {
-                    selected_type = memory_type;
-                    break;
-                }
+                if ((type.propertyFlags & flags) == flags)
+                    return memory_type;
             }
         }
     }
 
-    return selected_type;
+    return ~0u; // none has the required flags.
 }
 
 VkSurfaceFormatKHR choose_swapchain_surface_format (const std::vector<VkSurfaceFormatKHR>& available_formats) {
@@ -78,7 +69,12 @@ VkExtent2D choose_swapchain_extent (const VkSurfaceCapabilitiesKHR& capabilities
 }
 
 VkShaderModule create_shader_module (VkDevice device, const VkAllocationCallbacks* ac, const std::vector<uint8_t>& spirv) {
-    auto create_info = init_VkShaderModuleCreateInfo (spirv.size (), reinterpret_cast<const uint32_t*>(spirv.data ()));
+    return create_shader_module (device, ac, dataspan { (void*) spirv.data (), spirv.size () });
+}
+
+VkShaderModule create_shader_module (VkDevice device, const VkAllocationCallbacks* ac, dataspan spirv) {
+    assert (spirv.size % 4 == 0 && (uintptr_t) spirv.address % 4 == 0);
+    auto create_info = init_VkShaderModuleCreateInfo (spirv.size, reinterpret_cast<const uint32_t*>(spirv.address));
     VkShaderModule shader_module;
     vk_assert (vkCreateShaderModule (device, &create_info, ac, &shader_module));
 
@@ -106,6 +102,17 @@ VkBool32 get_supported_depth_format (VkPhysicalDevice physical_device, VkFormat*
     return false;
 }
 
+uint32_t get_texel_size (VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8_UNORM: return 1;
+        case VK_FORMAT_R8G8_UNORM: return 2;
+        case VK_FORMAT_R16_SFLOAT: return 2;
+        case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
+        default: return 4; // rgba8 (unorm & srgb), rgb10a2, r32f & r32ui.
+    }
+}
+
 void set_image_layout(
     VkCommandBuffer command_buffer,
     VkImage image,
@@ -16,12 +16,15 @@
 
 namespace sge::vk::utils {
 
-uint32_t                choose_memory_type                              (VkPhysicalDevice, const VkMemoryRequirements&, VkMemoryPropertyFlags, VkMemoryPropertyFlags = 0);
+uint32_t                choose_memory_type                              (VkPhysicalDevice, const VkMemoryRequirements&, VkMemoryPropertyFlags, VkMemoryPropertyFlags = 0); // asserts there is one.
+uint32_t                try_choose_memory_type                          (VkPhysicalDevice, const VkMemoryRequirements&, VkMemoryPropertyFlags, VkMemoryPropertyFlags = 0); // ~0u if none has the required flags.
 VkSurfaceFormatKHR      choose_swapchain_surface_format                 (const std::vector<VkSurfaceFormatKHR>&);
 VkPresentModeKHR        choose_swapchain_present_mode                   (const std::vector<VkPresentModeKHR>);
 VkExtent2D              choose_swapchain_extent                         (const VkSurfaceCapabilitiesKHR&, const int, const int);
 VkShaderModule          create_shader_module                            (VkDevice, const VkAllocationCallbacks*, const std::vector<uint8_t>&);
+VkShaderModule          create_shader_module                            (VkDevice, const VkAllocationCallbacks*, dataspan); // i.e. SPIR-V used in place from the assets.
 VkBool32                get_supported_depth_format                      (VkPhysicalDevice, VkFormat*);
+uint32_t                get_texel_size                                  (VkFormat); // in bytes, of the compute output's & content textures' possible formats.
 
 void set_image_layout (
     VkCommandBuffer cmdbuffer,
@@ -247,6 +247,20 @@ inline VkImageMemoryBarrier init_VkImageMemoryBarrier () {
     return image_memory_barrier;
 }
 
+inline VkBufferMemoryBarrier init_VkBufferMemoryBarrier () {
+    VkBufferMemoryBarrier buffer_memory_barrier {};
+    buffer_memory_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_memory_barrier.pNext = nullptr;
+    //buffer_memory_barrier.srcAccessMask;
+    //buffer_memory_barrier.dstAccessMask;
+    buffer_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    //buffer_memory_barrier.buffer;
+    buffer_memory_barrier.offset = 0;
+    buffer_memory_barrier.size = VK_WHOLE_SIZE;
+    return buffer_memory_barrier;
+}
+
 inline VkImageCreateInfo init_VkImageCreateInfo () {
     VkImageCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -748,6 +762,23 @@ inline VkPipelineShaderStageCreateInfo init_VkPipelineShaderStageCreateInfo (VkS
     return create_info;
 }
 
+inline VkSpecializationMapEntry init_VkSpecializationMapEntry (uint32_t constant_id, uint32_t offset, size_t size) {
+    VkSpecializationMapEntry entry {};
+    entry.constantID = constant_id;
+    entry.offset = offset;
+    entry.size = size;
+    return entry;
+}
+
+inline VkSpecializationInfo init_VkSpecializationInfo (const std::vector<VkSpecializationMapEntry>& entries, size_t data_size, const void* data) {
+    VkSpecializationInfo info {};
+    info.mapEntryCount = static_cast<uint32_t>(entries.size ());
+    info.pMapEntries = entries.data ();
+    info.dataSize = data_size;
+    info.pData = data;
+    return info;
+}
+
 inline VkPipelineCacheCreateInfo init_VkPipelineCacheCreateInfo () {
     VkPipelineCacheCreateInfo create_info = {};
     create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
@@ -0,0 +1,191 @@
+#include "sge_vk_workgroup_tuner.hh"
+
+#include "sge_utils.hh"
+
+namespace sge::vk {
+
+// square tiles, wide tiles & wave sized rows (32 for most desktop parts, 64 for AMD's GCN), those beyond the device's
+// limits are skipped.
+static const VkExtent2D candidate_sizes[] = {
+    { 8, 8 }, { 16, 8 }, { 16, 16 }, { 32, 4 }, { 32, 8 }, { 64, 4 }, { 32, 1 }, { 64, 1 },
+};
+
+workgroup_tuner::workgroup_tuner (const struct context& z_context, const struct queue_identifier& z_qid, const std::string& z_cache_path, int z_frames_per_candidate)
+    : context (z_context)
+    , cache_path (z_cache_path.empty () ? std::string () : [&] {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties (z_context.physical_device, &properties);
+        std::stringstream ss;
+        ss << z_cache_path << "." << std::hex << properties.vendorID << "-" << properties.deviceID << ".workgroups";
+        return ss.str ();
+    } ())
+    , frames_per_candidate ((uint32_t) std::max (z_frames_per_candidate, 1))
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties (context.physical_device, &properties);
+    const VkPhysicalDeviceLimits& limits = properties.limits;
+    for (const VkExtent2D& size : candidate_sizes) {
+        if (size.width <= limits.maxComputeWorkGroupSize[0]
+            && size.height <= limits.maxComputeWorkGroupSize[1]
+            && size.width * size.height <= limits.maxComputeWorkGroupInvocations)
+            candidates.emplace_back (candidate { size });
+    }
+
+    uint32_t num_queue_families = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties (context.physical_device, &num_queue_families, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families (num_queue_families);
+    vkGetPhysicalDeviceQueueFamilyProperties (context.physical_device, &num_queue_families, queue_families.data ());
+    const uint32_t valid_bits = queue_families[z_qid.family_index].timestampValidBits;
+
+    if (valid_bits > 0) {
+        timestamp_period = limits.timestampPeriod;
+        timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+        VkQueryPoolCreateInfo query_pool_create_info = {};
+        query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_create_info.queryCount = 2;
+        vk_assert (vkCreateQueryPool (context.logical_device, &query_pool_create_info, context.allocation_callbacks, &query_pool));
+
+        // queries must be reset before their results can be asked for, even if they've never been written.
+        VkCommandBuffer reset_command = context.create_command_buffer (VK_COMMAND_BUFFER_LEVEL_PRIMARY, z_qid, true);
+        vkCmdResetQueryPool (reset_command, query_pool, 0, 2);
+        context.flush_command_buffer (reset_command, z_qid, true);
+    }
+
+    load ();
+}
+
+workgroup_tuner::~workgroup_tuner () {
+    vkDestroyQueryPool (context.logical_device, query_pool, context.allocation_callbacks);
+}
+
+void workgroup_tuner::select (uint64_t z_key) {
+    if (z_key == key && (tuning || size.has_value ()))
+        return;
+    key = z_key;
+    tuning = false;
+    changed = true;
+    const auto choice = choices.find (key);
+    if (choice != choices.end ())
+        size = choice->second;
+    else {
+        size.reset ();
+        start ();
+    }
+}
+
+std::optional<VkExtent2D> workgroup_tuner::get_workgroup_size () const {
+    return size;
+}
+
+bool workgroup_tuner::update () {
+    if (tuning) {
+        uint64_t timestamps[2];
+        const VkResult r = vkGetQueryPoolResults (context.logical_device, query_pool, 0, 2, sizeof (timestamps), timestamps, sizeof (uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (r == VK_SUCCESS) {
+            candidate& c = candidates[current];
+            if (++frame > warmup_frames) {
+                c.samples++;
+                c.total_ms += (double) ((timestamps[1] - timestamps[0]) & timestamp_mask) * timestamp_period / 1000000.0;
+            }
+            if (c.samples >= frames_per_candidate) {
+                if (++current < candidates.size ()) {
+                    size = candidates[current].size;
+                    frame = 0;
+                    changed = true;
+                }
+                else
+                    finish ();
+            }
+        }
+    }
+    const bool result = changed;
+    changed = false;
+    return result;
+}
+
+void workgroup_tuner::write_begin (VkCommandBuffer z_command_buffer) {
+    if (!tuning)
+        return;
+    vkCmdResetQueryPool (z_command_buffer, query_pool, 0, 2);
+    vkCmdWriteTimestamp (z_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+}
+
+void workgroup_tuner::write_end (VkCommandBuffer z_command_buffer) {
+    if (!tuning)
+        return;
+    vkCmdWriteTimestamp (z_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+}
+
+void workgroup_tuner::start () {
+    if (query_pool == VK_NULL_HANDLE || candidates.empty ())
+        return;
+    for (auto& c : candidates) {
+        c.samples = 0;
+        c.total_ms = 0.0;
+    }
+    tuning = true;
+    current = 0;
+    frame = 0;
+    size = candidates[current].size;
+    changed = true;
+}
+
+void workgroup_tuner::finish () {
+    tuning = false;
+    const auto best = std::min_element (candidates.begin (), candidates.end (), [] (const candidate& l, const candidate& r) {
+        return l.average_ms () < r.average_ms ();
+    });
+    size = best->size;
+    changed = true;
+    choices[key] = best->size;
+    save ();
+}
+
+// one line per choice: <key> <width> <height>
+void workgroup_tuner::load () {
+    if (cache_path.empty ())
+        return;
+    std::ifstream file (cache_path);
+    std::string line;
+    while (std::getline (file, line)) {
+        unsigned long long k = 0;
+        uint32_t w = 0, h = 0;
+        if (sscanf (line.c_str (), "%llx %u %u", &k, &w, &h) == 3 && w > 0 && h > 0)
+            choices[(uint64_t) k] = { w, h };
+    }
+}
+
+void workgroup_tuner::save () const {
+    if (cache_path.empty ())
+        return;
+    std::string contents;
+    char line[64];
+    for (const auto& choice : choices) {
+        snprintf (line, sizeof (line), "%016llx %u %u\n", (unsigned long long) choice.first, choice.second.width, choice.second.height);
+        contents += line;
+    }
+    sge::utils::write_file_atomic (cache_path.c_str (), contents.data (), contents.size ());
+}
+
+void workgroup_tuner::debug_ui () {
+    ImGui::Text ("Workgroup size autotune");
+    if (query_pool == VK_NULL_HANDLE) {
+        ImGui::BulletText ("Unavailable, the compute queue doesn't support timestamps.");
+        return;
+    }
+    if (tuning)
+        ImGui::BulletText ("Timing %ux%u (%u of %u)", size->width, size->height, current + 1, (uint32_t) candidates.size ());
+    else if (size.has_value ())
+        ImGui::BulletText ("Using %ux%u", size->width, size->height);
+    for (const auto& c : candidates)
+        if (c.samples)
+            ImGui::BulletText ("%ux%u: %.3f ms", c.size.width, c.size.height, c.average_ms ());
+    if (!tuning && ImGui::Button ("Retune")) {
+        choices.erase (key);
+        start ();
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+// SGE-VK-WORKGROUP-TUNER
+// ---------------------------------- //
+// Picks the fastest workgroup size for
+// the compute shader on this device.
+// ---------------------------------- //
+// * Only applies to shaders whose local size is specialized (see sge::app::content::workgroup_size_ids).
+// * Each candidate size is dispatched for a number of frames and timed with GPU timestamps, the fastest is kept and
+//   written to a per-device file alongside the pipeline cache so later launches skip straight to it.
+// * Choices are keyed by the shader code and specialization constants, so editing the shader retunes it.
+
+#pragma once
+
+#include "sge.hh"
+#include "sge_vk_utils.hh"
+#include "sge_vk_context.hh"
+
+namespace sge::vk {
+
+class workgroup_tuner {
+public:
+    // `cache_path` is the base path of the pipeline cache, empty disables persistence.
+    workgroup_tuner (const struct context&, const struct queue_identifier&, const std::string& cache_path, int frames_per_candidate);
+    ~workgroup_tuner ();
+
+    // the shader (& specialization) now being dispatched, uses its cached choice or starts tuning it.
+    void                                select                                  (uint64_t key);
+
+    // the size to dispatch with, either the choice for the selected shader or the candidate being timed.
+    std::optional<VkExtent2D>           get_workgroup_size                      () const;
+
+    // called once per frame before the command buffer could be re-recorded, reads back the timing of the last frame,
+    // returns true if the size to dispatch with has changed.
+    bool                                update                                  ();
+
+    // brackets the dispatch whilst tuning.
+    void                                write_begin                             (VkCommandBuffer);
+    void                                write_end                               (VkCommandBuffer);
+
+    void                                debug_ui                                ();
+
+private:
+    struct candidate {
+        VkExtent2D                      size;
+        uint32_t                        samples = 0;
+        double                          total_ms = 0.0;
+
+        float average_ms () const { return samples ? (float) (total_ms / samples) : 0.0f; }
+    };
+
+    const context&                      context;
+    const std::string                   cache_path; // per device, empty if not persisted.
+    const uint32_t                      frames_per_candidate;
+    const uint32_t                      warmup_frames = 2; // not timed after a change, whilst caches & clocks settle.
+
+    VkQueryPool                         query_pool = VK_NULL_HANDLE; // null if the queue can't write timestamps.
+    float                               timestamp_period = 1.0f; // nanoseconds per tick.
+    uint64_t                            timestamp_mask = ~0ull;
+
+    std::unordered_map<uint64_t, VkExtent2D> choices;
+    std::vector<candidate>              candidates;
+    uint64_t                            key = 0;
+    std::optional<VkExtent2D>           size;
+    bool                                tuning = false;
+    bool                                changed = false;
+    uint32_t                            current = 0; // candidate being timed.
+    uint32_t                            frame = 0; // frames since the current candidate was set.
+
+    void                                start                                   ();
+    void                                finish                                  ();
+    void                                load                                    ();
+    void                                save                                    () const;
+};
+
+}